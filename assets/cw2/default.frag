@@ -1,5 +1,15 @@
 #version 430
 
+// Variants (see ShaderPermutations), selected with preprocessor definitions:
+//  - TEXTURED 0/1: base color from the vertex color or the texture. If not
+//    defined, each object's material decides at run time.
+//  - MAX_POINT_LIGHTS n: at most n point lights per fragment; 0 skips the
+//    cluster lookup entirely. Unlimited if not defined.
+//  - FOG: exponential distance fog towards the clear color.
+#ifndef FOG_DENSITY
+#define FOG_DENSITY 0.02
+#endif
+
 // Input attributes (from vertex shader)
 in vec3 v2fColor;         // Vertex color
 in vec3 v2fNormal;        // Vertex normal
@@ -9,7 +19,11 @@ in vec3 v2fKd;            // Diffuse reflectivity (Kd)
 in vec3 v2fKs;            // Specular reflectivity (Ks)
 in float v2fNs;           // Shininess (Ns)
 in vec3 v2fKe;            // Emission (Ke)
-in vec3 v2fPosition;      // Vertex position
+in vec3 v2fPosition;      // Vertex position (world space)
+in vec3 v2fToEye;         // To the camera (world space)
+in vec4 v2fClip;          // Clip space position
+flat in uint v2fView;     // Frame view
+flat in uint v2fUseTexture; // Use texture instead of the vertex color
 
 
 // Uniforms
@@ -17,20 +31,28 @@ layout(location = 2) uniform vec3 uDirLightDir;          // Light direction (wor
 layout(location = 3) uniform vec3 uDirLightDiffuse;      // Light diffuse color/intensity
 layout(location = 4) uniform vec3 uSceneAmbient;      // Ambient light color/intensity
 layout(binding = 0) uniform sampler2D uTexture;       // Texture sampler
-layout(location = 5) uniform bool uUseTexture;        // Flag to use texture
 
-// Point Light structs and uniforms
+// Point lights, binned into clusters of the view frustum on the CPU (see
+// light_clusters.hpp)
 struct PointLight {
-    vec3 position;  // 12 bytes + 4 bytes padding
-    float padding1; // Not explicitly required in GLSL, but aligns
-    vec3 color;     // 12 bytes + 4 bytes padding
-    float padding2; // Not explicitly required in GLSL
-    vec3 normal;    // 12 bytes + 4 bytes padding
-    float radius;   // Aligned at 4 bytes
+    vec3 position;  // World space
+    float range;    // No light beyond this distance
+    vec3 color;
+    float radius;   // Half intensity at this distance
+};
+
+layout(std430, binding = 4) readonly buffer LightBlock {
+    PointLight uLights[];
+};
+
+layout(std430, binding = 5) readonly buffer ClusterBlock {
+    uvec4 uClusterDims;   // Tiles x, y, depth slices, clusters per view
+    vec4 uClusterDepth;   // x, y: slice = log(depth) * x + y
+    uvec2 uClusters[];    // Per cluster: offset and count of its light indices
 };
 
-layout(std140, binding = 1) uniform PointLightBlock {
-    PointLight lights[3];
+layout(std430, binding = 6) readonly buffer LightIndexBlock {
+    uint uLightIndices[];
 };
 
 out vec3 oColor;
@@ -49,8 +71,11 @@ vec3 calculatePointLight(PointLight light, vec3 normal, vec3 viewDir, vec3 posit
     float distance = length(lightDir);
     lightDir = normalize(lightDir);
 
-    // Attenuation
+    // Attenuation, windowed so that the light ends at its range (lights
+    // are only assigned to the clusters within range)
     float attenuation = 1.0 / (1.0 + (distance * distance) / (light.radius * light.radius));
+    float window = clamp(1.0 - pow(distance / light.range, 4.0), 0.0, 1.0);
+    attenuation *= window * window;
 
     // Diffuse
     float diff = max(dotProduct(normal, lightDir), 0.0);
@@ -66,10 +91,27 @@ vec3 calculatePointLight(PointLight light, vec3 normal, vec3 viewDir, vec3 posit
     return (diffuse + specular);
 }
 
+// Cluster of the fragment: the tile from its NDC position, the slice from
+// its view depth (clip w)
+uint clusterIndex() {
+    vec2 tiles = vec2(uClusterDims.xy);
+    vec2 ndc = v2fClip.xy / v2fClip.w;
+    uvec2 tile = uvec2(clamp(floor((ndc * 0.5 + 0.5) * tiles), vec2(0.0), tiles - 1.0));
+    float slice = clamp(floor(log(v2fClip.w) * uClusterDepth.x + uClusterDepth.y), 0.0, float(uClusterDims.z - 1u));
+
+    return v2fView * uClusterDims.w + (uint(slice) * uClusterDims.y + tile.y) * uClusterDims.x + tile.x;
+}
+
 void main() {
     vec3 normal = normalize(v2fNormal);
-    vec3 baseColor = uUseTexture ? texture(uTexture, v2fTexCoord).rgb : v2fColor;
-    vec3 viewDir = normalize(-v2fPosition);
+#if !defined(TEXTURED)
+    vec3 baseColor = v2fUseTexture != 0u ? texture(uTexture, v2fTexCoord).rgb : v2fColor;
+#elif TEXTURED
+    vec3 baseColor = texture(uTexture, v2fTexCoord).rgb;
+#else
+    vec3 baseColor = v2fColor;
+#endif
+    vec3 viewDir = normalize(v2fToEye);
 
     // Ambient lighting
     vec3 ambient = v2fKa * uSceneAmbient;
@@ -82,11 +124,17 @@ void main() {
     float dirSpec = pow(max(dotProduct(normal, dirHalfwayDir), 0.0), v2fNs);
     vec3 dirSpecular = v2fKs * uDirLightDiffuse * dirSpec;
 
-    // Accumulate point lights
+    // Accumulate the point lights of the fragment's cluster
     vec3 pointLighting = vec3(0.0);
-    for(int i = 0; i < 3; i++) {
-        pointLighting += calculatePointLight(lights[i], normal, viewDir, v2fPosition);
+#if !defined(MAX_POINT_LIGHTS) || MAX_POINT_LIGHTS > 0
+    uvec2 cluster = uClusters[clusterIndex()];
+#if defined(MAX_POINT_LIGHTS)
+    cluster.y = min(cluster.y, uint(MAX_POINT_LIGHTS));
+#endif
+    for(uint i = 0u; i < cluster.y; i++) {
+        pointLighting += calculatePointLight(uLights[uLightIndices[cluster.x + i]], normal, viewDir, v2fPosition);
     }
+#endif
 
     // Emission
     vec3 emission = v2fKe;
@@ -94,6 +142,12 @@ void main() {
     // Combine all lighting components
     vec3 lighting = ambient + dirDiffuse + dirSpecular + pointLighting + emission;
     oColor = lighting * baseColor;
+
+#if defined(FOG)
+    // Clip w is the view depth; the fog color matches glClearColor()
+    float fog = exp(-FOG_DENSITY * v2fClip.w);
+    oColor = mix(vec3(0.2), oColor, fog);
+#endif
     // Debugging options (uncomment one if needed)
     // oColor = normal;                                                 // Visualize normals
     // oColor = vec3(v2fTexCoord[0], v2fTexCoord[1], 0.0);              // Visualize texture coordinates
@@ -1,5 +1,10 @@
 #version 430
 
+// Vertex shaders may select the viewport on most drivers; without either
+// extension, main.cpp draws one view at a time (only view 0 is used)
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_viewport_index : enable
+
 // Input data
 layout( location = 0 ) in vec3 iPosition;  // Vertex position (x, y, z)
 layout( location = 1 ) in vec3 iColor;     // Vertex color
@@ -10,12 +15,45 @@ layout( location = 5 ) in vec3 iKd;
 layout( location = 6 ) in vec3 iKs;
 layout( location = 7 ) in float iNs;
 layout( location = 8 ) in vec3 iKe;
+layout( location = 9 ) in uint iObjectIndex; // Per instance; selected by the base instance
+
+// Per-view data (see frame_uniforms.hpp). Each object is instanced once per
+// view; instance i is drawn into view i % uViewCount.
+struct CameraData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+
+layout( std140, binding = 2 ) uniform CameraBlock
+{
+    CameraData uViews[8];
+    uint uViewCount;
+    uint uFirstView;  // Frame view of uViews[0]; selects the visibility bit
+};
+
+// Per-object transforms and material, written once per frame
+struct ObjectData
+{
+    mat4 model;
+    mat4 normal;      // Upper 3x3: normal matrix
+    vec4 texRange;    // xy: min X and Z, zw: diff X and Z
+    vec4 palette[3];  // xyz: colors weighted by the vertex color's channels
+    uint useTexture;
+};
 
-// Uniforms
-layout( location = 0 ) uniform mat4 uProjCameraWorld; // Projection and camera matrix
-layout( location = 1 ) uniform mat3 uNormalMatrix;    // Normal matrix for transforming normals
-layout( location = 6 ) uniform vec2 uMin;            // Min X and Z
-layout( location = 7 ) uniform vec2 uDiff;           // Diff X and Z
+layout( std430, binding = 0 ) readonly buffer ObjectBlock
+{
+    ObjectData uObjects[];
+};
+
+// Per-object visibility masks from culling, one byte per object; bit v is
+// set if the object is visible in frame view v
+layout( std430, binding = 3 ) readonly buffer VisibilityBlock
+{
+    uint uVisibility[];
+};
 
 // Output attributes to the fragment shader
 out vec3 v2fColor;    // Interpolated color
@@ -26,19 +64,30 @@ out vec3 v2fKd;       // Diffuse reflectivity (passed to fragment shader)
 out vec3 v2fKs;       // Specular reflectivity (passed to fragment shader)
 out float v2fNs;      // Shininess (passed to fragment shader)
 out vec3 v2fKe;       // Emission (passed to fragment shader)
-out vec3 v2fPosition;       // Vetex position
+out vec3 v2fPosition;       // Vertex position (world space)
+out vec3 v2fToEye;          // From the vertex to the camera (world space)
+out vec4 v2fClip;           // Clip space position; selects the light cluster
+flat out uint v2fView;      // Frame view
+flat out uint v2fUseTexture; // Use texture instead of the vertex color
+
+// Depth must match the pre-pass (depth.vert) exactly; see renderScene()
+invariant gl_Position;
 
 void main()
 {
-    // Copy input color to the output color attribute
-    v2fColor = iColor;
+    ObjectData xform = uObjects[iObjectIndex];
+
+    // Vertex color, through the object's palette
+    v2fColor = mat3(xform.palette[0].xyz, xform.palette[1].xyz, xform.palette[2].xyz) * iColor;
+    vec2 texMin = xform.texRange.xy;
+    vec2 texDiff = xform.texRange.zw;
 
     // Apply normal matrix to the normal and pass it as output
-    v2fNormal = normalize(uNormalMatrix * iNormal);
+    v2fNormal = normalize(mat3(xform.normal) * iNormal);
 
     // Calculate texture coordinates, clamping for safety
-    float u = uDiff.x != 0.0 ? (iPosition.x - uMin.x) / uDiff.x : 0.0;
-    float v = uDiff.y != 0.0 ? (iPosition.z - uMin.y) / uDiff.y : 0.0;
+    float u = texDiff.x != 0.0 ? (iPosition.x - texMin.x) / texDiff.x : 0.0;
+    float v = texDiff.y != 0.0 ? (iPosition.z - texMin.y) / texDiff.y : 0.0;
     v2fTexCoord = vec2(clamp(u, 0.0, 1.0), clamp(v, 0.0, 1.0));
 
     // Pass the material properties to the fragment shader
@@ -47,10 +96,29 @@ void main()
     v2fKs = iKs;
     v2fNs = iNs;
     v2fKe = iKe;
+    v2fUseTexture = xform.useTexture;
+
+    uint view = uint(gl_InstanceID) % uViewCount;
+#if defined(GL_ARB_shader_viewport_layer_array) || defined(GL_AMD_vertex_shader_viewport_index)
+    gl_ViewportIndex = int(view);
+#endif
 
+    // Lighting is done in world space
+    vec4 world = xform.model * vec4(iPosition, 1.0);
+    mat4 camera = uViews[view].view;
+    vec3 eye = -(transpose(mat3(camera)) * camera[3].xyz);
 
-    v2fPosition = iPosition;
+    v2fPosition = world.xyz;
+    v2fToEye = eye - world.xyz;
+    v2fView = uFirstView + view;
 
     // Apply the projection-camera-world transformation to the vertex position
-    gl_Position = uProjCameraWorld * vec4(iPosition, 1.0);
+    gl_Position = uViews[view].viewProjection * world;
+    v2fClip = gl_Position;
+
+    // Draws cover all views an object is visible in; move the vertices out
+    // of the clip volume in the other views, so the triangles are clipped
+    uint visibility = (uVisibility[iObjectIndex >> 2] >> ((iObjectIndex & 3u) * 8u)) & 0xffu;
+    if( 0u == (visibility & (1u << (uFirstView + view))) )
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
 }
\ No newline at end of file
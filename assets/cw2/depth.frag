@@ -0,0 +1,6 @@
+#version 430
+
+// Depth pre-pass: depth only, color writes are masked
+void main()
+{
+}
@@ -0,0 +1,61 @@
+#version 430
+
+// Depth pre-pass: positions only, see GeometryArena::bind_depth(). Must
+// compute gl_Position exactly as default.vert does, since the main pass then
+// tests with GL_EQUAL.
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_viewport_index : enable
+
+layout( location = 0 ) in vec3 iPosition;
+layout( location = 9 ) in uint iObjectIndex;
+
+struct CameraData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+
+layout( std140, binding = 2 ) uniform CameraBlock
+{
+    CameraData uViews[8];
+    uint uViewCount;
+    uint uFirstView;
+};
+
+struct ObjectData
+{
+    mat4 model;
+    mat4 normal;
+    vec4 texRange;
+    vec4 palette[3];
+    uint useTexture;
+};
+
+layout( std430, binding = 0 ) readonly buffer ObjectBlock
+{
+    ObjectData uObjects[];
+};
+
+layout( std430, binding = 3 ) readonly buffer VisibilityBlock
+{
+    uint uVisibility[];
+};
+
+invariant gl_Position;
+
+void main()
+{
+    uint view = uint(gl_InstanceID) % uViewCount;
+#if defined(GL_ARB_shader_viewport_layer_array) || defined(GL_AMD_vertex_shader_viewport_index)
+    gl_ViewportIndex = int(view);
+#endif
+
+    ObjectData xform = uObjects[iObjectIndex];
+    vec4 world = xform.model * vec4(iPosition, 1.0);
+    gl_Position = uViews[view].viewProjection * world;
+
+    uint visibility = (uVisibility[iObjectIndex >> 2] >> ((iObjectIndex & 3u) * 8u)) & 0xffu;
+    if( 0u == (visibility & (1u << (uFirstView + view))) )
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+}
@@ -1,11 +1,40 @@
-#version 330 core
+#version 430
+
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_viewport_index : enable
+
 layout(location = 0) in vec3 position;
 layout(location = 1) in float size;
 
-uniform mat4 uViewProjection;
+// Camera block of the default shader (see default.vert); one instance of
+// the particles is drawn per view
+struct CameraData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+};
+
+layout(std140, binding = 2) uniform CameraBlock
+{
+    CameraData uViews[8];
+    uint uViewCount;
+    uint uFirstView;
+};
+
+layout(location = 1) uniform uint uViewMask; // Frame views the particles are visible in
+layout(location = 2) uniform float uPointScale; // Resolution scale of the scene target
 
 
 void main() {
-    gl_Position = uViewProjection * vec4(position, 1.0);
-    gl_PointSize = size / gl_Position.w; // This makes the size perspective-correct
+    uint view = uint(gl_InstanceID);
+#if defined(GL_ARB_shader_viewport_layer_array) || defined(GL_AMD_vertex_shader_viewport_index)
+    gl_ViewportIndex = int(view);
+#endif
+
+    gl_Position = uViews[view].viewProjection * vec4(position, 1.0);
+    gl_PointSize = uPointScale * size / gl_Position.w; // This makes the size perspective-correct
+
+    if ((uViewMask & (1u << (uFirstView + view))) == 0u)
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
 }
\ No newline at end of file
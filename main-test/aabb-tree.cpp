@@ -0,0 +1,210 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/aabb_tree.hpp"
+
+#include <random>
+#include <numbers>
+#include <algorithm>
+
+#include "../vmlib/mat44.hpp"
+
+namespace
+{
+    Aabb random_box_( std::mt19937& aRng )
+    {
+        std::uniform_real_distribution<float> pos( -100.f, 100.f );
+        std::uniform_real_distribution<float> size( 0.1f, 3.f );
+
+        Vec3f const c{ pos( aRng ), pos( aRng ), pos( aRng ) };
+        Vec3f const e{ size( aRng ), size( aRng ), size( aRng ) };
+        return Aabb{ c - e, c + e };
+    }
+
+    Frustum frustum_( Vec3f aEye, float aYaw )
+    {
+        Mat44f const proj = make_perspective_projection( 60.f * std::numbers::pi_v<float> / 180.f, 1.5f, 0.1f, 80.f );
+        Mat44f const view = make_rotation_y( -aYaw ) * make_translation( -aEye );
+        return make_frustum( proj * view );
+    }
+
+    struct Scene_
+    {
+        AabbTree tree;
+        std::vector<std::int32_t> proxies;  // By user data; kNull if removed
+    };
+
+    Scene_ make_scene_( std::size_t aCount, std::mt19937& aRng )
+    {
+        Scene_ scene;
+        for( std::size_t i = 0; i < aCount; ++i )
+            scene.proxies.emplace_back( scene.tree.insert( random_box_( aRng ), std::uint32_t(i) ) );
+        return scene;
+    }
+}
+
+TEST_CASE( "AABB tree structure", "[aabb_tree]" )
+{
+    std::mt19937 rng( 3 );
+    auto scene = make_scene_( 2000, rng );
+
+    REQUIRE( scene.tree.size() == 2000 );
+    REQUIRE_NOTHROW( scene.tree.validate() );
+
+    // Balanced: far from the height of a degenerate list
+    REQUIRE( scene.tree.height() < 32 );
+
+    SECTION( "Remove" )
+    {
+        for( std::size_t i = 0; i < scene.proxies.size(); i += 2 )
+        {
+            scene.tree.remove( scene.proxies[i] );
+            scene.proxies[i] = AabbTree::kNull;
+        }
+
+        REQUIRE( scene.tree.size() == 1000 );
+        REQUIRE_NOTHROW( scene.tree.validate() );
+        REQUIRE_THROWS( scene.tree.remove( AabbTree::kNull ) );
+
+        // Freed nodes are reused
+        for( std::size_t i = 0; i < 1000; ++i )
+            scene.tree.insert( random_box_( rng ), 0 );
+        REQUIRE( scene.tree.size() == 2000 );
+        REQUIRE_NOTHROW( scene.tree.validate() );
+    }
+
+    SECTION( "Move" )
+    {
+        // Small moves stay within the fat box
+        auto const fat = scene.tree.fat_bounds( scene.proxies[7] );
+        REQUIRE( !scene.tree.move( scene.proxies[7], expand( fat, -0.05f ) ) );
+
+        std::size_t reinserted = 0;
+        for( int frame = 0; frame < 20; ++frame )
+        {
+            for( auto const proxy : scene.proxies )
+                reinserted += scene.tree.move( proxy, random_box_( rng ) );
+        }
+
+        REQUIRE( reinserted > 0 );
+        REQUIRE( scene.tree.size() == 2000 );
+        REQUIRE_NOTHROW( scene.tree.validate() );
+        REQUIRE( scene.tree.height() < 32 );
+    }
+}
+
+TEST_CASE( "AABB tree queries", "[aabb_tree]" )
+{
+    std::mt19937 rng( 11 );
+    auto scene = make_scene_( 5000, rng );
+
+    SECTION( "Batched frustum query" )
+    {
+        Frustum const frustums[2] = {
+            frustum_( { 0.f, 0.f, 0.f }, 0.f ),
+            frustum_( { 10.f, 5.f, -20.f }, 2.f )
+        };
+
+        std::vector<std::uint32_t> masks( scene.proxies.size(), 0 );
+        scene.tree.query( frustums, 2, [&] ( std::uint32_t aUser, std::uint32_t aMask ) {
+            REQUIRE( 0 == masks[aUser] ); // Each leaf is reported once
+            masks[aUser] = aMask;
+        } );
+
+        std::size_t hits[2] = {};
+        for( std::size_t i = 0; i < scene.proxies.size(); ++i )
+        {
+            Aabb const& box = scene.tree.fat_bounds( scene.proxies[i] );
+            for( std::uint32_t v = 0; v < 2; ++v )
+            {
+                bool const expected = intersects( frustums[v], box );
+                REQUIRE( bool(masks[i] & (1u << v)) == expected );
+                hits[v] += expected;
+            }
+        }
+
+        REQUIRE( hits[0] > 0 );
+        REQUIRE( hits[1] > 0 );
+        REQUIRE( hits[0] < scene.proxies.size() );
+    }
+
+    SECTION( "Parallel frustum query" )
+    {
+        REQUIRE( scene.tree.size() >= AabbTree::kParallelQueryLeaves );
+
+        Frustum const frustums[3] = {
+            frustum_( { 0.f, 0.f, 0.f }, 0.f ),
+            frustum_( { 10.f, 5.f, -20.f }, 2.f ),
+            frustum_( { -40.f, 0.f, 30.f }, -1.f )
+        };
+
+        std::vector<std::uint32_t> expected( scene.proxies.size(), 0 );
+        scene.tree.query( frustums, 3, [&] ( std::uint32_t aUser, std::uint32_t aMask ) {
+            expected[aUser] = aMask;
+        } );
+
+        // Called from several threads; each leaf writes its own elements
+        std::vector<std::uint32_t> masks( scene.proxies.size(), 0 );
+        std::vector<std::uint32_t> reports( scene.proxies.size(), 0 );
+        scene.tree.parallel_query( frustums, 3, [&] ( std::uint32_t aUser, std::uint32_t aMask ) {
+            masks[aUser] = aMask;
+            ++reports[aUser];
+        } );
+
+        REQUIRE( masks == expected );
+        REQUIRE( std::all_of( reports.begin(), reports.end(), [] ( std::uint32_t aCount ) { return aCount <= 1; } ) );
+        REQUIRE( std::count( reports.begin(), reports.end(), 1u ) > 0 );
+    }
+
+    SECTION( "Ray cast" )
+    {
+        for( int i = 0; i < 50; ++i )
+        {
+            Aabb const target = scene.tree.fat_bounds( scene.proxies[std::size_t(i) * 97] );
+            Vec3f const origin{ -150.f, float(i) - 25.f, 20.f };
+            Vec3f const dir = center( target ) - origin;
+            Vec3f const inv{ 1.f / dir.x, 1.f / dir.y, 1.f / dir.z };
+
+            // Hit distance is the entry distance of the box
+            auto const hit = scene.tree.raycast( origin, dir, 10.f, [] ( std::uint32_t, float aEntry ) {
+                return aEntry;
+            } );
+
+            float best = std::numeric_limits<float>::max();
+            for( auto const proxy : scene.proxies )
+            {
+                float t = 0.f;
+                if( intersect_ray( scene.tree.fat_bounds( proxy ), origin, inv, 10.f, t ) )
+                    best = std::min( best, t );
+            }
+
+            REQUIRE( AabbTree::kNull != hit.proxy );
+            REQUIRE( hit.distance == Catch::Approx( best ) );
+        }
+
+        // Away from everything
+        auto const miss = scene.tree.raycast( { 0.f, 500.f, 0.f }, { 0.f, 1.f, 0.f }, 1000.f, [] ( std::uint32_t, float aEntry ) {
+            return aEntry;
+        } );
+        REQUIRE( AabbTree::kNull == miss.proxy );
+    }
+
+    SECTION( "Nearest" )
+    {
+        std::uniform_real_distribution<float> pos( -120.f, 120.f );
+        for( int i = 0; i < 50; ++i )
+        {
+            Vec3f const p{ pos( rng ), pos( rng ), pos( rng ) };
+
+            std::int32_t const nearest = scene.tree.nearest( p );
+            REQUIRE( AabbTree::kNull != nearest );
+
+            float best = std::numeric_limits<float>::max();
+            for( auto const proxy : scene.proxies )
+                best = std::min( best, distance_squared( scene.tree.fat_bounds( proxy ), p ) );
+
+            REQUIRE( distance_squared( scene.tree.fat_bounds( nearest ), p ) == Catch::Approx( best ) );
+        }
+
+        REQUIRE( AabbTree::kNull == scene.tree.nearest( { 1000.f, 1000.f, 1000.f }, 10.f ) );
+    }
+}
@@ -0,0 +1,91 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/dynamic_resolution.hpp"
+
+#include <cmath>
+
+namespace
+{
+    // A scene whose GPU time is proportional to its pixel count
+    float run_( ResolutionController& aController, double aCostPerArea, int aFrames )
+    {
+        for( int i = 0; i < aFrames; ++i )
+        {
+            float const scale = aController.scale();
+            aController.update( aCostPerArea * scale * scale, scale );
+        }
+        return aController.scale();
+    }
+}
+
+TEST_CASE( "Resolution scale meets the GPU time target", "[dynamic-resolution]" )
+{
+    ResolutionController controller( 10.f, 0.5f, 1.f );
+    REQUIRE( controller.scale() == 1.f );
+
+    SECTION( "Within budget" )
+    {
+        REQUIRE( run_( controller, 8.0, 50 ) == 1.f );
+    }
+
+    SECTION( "Over budget" )
+    {
+        // 20 ms at full resolution: half the pixels
+        float const scale = run_( controller, 20.0, 50 );
+        REQUIRE( scale == Catch::Approx( std::sqrt( 0.5f ) ).margin( ResolutionController::kDeadband ) );
+        REQUIRE( 20.0 * scale * scale <= 10.0 + 1e-3 );
+    }
+
+    SECTION( "Clamped to the minimum" )
+    {
+        REQUIRE( run_( controller, 100.0, 50 ) == 0.5f );
+    }
+
+    SECTION( "Recovers gradually" )
+    {
+        run_( controller, 40.0, 50 );
+        REQUIRE( controller.scale() == 0.5f );
+
+        // One frame of a cheap scene does not restore full resolution
+        controller.update( 1.0 * 0.25, 0.5f );
+        REQUIRE( controller.scale() <= 0.5f + ResolutionController::kMaxStepUp );
+
+        REQUIRE( run_( controller, 1.0, 100 ) == 1.f );
+    }
+}
+
+TEST_CASE( "Late GPU timings are tagged with their scale", "[dynamic-resolution]" )
+{
+    ResolutionController controller( 10.f, 0.25f, 1.f );
+
+    // Results that arrive after the scale changed: the cost per area is
+    // the same, so the estimate stays put
+    controller.update( 20.0, 1.f );
+    float const scale = controller.scale();
+    controller.update( 20.0, 1.f );
+    REQUIRE( controller.scale() == Catch::Approx( scale ) );
+
+    controller.update( 20.0 * scale * scale, scale );
+    REQUIRE( controller.scale() == Catch::Approx( scale ) );
+
+    // Invalid timings are ignored
+    controller.update( 0.0, 1.f );
+    REQUIRE( controller.scale() == Catch::Approx( scale ) );
+
+    controller.reset();
+    REQUIRE( controller.scale() == 1.f );
+}
+
+TEST_CASE( "Scaled sizes are at least one pixel", "[dynamic-resolution]" )
+{
+    REQUIRE( scaled_size( 1280, 0.5f ) == 640 );
+    REQUIRE( scaled_size( 719, 1.f ) == 719 );
+    REQUIRE( scaled_size( 1, 0.5f ) == 1 );
+}
+
+TEST_CASE( "Scene target stores sRGB color", "[dynamic-resolution]" )
+{
+    // Same encoding as the default framebuffer with GL_FRAMEBUFFER_SRGB; a
+    // linear 8 bit target bands in dark gradients
+    STATIC_REQUIRE( kSceneTargetColorFormat == GL_SRGB8_ALPHA8 );
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/fixed_timestep.hpp"
+
+#include <numbers>
+
+TEST_CASE( "Fixed steps do not depend on the frame rate", "[fixed-timestep]" )
+{
+    // One simulated second at different frame rates
+    float const frameRate = GENERATE( 30.f, 60.f, 144.f, 1000.f );
+
+    FixedTimestep clock( 0.01f );
+    std::size_t steps = 0;
+    for( int i = 0; i < int(frameRate); ++i )
+        steps += clock.advance( 1.f / frameRate );
+
+    // Rounding may leave the last step in the accumulator
+    REQUIRE( steps >= 99 );
+    REQUIRE( steps <= 100 );
+    REQUIRE( clock.alpha() >= 0.f );
+    REQUIRE( clock.alpha() < 1.f );
+    REQUIRE( clock.dropped() == 0 );
+}
+
+TEST_CASE( "Long frames drop steps", "[fixed-timestep]" )
+{
+    FixedTimestep clock( 0.01f, 4 );
+
+    REQUIRE( clock.advance( 0.025f ) == 2 );
+    REQUIRE( clock.alpha() == Catch::Approx( 0.5f ) );
+
+    // A one second stall runs four steps, the rest is dropped
+    REQUIRE( clock.advance( 1.f ) == 4 );
+    REQUIRE( clock.dropped() == 96 );
+    REQUIRE( clock.alpha() == Catch::Approx( 0.5f ).margin( 1e-3 ) );
+
+    REQUIRE( clock.advance( 0.f ) == 0 );
+    REQUIRE( clock.advance( -1.f ) == 0 );
+}
+
+TEST_CASE( "Rigid transforms interpolate without scaling", "[fixed-timestep]" )
+{
+    float const angle = std::numbers::pi_v<float> / 8.f;
+    Mat44f const from = make_translation( { 1.f, 0.f, 0.f } );
+    Mat44f const to = make_translation( { 3.f, 2.f, 0.f } ) * make_rotation_z( angle );
+
+    Mat44f const mid = interpolate_rigid( from, to, 0.5f );
+
+    REQUIRE( mid( 0, 3 ) == Catch::Approx( 2.f ) );
+    REQUIRE( mid( 1, 3 ) == Catch::Approx( 1.f ) );
+
+    // Half the rotation, and orthonormal
+    Mat44f const expected = make_rotation_z( 0.5f * angle );
+    for( std::size_t i = 0; i < 3; ++i )
+    {
+        for( std::size_t j = 0; j < 3; ++j )
+            REQUIRE( mid( i, j ) == Catch::Approx( expected( i, j ) ).margin( 1e-3 ) );
+    }
+
+    // The ends are exact
+    Mat44f const end = interpolate_rigid( from, to, 1.f );
+    for( std::size_t i = 0; i < 16; ++i )
+        REQUIRE( end.v[i] == Catch::Approx( to.v[i] ).margin( 1e-5 ) );
+}
@@ -0,0 +1,107 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/bounds.hpp"
+#include "../main/frustum_cull.hpp"
+
+#include <random>
+#include <numbers>
+
+#include "../vmlib/mat44.hpp"
+
+namespace
+{
+    // Camera at the origin, looking down -z
+    Frustum test_frustum_()
+    {
+        Mat44f const proj = make_perspective_projection( 60.f * std::numbers::pi_v<float> / 180.f, 1.f, 0.1f, 100.f );
+        return make_frustum( proj );
+    }
+
+    Aabb box_at_( Vec3f aCenter, float aHalf )
+    {
+        Vec3f const e{ aHalf, aHalf, aHalf };
+        return Aabb{ aCenter - e, aCenter + e };
+    }
+}
+
+TEST_CASE( "Aabb transform", "[bounds]" )
+{
+    Aabb const box{ { -1.f, -2.f, -3.f }, { 1.f, 2.f, 3.f } };
+
+    SECTION( "Translation" )
+    {
+        auto const moved = transform_aabb( box, make_translation( { 5.f, 0.f, -1.f } ) );
+        REQUIRE( moved.min.x == Catch::Approx( 4.f ) );
+        REQUIRE( moved.max.x == Catch::Approx( 6.f ) );
+        REQUIRE( moved.min.z == Catch::Approx( -4.f ) );
+        REQUIRE( moved.max.z == Catch::Approx( 2.f ) );
+    }
+
+    SECTION( "Rotation" )
+    {
+        // A quarter turn around y swaps the x and z extents
+        auto const turned = transform_aabb( box, make_rotation_y( std::numbers::pi_v<float> / 2.f ) );
+        REQUIRE( turned.min.x == Catch::Approx( -3.f ) );
+        REQUIRE( turned.max.x == Catch::Approx( 3.f ) );
+        REQUIRE( turned.min.y == Catch::Approx( -2.f ) );
+        REQUIRE( turned.max.z == Catch::Approx( 1.f ) );
+    }
+
+    SECTION( "Empty" )
+    {
+        REQUIRE( is_empty( transform_aabb( Aabb{}, make_translation( { 1.f, 1.f, 1.f } ) ) ) );
+    }
+}
+
+TEST_CASE( "Frustum culling", "[frustum_cull]" )
+{
+    Frustum const frustum = test_frustum_();
+
+    SECTION( "Single boxes" )
+    {
+        REQUIRE( intersects( frustum, box_at_( { 0.f, 0.f, -10.f }, 1.f ) ) );
+        REQUIRE( !intersects( frustum, box_at_( { 0.f, 0.f, 10.f }, 1.f ) ) );   // Behind
+        REQUIRE( !intersects( frustum, box_at_( { 0.f, 0.f, -200.f }, 1.f ) ) ); // Beyond far
+        REQUIRE( !intersects( frustum, box_at_( { 50.f, 0.f, -10.f }, 1.f ) ) ); // Right
+        REQUIRE( intersects( frustum, box_at_( { 0.f, 0.f, 0.f }, 1.f ) ) );     // Straddles near
+        REQUIRE( !intersects( frustum, Aabb{} ) );
+    }
+
+    SECTION( "Batch matches single tests" )
+    {
+        // Large enough to take the multi-threaded path
+        std::size_t const count = 3 * kParallelCullThreshold + 17;
+
+        std::mt19937 rng( 7 );
+        std::uniform_real_distribution<float> pos( -150.f, 150.f );
+        std::uniform_real_distribution<float> size( 0.f, 5.f );
+
+        CullVolumes volumes;
+        volumes.resize( count );
+
+        std::vector<Aabb> boxes;
+        for( std::size_t i = 0; i < count; ++i )
+        {
+            boxes.emplace_back( i % 101 == 0 ? Aabb{} : box_at_( { pos( rng ), pos( rng ), pos( rng ) }, size( rng ) ) );
+            volumes.set( i, boxes.back() );
+        }
+
+        std::vector<std::uint8_t> visible;
+        auto const stats = frustum_cull( frustum, volumes, visible );
+
+        REQUIRE( visible.size() == count );
+        REQUIRE( stats.visible + stats.culled == count );
+
+        std::size_t expected = 0;
+        for( std::size_t i = 0; i < count; ++i )
+        {
+            bool const single = intersects( frustum, boxes[i] );
+            REQUIRE( bool(visible[i]) == single );
+            expected += single;
+        }
+
+        REQUIRE( stats.visible == expected );
+        REQUIRE( stats.visible > 0 );
+        REQUIRE( stats.culled > 0 );
+    }
+}
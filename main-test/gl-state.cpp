@@ -0,0 +1,162 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/gl_state.hpp"
+
+#include <vector>
+
+// The cache is exercised without a context: the GL entry points that it
+// uses are replaced by stubs that record the calls.
+namespace
+{
+    std::vector<GLenum> gCalls_;
+
+    void APIENTRY enable_( GLenum aCap ) { gCalls_.emplace_back( aCap ); }
+    void APIENTRY disable_( GLenum aCap ) { gCalls_.emplace_back( aCap ); }
+    void APIENTRY blend_func_( GLenum, GLenum ) { gCalls_.emplace_back( GL_BLEND_SRC ); }
+    void APIENTRY depth_mask_( GLboolean ) { gCalls_.emplace_back( GL_DEPTH_WRITEMASK ); }
+    void APIENTRY color_mask_( GLboolean, GLboolean, GLboolean, GLboolean ) { gCalls_.emplace_back( GL_COLOR_WRITEMASK ); }
+    void APIENTRY use_program_( GLuint ) { gCalls_.emplace_back( GL_CURRENT_PROGRAM ); }
+    void APIENTRY bind_vertex_array_( GLuint ) { gCalls_.emplace_back( GL_VERTEX_ARRAY_BINDING ); }
+    void APIENTRY active_texture_( GLenum ) { gCalls_.emplace_back( GL_ACTIVE_TEXTURE ); }
+    void APIENTRY bind_texture_( GLenum, GLuint ) { gCalls_.emplace_back( GL_TEXTURE_BINDING_2D ); }
+
+    struct StubGl_
+    {
+        StubGl_()
+            : enable( glad_glEnable ), disable( glad_glDisable )
+            , blendFunc( glad_glBlendFunc ), depthMask( glad_glDepthMask ), colorMask( glad_glColorMask )
+            , useProgram( glad_glUseProgram ), bindVertexArray( glad_glBindVertexArray )
+            , activeTexture( glad_glActiveTexture ), bindTexture( glad_glBindTexture )
+        {
+            glad_glEnable = &enable_;
+            glad_glDisable = &disable_;
+            glad_glBlendFunc = &blend_func_;
+            glad_glDepthMask = &depth_mask_;
+            glad_glColorMask = &color_mask_;
+            glad_glUseProgram = &use_program_;
+            glad_glBindVertexArray = &bind_vertex_array_;
+            glad_glActiveTexture = &active_texture_;
+            glad_glBindTexture = &bind_texture_;
+            gCalls_.clear();
+        }
+
+        ~StubGl_()
+        {
+            glad_glEnable = enable;
+            glad_glDisable = disable;
+            glad_glBlendFunc = blendFunc;
+            glad_glDepthMask = depthMask;
+            glad_glColorMask = colorMask;
+            glad_glUseProgram = useProgram;
+            glad_glBindVertexArray = bindVertexArray;
+            glad_glActiveTexture = activeTexture;
+            glad_glBindTexture = bindTexture;
+        }
+
+        PFNGLENABLEPROC enable;
+        PFNGLDISABLEPROC disable;
+        PFNGLBLENDFUNCPROC blendFunc;
+        PFNGLDEPTHMASKPROC depthMask;
+        PFNGLCOLORMASKPROC colorMask;
+        PFNGLUSEPROGRAMPROC useProgram;
+        PFNGLBINDVERTEXARRAYPROC bindVertexArray;
+        PFNGLACTIVETEXTUREPROC activeTexture;
+        PFNGLBINDTEXTUREPROC bindTexture;
+    };
+}
+
+TEST_CASE( "GL state cache skips redundant calls", "[gl-state]" )
+{
+    StubGl_ stub;
+    GlStateCache cache;
+
+    SECTION( "Capabilities" )
+    {
+        REQUIRE( cache.enable( GL_BLEND ) );
+        REQUIRE( !cache.enable( GL_BLEND ) );
+        REQUIRE( cache.enable( GL_DEPTH_TEST ) );
+        REQUIRE( cache.disable( GL_BLEND ) );
+        REQUIRE( !cache.set_enabled( GL_BLEND, false ) );
+        REQUIRE( !cache.enable( GL_DEPTH_TEST ) );
+
+        REQUIRE( gCalls_.size() == 3 );
+
+        auto const& stats = cache.frame_stats();
+        REQUIRE( stats.issued[std::size_t(GlStateCall::capability)] == 3 );
+        REQUIRE( stats.skipped[std::size_t(GlStateCall::capability)] == 3 );
+    }
+
+    SECTION( "Blend function and write masks" )
+    {
+        REQUIRE( cache.blend_func( GL_ONE, GL_SRC_ALPHA ) );
+        REQUIRE( !cache.blend_func( GL_ONE, GL_SRC_ALPHA ) );
+        REQUIRE( cache.blend_func( GL_SRC_ALPHA, GL_SRC_ALPHA ) );
+
+        REQUIRE( cache.depth_mask( false ) );
+        REQUIRE( !cache.depth_mask( false ) );
+        REQUIRE( cache.depth_mask( true ) );
+
+        REQUIRE( cache.color_mask( false ) );
+        REQUIRE( !cache.color_mask( false ) );
+        REQUIRE( cache.color_mask( true ) );
+
+        REQUIRE( gCalls_.size() == 6 );
+    }
+
+    SECTION( "Programs and vertex arrays" )
+    {
+        REQUIRE( cache.use_program( 3 ) );
+        REQUIRE( !cache.use_program( 3 ) );
+        REQUIRE( cache.bind_vertex_array( 0 ) );
+        REQUIRE( !cache.bind_vertex_array( 0 ) );
+
+        // Deleting the bound VAO reverts the binding to zero
+        REQUIRE( cache.bind_vertex_array( 7 ) );
+        cache.forget_vertex_array( 7 );
+        REQUIRE( !cache.bind_vertex_array( 0 ) );
+        REQUIRE( cache.bind_vertex_array( 7 ) );
+
+        // A program deleted while in use must be rebound
+        cache.forget_program( 3 );
+        REQUIRE( cache.use_program( 3 ) );
+    }
+
+    SECTION( "Textures per unit" )
+    {
+        REQUIRE( cache.bind_texture_2d( GL_TEXTURE0, 5 ) );
+        REQUIRE( gCalls_ == std::vector<GLenum>{ GL_ACTIVE_TEXTURE, GL_TEXTURE_BINDING_2D } );
+
+        REQUIRE( !cache.bind_texture_2d( GL_TEXTURE0, 5 ) );
+        REQUIRE( gCalls_.size() == 2 );
+
+        // Another unit: switches the active unit, and back
+        REQUIRE( cache.bind_texture_2d( GL_TEXTURE1, 5 ) );
+        REQUIRE( !cache.bind_texture_2d( GL_TEXTURE0, 5 ) );
+        REQUIRE( cache.bind_texture_2d( GL_TEXTURE0, 6 ) );
+        REQUIRE( gCalls_.size() == 6 );
+
+        // bind_texture() binds to the active unit (GL_TEXTURE0)
+        REQUIRE( !cache.bind_texture( GL_TEXTURE_2D, 6 ) );
+        REQUIRE( cache.bind_texture( GL_TEXTURE_CUBE_MAP, 6 ) );  // Not tracked
+
+        cache.forget_texture( 5 );
+        REQUIRE( !cache.bind_texture_2d( GL_TEXTURE1, 0 ) );
+    }
+
+    SECTION( "Invalidate and frame counters" )
+    {
+        cache.enable( GL_BLEND );
+        cache.use_program( 1 );
+        cache.use_program( 1 );
+
+        cache.end_frame();
+        REQUIRE( cache.last_frame_stats().total_issued() == 2 );
+        REQUIRE( cache.last_frame_stats().total_skipped() == 1 );
+        REQUIRE( cache.frame_stats().total_issued() == 0 );
+
+        cache.invalidate();
+        REQUIRE( cache.enable( GL_BLEND ) );
+        REQUIRE( cache.use_program( 1 ) );
+        REQUIRE( cache.frame_stats().total_issued() == 2 );
+    }
+}
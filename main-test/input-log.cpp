@@ -0,0 +1,119 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/input_log.hpp"
+
+#include <cstdint>
+
+namespace
+{
+    InputLog make_log_()
+    {
+        InputLog log;
+        log.seed = 0xdeadbeefu;
+        log.windowWidth = 1280;
+        log.windowHeight = 720;
+
+        for( std::uint64_t step = 0; step < 1000; step += 7 )
+        {
+            InputEvent cursor;
+            cursor.step = step;
+            cursor.type = InputEventType::cursor;
+            cursor.x = 12.5f + float(step);
+            cursor.y = -3.25f;
+            log.events.emplace_back( cursor );
+        }
+
+        InputEvent key;
+        key.step = 1000;
+        key.type = InputEventType::key;
+        key.code = 87;
+        key.scancode = -1;
+        key.action = 1;
+        key.mods = 0x3;
+        log.events.emplace_back( key );
+
+        InputEvent button;
+        button.step = 1000;
+        button.type = InputEventType::mouseButton;
+        button.code = 1;
+        button.action = 0;
+        button.mods = 0x1;
+        log.events.emplace_back( button );
+
+        InputEvent end;
+        end.step = 123456;
+        end.type = InputEventType::end;
+        log.events.emplace_back( end );
+
+        return log;
+    }
+}
+
+TEST_CASE( "Input log round trip", "[input_log]" )
+{
+    auto const log = make_log_();
+
+    auto const bytes = encode_input_log( log );
+    auto const decoded = decode_input_log( bytes.data(), bytes.size() );
+
+    REQUIRE( decoded.seed == log.seed );
+    REQUIRE( decoded.windowWidth == log.windowWidth );
+    REQUIRE( decoded.windowHeight == log.windowHeight );
+    REQUIRE( decoded.events.size() == log.events.size() );
+
+    for( std::size_t i = 0; i < log.events.size(); ++i )
+    {
+        auto const& a = log.events[i];
+        auto const& b = decoded.events[i];
+
+        REQUIRE( b.step == a.step );
+        REQUIRE( b.type == a.type );
+        REQUIRE( b.code == a.code );
+        REQUIRE( b.scancode == a.scancode );
+        REQUIRE( b.action == a.action );
+        REQUIRE( b.mods == a.mods );
+        REQUIRE( b.x == a.x );
+        REQUIRE( b.y == a.y );
+    }
+
+    // Cursor events: one byte of step delta, one of type, two floats
+    REQUIRE( bytes.size() < 20 + log.events.size() * 12 );
+}
+
+TEST_CASE( "Input log rejects bad data", "[input_log]" )
+{
+    auto bytes = encode_input_log( make_log_() );
+
+    SECTION( "Bad magic" )
+    {
+        bytes[0] = 'X';
+        REQUIRE_THROWS( decode_input_log( bytes.data(), bytes.size() ) );
+    }
+
+    SECTION( "Old version" )
+    {
+        bytes[4] = 1;
+        REQUIRE_THROWS( decode_input_log( bytes.data(), bytes.size() ) );
+    }
+
+    SECTION( "No window size" )
+    {
+        auto log = make_log_();
+        log.windowWidth = 0;
+        auto const noSize = encode_input_log( log );
+        REQUIRE_THROWS( decode_input_log( noSize.data(), noSize.size() ) );
+    }
+
+    SECTION( "Truncated" )
+    {
+        REQUIRE_THROWS( decode_input_log( bytes.data(), 8 ) );
+        REQUIRE_THROWS( decode_input_log( bytes.data(), bytes.size() - 3 ) );
+    }
+
+    SECTION( "Out of order" )
+    {
+        auto log = make_log_();
+        log.events.back().step = 0;
+        REQUIRE_THROWS( encode_input_log( log ) );
+    }
+}
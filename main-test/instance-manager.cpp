@@ -0,0 +1,211 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/instance_manager.hpp"
+
+#include <vector>
+#include <cstring>
+
+// The manager is exercised without a context: the buffer entry points that
+// sync() uses are replaced by stubs that record the uploads.
+namespace
+{
+    struct Upload_
+    {
+        bool whole;        // glBufferData() rather than glBufferSubData()
+        GLintptr offset;
+        GLsizeiptr size;
+        std::vector<ObjectData> data;
+    };
+
+    std::vector<Upload_> gUploads_;
+
+    std::vector<ObjectData> copy_( void const* aData, GLsizeiptr aSize )
+    {
+        std::vector<ObjectData> ret( std::size_t(aSize) / sizeof(ObjectData) );
+        std::memcpy( ret.data(), aData, ret.size() * sizeof(ObjectData) );
+        return ret;
+    }
+
+    void APIENTRY gen_buffers_( GLsizei aCount, GLuint* aBuffers )
+    {
+        for( GLsizei i = 0; i < aCount; ++i )
+            aBuffers[i] = GLuint(i + 1);
+    }
+    void APIENTRY delete_buffers_( GLsizei, GLuint const* ) {}
+    void APIENTRY bind_buffer_( GLenum, GLuint ) {}
+    void APIENTRY buffer_data_( GLenum, GLsizeiptr aSize, void const* aData, GLenum )
+    {
+        gUploads_.emplace_back( Upload_{ true, 0, aSize, copy_( aData, aSize ) } );
+    }
+    void APIENTRY buffer_sub_data_( GLenum, GLintptr aOffset, GLsizeiptr aSize, void const* aData )
+    {
+        gUploads_.emplace_back( Upload_{ false, aOffset, aSize, copy_( aData, aSize ) } );
+    }
+
+    struct StubGl_
+    {
+        StubGl_()
+            : genBuffers( glad_glGenBuffers ), deleteBuffers( glad_glDeleteBuffers ), bindBuffer( glad_glBindBuffer )
+            , bufferData( glad_glBufferData ), bufferSubData( glad_glBufferSubData )
+        {
+            glad_glGenBuffers = &gen_buffers_;
+            glad_glDeleteBuffers = &delete_buffers_;
+            glad_glBindBuffer = &bind_buffer_;
+            glad_glBufferData = &buffer_data_;
+            glad_glBufferSubData = &buffer_sub_data_;
+            gUploads_.clear();
+        }
+
+        ~StubGl_()
+        {
+            glad_glGenBuffers = genBuffers;
+            glad_glDeleteBuffers = deleteBuffers;
+            glad_glBindBuffer = bindBuffer;
+            glad_glBufferData = bufferData;
+            glad_glBufferSubData = bufferSubData;
+        }
+
+        PFNGLGENBUFFERSPROC genBuffers;
+        PFNGLDELETEBUFFERSPROC deleteBuffers;
+        PFNGLBINDBUFFERPROC bindBuffer;
+        PFNGLBUFFERDATAPROC bufferData;
+        PFNGLBUFFERSUBDATAPROC bufferSubData;
+    };
+
+    MeshRange mesh_( GLuint aFirstIndex )
+    {
+        return MeshRange{ 0, aFirstIndex, 36, Aabb{ { -1.f, -1.f, -1.f }, { 1.f, 1.f, 1.f } } };
+    }
+
+    // ObjectData::model is stored transposed
+    float uploaded_x_( ObjectData const& aData )
+    {
+        return aData.model( 3, 0 );
+    }
+}
+
+TEST_CASE( "Instance manager uploads only modified instances", "[instance-manager]" )
+{
+    constexpr std::size_t kStride = sizeof(ObjectData);
+
+    StubGl_ stub;
+    InstanceManager instances;
+
+    // Three instances of one mesh (slots 0-2), one of another (slot 3)
+    MeshRange const a = mesh_( 0 ), b = mesh_( 36 );
+    InstanceHandle const a0 = instances.add( a, 0, make_translation( { 0.f, 0.f, 0.f } ), DrawMaterial{}, false );
+    InstanceHandle const b0 = instances.add( b, 0, make_translation( { 3.f, 0.f, 0.f } ), DrawMaterial{}, false );
+    InstanceHandle const a1 = instances.add( a, 0, make_translation( { 1.f, 0.f, 0.f } ), DrawMaterial{}, false );
+    InstanceHandle const a2 = instances.add( a, 0, make_translation( { 2.f, 0.f, 0.f } ), DrawMaterial{}, false );
+
+    auto const initial = instances.sync();
+    REQUIRE( initial.relayout );
+    REQUIRE( initial.uploadedInstances == 4 );
+    REQUIRE( initial.uploadRanges == 1 );
+
+    REQUIRE( gUploads_.size() == 1 );
+    REQUIRE( gUploads_[0].whole );
+    REQUIRE( gUploads_[0].size == GLsizeiptr(4 * kStride) );
+
+    REQUIRE( instances.groups().size() == 2 );
+    REQUIRE( instances.slot( a0 ) == 0 );
+    REQUIRE( instances.slot( a1 ) == 1 );
+    REQUIRE( instances.slot( a2 ) == 2 );
+    REQUIRE( instances.slot( b0 ) == 3 );
+
+    gUploads_.clear();
+
+    SECTION( "Nothing moved" )
+    {
+        auto const stats = instances.sync();
+        REQUIRE( !stats.relayout );
+        REQUIRE( stats.uploadedInstances == 0 );
+        REQUIRE( stats.uploadRanges == 0 );
+        REQUIRE( gUploads_.empty() );
+    }
+
+    SECTION( "Separate slots are separate uploads" )
+    {
+        instances.set_transform( a2, make_translation( { 12.f, 0.f, 0.f } ) );
+        instances.set_transform( a0, make_translation( { 10.f, 0.f, 0.f } ) );
+        instances.set_transform( a0, make_translation( { 20.f, 0.f, 0.f } ) );  // Same slot again
+
+        auto const stats = instances.sync();
+        REQUIRE( !stats.relayout );
+        REQUIRE( stats.uploadedInstances == 2 );
+        REQUIRE( stats.uploadRanges == 2 );
+
+        // In slot order, one instance each
+        REQUIRE( gUploads_.size() == 2 );
+        REQUIRE( !gUploads_[0].whole );
+        REQUIRE( gUploads_[0].offset == 0 );
+        REQUIRE( gUploads_[0].size == GLsizeiptr(kStride) );
+        REQUIRE( uploaded_x_( gUploads_[0].data[0] ) == 20.f );
+
+        REQUIRE( !gUploads_[1].whole );
+        REQUIRE( gUploads_[1].offset == GLintptr(2 * kStride) );
+        REQUIRE( gUploads_[1].size == GLsizeiptr(kStride) );
+        REQUIRE( uploaded_x_( gUploads_[1].data[0] ) == 12.f );
+
+        // Uploaded slots are clean again
+        gUploads_.clear();
+        REQUIRE( instances.sync().uploadRanges == 0 );
+        REQUIRE( gUploads_.empty() );
+    }
+
+    SECTION( "Consecutive slots are merged" )
+    {
+        instances.set_transform( b0, make_translation( { 13.f, 0.f, 0.f } ) );
+        instances.set_transform( a1, make_translation( { 11.f, 0.f, 0.f } ) );
+        instances.set_material( a2, DrawMaterial{ 1, true } );
+
+        auto const stats = instances.sync();
+        REQUIRE( stats.uploadedInstances == 3 );
+        REQUIRE( stats.uploadRanges == 1 );
+
+        // Slots 1-3, across the group boundary
+        REQUIRE( gUploads_.size() == 1 );
+        REQUIRE( !gUploads_[0].whole );
+        REQUIRE( gUploads_[0].offset == GLintptr(kStride) );
+        REQUIRE( gUploads_[0].size == GLsizeiptr(3 * kStride) );
+        REQUIRE( uploaded_x_( gUploads_[0].data[0] ) == 11.f );
+        REQUIRE( gUploads_[0].data[1].useTexture == 1u );
+        REQUIRE( uploaded_x_( gUploads_[0].data[2] ) == 13.f );
+    }
+
+    SECTION( "Adding an instance relayouts" )
+    {
+        InstanceHandle const a3 = instances.add( a, 0, make_translation( { 4.f, 0.f, 0.f } ), DrawMaterial{}, false );
+
+        // Moves before the relayout are part of the full upload
+        instances.set_transform( a0, make_translation( { 10.f, 0.f, 0.f } ) );
+
+        auto const stats = instances.sync();
+        REQUIRE( stats.relayout );
+        REQUIRE( stats.uploadedInstances == 5 );
+        REQUIRE( stats.uploadRanges == 1 );
+
+        // The buffer grows
+        REQUIRE( gUploads_.size() == 1 );
+        REQUIRE( gUploads_[0].whole );
+        REQUIRE( gUploads_[0].size == GLsizeiptr(5 * kStride) );
+        REQUIRE( uploaded_x_( gUploads_[0].data[0] ) == 10.f );
+
+        // The new instance joins its group; the other group shifts
+        REQUIRE( instances.slot( a3 ) == 3 );
+        REQUIRE( instances.slot( b0 ) == 4 );
+        REQUIRE( instances.groups()[0].count == 4 );
+        REQUIRE( instances.groups()[1].first == 4 );
+        REQUIRE( uploaded_x_( gUploads_[0].data[4] ) == 3.f );
+
+        // Later moves upload the instance's new slot
+        gUploads_.clear();
+        instances.set_transform( b0, make_translation( { 13.f, 0.f, 0.f } ) );
+
+        REQUIRE( instances.sync().uploadRanges == 1 );
+        REQUIRE( gUploads_.size() == 1 );
+        REQUIRE( gUploads_[0].offset == GLintptr(4 * kStride) );
+        REQUIRE( gUploads_[0].size == GLsizeiptr(kStride) );
+        REQUIRE( uploaded_x_( gUploads_[0].data[0] ) == 13.f );
+    }
+}
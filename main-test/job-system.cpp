@@ -0,0 +1,78 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../support/job_system.hpp"
+
+#include <atomic>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+TEST_CASE( "parallel_for visits every index once", "[job-system]" )
+{
+    std::size_t const threads = GENERATE( 1, 2, 4 );
+    std::size_t const grain = GENERATE( 0, 1, 7, 1000 );
+
+    JobSystem jobs( threads );
+
+    std::vector<int> visits( 10000, 0 );
+    jobs.parallel_for( 0, visits.size(), grain, [&] ( std::size_t aBegin, std::size_t aEnd ) {
+        for( std::size_t i = aBegin; i < aEnd; ++i )
+            ++visits[i];
+    } );
+
+    REQUIRE( std::accumulate( visits.begin(), visits.end(), 0 ) == 10000 );
+    REQUIRE( std::all_of( visits.begin(), visits.end(), [] ( int aCount ) { return 1 == aCount; } ) );
+}
+
+TEST_CASE( "Counters order dependent jobs", "[job-system]" )
+{
+    JobSystem jobs( 4 );
+
+    // Stage two reads what all of stage one wrote
+    std::vector<int> values( 64, 0 );
+    std::atomic<int> sum{ 0 };
+
+    JobCounter stageOne, stageTwo;
+    for( std::size_t i = 0; i < values.size(); ++i )
+        jobs.run( stageOne, [&values, i] { values[i] = int(i); } );
+
+    jobs.run( stageTwo, [&] {
+        jobs.wait( stageOne );
+        sum = std::accumulate( values.begin(), values.end(), 0 );
+    } );
+
+    jobs.wait( stageTwo );
+    REQUIRE( stageOne.done() );
+    REQUIRE( sum == 64*63/2 );
+}
+
+TEST_CASE( "Jobs may submit jobs", "[job-system]" )
+{
+    JobSystem jobs( 3 );
+
+    std::atomic<std::size_t> count{ 0 };
+    jobs.parallel_for( 0, 16, 1, [&] ( std::size_t, std::size_t ) {
+        jobs.parallel_for( 0, 100, 10, [&] ( std::size_t aBegin, std::size_t aEnd ) {
+            count += aEnd - aBegin;
+        } );
+    } );
+
+    REQUIRE( count == 1600 );
+}
+
+TEST_CASE( "Job exceptions are rethrown by wait()", "[job-system]" )
+{
+    JobSystem jobs( 2 );
+
+    JobCounter counter;
+    jobs.run( counter, [] { throw std::runtime_error( "job failed" ); } );
+    jobs.run( counter, [] {} );
+
+    REQUIRE_THROWS_AS( jobs.wait( counter ), std::runtime_error );
+    REQUIRE( counter.done() );
+
+    REQUIRE_THROWS_AS( jobs.parallel_for( 0, 100, 10, [] ( std::size_t aBegin, std::size_t ) {
+        if( 50 == aBegin )
+            throw std::runtime_error( "chunk failed" );
+    } ), std::runtime_error );
+}
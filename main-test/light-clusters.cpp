@@ -0,0 +1,144 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/light_clusters.hpp"
+
+#include <random>
+#include <algorithm>
+
+#include <cmath>
+#include <numbers>
+
+namespace
+{
+    Mat44f projection_()
+    {
+        return make_perspective_projection( 60.f * std::numbers::pi_v<float> / 180.f, 16.f / 9.f, 0.1f, 100.f );
+    }
+
+    std::vector<PointLight> random_lights_( std::size_t aCount, std::uint32_t aSeed )
+    {
+        std::mt19937 rng( aSeed );
+        std::uniform_real_distribution<float> pos( -30.f, 30.f );
+        std::uniform_real_distribution<float> range( 0.5f, 4.f );
+
+        std::vector<PointLight> lights( aCount );
+        for( auto& light : lights )
+        {
+            light.position = Vec3f{ pos( rng ), 0.2f * pos( rng ), pos( rng ) - 30.f };
+            light.range = range( rng );
+            light.color = Vec3f{ 1.f, 1.f, 1.f };
+            light.radius = 0.5f * light.range;
+        }
+        return lights;
+    }
+
+    bool lists_light_( LightClusters const& aClusters, std::uint32_t aCluster, std::uint32_t aLight )
+    {
+        ClusterRange const range = aClusters.clusters()[aCluster];
+        auto const begin = aClusters.indices().begin() + range.offset;
+        return std::binary_search( begin, begin + range.count, aLight );
+    }
+}
+
+TEST_CASE( "Depth slices are exponential", "[light-clusters]" )
+{
+    LightClusters clusters;
+    clusters.set_projection( projection_() );
+
+    REQUIRE( clusters.slice( 0.1f ) == 0 );
+    REQUIRE( clusters.slice( 0.01f ) == 0 );
+    REQUIRE( clusters.slice( 99.9f ) == kClusterSlices - 1 );
+    REQUIRE( clusters.slice( 1000.f ) == kClusterSlices - 1 );
+
+    // The middle of each slice, in log space
+    for( std::uint32_t k = 0; k < kClusterSlices; ++k )
+    {
+        float const depth = 0.1f * std::pow( 1000.f, (float(k) + 0.5f) / float(kClusterSlices) );
+        REQUIRE( clusters.slice( depth ) == k );
+    }
+}
+
+TEST_CASE( "Lights reach every cluster they touch", "[light-clusters]" )
+{
+    // Few lights on the calling thread, many on worker threads
+    std::size_t const lightCount = GENERATE( std::size_t(64), std::size_t(1500) );
+    auto const lights = random_lights_( lightCount, 7 );
+
+    Mat44f const views[2] = {
+        kIdentity44f,
+        make_look_at( Vec4f{ 5.f, 10.f, 5.f, 1.f }, Vec4f{ 0.f, 0.f, -30.f, 1.f }, Vec4f{ 0.f, 1.f, 0.f, 0.f } )
+    };
+
+    LightClusters clusters;
+    clusters.set_projection( projection_() );
+    ClusterStats const stats = clusters.assign( views, 2, lights );
+
+    REQUIRE( stats.lights == lightCount );
+    REQUIRE( stats.assignments == clusters.indices().size() );
+    REQUIRE( clusters.clusters().size() == 2 * kClustersPerView );
+
+    // Lists are sorted and within the index list
+    for( auto const& range : clusters.clusters() )
+    {
+        REQUIRE( range.offset + range.count <= clusters.indices().size() );
+        auto const begin = clusters.indices().begin() + range.offset;
+        REQUIRE( std::is_sorted( begin, begin + range.count ) );
+    }
+
+    // Points inside each light's sphere find the light in their cluster
+    std::mt19937 rng( 11 );
+    std::uniform_real_distribution<float> unit( -1.f, 1.f );
+
+    for( std::size_t v = 0; v < 2; ++v )
+    {
+        for( std::uint32_t i = 0; i < lightCount; i += 7 )
+        {
+            for( int s = 0; s < 8; ++s )
+            {
+                Vec3f const offset = 0.99f * lights[i].range * Vec3f{ unit( rng ), unit( rng ), unit( rng ) } / std::sqrt( 3.f );
+                Vec4f const p = views[v] * Vec4f{ lights[i].position.x + offset.x, lights[i].position.y + offset.y, lights[i].position.z + offset.z, 1.f };
+
+                // Only points inside the view volume are shaded
+                Vec4f const clip = projection_() * p;
+                if( clip.w <= 0.f || std::abs( clip.x ) > clip.w || std::abs( clip.y ) > clip.w || std::abs( clip.z ) > clip.w )
+                    continue;
+
+                REQUIRE( lists_light_( clusters, clusters.cluster_at( v, Vec3f{ p.x, p.y, p.z } ), i ) );
+            }
+        }
+    }
+}
+
+TEST_CASE( "Lights outside of the view are not assigned", "[light-clusters]" )
+{
+    LightClusters clusters;
+    clusters.set_projection( projection_() );
+
+    std::vector<PointLight> lights( 3 );
+    lights[0].position = Vec3f{ 0.f, 0.f, 5.f };      // Behind the camera
+    lights[1].position = Vec3f{ 0.f, 0.f, -150.f };   // Beyond the far plane
+    lights[2].position = Vec3f{ 50.f, 0.f, -5.f };    // Right of the frustum
+    for( auto& light : lights )
+        light.range = 1.f;
+
+    ClusterStats const stats = clusters.assign( &kIdentity44f, 1, lights );
+    REQUIRE( stats.assignments == 0 );
+    REQUIRE( stats.maxPerCluster == 0 );
+
+    // A light in front of the camera lands in the center tiles
+    lights.push_back( PointLight{ Vec3f{ 0.f, 0.f, -10.f }, 0.5f, Vec3f{ 1.f, 1.f, 1.f }, 0.25f } );
+    clusters.assign( &kIdentity44f, 1, lights );
+
+    REQUIRE( !clusters.indices().empty() );
+    REQUIRE( lists_light_( clusters, clusters.cluster_at( 0, Vec3f{ 0.f, 0.f, -10.f } ), 3 ) );
+    REQUIRE( !lists_light_( clusters, clusters.cluster_at( 0, Vec3f{ 0.f, 0.f, -20.f } ), 3 ) );
+}
+
+TEST_CASE( "Cluster grid needs a perspective projection", "[light-clusters]" )
+{
+    LightClusters clusters;
+    std::vector<PointLight> const lights;
+
+    REQUIRE_THROWS( clusters.assign( &kIdentity44f, 1, lights ) );
+    REQUIRE_THROWS( clusters.set_projection( kIdentity44f ) );
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/mesh_cache.hpp"
+
+TEST_CASE( "Mesh cache shares identical requests", "[mesh_cache]" )
+{
+    MeshCache cache;
+
+    SECTION( "Identical requests" )
+    {
+        auto const a = cache.spaceship( 8 );
+        auto const b = cache.spaceship( 8 );
+
+        REQUIRE( a == b );
+        REQUIRE( cache.size() == 1 );
+        REQUIRE( cache.misses() == 1 );
+        REQUIRE( cache.hits() == 1 );
+
+        REQUIRE( a->vertexCount > 0 );
+        REQUIRE( a->vertexCount == a->data.positions.size() );
+    }
+
+    SECTION( "Different geometry" )
+    {
+        auto const a = cache.cylinder( true, 16 );
+
+        REQUIRE( cache.cylinder( true, 8 ) != a );
+        REQUIRE( cache.cylinder( false, 16 ) != a );
+        REQUIRE( cache.cone( true, 16 ) != a );
+        REQUIRE( cache.truncated_ovoid( 16, 8, 2.f, 0.6f, 0.15f ) != cache.truncated_ovoid( 16, 8, 2.f, 0.5f, 0.15f ) );
+        REQUIRE( cache.triangle_prism( true, { 1.f, 0.f }, { 0.f, 0.f }, { 0.f, 1.f }, 0.05f )
+            != cache.triangle_prism( true, { 1.f, 0.f }, { 0.f, 0.f }, { 0.f, 1.f }, 0.1f ) );
+
+        REQUIRE( cache.size() == 8 );
+        REQUIRE( cache.hits() == 0 );
+    }
+
+    SECTION( "Meshes are generated in the palette's base colors" )
+    {
+        auto const rocket = cache.spaceship( 8 );
+
+        bool body = false, fins = false, nozzle = false;
+        for( auto const& c : rocket->data.colors )
+        {
+            body |= c.x == kPaletteColor0.x && c.y == kPaletteColor0.y && c.z == kPaletteColor0.z;
+            fins |= c.x == kPaletteColor1.x && c.y == kPaletteColor1.y && c.z == kPaletteColor1.z;
+            nozzle |= c.x == kPaletteColor2.x && c.y == kPaletteColor2.y && c.z == kPaletteColor2.z;
+        }
+
+        REQUIRE( body );
+        REQUIRE( fins );
+        REQUIRE( nozzle );
+    }
+
+    SECTION( "Handles outlive clear()" )
+    {
+        auto const a = cache.cone();
+        cache.clear();
+
+        REQUIRE( cache.size() == 0 );
+        REQUIRE( !a->data.positions.empty() );
+        REQUIRE( cache.cone() != a );
+    }
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/mesh_cleanup.hpp"
+#include "../main/mesh_winding.hpp"
+#include "../main/cylinder.hpp"
+#include "../main/ovoid.hpp"
+
+TEST_CASE( "Mesh cleanup", "[mesh_cleanup]" )
+{
+    SECTION( "Degenerate pole triangles are removed" )
+    {
+        auto mesh = make_truncated_ovoid( 8, 4, 1.f, 0.f, 0.f );
+        auto const winding = check_winding( mesh );
+        REQUIRE( winding.degenerate > 0 );
+
+        auto const stats = clean_mesh( mesh );
+        REQUIRE( stats.degenerateRemoved == winding.degenerate );
+        REQUIRE( stats.triangles == winding.triangles - winding.degenerate );
+        REQUIRE( check_winding( mesh ).degenerate == 0 );
+    }
+
+    SECTION( "Duplicate triangles are removed, double-sided ones kept" )
+    {
+        auto mesh = make_cylinder( true, 16 );
+        std::size_t const triangles = mesh.positions.size() / 3;
+
+        // Exact copy of the first triangle, rotated
+        auto copy = mesh;
+        copy.positions = { mesh.positions[1], mesh.positions[2], mesh.positions[0] };
+        copy.normals = { mesh.normals[1], mesh.normals[2], mesh.normals[0] };
+        copy.colors = { mesh.colors[1], mesh.colors[2], mesh.colors[0] };
+        mesh = concatenate( std::move(mesh), copy );
+
+        // Back side of the second triangle
+        auto back = copy;
+        back.positions = { mesh.positions[3], mesh.positions[5], mesh.positions[4] };
+        back.normals = { mesh.normals[3], mesh.normals[5], mesh.normals[4] };
+        back.colors = { mesh.colors[3], mesh.colors[5], mesh.colors[4] };
+        mesh = concatenate( std::move(mesh), back );
+
+        auto const stats = clean_mesh( mesh );
+        REQUIRE( stats.duplicateRemoved == 1 );
+        REQUIRE( stats.degenerateRemoved == 0 );
+        REQUIRE( stats.triangles == triangles + 1 );
+    }
+
+    SECTION( "Unreferenced vertices are dropped" )
+    {
+        SimpleMeshData mesh;
+        mesh.positions = { { 0.f, 0.f, 0.f }, { 9.f, 9.f, 9.f }, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } };
+        mesh.colors = { { 1.f, 0.f, 0.f }, { 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } };
+        mesh.indices = { 0, 2, 3 };
+
+        auto const stats = clean_mesh( mesh );
+        REQUIRE( stats.unreferencedRemoved == 1 );
+        REQUIRE( stats.vertices == 3 );
+        REQUIRE( mesh.colors.size() == 3 );
+        REQUIRE( mesh.colors[1].y == 1.f );
+        REQUIRE( stats.boundsMax.x == 1.f );
+        REQUIRE( stats.boundsMax.y == 1.f );
+        REQUIRE( stats.positionBytes == 3 * sizeof(Vec3f) );
+        REQUIRE( stats.indexBytes == 3 * sizeof(std::uint32_t) );
+    }
+}
@@ -0,0 +1,123 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/mesh_codec.hpp"
+#include "../main/cylinder.hpp"
+#include "../main/spaceship.hpp"
+#include "../main/loadobj.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+
+#include <cstdint>
+#include <cstring>
+
+TEST_CASE( "Mesh codec round trip", "[mesh_codec]" )
+{
+    static constexpr float kEps_ = 1e-3f;
+
+    using namespace Catch::Matchers;
+
+    SECTION( "Cylinder" )
+    {
+        auto const mesh = make_cylinder( true, 16, { 0.5f, 0.25f, 1.f }, make_scaling( 4.f, 0.5f, 0.5f ) );
+
+        auto const bytes = encode_mesh( mesh );
+        auto const decoded = decode_mesh( bytes.data(), bytes.size() );
+
+        // Smaller than the raw (non-indexed, float) vertex streams
+        REQUIRE( bytes.size() < mesh.positions.size() * sizeof(Vec3f) );
+
+        // Same triangles as the input, in the same order
+        REQUIRE( decoded.indices.size() == mesh.positions.size() );
+        REQUIRE( decoded.positions.size() < mesh.positions.size() );
+
+        for( std::size_t i = 0; i < decoded.indices.size(); ++i )
+        {
+            auto const idx = decoded.indices[i];
+            REQUIRE( idx < decoded.positions.size() );
+
+            REQUIRE_THAT( decoded.positions[idx].x, WithinAbs( mesh.positions[i].x, kEps_ ) );
+            REQUIRE_THAT( decoded.positions[idx].y, WithinAbs( mesh.positions[i].y, kEps_ ) );
+            REQUIRE_THAT( decoded.positions[idx].z, WithinAbs( mesh.positions[i].z, kEps_ ) );
+
+            REQUIRE( dot( decoded.normals[idx], mesh.normals[i] ) > 0.9999f );
+
+            REQUIRE( decoded.colors[idx].x == mesh.colors[i].x );
+            REQUIRE( decoded.Ns[idx] == mesh.Ns[i] );
+        }
+    }
+
+    SECTION( "Non-vertex data" )
+    {
+        auto const mesh = create_spaceship( 8, { 0.2f, 0.2f, 0.2f }, { 0.8f, 0.2f, 0.2f }, make_scaling( 0.05f, 0.05f, 0.05f ) );
+
+        auto const bytes = encode_mesh( mesh );
+        auto const decoded = decode_mesh( bytes.data(), bytes.size() );
+
+        REQUIRE( decoded.engineLocation.x == mesh.engineLocation.x );
+        REQUIRE( decoded.engineDirection.y == mesh.engineDirection.y );
+        REQUIRE( decoded.pointLightPos[2].z == mesh.pointLightPos[2].z );
+        REQUIRE( decoded.isTextureSupplied == mesh.isTextureSupplied );
+    }
+
+    SECTION( "Corrupt input is rejected" )
+    {
+        auto bytes = encode_mesh( make_cylinder( false, 4 ) );
+
+        REQUIRE_THROWS( decode_mesh( bytes.data(), bytes.size() / 2 ) );
+
+        bytes[0] = 'X';
+        REQUIRE_THROWS( decode_mesh( bytes.data(), bytes.size() ) );
+    }
+
+    SECTION( "Corrupt header counts are rejected before allocating" )
+    {
+        auto const bytes = encode_mesh( make_cylinder( true, 16 ) );
+
+        // Header: magic, version, flags, vertex count, index count, index
+        // bytes, material count (see mesh_codec.cpp), 32 bit each
+        auto const corrupt = [&bytes] ( std::size_t aOffset ) {
+            auto copy = bytes;
+            std::uint32_t const huge = 0xffffffffu;
+            std::memcpy( copy.data() + aOffset, &huge, sizeof(huge) );
+            return copy;
+        };
+
+        auto const indexCount = corrupt( 16 );
+        REQUIRE_THROWS( decode_mesh( indexCount.data(), indexCount.size() ) );
+
+        auto const materialCount = corrupt( 24 );
+        REQUIRE_THROWS( decode_mesh( materialCount.data(), materialCount.size() ) );
+    }
+}
+
+TEST_CASE( "A corrupt OBJ cache is rebuilt", "[mesh_codec]" )
+{
+    namespace fs = std::filesystem;
+
+    fs::path const asset = "assets/cw2/landingpad";
+    if( !fs::exists( asset.string() + ".obj" ) )
+        SKIP( "run from the repository root to test OBJ assets" );
+
+    fs::path const dir = fs::temp_directory_path() / "mesh-codec-test";
+    fs::create_directories( dir );
+    fs::copy_file( asset.string() + ".obj", dir / "landingpad.obj", fs::copy_options::overwrite_existing );
+    fs::copy_file( asset.string() + ".mtl", dir / "landingpad.mtl", fs::copy_options::overwrite_existing );
+
+    fs::path const obj = dir / "landingpad.obj";
+    fs::path const cache = dir / "landingpad.obj.cmesh";
+
+    // Newer than the OBJ, so it is used, but not a mesh
+    std::ofstream( cache, std::ios::binary ) << "CMSH truncated";
+    fs::last_write_time( cache, fs::last_write_time( obj ) + std::chrono::seconds( 1 ) );
+
+    SimpleMeshData mesh;
+    REQUIRE_NOTHROW( mesh = load_wavefront_obj_cached( obj.string().c_str() ) );
+    REQUIRE( !mesh.positions.empty() );
+
+    // Rewritten from the OBJ
+    REQUIRE( !load_mesh_binary( cache.string().c_str() ).positions.empty() );
+
+    fs::remove_all( dir );
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/multi_view.hpp"
+
+TEST_CASE( "View layouts tile the window", "[multi-view]" )
+{
+    auto const layout = GENERATE( ViewLayout::single, ViewLayout::split, ViewLayout::quad );
+    int const width = GENERATE( 1280, 1279 );
+    int const height = GENERATE( 720, 721 );
+
+    ViewRect rects[kMaxLayoutViews];
+    std::size_t const count = layout_views( layout, width, height, rects );
+    REQUIRE( count == view_count( layout ) );
+
+    // Every pixel belongs to exactly one view
+    long area = 0;
+    for( std::size_t i = 0; i < count; ++i )
+    {
+        REQUIRE( rects[i].x >= 0 );
+        REQUIRE( rects[i].y >= 0 );
+        REQUIRE( rects[i].x + rects[i].width <= width );
+        REQUIRE( rects[i].y + rects[i].height <= height );
+        area += long(rects[i].width) * rects[i].height;
+
+        for( std::size_t j = i+1; j < count; ++j )
+        {
+            bool const apart = rects[i].x + rects[i].width <= rects[j].x
+                || rects[j].x + rects[j].width <= rects[i].x
+                || rects[i].y + rects[i].height <= rects[j].y
+                || rects[j].y + rects[j].height <= rects[i].y;
+            REQUIRE( apart );
+        }
+    }
+
+    REQUIRE( area == long(width) * height );
+}
+
+TEST_CASE( "Layouts cycle through all view counts", "[multi-view]" )
+{
+    REQUIRE( next_layout( ViewLayout::single ) == ViewLayout::split );
+    REQUIRE( next_layout( ViewLayout::split ) == ViewLayout::quad );
+    REQUIRE( next_layout( ViewLayout::quad ) == ViewLayout::single );
+}
+
+TEST_CASE( "View at window position", "[multi-view]" )
+{
+    ViewRect rects[kMaxLayoutViews];
+    std::size_t const count = layout_views( ViewLayout::quad, 200, 100, rects );
+
+    SECTION( "Centre of each view" )
+    {
+        for( std::size_t i = 0; i < count; ++i )
+        {
+            float const x = float(rects[i].x) + 0.5f * float(rects[i].width);
+            float const y = float(rects[i].y) + 0.5f * float(rects[i].height);
+
+            auto const hit = view_at( rects, count, x, y );
+            REQUIRE( hit );
+            REQUIRE( hit->view == i );
+            REQUIRE( hit->ndc.x == Catch::Approx( 0.f ).margin( 1e-6f ) );
+            REQUIRE( hit->ndc.y == Catch::Approx( 0.f ).margin( 1e-6f ) );
+        }
+    }
+
+    SECTION( "Corners" )
+    {
+        auto const bottomLeft = view_at( rects, count, 0.f, 0.f );
+        REQUIRE( bottomLeft );
+        REQUIRE( bottomLeft->view == 0 );
+        REQUIRE( bottomLeft->ndc.x == Catch::Approx( -1.f ) );
+        REQUIRE( bottomLeft->ndc.y == Catch::Approx( -1.f ) );
+
+        auto const topRight = view_at( rects, count, 199.5f, 99.5f );
+        REQUIRE( topRight );
+        REQUIRE( topRight->view == 3 );
+        REQUIRE( topRight->ndc.x == Catch::Approx( 0.99f ) );
+        REQUIRE( topRight->ndc.y == Catch::Approx( 0.98f ) );
+    }
+
+    SECTION( "Outside" )
+    {
+        REQUIRE( !view_at( rects, count, -1.f, 50.f ) );
+        REQUIRE( !view_at( rects, count, 200.f, 50.f ) );
+    }
+}
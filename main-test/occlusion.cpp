@@ -0,0 +1,146 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/occlusion.hpp"
+#include "../main/cylinder.hpp"
+#include "../main/loadobj.hpp"
+
+#include <filesystem>
+#include <numbers>
+
+namespace
+{
+    Mat44f projection_()
+    {
+        return make_perspective_projection( 60.f * std::numbers::pi_v<float> / 180.f, 2.f, 0.1f, 100.f );
+    }
+
+    Aabb box_at_( Vec3f aCenter, float aHalf )
+    {
+        Vec3f const e{ aHalf, aHalf, aHalf };
+        return Aabb{ aCenter - e, aCenter + e };
+    }
+
+    std::size_t covered_pixels_( OcclusionBuffer const& aBuffer )
+    {
+        std::size_t covered = 0;
+        for( std::size_t y = 0; y < aBuffer.height(); ++y )
+        {
+            for( std::size_t x = 0; x < aBuffer.width(); ++x )
+                covered += aBuffer.depth( x, y ) < 1.f;
+        }
+        return covered;
+    }
+
+    // A log lying across the view: axis along x, x in [-5,5], radius 2,
+    // at z = -10. The camera is at the origin, looking down -z.
+    OcclusionBuffer log_buffer_( std::size_t aSubdivs )
+    {
+        auto const log = simplify_occluder( make_cylinder( true, aSubdivs, { 1.f, 1.f, 1.f },
+            make_translation( { -5.f, 0.f, -10.f } ) * make_scaling( 10.f, 2.f, 2.f ) ), 0.f );
+
+        OcclusionBuffer buffer;
+        buffer.begin( projection_() );
+        buffer.add_occluder( log, kIdentity44f );
+        buffer.rasterize();
+        return buffer;
+    }
+}
+
+TEST_CASE( "Occlusion buffer", "[occlusion]" )
+{
+    SECTION( "Without occluders everything is visible" )
+    {
+        OcclusionBuffer buffer;
+        buffer.begin( projection_() );
+        buffer.rasterize();
+
+        REQUIRE( 0 == covered_pixels_( buffer ) );
+        REQUIRE( buffer.is_visible( box_at_( { 0.f, 0.f, -20.f }, 0.5f ) ) );
+        REQUIRE( !buffer.is_visible( Aabb{} ) );
+    }
+
+    SECTION( "Cylinder occluder" )
+    {
+        auto const buffer = log_buffer_( 32 );
+
+        REQUIRE( buffer.triangle_count() > 0 );
+        REQUIRE( covered_pixels_( buffer ) > 0 );
+        REQUIRE( buffer.levels() > 1 );
+
+        REQUIRE( !buffer.is_visible( box_at_( { 0.f, 0.f, -20.f }, 0.5f ) ) );  // Behind the log
+        REQUIRE( !buffer.is_visible( box_at_( { 3.f, -0.5f, -30.f }, 1.f ) ) );
+        REQUIRE( buffer.is_visible( box_at_( { 0.f, 0.f, -5.f }, 0.5f ) ) );    // In front of it
+        REQUIRE( buffer.is_visible( box_at_( { 0.f, 6.f, -20.f }, 0.5f ) ) );   // Above it
+        REQUIRE( buffer.is_visible( box_at_( { 0.f, 0.f, -10.f }, 3.f ) ) );    // Contains it
+        REQUIRE( buffer.is_visible( box_at_( { 0.f, 0.f, 0.f }, 0.5f ) ) );     // At the camera
+    }
+
+    SECTION( "Threaded rasterization" )
+    {
+        // Enough triangles for the multi-threaded path; same answers
+        auto const buffer = log_buffer_( 4 * kParallelRasterThreshold );
+        REQUIRE( buffer.triangle_count() >= kParallelRasterThreshold );
+
+        auto const reference = log_buffer_( 32 );
+        REQUIRE( covered_pixels_( buffer ) >= covered_pixels_( reference ) );
+
+        REQUIRE( !buffer.is_visible( box_at_( { 0.f, 0.f, -20.f }, 0.5f ) ) );
+        REQUIRE( buffer.is_visible( box_at_( { 0.f, 6.f, -20.f }, 0.5f ) ) );
+    }
+
+    SECTION( "Occluder crossing the near plane" )
+    {
+        // The camera sits inside the log; clipped triangles still occlude
+        auto const log = simplify_occluder( make_cylinder( true, 32, { 1.f, 1.f, 1.f },
+            make_translation( { -5.f, 0.f, -1.f } ) * make_scaling( 10.f, 2.f, 2.f ) ), 0.f );
+
+        OcclusionBuffer buffer;
+        buffer.begin( projection_() );
+        buffer.add_occluder( log, kIdentity44f );
+        buffer.rasterize();
+
+        REQUIRE( !buffer.is_visible( box_at_( { 0.f, 0.f, -20.f }, 0.5f ) ) );
+    }
+}
+
+TEST_CASE( "Occluder simplification", "[occlusion]" )
+{
+    auto const mesh = make_cylinder( true, 64, { 1.f, 1.f, 1.f }, make_scaling( 4.f, 1.f, 1.f ) );
+
+    auto const full = simplify_occluder( mesh, 0.f );
+    auto const coarse = simplify_occluder( mesh, 0.5f );
+
+    REQUIRE( full.indices.size() == draw_count( mesh ) );
+    REQUIRE( coarse.indices.size() < full.indices.size() );
+    REQUIRE( coarse.positions.size() < full.positions.size() );
+
+    // Clusters are represented by their lowest vertex
+    float fullTop = -1e9f, coarseTop = -1e9f;
+    for( auto const& p : full.positions )
+        fullTop = std::max( fullTop, p.y );
+    for( auto const& p : coarse.positions )
+        coarseTop = std::max( coarseTop, p.y );
+    REQUIRE( coarseTop <= fullTop );
+}
+
+TEST_CASE( "Launchpad occludes from above", "[occlusion]" )
+{
+    char const* path = "assets/cw2/landingpad.obj";
+    if( !std::filesystem::exists( path ) )
+        SKIP( "run from the repository root to test OBJ assets" );
+
+    auto const pad = simplify_occluder( load_wavefront_obj( path ), 0.f );
+
+    // Looking straight down at the pad from 3 units above
+    Mat44f const view = make_rotation_x( std::numbers::pi_v<float> / 2.f ) * make_translation( { 0.f, -3.f, 0.f } );
+
+    OcclusionBuffer buffer;
+    buffer.begin( projection_() * view );
+    buffer.add_occluder( pad, kIdentity44f );
+    buffer.rasterize();
+
+    REQUIRE( covered_pixels_( buffer ) > 0 );
+    REQUIRE( !buffer.is_visible( box_at_( { 0.f, -1.f, 0.f }, 0.05f ) ) );  // Below the pad
+    REQUIRE( buffer.is_visible( box_at_( { 0.f, 1.f, 0.f }, 0.05f ) ) );    // Above it
+    REQUIRE( buffer.is_visible( box_at_( { 3.f, -1.f, 0.f }, 0.05f ) ) );   // Beside it
+}
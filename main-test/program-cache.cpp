@@ -0,0 +1,128 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../support/program_cache.hpp"
+
+#include <fstream>
+#include <filesystem>
+
+namespace
+{
+    // A fresh cache directory, removed at the end of the test
+    struct TempDirectory_
+    {
+        TempDirectory_()
+            : path( std::filesystem::temp_directory_path() / "program-cache-test" )
+        {
+            std::filesystem::remove_all( path );
+        }
+        ~TempDirectory_()
+        {
+            std::error_code ec;
+            std::filesystem::remove_all( path, ec );
+        }
+
+        std::filesystem::path path;
+    };
+}
+
+TEST_CASE( "Definitions follow the version line", "[program-cache]" )
+{
+    std::string const source = "#version 430\nvoid main() {}\n";
+
+    REQUIRE( inject_defines( source, {} ) == source );
+    REQUIRE( inject_defines( source, { "FOG", "TEXTURED 1" } )
+        == "#version 430\n#define FOG\n#define TEXTURED 1\n#line 2\nvoid main() {}\n" );
+
+    // Comments before the version line keep their line numbers
+    REQUIRE( inject_defines( "// A\n#version 430\nx\n", { "A" } ) == "// A\n#version 430\n#define A\n#line 3\nx\n" );
+
+    // Without a version line, at the start
+    REQUIRE( inject_defines( "x\n", { "A" } ) == "#define A\n#line 1\nx\n" );
+}
+
+TEST_CASE( "Cache keys cover driver, stages and definitions", "[program-cache]" )
+{
+    TempDirectory_ dir;
+    ProgramBinaryCache cache( dir.path, "vendor|renderer|4.6|4.60" );
+    ProgramBinaryCache otherDriver( dir.path, "vendor|renderer|4.6.1|4.60" );
+
+    std::string const source = "#version 430\nvoid main() {}\n";
+    std::vector<ProgramBinaryCache::Stage> const stages{
+        { GL_VERTEX_SHADER, source },
+        { GL_FRAGMENT_SHADER, source }
+    };
+
+    std::uint64_t const key = cache.key( stages );
+    REQUIRE( key == cache.key( stages ) );
+    REQUIRE( key != otherDriver.key( stages ) );
+
+    auto swapped = stages;
+    std::swap( swapped[0].type, swapped[1].type );
+    REQUIRE( key != cache.key( swapped ) );
+
+    auto defined = stages;
+    defined[1].text = inject_defines( source, { "FOG" } );
+    REQUIRE( key != cache.key( defined ) );
+}
+
+TEST_CASE( "Cache entries round trip", "[program-cache]" )
+{
+    TempDirectory_ dir;
+    ProgramBinaryCache cache( dir.path, "driver" );
+
+    REQUIRE( !cache.load( 42 ) );
+    REQUIRE( cache.misses() == 1 );
+
+    ProgramBinary binary;
+    binary.format = 0x1234;
+    binary.data = { 1, 2, 3, 250, 0, 7 };
+    cache.store( 42, binary );
+
+    auto const loaded = cache.load( 42 );
+    REQUIRE( loaded );
+    REQUIRE( loaded->format == binary.format );
+    REQUIRE( loaded->data == binary.data );
+    REQUIRE( cache.hits() == 1 );
+
+    // Other keys miss; rejected entries are gone
+    REQUIRE( !cache.load( 43 ) );
+    cache.reject( 42 );
+    REQUIRE( !cache.load( 42 ) );
+    REQUIRE( cache.hits() == 0 );
+    REQUIRE( cache.misses() == 4 );
+}
+
+TEST_CASE( "Damaged cache entries miss", "[program-cache]" )
+{
+    TempDirectory_ dir;
+    ProgramBinaryCache cache( dir.path, "driver" );
+
+    ProgramBinary binary;
+    binary.format = 0x1234;
+    binary.data.assign( 64, 9 );
+    cache.store( 42, binary );
+
+    // Exactly one entry file
+    std::filesystem::path entry;
+    for( auto const& file : std::filesystem::directory_iterator( dir.path ) )
+        entry = file.path();
+    REQUIRE( !entry.empty() );
+
+    SECTION( "Truncated" )
+    {
+        std::filesystem::resize_file( entry, std::filesystem::file_size( entry ) - 1 );
+    }
+
+    SECTION( "Size field larger than the file" )
+    {
+        // The size is the last field of the 32 byte header
+        std::fstream file( entry, std::ios::in | std::ios::out | std::ios::binary );
+        std::uint64_t const size = ~std::uint64_t(0);
+        file.seekp( 24 );
+        file.write( reinterpret_cast<char const*>(&size), sizeof(size) );
+    }
+
+    REQUIRE( !cache.load( 42 ) );
+    REQUIRE( cache.misses() == 1 );
+    REQUIRE( !std::filesystem::exists( entry ) );
+}
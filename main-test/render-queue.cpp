@@ -0,0 +1,89 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/render_queue.hpp"
+
+#include <random>
+#include <algorithm>
+
+TEST_CASE( "Render queue radix sort", "[render_queue]" )
+{
+    std::mt19937_64 rng( 42 );
+
+    auto const check_sorted = [] ( std::vector<RenderSortEntry> aEntries ) {
+        auto expected = aEntries;
+        std::stable_sort( expected.begin(), expected.end(), [] ( auto const& aA, auto const& aB ) {
+            return aA.key < aB.key;
+        } );
+
+        std::vector<RenderSortEntry> scratch;
+        radix_sort( aEntries, scratch );
+
+        REQUIRE( aEntries.size() == expected.size() );
+        for( std::size_t i = 0; i < aEntries.size(); ++i )
+        {
+            REQUIRE( aEntries[i].key == expected[i].key );
+            REQUIRE( aEntries[i].index == expected[i].index ); // Stable
+        }
+    };
+
+    SECTION( "Random keys" )
+    {
+        std::vector<RenderSortEntry> entries;
+        for( std::uint32_t i = 0; i < 5000; ++i )
+            entries.push_back( { rng(), i } );
+
+        check_sorted( entries );
+    }
+
+    SECTION( "Keys differing in few digits, with ties" )
+    {
+        // Exercises the skipped passes (odd and even number of swaps)
+        std::vector<RenderSortEntry> entries;
+        for( std::uint32_t i = 0; i < 1000; ++i )
+            entries.push_back( { 0x1234'0000'0000'0000ull | (rng() & 0x0f00ull), i } );
+        check_sorted( entries );
+
+        for( auto& entry : entries )
+            entry.key |= (rng() & 0xffull) << 40;
+        check_sorted( entries );
+    }
+
+    SECTION( "Trivial inputs" )
+    {
+        check_sorted( {} );
+        check_sorted( { { 7, 0 } } );
+        check_sorted( { { 5, 0 }, { 5, 1 }, { 5, 2 } } );
+    }
+}
+
+TEST_CASE( "Render queue sort keys", "[render_queue]" )
+{
+    SECTION( "Opaque before transparent" )
+    {
+        REQUIRE( make_sort_key( RenderPass::opaque, 255, 4095, 4095, 255, 1e6f )
+            < make_sort_key( RenderPass::transparent, 0, 0, 0, 0, 0.f ) );
+    }
+
+    SECTION( "Opaque: grouped by state, then front to back" )
+    {
+        auto const near = make_sort_key( RenderPass::opaque, 3, 1, 2, 1, 1.f );
+        auto const far = make_sort_key( RenderPass::opaque, 3, 1, 2, 1, 50.f );
+        auto const otherProgram = make_sort_key( RenderPass::opaque, 4, 1, 2, 1, 0.5f );
+        auto const otherMaterial = make_sort_key( RenderPass::opaque, 3, 2, 0, 0, 0.5f );
+
+        REQUIRE( near < far );
+        REQUIRE( far < otherMaterial );
+        REQUIRE( otherMaterial < otherProgram );
+
+        // Behind the camera sorts as depth zero
+        REQUIRE( make_sort_key( RenderPass::opaque, 3, 1, 2, 1, -4.f ) < near );
+    }
+
+    SECTION( "Transparent: back to front" )
+    {
+        auto const near = make_sort_key( RenderPass::transparent, 3, 1, 2, 1, 0.25f );
+        auto const far = make_sort_key( RenderPass::transparent, 9, 1, 2, 1, 20.f );
+
+        REQUIRE( far < near );
+    }
+}
@@ -0,0 +1,86 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/run_options.hpp"
+
+#include "../support/error.hpp"
+
+namespace
+{
+    template< std::size_t tCount >
+    RunOptions parse_( char const* const (&aArgs)[tCount] )
+    {
+        return parse_run_options( int(tCount), aArgs );
+    }
+}
+
+TEST_CASE( "Without options, run windowed until closed", "[run-options]" )
+{
+    char const* const args[] = { "main" };
+    auto const options = parse_( args );
+
+    REQUIRE( !options.headless );
+    REQUIRE( options.width == 1280 );
+    REQUIRE( options.height == 720 );
+    REQUIRE( options.frames == 0 );
+}
+
+TEST_CASE( "Headless options", "[run-options]" )
+{
+    SECTION( "Headless runs end by default" )
+    {
+        char const* const args[] = { "main", "--headless" };
+        auto const options = parse_( args );
+
+        REQUIRE( options.headless );
+        REQUIRE( options.context == HeadlessContext::egl );
+        REQUIRE( options.frames == kDefaultHeadlessFrames );
+    }
+
+    SECTION( "All options" )
+    {
+        char const* const args[] = { "main", "--headless", "--context=osmesa", "--size=640x360", "--frames=50" };
+        auto const options = parse_( args );
+
+        REQUIRE( options.headless );
+        REQUIRE( options.context == HeadlessContext::osmesa );
+        REQUIRE( options.width == 640 );
+        REQUIRE( options.height == 360 );
+        REQUIRE( options.frames == 50 );
+    }
+}
+
+TEST_CASE( "Recording options", "[run-options]" )
+{
+    SECTION( "Record" )
+    {
+        char const* const args[] = { "main", "--record=session.input", "--seed=42" };
+        auto const options = parse_( args );
+
+        REQUIRE( options.record == "session.input" );
+        REQUIRE( options.replay.empty() );
+        REQUIRE( options.seed == 42u );
+    }
+
+    SECTION( "Replay" )
+    {
+        char const* const args[] = { "main", "--headless", "--replay=session.input" };
+        auto const options = parse_( args );
+
+        REQUIRE( options.headless );
+        REQUIRE( options.replay == "session.input" );
+        REQUIRE( !options.seed );
+    }
+}
+
+TEST_CASE( "Invalid options throw", "[run-options]" )
+{
+    char const* const arg = GENERATE( "--size=640", "--size=0x100", "--size=axb", "--frames=0", "--frames=-3",
+        "--context=glx", "--headles", "--frames",
+        "--record=", "--seed=-1", "--seed=x" );
+
+    char const* const args[] = { "main", arg };
+    REQUIRE_THROWS_AS( parse_( args ), Error );
+
+    char const* const both[] = { "main", "--record=a.input", "--replay=b.input" };
+    REQUIRE_THROWS_AS( parse_( both ), Error );
+}
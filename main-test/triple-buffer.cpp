@@ -0,0 +1,74 @@
+#include <catch2/catch_amalgamated.hpp>
+
+#include "../main/triple_buffer.hpp"
+
+#include <thread>
+#include <vector>
+
+TEST_CASE( "The consumer sees the latest published value", "[triple-buffer]" )
+{
+    TripleBuffer<int> buffer;
+
+    REQUIRE( !buffer.acquire() );
+
+    buffer.back() = 1;
+    buffer.publish();
+    buffer.back() = 2;
+    buffer.publish();
+
+    REQUIRE( buffer.published() == 2 );
+    REQUIRE( buffer.acquire() );
+    REQUIRE( buffer.front() == 2 );
+
+    // Nothing new: front() stays
+    REQUIRE( !buffer.acquire() );
+    REQUIRE( buffer.front() == 2 );
+
+    buffer.back() = 3;
+    buffer.publish();
+    REQUIRE( buffer.acquire() );
+    REQUIRE( buffer.front() == 3 );
+}
+
+TEST_CASE( "Published values are not written while read", "[triple-buffer]" )
+{
+    // Each value is a run of equal numbers; a torn read would mix two
+    struct Value_
+    {
+        std::vector<int> data = std::vector<int>( 256, 0 );
+    };
+
+    TripleBuffer<Value_> buffer;
+    constexpr int kCount = 20000;
+
+    std::thread producer( [&] {
+        for( int i = 1; i <= kCount; ++i )
+        {
+            buffer.back().data.assign( 256, i );
+            buffer.publish();
+        }
+    } );
+
+    int last = 0;
+    bool consistent = true, increasing = true;
+    std::uint64_t seen = 0;
+    while( last < kCount )
+    {
+        seen = buffer.wait( seen );
+        if( !buffer.acquire() )
+            continue;
+
+        auto const& data = buffer.front().data;
+        for( int const x : data )
+            consistent = consistent && (x == data.front());
+
+        increasing = increasing && (data.front() > last);
+        last = data.front();
+    }
+
+    producer.join();
+
+    REQUIRE( consistent );
+    REQUIRE( increasing );
+    REQUIRE( buffer.published() == std::uint64_t(kCount) );
+}
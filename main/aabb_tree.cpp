@@ -0,0 +1,368 @@
+#include "aabb_tree.hpp"
+
+#include <utility>
+#include <algorithm>
+
+#include "../support/error.hpp"
+
+AabbTree::AabbTree( float aMargin )
+    : mMargin( aMargin )
+{}
+
+std::int32_t AabbTree::insert( Aabb const& aBox, std::uint32_t aUserData )
+{
+    std::int32_t const proxy = allocate_node_();
+
+    Node_& node = mNodes[proxy];
+    node.box = expand( aBox, mMargin );
+    node.userData = aUserData;
+    node.height = 0;
+
+    insert_leaf_( proxy );
+    ++mLeafCount;
+
+    return proxy;
+}
+
+void AabbTree::remove( std::int32_t aProxy )
+{
+    check_proxy_( aProxy );
+
+    remove_leaf_( aProxy );
+    free_node_( aProxy );
+    --mLeafCount;
+}
+
+bool AabbTree::move( std::int32_t aProxy, Aabb const& aBox )
+{
+    check_proxy_( aProxy );
+
+    if( contains( mNodes[aProxy].box, aBox ) )
+        return false;
+
+    remove_leaf_( aProxy );
+    mNodes[aProxy].box = expand( aBox, mMargin );
+    insert_leaf_( aProxy );
+
+    return true;
+}
+
+void AabbTree::clear()
+{
+    mNodes.clear();
+    mRoot = kNull;
+    mFreeList = kNull;
+    mLeafCount = 0;
+}
+
+Aabb const& AabbTree::fat_bounds( std::int32_t aProxy ) const
+{
+    check_proxy_( aProxy );
+    return mNodes[aProxy].box;
+}
+
+std::uint32_t AabbTree::user_data( std::int32_t aProxy ) const
+{
+    check_proxy_( aProxy );
+    return mNodes[aProxy].userData;
+}
+
+std::size_t AabbTree::size() const noexcept
+{
+    return mLeafCount;
+}
+
+int AabbTree::height() const noexcept
+{
+    return kNull == mRoot ? 0 : mNodes[mRoot].height;
+}
+
+void AabbTree::validate() const
+{
+    if( kNull == mRoot )
+    {
+        if( 0 != mLeafCount )
+            throw Error( "AabbTree: empty tree with %zu leaves", mLeafCount );
+        return;
+    }
+
+    if( kNull != mNodes[mRoot].parent )
+        throw Error( "AabbTree: root has a parent" );
+
+    std::size_t leaves = 0;
+    std::vector<std::int32_t> stack{ mRoot };
+    while( !stack.empty() )
+    {
+        std::int32_t const index = stack.back();
+        stack.pop_back();
+
+        Node_ const& node = mNodes[index];
+        if( node.is_leaf() )
+        {
+            if( 0 != node.height || kNull != node.child2 )
+                throw Error( "AabbTree: malformed leaf %d", int(index) );
+            ++leaves;
+            continue;
+        }
+
+        Node_ const& c1 = mNodes[node.child1];
+        Node_ const& c2 = mNodes[node.child2];
+        if( c1.parent != index || c2.parent != index )
+            throw Error( "AabbTree: broken parent link below %d", int(index) );
+        if( node.height != 1 + std::max( c1.height, c2.height ) )
+            throw Error( "AabbTree: wrong height at %d", int(index) );
+        if( std::abs( c1.height - c2.height ) > 1 )
+            throw Error( "AabbTree: unbalanced at %d (%d vs %d)", int(index), int(c1.height), int(c2.height) );
+        if( !contains( node.box, c1.box ) || !contains( node.box, c2.box ) )
+            throw Error( "AabbTree: box of %d does not enclose its children", int(index) );
+
+        stack.emplace_back( node.child1 );
+        stack.emplace_back( node.child2 );
+    }
+
+    if( leaves != mLeafCount )
+        throw Error( "AabbTree: found %zu leaves, expected %zu", leaves, mLeafCount );
+}
+
+std::int32_t AabbTree::nearest( Vec3f aPoint, float aMaxDistance ) const
+{
+    if( kNull == mRoot )
+        return kNull;
+
+    struct Entry_
+    {
+        std::int32_t node;
+        float distSq;
+    };
+
+    std::int32_t best = kNull;
+    float bestSq = aMaxDistance < std::numeric_limits<float>::max() ? aMaxDistance * aMaxDistance : aMaxDistance;
+
+    std::vector<Entry_> stack;
+    stack.reserve( 64 );
+    stack.emplace_back( Entry_{ mRoot, distance_squared( mNodes[mRoot].box, aPoint ) } );
+
+    while( !stack.empty() )
+    {
+        Entry_ const entry = stack.back();
+        stack.pop_back();
+
+        if( entry.distSq > bestSq )
+            continue;
+
+        Node_ const& node = mNodes[entry.node];
+        if( node.is_leaf() )
+        {
+            best = entry.node;
+            bestSq = entry.distSq;
+            continue;
+        }
+
+        // Visit the closer child first; it is more likely to tighten bestSq
+        float const d1 = distance_squared( mNodes[node.child1].box, aPoint );
+        float const d2 = distance_squared( mNodes[node.child2].box, aPoint );
+        if( d1 < d2 )
+        {
+            stack.emplace_back( Entry_{ node.child2, d2 } );
+            stack.emplace_back( Entry_{ node.child1, d1 } );
+        }
+        else
+        {
+            stack.emplace_back( Entry_{ node.child1, d1 } );
+            stack.emplace_back( Entry_{ node.child2, d2 } );
+        }
+    }
+
+    return best;
+}
+
+std::int32_t AabbTree::allocate_node_()
+{
+    if( kNull == mFreeList )
+    {
+        mNodes.emplace_back();
+        return std::int32_t(mNodes.size() - 1);
+    }
+
+    std::int32_t const index = mFreeList;
+    mFreeList = mNodes[index].parent;
+    mNodes[index] = Node_{};
+    return index;
+}
+
+void AabbTree::free_node_( std::int32_t aIndex )
+{
+    mNodes[aIndex] = Node_{};
+    mNodes[aIndex].parent = mFreeList;
+    mFreeList = aIndex;
+}
+
+void AabbTree::insert_leaf_( std::int32_t aLeaf )
+{
+    if( kNull == mRoot )
+    {
+        mRoot = aLeaf;
+        mNodes[aLeaf].parent = kNull;
+        return;
+    }
+
+    // Descend towards the sibling with the lowest cost. Creating a parent for
+    // sibling S costs SA(S + leaf); every ancestor grows by
+    // SA(A + leaf) - SA(A) (the inheritance cost).
+    Aabb const leafBox = mNodes[aLeaf].box;
+
+    std::int32_t index = mRoot;
+    while( !mNodes[index].is_leaf() )
+    {
+        Node_ const& node = mNodes[index];
+
+        float const area = surface_area( node.box );
+        float const combinedArea = surface_area( merge( node.box, leafBox ) );
+
+        float const cost = 2.f * combinedArea;
+        float const inheritance = 2.f * (combinedArea - area);
+
+        auto const child_cost = [&] ( std::int32_t aChild ) {
+            Node_ const& child = mNodes[aChild];
+            float const merged = surface_area( merge( child.box, leafBox ) );
+            return child.is_leaf() ? merged + inheritance : (merged - surface_area( child.box )) + inheritance;
+        };
+
+        float const cost1 = child_cost( node.child1 );
+        float const cost2 = child_cost( node.child2 );
+
+        if( cost < cost1 && cost < cost2 )
+            break;
+
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    // Replace the sibling with a new parent of sibling and leaf
+    std::int32_t const sibling = index;
+    std::int32_t const oldParent = mNodes[sibling].parent;
+    std::int32_t const newParent = allocate_node_();
+
+    mNodes[newParent].parent = oldParent;
+    mNodes[newParent].box = merge( leafBox, mNodes[sibling].box );
+    mNodes[newParent].height = mNodes[sibling].height + 1;
+    mNodes[newParent].child1 = sibling;
+    mNodes[newParent].child2 = aLeaf;
+    mNodes[sibling].parent = newParent;
+    mNodes[aLeaf].parent = newParent;
+
+    if( kNull == oldParent )
+        mRoot = newParent;
+    else if( mNodes[oldParent].child1 == sibling )
+        mNodes[oldParent].child1 = newParent;
+    else
+        mNodes[oldParent].child2 = newParent;
+
+    refit_from_( mNodes[aLeaf].parent );
+}
+
+void AabbTree::remove_leaf_( std::int32_t aLeaf )
+{
+    if( aLeaf == mRoot )
+    {
+        mRoot = kNull;
+        return;
+    }
+
+    std::int32_t const parent = mNodes[aLeaf].parent;
+    std::int32_t const grandParent = mNodes[parent].parent;
+    std::int32_t const sibling = mNodes[parent].child1 == aLeaf ? mNodes[parent].child2 : mNodes[parent].child1;
+
+    // The sibling takes the parent's place
+    if( kNull == grandParent )
+    {
+        mRoot = sibling;
+        mNodes[sibling].parent = kNull;
+    }
+    else
+    {
+        if( mNodes[grandParent].child1 == parent )
+            mNodes[grandParent].child1 = sibling;
+        else
+            mNodes[grandParent].child2 = sibling;
+
+        mNodes[sibling].parent = grandParent;
+        refit_from_( grandParent );
+    }
+
+    free_node_( parent );
+    mNodes[aLeaf].parent = kNull;
+}
+
+void AabbTree::refit_from_( std::int32_t aIndex )
+{
+    for( std::int32_t index = aIndex; kNull != index; index = mNodes[index].parent )
+    {
+        index = balance_( index );
+
+        Node_& node = mNodes[index];
+        node.height = 1 + std::max( mNodes[node.child1].height, mNodes[node.child2].height );
+        node.box = merge( mNodes[node.child1].box, mNodes[node.child2].box );
+    }
+}
+
+std::int32_t AabbTree::balance_( std::int32_t aA )
+{
+    // Rotates the taller grandchild of A up if A's children differ in height
+    // by more than one. Returns the index of the subtree's new root.
+    Node_& a = mNodes[aA];
+    if( a.is_leaf() || a.height < 2 )
+        return aA;
+
+    std::int32_t const iB = a.child1;
+    std::int32_t const iC = a.child2;
+    int const balance = mNodes[iC].height - mNodes[iB].height;
+
+    if( balance >= -1 && balance <= 1 )
+        return aA;
+
+    // The taller child (up) moves up and takes A's place; A adopts one of
+    // up's children (the shorter one) in place of up.
+    std::int32_t const up = balance > 1 ? iC : iB;
+    std::int32_t const other = balance > 1 ? iB : iC;
+
+    Node_& u = mNodes[up];
+    std::int32_t const iF = u.child1;
+    std::int32_t const iG = u.child2;
+
+    // Swap A and up
+    u.child1 = aA;
+    u.parent = a.parent;
+    a.parent = up;
+
+    if( kNull == u.parent )
+        mRoot = up;
+    else if( mNodes[u.parent].child1 == aA )
+        mNodes[u.parent].child1 = up;
+    else
+        mNodes[u.parent].child2 = up;
+
+    // The taller of up's children stays with up; the other goes to A
+    std::int32_t const keep = mNodes[iF].height > mNodes[iG].height ? iF : iG;
+    std::int32_t const give = keep == iF ? iG : iF;
+
+    u.child2 = keep;
+    if( balance > 1 )
+        a.child2 = give;
+    else
+        a.child1 = give;
+    mNodes[give].parent = aA;
+
+    a.box = merge( mNodes[other].box, mNodes[give].box );
+    a.height = 1 + std::max( mNodes[other].height, mNodes[give].height );
+
+    u.box = merge( a.box, mNodes[keep].box );
+    u.height = 1 + std::max( a.height, mNodes[keep].height );
+
+    return up;
+}
+
+void AabbTree::check_proxy_( std::int32_t aProxy ) const
+{
+    if( aProxy < 0 || std::size_t(aProxy) >= mNodes.size() || 0 != mNodes[aProxy].height )
+        throw Error( "AabbTree: invalid proxy %d", int(aProxy) );
+}
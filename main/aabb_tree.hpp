@@ -0,0 +1,326 @@
+#ifndef AABB_TREE_HPP_8C4C733D_9982_434C_90C6_A3433068580E
+#define AABB_TREE_HPP_8C4C733D_9982_434C_90C6_A3433068580E
+
+#include <limits>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bounds.hpp"
+#include "frustum_cull.hpp"
+
+#include "../support/job_system.hpp"
+
+#include "../vmlib/vec3.hpp"
+
+// Dynamic AABB tree
+//
+// A binary bounding volume hierarchy over the bounds of scene objects, in the
+// style of the dynamic trees used by physics engines. Each object is a leaf
+// (a proxy) that stores a "fat" box, its bounds grown by a margin. Moving an
+// object only touches the tree when its new bounds leave the fat box; the
+// leaf is then removed and reinserted. Insertion picks the sibling with the
+// smallest increase in surface area, and the path to the root is rebalanced
+// with AVL-style rotations, so the height stays logarithmic.
+//
+// Queries report leaves through a callback, with the user data given at
+// insertion:
+//  - query( frustums, count, f ) visits the leaves that intersect any of up
+//    to kMaxQueryViews frustums in a single traversal, f( userData, mask ).
+//    Subtrees fully inside a frustum are accepted without further tests.
+//    parallel_query() is the same query, with subtrees traversed as jobs of
+//    the shared job system once the tree has kParallelQueryLeaves leaves.
+//  - raycast( origin, dir, maxT, f ) visits leaves along a ray, nearest
+//    first; f( userData, tEntry ) returns the object's exact hit distance or
+//    a negative value for a miss, and the closest hit is returned.
+//  - nearest( point ) returns the leaf whose box is closest to a point.
+//
+// Proxies are node indices; they stay valid until removed.
+
+struct AabbRayHit
+{
+    std::int32_t proxy = -1;  // AabbTree::kNull if nothing was hit
+    std::uint32_t userData = 0;
+    float distance = std::numeric_limits<float>::max();
+};
+
+class AabbTree final
+{
+    public:
+        static constexpr std::int32_t kNull = -1;
+        static constexpr std::size_t kMaxQueryViews = 32;
+        static constexpr std::size_t kParallelQueryLeaves = 2048;
+
+    public:
+        explicit AabbTree( float aMargin = 0.1f );
+
+    public:
+        std::int32_t insert( Aabb const&, std::uint32_t aUserData );
+        void remove( std::int32_t aProxy );
+
+        // Updates the bounds of a proxy. Returns true if the proxy had to be
+        // reinserted, false if the bounds still fit the fat box.
+        bool move( std::int32_t aProxy, Aabb const& );
+
+        void clear();
+
+        Aabb const& fat_bounds( std::int32_t aProxy ) const;
+        std::uint32_t user_data( std::int32_t aProxy ) const;
+
+        std::size_t size() const noexcept;  // Number of proxies
+        int height() const noexcept;        // 0 for a single leaf
+
+        // Checks the structural invariants; throws Error if one is violated.
+        void validate() const;
+
+        template< typename tFunc >
+        void query( Frustum const* aFrustums, std::size_t aCount, tFunc&& aFunc ) const;
+
+        // As query(), but aFunc may be called concurrently from several
+        // threads (for distinct leaves).
+        template< typename tFunc >
+        void parallel_query( Frustum const* aFrustums, std::size_t aCount, tFunc&& aFunc ) const;
+
+        template< typename tFunc >
+        AabbRayHit raycast( Vec3f aOrigin, Vec3f aDirection, float aMaxDistance, tFunc&& aFunc ) const;
+
+        std::int32_t nearest( Vec3f aPoint, float aMaxDistance = std::numeric_limits<float>::max() ) const;
+
+    private:
+        struct Node_
+        {
+            Aabb box;
+            std::uint32_t userData = 0;
+            std::int32_t parent = kNull;  // Next free node while on the free list
+            std::int32_t child1 = kNull;
+            std::int32_t child2 = kNull;
+            std::int32_t height = -1;     // 0 for leaves, -1 for free nodes
+
+            bool is_leaf() const noexcept { return kNull == child1; }
+        };
+
+        // A node of a frustum query: views whose frustum still cuts the
+        // node's box (active), and views whose frustum contains it (inside)
+        struct QueryEntry_
+        {
+            std::int32_t node;
+            std::uint32_t active;
+            std::uint32_t inside;
+        };
+
+        static std::uint32_t all_views_( std::size_t aCount ) noexcept;
+
+        // Tests the node against the entry's active views. Returns false if
+        // the node is outside of all views.
+        bool classify_( Frustum const*, QueryEntry_& ) const noexcept;
+
+        template< typename tFunc >
+        void query_from_( Frustum const*, QueryEntry_, std::vector<QueryEntry_>& aStack, tFunc& ) const;
+
+        std::int32_t allocate_node_();
+        void free_node_( std::int32_t );
+
+        void insert_leaf_( std::int32_t );
+        void remove_leaf_( std::int32_t );
+        void refit_from_( std::int32_t );
+        std::int32_t balance_( std::int32_t );
+
+        void check_proxy_( std::int32_t ) const;
+
+        std::vector<Node_> mNodes;
+        std::int32_t mRoot = kNull;
+        std::int32_t mFreeList = kNull;
+        std::size_t mLeafCount = 0;
+
+        float mMargin;
+};
+
+template< typename tFunc >
+void AabbTree::query( Frustum const* aFrustums, std::size_t aCount, tFunc&& aFunc ) const
+{
+    if( kNull == mRoot || 0 == aCount )
+        return;
+
+    std::vector<QueryEntry_> stack;
+    stack.reserve( 64 );
+    query_from_( aFrustums, QueryEntry_{ mRoot, all_views_( aCount ), 0 }, stack, aFunc );
+}
+
+template< typename tFunc >
+void AabbTree::parallel_query( Frustum const* aFrustums, std::size_t aCount, tFunc&& aFunc ) const
+{
+    if( mLeafCount < kParallelQueryLeaves )
+    {
+        query( aFrustums, aCount, aFunc );
+        return;
+    }
+
+    if( 0 == aCount )
+        return;
+
+    // Splits the top of the tree, breadth first, into a few subtrees per
+    // thread. Subtrees outside of all views are dropped on the way.
+    JobSystem& jobs = job_system();
+    std::size_t const target = 4 * jobs.thread_count();
+
+    std::vector<QueryEntry_> subtrees{ QueryEntry_{ mRoot, all_views_( aCount ), 0 } };
+    std::vector<QueryEntry_> next;
+    for( bool split = true; split && subtrees.size() < target; )
+    {
+        split = false;
+        next.clear();
+        for( QueryEntry_ entry : subtrees )
+        {
+            Node_ const& node = mNodes[entry.node];
+            if( node.is_leaf() )
+            {
+                next.emplace_back( entry );
+                continue;
+            }
+
+            if( !classify_( aFrustums, entry ) )
+                continue;
+
+            next.emplace_back( QueryEntry_{ node.child1, entry.active, entry.inside } );
+            next.emplace_back( QueryEntry_{ node.child2, entry.active, entry.inside } );
+            split = true;
+        }
+        std::swap( subtrees, next );
+    }
+
+    jobs.parallel_for( 0, subtrees.size(), 1, [&] ( std::size_t aBegin, std::size_t aEnd ) {
+        std::vector<QueryEntry_> stack;
+        stack.reserve( 64 );
+        for( std::size_t i = aBegin; i < aEnd; ++i )
+            query_from_( aFrustums, subtrees[i], stack, aFunc );
+    } );
+}
+
+template< typename tFunc >
+void AabbTree::query_from_( Frustum const* aFrustums, QueryEntry_ aRoot, std::vector<QueryEntry_>& aStack, tFunc& aFunc ) const
+{
+    aStack.clear();
+    aStack.emplace_back( aRoot );
+
+    while( !aStack.empty() )
+    {
+        QueryEntry_ entry = aStack.back();
+        aStack.pop_back();
+
+        if( !classify_( aFrustums, entry ) )
+            continue;
+
+        Node_ const& node = mNodes[entry.node];
+        if( node.is_leaf() )
+            aFunc( node.userData, entry.active | entry.inside );
+        else
+        {
+            aStack.emplace_back( QueryEntry_{ node.child1, entry.active, entry.inside } );
+            aStack.emplace_back( QueryEntry_{ node.child2, entry.active, entry.inside } );
+        }
+    }
+}
+
+inline
+std::uint32_t AabbTree::all_views_( std::size_t aCount ) noexcept
+{
+    return aCount >= kMaxQueryViews ? ~std::uint32_t(0) : (std::uint32_t(1) << aCount) - 1;
+}
+
+inline
+bool AabbTree::classify_( Frustum const* aFrustums, QueryEntry_& aEntry ) const noexcept
+{
+    Node_ const& node = mNodes[aEntry.node];
+    for( std::uint32_t active = aEntry.active; active; active &= active - 1 )
+    {
+        std::uint32_t const view = std::uint32_t(__builtin_ctz( active ));
+        std::uint32_t const bit = std::uint32_t(1) << view;
+
+        FrustumTest const test = classify( aFrustums[view], node.box );
+        if( FrustumTest::outside == test )
+            aEntry.active &= ~bit;
+        else if( FrustumTest::inside == test )
+        {
+            aEntry.active &= ~bit;
+            aEntry.inside |= bit;
+        }
+    }
+
+    return 0 != (aEntry.active | aEntry.inside);
+}
+
+template< typename tFunc >
+AabbRayHit AabbTree::raycast( Vec3f aOrigin, Vec3f aDirection, float aMaxDistance, tFunc&& aFunc ) const
+{
+    AabbRayHit hit;
+    hit.distance = aMaxDistance;
+
+    if( kNull == mRoot )
+        return hit;
+
+    Vec3f const inv{ 1.f / aDirection.x, 1.f / aDirection.y, 1.f / aDirection.z };
+
+    struct Entry_
+    {
+        std::int32_t node;
+        float entry;
+    };
+
+    std::vector<Entry_> stack;
+    stack.reserve( 64 );
+
+    float rootEntry = 0.f;
+    if( intersect_ray( mNodes[mRoot].box, aOrigin, inv, hit.distance, rootEntry ) )
+        stack.emplace_back( Entry_{ mRoot, rootEntry } );
+
+    while( !stack.empty() )
+    {
+        Entry_ const entry = stack.back();
+        stack.pop_back();
+
+        // A closer hit may have been found since the node was pushed
+        if( entry.entry > hit.distance )
+            continue;
+
+        Node_ const& node = mNodes[entry.node];
+        if( node.is_leaf() )
+        {
+            float const t = aFunc( node.userData, entry.entry );
+            if( t >= 0.f && t <= hit.distance )
+            {
+                hit.proxy = entry.node;
+                hit.userData = node.userData;
+                hit.distance = t;
+            }
+            continue;
+        }
+
+        float t1 = 0.f, t2 = 0.f;
+        bool const hit1 = intersect_ray( mNodes[node.child1].box, aOrigin, inv, hit.distance, t1 );
+        bool const hit2 = intersect_ray( mNodes[node.child2].box, aOrigin, inv, hit.distance, t2 );
+
+        // Push the farther child first, so that the nearer one is visited first
+        if( hit1 && hit2 )
+        {
+            if( t1 < t2 )
+            {
+                stack.emplace_back( Entry_{ node.child2, t2 } );
+                stack.emplace_back( Entry_{ node.child1, t1 } );
+            }
+            else
+            {
+                stack.emplace_back( Entry_{ node.child1, t1 } );
+                stack.emplace_back( Entry_{ node.child2, t2 } );
+            }
+        }
+        else if( hit1 )
+            stack.emplace_back( Entry_{ node.child1, t1 } );
+        else if( hit2 )
+            stack.emplace_back( Entry_{ node.child2, t2 } );
+    }
+
+    return hit;
+}
+
+#endif // AABB_TREE_HPP_8C4C733D_9982_434C_90C6_A3433068580E
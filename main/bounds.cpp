@@ -0,0 +1,113 @@
+#include "bounds.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+
+bool is_empty( Aabb const& aBox ) noexcept
+{
+    return aBox.min.x > aBox.max.x || aBox.min.y > aBox.max.y || aBox.min.z > aBox.max.z;
+}
+
+Vec3f center( Aabb const& aBox ) noexcept
+{
+    return 0.5f * (aBox.min + aBox.max);
+}
+Vec3f half_extent( Aabb const& aBox ) noexcept
+{
+    return 0.5f * (aBox.max - aBox.min);
+}
+
+Aabb merge( Aabb const& aA, Aabb const& aB ) noexcept
+{
+    return Aabb{
+        Vec3f{ std::min( aA.min.x, aB.min.x ), std::min( aA.min.y, aB.min.y ), std::min( aA.min.z, aB.min.z ) },
+        Vec3f{ std::max( aA.max.x, aB.max.x ), std::max( aA.max.y, aB.max.y ), std::max( aA.max.z, aB.max.z ) }
+    };
+}
+Aabb merge( Aabb const& aBox, Vec3f aPoint ) noexcept
+{
+    return merge( aBox, Aabb{ aPoint, aPoint } );
+}
+
+Aabb expand( Aabb const& aBox, float aMargin ) noexcept
+{
+    Vec3f const m{ aMargin, aMargin, aMargin };
+    return Aabb{ aBox.min - m, aBox.max + m };
+}
+
+bool contains( Aabb const& aOuter, Aabb const& aInner ) noexcept
+{
+    return aOuter.min.x <= aInner.min.x && aOuter.min.y <= aInner.min.y && aOuter.min.z <= aInner.min.z
+        && aInner.max.x <= aOuter.max.x && aInner.max.y <= aOuter.max.y && aInner.max.z <= aOuter.max.z;
+}
+
+float surface_area( Aabb const& aBox ) noexcept
+{
+    if( is_empty( aBox ) )
+        return 0.f;
+
+    Vec3f const d = aBox.max - aBox.min;
+    return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+float distance_squared( Aabb const& aBox, Vec3f aPoint ) noexcept
+{
+    float const dx = std::max( { aBox.min.x - aPoint.x, 0.f, aPoint.x - aBox.max.x } );
+    float const dy = std::max( { aBox.min.y - aPoint.y, 0.f, aPoint.y - aBox.max.y } );
+    float const dz = std::max( { aBox.min.z - aPoint.z, 0.f, aPoint.z - aBox.max.z } );
+    return dx*dx + dy*dy + dz*dz;
+}
+
+bool intersect_ray( Aabb const& aBox, Vec3f aOrigin, Vec3f aInvDirection, float aMaxT, float& aEntry ) noexcept
+{
+    // Zero direction components give infinite reciprocals; the slab of that
+    // axis then either contains the ray (+-inf bounds) or rejects it.
+    float const tx0 = (aBox.min.x - aOrigin.x) * aInvDirection.x;
+    float const tx1 = (aBox.max.x - aOrigin.x) * aInvDirection.x;
+    float const ty0 = (aBox.min.y - aOrigin.y) * aInvDirection.y;
+    float const ty1 = (aBox.max.y - aOrigin.y) * aInvDirection.y;
+    float const tz0 = (aBox.min.z - aOrigin.z) * aInvDirection.z;
+    float const tz1 = (aBox.max.z - aOrigin.z) * aInvDirection.z;
+
+    float const tmin = std::max( { std::min( tx0, tx1 ), std::min( ty0, ty1 ), std::min( tz0, tz1 ), 0.f } );
+    float const tmax = std::min( { std::max( tx0, tx1 ), std::max( ty0, ty1 ), std::max( tz0, tz1 ), aMaxT } );
+
+    if( tmin > tmax )
+        return false;
+
+    aEntry = tmin;
+    return true;
+}
+
+Aabb transform_aabb( Aabb const& aBox, Mat44f const& aM ) noexcept
+{
+    if( is_empty( aBox ) )
+        return aBox;
+
+    // Transform the center, and the half extent by the absolute value of the
+    // linear part (Arvo, "Transforming Axis-Aligned Bounding Boxes").
+    Vec3f const c = center( aBox );
+    Vec3f const e = half_extent( aBox );
+
+    Vec3f const cw{
+        aM(0,0) * c.x + aM(0,1) * c.y + aM(0,2) * c.z + aM(0,3),
+        aM(1,0) * c.x + aM(1,1) * c.y + aM(1,2) * c.z + aM(1,3),
+        aM(2,0) * c.x + aM(2,1) * c.y + aM(2,2) * c.z + aM(2,3)
+    };
+    Vec3f const ew{
+        std::abs( aM(0,0) ) * e.x + std::abs( aM(0,1) ) * e.y + std::abs( aM(0,2) ) * e.z,
+        std::abs( aM(1,0) ) * e.x + std::abs( aM(1,1) ) * e.y + std::abs( aM(1,2) ) * e.z,
+        std::abs( aM(2,0) ) * e.x + std::abs( aM(2,1) ) * e.y + std::abs( aM(2,2) ) * e.z
+    };
+
+    return Aabb{ cw - ew, cw + ew };
+}
+
+Aabb aabb_of( std::vector<Vec3f> const& aPoints ) noexcept
+{
+    Aabb box;
+    for( auto const& p : aPoints )
+        box = merge( box, p );
+    return box;
+}
@@ -0,0 +1,51 @@
+#ifndef BOUNDS_HPP_1E5115E1_AD3E_46E8_AF2C_E112A8E7701C
+#define BOUNDS_HPP_1E5115E1_AD3E_46E8_AF2C_E112A8E7701C
+
+#include <vector>
+#include <limits>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+// Axis aligned bounding boxes
+//
+// A default constructed Aabb is empty (min > max); merging anything into it
+// yields that thing. Bounds of meshes are computed in model space and moved
+// to world space with transform_aabb().
+
+struct Aabb
+{
+    Vec3f min{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    Vec3f max{ -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(), -std::numeric_limits<float>::max() };
+};
+
+bool is_empty( Aabb const& ) noexcept;
+
+Vec3f center( Aabb const& ) noexcept;
+Vec3f half_extent( Aabb const& ) noexcept;
+
+Aabb merge( Aabb const&, Aabb const& ) noexcept;
+Aabb merge( Aabb const&, Vec3f ) noexcept;
+
+Aabb expand( Aabb const&, float aMargin ) noexcept;
+
+// True if aInner lies completely inside aOuter
+bool contains( Aabb const& aOuter, Aabb const& aInner ) noexcept;
+
+float surface_area( Aabb const& ) noexcept;
+
+// Squared distance from the point to the box; zero inside the box.
+float distance_squared( Aabb const&, Vec3f ) noexcept;
+
+// Slab test of the ray aOrigin + t * aDirection, t in [0, aMaxT], where
+// aInvDirection holds the reciprocals of the direction's components. On a
+// hit, returns true and the entry distance in aEntry (0 if aOrigin is inside).
+bool intersect_ray( Aabb const&, Vec3f aOrigin, Vec3f aInvDirection, float aMaxT, float& aEntry ) noexcept;
+
+// Bounds of the box after an affine transform. The result is the tightest
+// Aabb of the transformed box, not of the original geometry.
+Aabb transform_aabb( Aabb const&, Mat44f const& ) noexcept;
+
+Aabb aabb_of( std::vector<Vec3f> const& aPoints ) noexcept;
+
+#endif // BOUNDS_HPP_1E5115E1_AD3E_46E8_AF2C_E112A8E7701C
@@ -8,6 +8,8 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 
+#include "gl_state.hpp"
+
 class Button {
 public:
     struct Vertex {
@@ -39,49 +41,56 @@ public:
 
     ~Button() {
         glDeleteVertexArrays(1, &vao_);
+        gl_state().forget_vertex_array(vao_);
         glDeleteBuffers(1, &vbo_);
     }
 
     void setOnClick(std::function<void()> callback) { onClick_ = callback; }
     void setColors(const ButtonColors& colors) { colors_ = colors; }
 
-    void update(GLFWwindow* window) {
-        int windowWidth, windowHeight;
-        glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
-        updateScreenCoordinates(windowWidth, windowHeight);
-
-        double mouseX, mouseY;
-        glfwGetCursorPos(window, &mouseX, &mouseY);
+    // Handles the mouse and returns the button's new state. The cursor is
+    // in window coordinates (y down), as reported by GLFW; the caller tracks
+    // it from input events, so that replayed input clicks too. Makes no GL
+    // calls: it runs on the input thread, render() on the render thread.
+    State update(double mouseX, double mouseY, int windowWidth, int windowHeight, bool pressed) {
         mouseY = windowHeight - mouseY;
 
-        bool isInside = isPointInside(mouseX, mouseY);
-        int buttonState = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
+        bool isInside = isPointInside(mouseX, mouseY, windowWidth, windowHeight);
 
         if (!isInside) state_ = State::NEUTRAL;
-        else if (buttonState == GLFW_PRESS) state_ = State::PRESSED;
-        else if (state_ == State::PRESSED && buttonState == GLFW_RELEASE) {
+        else if (pressed) state_ = State::PRESSED;
+        else if (state_ == State::PRESSED) {
             if (onClick_) onClick_();
             state_ = State::HOVER;
         }
         else state_ = State::HOVER;
 
-        updateVertexColors();
+        return state_;
     }
 
-    void render(int screenWidth, int screenHeight) {
-        glUseProgram(shader_);
+    // Draws the button in the given state (as returned by update())
+    void render(int screenWidth, int screenHeight, State state) {
+        if (screenWidth != drawnWidth_ || screenHeight != drawnHeight_)
+            updateScreenCoordinates(screenWidth, screenHeight);
+        if (state != drawnState_) {
+            drawnState_ = state;
+            updateVertexColors();
+        }
+
+        GlStateCache& gl = gl_state();
+        gl.use_program(shader_);
 
         // Setup render state
-        glDisable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        gl.disable(GL_DEPTH_TEST);
+        gl.enable(GL_BLEND);
+        gl.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         // Send screen dims to shader
         glUniform2f(0, screenWidth, screenHeight);
 
 
         // Draw button (both border and fill)
-        glBindVertexArray(vao_);
+        gl.bind_vertex_array(vao_);
         glDrawArrays(GL_TRIANGLES, 0, 12); // 6 vertices for outer rect, 6 for inner
 
         // Render text
@@ -108,11 +117,7 @@ public:
             fonsDrawText(fontContext_, textX, textY, text_.c_str(), nullptr);
         }
 
-        // Reset state
-        glEnable(GL_DEPTH_TEST);
-        glDisable(GL_BLEND);
-        glBindVertexArray(0);
-        glUseProgram(0);
+        // No state is reset; the next pass sets what it needs
     }
 
 private:
@@ -120,7 +125,7 @@ private:
         glGenVertexArrays(1, &vao_);
         glGenBuffers(1, &vbo_);
 
-        glBindVertexArray(vao_);
+        gl_state().bind_vertex_array(vao_);
         glBindBuffer(GL_ARRAY_BUFFER, vbo_);
 
         // Position attribute
@@ -136,6 +141,9 @@ private:
     }
 
     void updateScreenCoordinates(int windowWidth, int windowHeight) {
+        drawnWidth_ = windowWidth;
+        drawnHeight_ = windowHeight;
+
         screenX_ = normalizedX_ * windowWidth;
         screenY_ = normalizedY_ * windowHeight;
         screenWidth_ = normalizedWidth_ * windowWidth;
@@ -184,7 +192,7 @@ private:
 
     void updateVertexColors() {
         const float* fillColor;
-        switch (state_) {
+        switch (drawnState_) {
         case State::HOVER: fillColor = colors_.hoverFill; break;
         case State::PRESSED: fillColor = colors_.pressedFill; break;
         default: fillColor = colors_.neutralFill;
@@ -207,9 +215,10 @@ private:
         glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
     }
 
-    bool isPointInside(double px, double py) const {
-        return px >= screenX_ && px <= screenX_ + screenWidth_ &&
-            py >= screenY_ && py <= screenY_ + screenHeight_;
+    bool isPointInside(double px, double py, int windowWidth, int windowHeight) const {
+        double const x = normalizedX_ * windowWidth, y = normalizedY_ * windowHeight;
+        return px >= x && px <= x + normalizedWidth_ * windowWidth &&
+            py >= y && py <= y + normalizedHeight_ * windowHeight;
     }
 
     float normalizedX_, normalizedY_;
@@ -218,8 +227,11 @@ private:
     float screenWidth_, screenHeight_;
     float borderThickness_;
 
+    int drawnWidth_ = 0, drawnHeight_ = 0;  // Render thread
+
     std::string text_;
-    State state_;
+    State state_;                           // Input thread
+    State drawnState_ = State::NEUTRAL;     // Render thread
     ButtonColors colors_;
     FONScontext* fontContext_;
     int fontId_;
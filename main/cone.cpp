@@ -58,13 +58,14 @@ SimpleMeshData make_cone(
         if (aCapped) {
             Vec3f baseNormal = Vec3f{ -1.f, 0.f, 0.f };
 
+            // Counter-clockwise when viewed from -x
             data.positions.emplace_back(Vec3f{ 0.f, prevY, prevZ });
             data.normals.emplace_back(normalize(N * baseNormal));
 
-            data.positions.emplace_back(Vec3f{ 0.f, y, z });
+            data.positions.emplace_back(Vec3f{ 0.f, 0.f, 0.f });
             data.normals.emplace_back(normalize(N * baseNormal));
 
-            data.positions.emplace_back(Vec3f{ 0.f, 0.f, 0.f });
+            data.positions.emplace_back(Vec3f{ 0.f, y, z });
             data.normals.emplace_back(normalize(N * baseNormal));
         }
 
@@ -52,24 +52,24 @@ SimpleMeshData make_cylinder(
         // Add caps if needed
         if (aCapped)
         {
-            // Cap at x = 0
+            // Cap at x = 0 (counter-clockwise when viewed from -x)
             data.positions.emplace_back(Vec3f{ 0.f, prevY, prevZ });
             data.normals.emplace_back(normalize(N * Vec3f{ -1.f, 0.f, 0.f }));
 
-            data.positions.emplace_back(Vec3f{ 0.f, y, z });
+            data.positions.emplace_back(Vec3f{ 0.f, 0.f, 0.f });
             data.normals.emplace_back(normalize(N * Vec3f{ -1.f, 0.f, 0.f }));
 
-            data.positions.emplace_back(Vec3f{ 0.f, 0.f, 0.f });
+            data.positions.emplace_back(Vec3f{ 0.f, y, z });
             data.normals.emplace_back(normalize(N * Vec3f{ -1.f, 0.f, 0.f }));
 
-            // Cap at x = 1
+            // Cap at x = 1 (counter-clockwise when viewed from +x)
             data.positions.emplace_back(Vec3f{ 1.f, 0.f, 0.f });
             data.normals.emplace_back(normalize(N * Vec3f{ 1.f, 0.f, 0.f }));
 
-            data.positions.emplace_back(Vec3f{ 1.f, y, z });
+            data.positions.emplace_back(Vec3f{ 1.f, prevY, prevZ });
             data.normals.emplace_back(normalize(N * Vec3f{ 1.f, 0.f, 0.f }));
 
-            data.positions.emplace_back(Vec3f{ 1.f, prevY, prevZ });
+            data.positions.emplace_back(Vec3f{ 1.f, y, z });
             data.normals.emplace_back(normalize(N * Vec3f{ 1.f, 0.f, 0.f }));
         }
 
@@ -0,0 +1,169 @@
+#include "dynamic_resolution.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+
+#include "../support/error.hpp"
+
+#include "gl_state.hpp"
+
+ResolutionController::ResolutionController( float aTargetMs, float aMinScale, float aMaxScale ) noexcept
+    : mTargetMs( aTargetMs )
+    , mMinScale( aMinScale )
+    , mMaxScale( aMaxScale )
+    , mScale( aMaxScale )
+{}
+
+float ResolutionController::update( double aGpuMs, float aScale ) noexcept
+{
+    if( aGpuMs <= 0.0 || aScale <= 0.f )
+        return mScale;
+
+    double const cost = aGpuMs / (double(aScale) * double(aScale));
+    mCostPerArea = mCostPerArea < 0.0 ? cost : mCostPerArea + kSmoothing * (cost - mCostPerArea);
+
+    float const wanted = std::clamp( float(std::sqrt( double(mTargetMs) / mCostPerArea )), mMinScale, mMaxScale );
+
+    if( wanted < mScale )
+        mScale = wanted;
+    else if( wanted > mScale + kDeadband )
+        mScale = std::min( wanted, mScale + kMaxStepUp );
+
+    return mScale;
+}
+
+float ResolutionController::scale() const noexcept
+{
+    return mScale;
+}
+float ResolutionController::target_ms() const noexcept
+{
+    return mTargetMs;
+}
+
+void ResolutionController::reset( float aScale ) noexcept
+{
+    mScale = std::clamp( aScale, mMinScale, mMaxScale );
+    mCostPerArea = -1.0;
+}
+
+
+GpuFrameTimer::GpuFrameTimer()
+{
+    glGenQueries( GLsizei(mQueries.size()), mQueries.data() );
+}
+
+GpuFrameTimer::~GpuFrameTimer()
+{
+    glDeleteQueries( GLsizei(mQueries.size()), mQueries.data() );
+}
+
+void GpuFrameTimer::begin( float aTag )
+{
+    mTags[mNext] = aTag;
+    mPending[mNext] = false;
+    glQueryCounter( mQueries[2*mNext], GL_TIMESTAMP );
+}
+
+void GpuFrameTimer::end()
+{
+    glQueryCounter( mQueries[2*mNext+1], GL_TIMESTAMP );
+    mPending[mNext] = true;
+    mNext = (mNext + 1) % kFrames;
+}
+
+std::optional<GpuFrameTimer::Sample> GpuFrameTimer::poll()
+{
+    // mNext is the oldest slot
+    for( std::size_t i = 0; i < kFrames; ++i )
+    {
+        std::size_t const slot = (mNext + i) % kFrames;
+        if( !mPending[slot] )
+            continue;
+
+        // Queries complete in order; if this one is not done, neither are
+        // the later ones
+        GLint available = 0;
+        glGetQueryObjectiv( mQueries[2*slot+1], GL_QUERY_RESULT_AVAILABLE, &available );
+        if( !available )
+            return {};
+
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v( mQueries[2*slot], GL_QUERY_RESULT, &start );
+        glGetQueryObjectui64v( mQueries[2*slot+1], GL_QUERY_RESULT, &end );
+        mPending[slot] = false;
+
+        return Sample{ double(end - start) * 1e-6, mTags[slot] };
+    }
+
+    return {};
+}
+
+
+SceneTarget::SceneTarget()
+{
+    glGenFramebuffers( 1, &mFramebuffer );
+}
+
+SceneTarget::~SceneTarget()
+{
+    gl_state().forget_texture( mColor );
+    glDeleteTextures( 1, &mColor );
+    glDeleteRenderbuffers( 1, &mDepth );
+    glDeleteFramebuffers( 1, &mFramebuffer );
+}
+
+void SceneTarget::bind( int aFramebufferWidth, int aFramebufferHeight )
+{
+    glBindFramebuffer( GL_DRAW_FRAMEBUFFER, mFramebuffer );
+
+    if( aFramebufferWidth == mWidth && aFramebufferHeight == mHeight )
+        return;
+
+    gl_state().forget_texture( mColor );
+    glDeleteTextures( 1, &mColor );
+    glDeleteRenderbuffers( 1, &mDepth );
+
+    // Filtered when scaled up; never sampled with mipmaps
+    glGenTextures( 1, &mColor );
+    gl_state().bind_texture( GL_TEXTURE_2D, mColor );
+    glTexStorage2D( GL_TEXTURE_2D, 1, kSceneTargetColorFormat, aFramebufferWidth, aFramebufferHeight );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+
+    glGenRenderbuffers( 1, &mDepth );
+    glBindRenderbuffer( GL_RENDERBUFFER, mDepth );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, aFramebufferWidth, aFramebufferHeight );
+    glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+
+    glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColor, 0 );
+    glFramebufferRenderbuffer( GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepth );
+
+    if( GL_FRAMEBUFFER_COMPLETE != glCheckFramebufferStatus( GL_DRAW_FRAMEBUFFER ) )
+        throw Error( "Scene target (%d x %d) is incomplete", aFramebufferWidth, aFramebufferHeight );
+
+    mWidth = aFramebufferWidth;
+    mHeight = aFramebufferHeight;
+}
+
+void SceneTarget::resolve( int aWidth, int aHeight, int aDstWidth, int aDstHeight, GLuint aDst )
+{
+    glBindFramebuffer( GL_READ_FRAMEBUFFER, mFramebuffer );
+    glBindFramebuffer( GL_DRAW_FRAMEBUFFER, aDst );
+
+    GLenum const filter = (aWidth == aDstWidth && aHeight == aDstHeight) ? GL_NEAREST : GL_LINEAR;
+    glBlitFramebuffer( 0, 0, aWidth, aHeight, 0, 0, aDstWidth, aDstHeight, GL_COLOR_BUFFER_BIT, filter );
+
+    glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+}
+
+GLuint SceneTarget::framebuffer() const noexcept
+{
+    return mFramebuffer;
+}
+
+int scaled_size( int aSize, float aScale ) noexcept
+{
+    return std::max( 1, int(std::lround( float(aSize) * aScale )) );
+}
@@ -0,0 +1,139 @@
+#ifndef DYNAMIC_RESOLUTION_HPP_CA85F246_2417_42F4_9A4C_159D9BA50D06
+#define DYNAMIC_RESOLUTION_HPP_CA85F246_2417_42F4_9A4C_159D9BA50D06
+
+#include <glad/glad.h>
+
+#include <array>
+#include <optional>
+
+#include <cstddef>
+
+// Dynamic resolution
+//
+// The scene is rendered into an offscreen target (SceneTarget) at a fraction
+// of the framebuffer's resolution and scaled up to the framebuffer with a
+// bilinear filter. The fraction is chosen per frame by ResolutionController,
+// from the GPU time of earlier frames (GpuFrameTimer): the GPU cost of the
+// scene is taken to be proportional to its pixel count, so the scale that
+// meets the target time is sqrt(target / cost per unit area).
+//
+// GPU timings arrive a few frames late; each is tagged with the scale that its
+// frame was rendered at, so that the estimate does not depend on how many
+// frames the GPU lags behind.
+
+constexpr float kDefaultGpuTargetMs = 15.f;  // Some headroom within 60 Hz
+constexpr float kMinResolutionScale = 0.5f;
+
+// Chooses the resolution scale; CPU only
+//
+// The cost per unit area is smoothed exponentially. The scale drops to the
+// estimate immediately when over budget, but rises by at most kMaxStepUp per
+// update, and only once the estimate exceeds the current scale by
+// kDeadband, so that it does not oscillate around the target.
+class ResolutionController final
+{
+    public:
+        static constexpr float kSmoothing = 0.25f;
+        static constexpr float kMaxStepUp = 0.05f;
+        static constexpr float kDeadband = 0.02f;
+
+    public:
+        explicit ResolutionController( float aTargetMs = kDefaultGpuTargetMs, float aMinScale = kMinResolutionScale, float aMaxScale = 1.f ) noexcept;
+
+    public:
+        // Feeds the GPU time of a frame that was rendered at aScale. Returns
+        // the scale for the next frame.
+        float update( double aGpuMs, float aScale ) noexcept;
+
+        float scale() const noexcept;
+        float target_ms() const noexcept;
+
+        // Forgets the history; e.g., after the window was resized
+        void reset( float aScale = 1.f ) noexcept;
+
+    private:
+        float mTargetMs, mMinScale, mMaxScale;
+        float mScale;
+        double mCostPerArea = -1.0;  // ms at scale 1; < 0 if unknown
+};
+
+// GPU time between begin() and end(), read back without waiting
+//
+// Keeps kFrames pairs of timestamp queries. A pair whose result was not read
+// by the time it is reused is dropped.
+class GpuFrameTimer final
+{
+    public:
+        static constexpr std::size_t kFrames = 4;
+
+        struct Sample
+        {
+            double ms;
+            float tag;
+        };
+
+    public:
+        GpuFrameTimer();
+        ~GpuFrameTimer();
+
+        GpuFrameTimer( GpuFrameTimer const& ) = delete;
+        GpuFrameTimer& operator= ( GpuFrameTimer const& ) = delete;
+
+    public:
+        // aTag is returned with the sample (e.g., the resolution scale)
+        void begin( float aTag );
+        void end();
+
+        // Oldest finished measurement, if any
+        std::optional<Sample> poll();
+
+    private:
+        std::array<GLuint, 2*kFrames> mQueries{};
+        std::array<float, kFrames> mTags{};
+        std::array<bool, kFrames> mPending{};
+        std::size_t mNext = 0;
+};
+
+// Offscreen color and depth target for the scene
+//
+// The attachments have the size of the framebuffer; scaled frames use their
+// lower left part, so that changing the scale never reallocates.
+//
+// The color attachment is sRGB (kSceneTargetColorFormat): with
+// GL_FRAMEBUFFER_SRGB enabled, lit colors are encoded as they are written,
+// as in the default framebuffer, and resolve() copies sRGB to sRGB. A linear
+// 8 bit target would band in dark gradients.
+constexpr GLenum kSceneTargetColorFormat = GL_SRGB8_ALPHA8;
+
+class SceneTarget final
+{
+    public:
+        SceneTarget();
+        ~SceneTarget();
+
+        SceneTarget( SceneTarget const& ) = delete;
+        SceneTarget& operator= ( SceneTarget const& ) = delete;
+
+    public:
+        // Binds the target as the draw framebuffer; (re)allocates the
+        // attachments if the framebuffer size changed.
+        void bind( int aFramebufferWidth, int aFramebufferHeight );
+
+        // Scales the lower left aWidth x aHeight pixels up to framebuffer
+        // aDst (aDstWidth x aDstHeight; 0 is the window's) and binds the
+        // latter as the draw framebuffer. The scissor test must be disabled.
+        void resolve( int aWidth, int aHeight, int aDstWidth, int aDstHeight, GLuint aDst = 0 );
+
+        // Also serves as the output of headless runs, in place of a window
+        GLuint framebuffer() const noexcept;
+
+    private:
+        GLuint mFramebuffer = 0;
+        GLuint mColor = 0, mDepth = 0;
+        int mWidth = 0, mHeight = 0;
+};
+
+// Size of a scaled frame, at least one pixel
+int scaled_size( int aSize, float aScale ) noexcept;
+
+#endif // DYNAMIC_RESOLUTION_HPP_CA85F246_2417_42F4_9A4C_159D9BA50D06
@@ -0,0 +1,70 @@
+#include "fixed_timestep.hpp"
+
+#include <algorithm>
+
+FixedTimestep::FixedTimestep( float aStep, std::size_t aMaxSteps ) noexcept
+    : mStep( aStep )
+    , mMaxSteps( aMaxSteps )
+{}
+
+std::size_t FixedTimestep::advance( float aSeconds ) noexcept
+{
+    mAccumulator += std::max( 0.0, double(aSeconds) );
+
+    auto steps = std::size_t(mAccumulator / mStep);
+    mAccumulator -= double(steps) * mStep;
+
+    if( steps > mMaxSteps )
+    {
+        mDropped += steps - mMaxSteps;
+        steps = mMaxSteps;
+    }
+
+    return steps;
+}
+
+float FixedTimestep::step() const noexcept
+{
+    return float(mStep);
+}
+
+float FixedTimestep::alpha() const noexcept
+{
+    return std::clamp( float(mAccumulator / mStep), 0.f, 1.f );
+}
+
+std::size_t FixedTimestep::dropped() const noexcept
+{
+    return mDropped;
+}
+
+Vec3f lerp( Vec3f const& aFrom, Vec3f const& aTo, float aT ) noexcept
+{
+    return aFrom + (aTo - aFrom) * aT;
+}
+Vec4f lerp( Vec4f const& aFrom, Vec4f const& aTo, float aT ) noexcept
+{
+    return aFrom + (aTo - aFrom) * aT;
+}
+
+Mat44f interpolate_rigid( Mat44f const& aFrom, Mat44f const& aTo, float aT ) noexcept
+{
+    auto const column_ = [] ( Mat44f const& aM, std::size_t aJ ) {
+        return Vec3f{ aM( 0, aJ ), aM( 1, aJ ), aM( 2, aJ ) };
+    };
+
+    // Gram-Schmidt on the interpolated x and y axes
+    Vec3f const x = normalize( lerp( column_( aFrom, 0 ), column_( aTo, 0 ), aT ) );
+    Vec3f y = lerp( column_( aFrom, 1 ), column_( aTo, 1 ), aT );
+    y = normalize( y - x * dot( x, y ) );
+    Vec3f const z = cross( x, y );
+
+    Vec3f const t = lerp( column_( aFrom, 3 ), column_( aTo, 3 ), aT );
+
+    return Mat44f{ {
+        x.x, y.x, z.x, t.x,
+        x.y, y.y, z.y, t.y,
+        x.z, y.z, z.z, t.z,
+        0.f, 0.f, 0.f, 1.f
+    } };
+}
@@ -0,0 +1,70 @@
+#ifndef FIXED_TIMESTEP_HPP_F63A4F64_C9A0_494D_950F_844EB6177F58
+#define FIXED_TIMESTEP_HPP_F63A4F64_C9A0_494D_950F_844EB6177F58
+
+#include <cstddef>
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat44.hpp"
+
+// Fixed-timestep simulation clock
+//
+// The simulation advances in steps of constant length, independent of the
+// frame rate: each frame adds its wall time to an accumulator and runs as
+// many whole steps as it holds. Rendering then interpolates between the
+// states before and after the last step, by alpha(), so that motion is
+// smooth at any frame rate.
+//
+// At most kMaxStepsPerFrame steps run per frame. If a frame takes longer
+// (e.g., a stall, or a debugger break), the excess time is dropped and the
+// simulation runs slower than real time, rather than spending ever more
+// time catching up. The cost of the simulation is hence bounded by the step
+// rate, whatever the frame rate.
+//
+// Usage per frame:
+//    std::size_t const steps = clock.advance( dt );
+//    for( std::size_t i = 0; i < steps; ++i )
+//    {
+//        previous = current;
+//        simulate( current, clock.step() );
+//    }
+//    render( interpolate( previous, current, clock.alpha() ) );
+
+constexpr float kSimulationStep = 1.f / 120.f;
+constexpr std::size_t kMaxStepsPerFrame = 8;
+
+class FixedTimestep final
+{
+    public:
+        explicit FixedTimestep( float aStep = kSimulationStep, std::size_t aMaxSteps = kMaxStepsPerFrame ) noexcept;
+
+    public:
+        // Adds a frame's wall time (seconds); returns the number of steps to
+        // simulate now.
+        std::size_t advance( float aSeconds ) noexcept;
+
+        float step() const noexcept;
+
+        // Time since the last step, in steps, [0,1)
+        float alpha() const noexcept;
+
+        // Total number of steps that were dropped
+        std::size_t dropped() const noexcept;
+
+    private:
+        double mStep;
+        std::size_t mMaxSteps;
+
+        double mAccumulator = 0.0;
+        std::size_t mDropped = 0;
+};
+
+Vec3f lerp( Vec3f const& aFrom, Vec3f const& aTo, float aT ) noexcept;
+Vec4f lerp( Vec4f const& aFrom, Vec4f const& aTo, float aT ) noexcept;
+
+// Interpolates rigid transforms (rotation and translation): the translation
+// linearly, the rotation by interpolating the axes and re-orthonormalizing
+// them. Accurate for the small rotations of a simulation step.
+Mat44f interpolate_rigid( Mat44f const& aFrom, Mat44f const& aTo, float aT ) noexcept;
+
+#endif // FIXED_TIMESTEP_HPP_F63A4F64_C9A0_494D_950F_844EB6177F58
@@ -0,0 +1,125 @@
+#ifndef FRAME_UNIFORMS_HPP_E93A1D5C_7F24_4B68_A0C7_3B6E25D8F910
+#define FRAME_UNIFORMS_HPP_E93A1D5C_7F24_4B68_A0C7_3B6E25D8F910
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/vec2.hpp"
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat44.hpp"
+
+// Shader interface for per-view and per-object data of the default shader
+// (see default.vert). Camera blocks are written into a PersistentRing; the
+// object block and the visibility masks are owned by the InstanceManager.
+//
+// Mat44f is row-major, GLSL matrices are column-major: all matrices are
+// stored transposed.
+//
+// The index of the object being drawn is not a uniform. It is the vertex
+// attribute kObjectIndexAttrib, which is sourced from an identity buffer
+// (see GeometryArena). A draw selects its object through the base instance,
+// so glMultiDrawElementsIndirect() can draw many objects without any state
+// change in between.
+//
+// A camera block holds up to kMaxCameraViews views. Draws are instanced
+// viewCount times per object: the attribute's divisor is viewCount, and the
+// shader draws instance i into view i % viewCount (see multi_view.hpp). The
+// views of a block are views firstView, firstView+1, ... of the frame; the
+// shader skips objects whose visibility mask (VisibilityBlock, one byte per
+// object) lacks the view's bit.
+
+// Uniform block CameraBlock (std140)
+constexpr GLuint kCameraUniformBinding = 2;
+
+// Shader storage block ObjectBlock (std430)
+constexpr GLuint kObjectStorageBinding = 0;
+
+// Shader storage block VisibilityBlock (std430)
+constexpr GLuint kVisibilityStorageBinding = 3;
+
+constexpr std::size_t kMaxCameraViews = 8;
+
+// Per-instance attribute holding the object index
+constexpr GLuint kObjectIndexAttrib = 9;
+
+// Per-object material parameters of the default shader. Materials are
+// identified by their id, which must be unique among the materials in use;
+// the render queue sorts by it.
+//
+// The palette recolors an object without copying its mesh: a vertex color c
+// is drawn as palette[0]*c.r + palette[1]*c.g + palette[2]*c.b. Shared
+// procedural meshes are generated in the palette's base colors (see
+// MeshCache); the default palette leaves vertex colors unchanged.
+struct DrawMaterial
+{
+    std::uint16_t id = 0;  // 12 bits are used in the sort key
+    bool useTexture = false;
+    Vec2f texMin{ 0.f, 0.f };
+    Vec2f texDiff{ 0.f, 0.f };
+    Vec3f palette[3] = { { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } };
+};
+
+struct CameraUniforms
+{
+    Mat44f view;
+    Mat44f projection;
+    Mat44f viewProjection;
+};
+
+// CameraBlock
+struct CameraBlockUniforms
+{
+    CameraUniforms views[kMaxCameraViews];
+    std::uint32_t viewCount;
+    std::uint32_t firstView;
+    std::uint32_t pad_[2];
+};
+
+// One element of ObjectBlock
+struct ObjectData
+{
+    Mat44f model;
+    Mat44f normal;          // Upper 3x3 is the normal matrix
+    Vec4f texRange;         // xy: min, zw: extent of the planar texture mapping
+    Vec4f palette[3];       // xyz: DrawMaterial::palette
+    std::uint32_t useTexture;
+    std::uint32_t pad_[3];  // std430 array stride is a multiple of 16
+};
+
+static_assert( sizeof(CameraUniforms) == 3*64 );
+static_assert( sizeof(CameraBlockUniforms) == kMaxCameraViews*3*64 + 16 );
+static_assert( sizeof(ObjectData) == 2*64 + 5*16 );
+
+inline
+CameraUniforms make_camera_uniforms( Mat44f const& aView, Mat44f const& aProjection ) noexcept
+{
+    return {
+        transpose( aView ),
+        transpose( aProjection ),
+        transpose( aProjection * aView )
+    };
+}
+
+inline
+ObjectData make_object_data( Mat44f const& aModel2World, DrawMaterial const& aMaterial ) noexcept
+{
+    // The normal matrix is transpose(invert(model)); stored transposed that
+    // is just the inverse.
+    return {
+        transpose( aModel2World ),
+        invert( aModel2World ),
+        Vec4f{ aMaterial.texMin.x, aMaterial.texMin.y, aMaterial.texDiff.x, aMaterial.texDiff.y },
+        {
+            Vec4f{ aMaterial.palette[0].x, aMaterial.palette[0].y, aMaterial.palette[0].z, 0.f },
+            Vec4f{ aMaterial.palette[1].x, aMaterial.palette[1].y, aMaterial.palette[1].z, 0.f },
+            Vec4f{ aMaterial.palette[2].x, aMaterial.palette[2].y, aMaterial.palette[2].z, 0.f }
+        },
+        aMaterial.useTexture ? 1u : 0u,
+        { 0, 0, 0 }
+    };
+}
+
+#endif // FRAME_UNIFORMS_HPP_E93A1D5C_7F24_4B68_A0C7_3B6E25D8F910
@@ -0,0 +1,171 @@
+#include "frustum_cull.hpp"
+
+#include <atomic>
+#include <limits>
+#include <algorithm>
+
+#include <cmath>
+
+#include "../support/job_system.hpp"
+
+namespace
+{
+    Vec4f normalize_plane_( Vec4f aPlane ) noexcept
+    {
+        float const len = std::sqrt( aPlane.x*aPlane.x + aPlane.y*aPlane.y + aPlane.z*aPlane.z );
+        return len > 0.f ? aPlane / len : aPlane;
+    }
+
+    // Tests volumes [aBegin, aEnd). Returns the number of visible volumes.
+    std::size_t cull_range_( Frustum const& aFrustum, float const* aCx, float const* aCy, float const* aCz, float const* aEx, float const* aEy, float const* aEz, std::uint8_t* aVisible, std::size_t aBegin, std::size_t aEnd ) noexcept
+    {
+        // Start with everything visible and clear the boxes that lie fully
+        // behind a plane. A box is behind the plane if its center's distance
+        // is below minus the box's projected radius.
+        for( std::size_t i = aBegin; i < aEnd; ++i )
+            aVisible[i] = 1;
+
+        for( auto const& plane : aFrustum.planes )
+        {
+            float const nx = plane.x, ny = plane.y, nz = plane.z, d = plane.w;
+            float const ax = std::abs( nx ), ay = std::abs( ny ), az = std::abs( nz );
+
+            for( std::size_t i = aBegin; i < aEnd; ++i )
+            {
+                float const dist = nx * aCx[i] + ny * aCy[i] + nz * aCz[i] + d;
+                float const radius = ax * aEx[i] + ay * aEy[i] + az * aEz[i];
+                aVisible[i] &= std::uint8_t(dist + radius >= 0.f);
+            }
+        }
+
+        std::size_t visible = 0;
+        for( std::size_t i = aBegin; i < aEnd; ++i )
+            visible += aVisible[i];
+
+        return visible;
+    }
+}
+
+Frustum make_frustum( Mat44f const& aM ) noexcept
+{
+    // Gribb & Hartmann: the planes are sums and differences of the rows of
+    // the clip matrix.
+    Vec4f const r0{ aM(0,0), aM(0,1), aM(0,2), aM(0,3) };
+    Vec4f const r1{ aM(1,0), aM(1,1), aM(1,2), aM(1,3) };
+    Vec4f const r2{ aM(2,0), aM(2,1), aM(2,2), aM(2,3) };
+    Vec4f const r3{ aM(3,0), aM(3,1), aM(3,2), aM(3,3) };
+
+    return Frustum{ {
+        normalize_plane_( r3 + r0 ), // Left
+        normalize_plane_( r3 - r0 ), // Right
+        normalize_plane_( r3 + r1 ), // Bottom
+        normalize_plane_( r3 - r1 ), // Top
+        normalize_plane_( r3 + r2 ), // Near
+        normalize_plane_( r3 - r2 )  // Far
+    } };
+}
+
+bool intersects( Frustum const& aFrustum, Aabb const& aBox ) noexcept
+{
+    if( is_empty( aBox ) )
+        return false;
+
+    Vec3f const c = center( aBox );
+    Vec3f const e = half_extent( aBox );
+    for( auto const& plane : aFrustum.planes )
+    {
+        float const dist = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+        float const radius = std::abs( plane.x ) * e.x + std::abs( plane.y ) * e.y + std::abs( plane.z ) * e.z;
+        if( dist + radius < 0.f )
+            return false;
+    }
+
+    return true;
+}
+
+FrustumTest classify( Frustum const& aFrustum, Aabb const& aBox ) noexcept
+{
+    if( is_empty( aBox ) )
+        return FrustumTest::outside;
+
+    Vec3f const c = center( aBox );
+    Vec3f const e = half_extent( aBox );
+
+    FrustumTest result = FrustumTest::inside;
+    for( auto const& plane : aFrustum.planes )
+    {
+        float const dist = plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w;
+        float const radius = std::abs( plane.x ) * e.x + std::abs( plane.y ) * e.y + std::abs( plane.z ) * e.z;
+        if( dist + radius < 0.f )
+            return FrustumTest::outside;
+        if( dist - radius < 0.f )
+            result = FrustumTest::intersecting;
+    }
+
+    return result;
+}
+
+CullStats& operator+= ( CullStats& aLeft, CullStats const& aRight ) noexcept
+{
+    aLeft.visible += aRight.visible;
+    aLeft.culled += aRight.culled;
+    return aLeft;
+}
+
+void CullVolumes::resize( std::size_t aCount )
+{
+    // New volumes are empty, see set()
+    mCx.resize( aCount, 0.f );
+    mCy.resize( aCount, 0.f );
+    mCz.resize( aCount, 0.f );
+    mEx.resize( aCount, -std::numeric_limits<float>::max() );
+    mEy.resize( aCount, -std::numeric_limits<float>::max() );
+    mEz.resize( aCount, -std::numeric_limits<float>::max() );
+}
+
+void CullVolumes::set( std::size_t aIndex, Aabb const& aBox )
+{
+    if( is_empty( aBox ) )
+    {
+        // An extent of -max makes the radius -inf: the box is never visible
+        mCx[aIndex] = mCy[aIndex] = mCz[aIndex] = 0.f;
+        mEx[aIndex] = mEy[aIndex] = mEz[aIndex] = -std::numeric_limits<float>::max();
+        return;
+    }
+
+    Vec3f const c = center( aBox );
+    Vec3f const e = half_extent( aBox );
+    mCx[aIndex] = c.x; mCy[aIndex] = c.y; mCz[aIndex] = c.z;
+    mEx[aIndex] = e.x; mEy[aIndex] = e.y; mEz[aIndex] = e.z;
+}
+
+std::size_t CullVolumes::size() const noexcept
+{
+    return mCx.size();
+}
+
+CullStats frustum_cull( Frustum const& aFrustum, CullVolumes const& aVolumes, std::vector<std::uint8_t>& aVisible )
+{
+    std::size_t const count = aVolumes.size();
+    aVisible.resize( count );
+
+    auto const cull = [&] ( std::size_t aBegin, std::size_t aEnd ) {
+        return cull_range_( aFrustum,
+            aVolumes.mCx.data(), aVolumes.mCy.data(), aVolumes.mCz.data(),
+            aVolumes.mEx.data(), aVolumes.mEy.data(), aVolumes.mEz.data(),
+            aVisible.data(), aBegin, aEnd
+        );
+    };
+
+    // Chunks are multiples of a cache line of results, so that no two jobs
+    // write to the same line.
+    static_assert( 0 == (kParallelCullThreshold/4) % 64 );
+    std::size_t const grain = count < kParallelCullThreshold ? count : kParallelCullThreshold/4;
+
+    std::atomic<std::size_t> visible{ 0 };
+    job_system().parallel_for( 0, count, grain, [&] ( std::size_t aBegin, std::size_t aEnd ) {
+        visible.fetch_add( cull( aBegin, aEnd ), std::memory_order_relaxed );
+    } );
+
+    return CullStats{ visible.load(), count - visible.load() };
+}
@@ -0,0 +1,84 @@
+#ifndef FRUSTUM_CULL_HPP_7DE2DC53_1F46_4464_97A0_71EAC2DAEC24
+#define FRUSTUM_CULL_HPP_7DE2DC53_1F46_4464_97A0_71EAC2DAEC24
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bounds.hpp"
+
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat44.hpp"
+
+// Frustum tests
+//
+// Each view extracts its six frustum planes from the view-projection matrix.
+// intersects() and classify() test single boxes; the scene's objects are
+// culled by traversing their AABB tree with them (see AabbTree::query() and
+// InstanceManager::cull()).
+//
+// frustum_cull() tests a flat set of boxes, without a hierarchy, e.g. as a
+// brute-force reference for the tree. It is not used at runtime. The bounds are kept as
+// structure-of-arrays (centers and half extents, see CullVolumes), so that
+// the test of consecutive boxes is a straight loop of independent float
+// operations that the compiler vectorizes. Sets of kParallelCullThreshold
+// boxes or more are split into chunks that are tested as jobs of the shared
+// job system (see job_system.hpp).
+//
+// The test is conservative: a box that straddles two planes outside of the
+// frustum's corner may be reported as visible.
+
+constexpr std::size_t kParallelCullThreshold = 16384;
+
+// Planes are (n, d) with n pointing inwards; p is inside if dot(n,p)+d >= 0.
+struct Frustum
+{
+    Vec4f planes[6];
+};
+
+// Extracts the planes of the clip volume -w <= x,y,z <= w (OpenGL
+// conventions) from aViewProjection = projection * view.
+Frustum make_frustum( Mat44f const& aViewProjection ) noexcept;
+
+bool intersects( Frustum const&, Aabb const& ) noexcept;
+
+enum class FrustumTest : std::uint8_t
+{
+    outside,
+    intersecting,
+    inside
+};
+
+// Like intersects(), but also detects boxes that are fully inside, whose
+// contents need no further tests (see AabbTree).
+FrustumTest classify( Frustum const&, Aabb const& ) noexcept;
+
+struct CullStats
+{
+    std::size_t visible = 0;
+    std::size_t culled = 0;
+};
+
+CullStats& operator+= ( CullStats&, CullStats const& ) noexcept;
+
+class CullVolumes final
+{
+    public:
+        void resize( std::size_t );
+        void set( std::size_t aIndex, Aabb const& );
+
+        std::size_t size() const noexcept;
+
+    private:
+        friend CullStats frustum_cull( Frustum const&, CullVolumes const&, std::vector<std::uint8_t>& );
+
+        std::vector<float> mCx, mCy, mCz;  // Centers
+        std::vector<float> mEx, mEy, mEz;  // Half extents
+};
+
+// Tests all volumes. aVisible[i] is set to 1 if volume i may be visible and
+// to 0 otherwise.
+CullStats frustum_cull( Frustum const&, CullVolumes const&, std::vector<std::uint8_t>& aVisible );
+
+#endif // FRUSTUM_CULL_HPP_7DE2DC53_1F46_4464_97A0_71EAC2DAEC24
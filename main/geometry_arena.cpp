@@ -0,0 +1,236 @@
+#include "geometry_arena.hpp"
+
+#include <limits>
+#include <numeric>
+
+#include <cstddef>
+
+#include "../support/error.hpp"
+
+#include "frame_uniforms.hpp"
+#include "gl_state.hpp"
+
+namespace
+{
+    template< typename tType >
+    tType attrib_( std::vector<tType> const& aStream, std::size_t aIndex, std::size_t aVertexCount )
+    {
+        // Streams that are not per-vertex (e.g. missing texcoords) read as zero
+        return aStream.size() == aVertexCount ? aStream[aIndex] : tType{};
+    }
+
+    void attrib_pointer_( GLuint aLocation, GLint aComponents, std::size_t aOffset )
+    {
+        glVertexAttribPointer( aLocation, aComponents, GL_FLOAT, GL_FALSE, sizeof(ArenaVertex), reinterpret_cast<void const*>(aOffset) );
+        glEnableVertexAttribArray( aLocation );
+    }
+}
+
+GeometryArena::~GeometryArena()
+{
+    if( 0 != mVao )
+    {
+        glDeleteVertexArrays( 1, &mVao );
+        gl_state().forget_vertex_array( mVao );
+    }
+    if( 0 != mDepthVao )
+    {
+        glDeleteVertexArrays( 1, &mDepthVao );
+        gl_state().forget_vertex_array( mDepthVao );
+    }
+    if( 0 != mVbo )
+        glDeleteBuffers( 1, &mVbo );
+    if( 0 != mPositionVbo )
+        glDeleteBuffers( 1, &mPositionVbo );
+    if( 0 != mIbo )
+        glDeleteBuffers( 1, &mIbo );
+    if( 0 != mObjectIds )
+        glDeleteBuffers( 1, &mObjectIds );
+}
+
+MeshRange GeometryArena::add( SimpleMeshData const& aMesh )
+{
+    SimpleMeshData const mesh = make_indexed( aMesh );
+
+    std::size_t const vertexCount = mesh.positions.size();
+    if( mVertices.size() + vertexCount > std::size_t(std::numeric_limits<GLint>::max()) )
+        throw Error( "GeometryArena: too many vertices (%zu + %zu)", mVertices.size(), vertexCount );
+
+    MeshRange range;
+    range.baseVertex = GLint(mVertices.size());
+    range.firstIndex = GLuint(mIndices.size());
+    range.indexCount = GLsizei(mesh.indices.size());
+    range.bounds = aabb_of( mesh.positions );
+
+    mVertices.reserve( mVertices.size() + vertexCount );
+    for( std::size_t i = 0; i < vertexCount; ++i )
+    {
+        mVertices.emplace_back( ArenaVertex{
+            mesh.positions[i],
+            attrib_( mesh.colors, i, vertexCount ),
+            attrib_( mesh.normals, i, vertexCount ),
+            attrib_( mesh.texcoords, i, vertexCount ),
+            attrib_( mesh.Ka, i, vertexCount ),
+            attrib_( mesh.Kd, i, vertexCount ),
+            attrib_( mesh.Ks, i, vertexCount ),
+            attrib_( mesh.Ns, i, vertexCount ),
+            attrib_( mesh.Ke, i, vertexCount )
+        } );
+    }
+
+    mIndices.insert( mIndices.end(), mesh.indices.begin(), mesh.indices.end() );
+
+    mDirty = true;
+    return range;
+}
+
+void GeometryArena::upload()
+{
+    if( !mDirty )
+        return;
+
+    if( 0 == mVao )
+        create_vao_();
+
+    glBindBuffer( GL_ARRAY_BUFFER, mVbo );
+    glBufferData( GL_ARRAY_BUFFER, mVertices.size() * sizeof(ArenaVertex), mVertices.data(), GL_STATIC_DRAW );
+
+    std::vector<Vec3f> positions;
+    positions.reserve( mVertices.size() );
+    for( auto const& vertex : mVertices )
+        positions.emplace_back( vertex.position );
+
+    glBindBuffer( GL_ARRAY_BUFFER, mPositionVbo );
+    glBufferData( GL_ARRAY_BUFFER, positions.size() * sizeof(Vec3f), positions.data(), GL_STATIC_DRAW );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    // The element buffer binding is VAO state
+    gl_state().bind_vertex_array( mVao );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * sizeof(std::uint32_t), mIndices.data(), GL_STATIC_DRAW );
+    gl_state().bind_vertex_array( 0 );
+
+    mDirty = false;
+}
+
+void GeometryArena::bind() const
+{
+    gl_state().bind_vertex_array( mVao );
+}
+
+void GeometryArena::bind_depth() const
+{
+    gl_state().bind_vertex_array( mDepthVao );
+}
+
+void GeometryArena::draw( MeshRange const& aRange, std::uint32_t aObject, std::uint32_t aObjectCount ) const
+{
+    glDrawElementsInstancedBaseVertexBaseInstance(
+        GL_TRIANGLES,
+        aRange.indexCount,
+        GL_UNSIGNED_INT,
+        reinterpret_cast<void const*>(aRange.firstIndex * sizeof(std::uint32_t)),
+        GLsizei(aObjectCount * mViewCount),
+        aRange.baseVertex,
+        aObject
+    );
+}
+
+void GeometryArena::set_view_count( std::uint32_t aViewCount )
+{
+    if( aViewCount == mViewCount || 0 == aViewCount )
+        return;
+
+    // The divisor is VAO state
+    for( auto const vao : { mVao, mDepthVao } )
+    {
+        gl_state().bind_vertex_array( vao );
+        glVertexAttribDivisor( kObjectIndexAttrib, aViewCount );
+    }
+
+    mViewCount = aViewCount;
+}
+
+std::uint32_t GeometryArena::view_count() const noexcept
+{
+    return mViewCount;
+}
+
+GLuint GeometryArena::vao() const noexcept
+{
+    return mVao;
+}
+GLuint GeometryArena::depth_vao() const noexcept
+{
+    return mDepthVao;
+}
+GLuint GeometryArena::vertex_buffer() const noexcept
+{
+    return mVbo;
+}
+GLuint GeometryArena::index_buffer() const noexcept
+{
+    return mIbo;
+}
+
+std::size_t GeometryArena::vertex_count() const noexcept
+{
+    return mVertices.size();
+}
+std::size_t GeometryArena::index_count() const noexcept
+{
+    return mIndices.size();
+}
+
+void GeometryArena::create_vao_()
+{
+    glGenBuffers( 1, &mVbo );
+    glGenBuffers( 1, &mIbo );
+
+    glGenVertexArrays( 1, &mVao );
+    gl_state().bind_vertex_array( mVao );
+
+    glBindBuffer( GL_ARRAY_BUFFER, mVbo );
+    attrib_pointer_( 0, 3, offsetof( ArenaVertex, position ) );
+    attrib_pointer_( 1, 3, offsetof( ArenaVertex, color ) );
+    attrib_pointer_( 2, 3, offsetof( ArenaVertex, normal ) );
+    attrib_pointer_( 3, 2, offsetof( ArenaVertex, texcoord ) );
+    attrib_pointer_( 4, 3, offsetof( ArenaVertex, Ka ) );
+    attrib_pointer_( 5, 3, offsetof( ArenaVertex, Kd ) );
+    attrib_pointer_( 6, 3, offsetof( ArenaVertex, Ks ) );
+    attrib_pointer_( 7, 1, offsetof( ArenaVertex, Ns ) );
+    attrib_pointer_( 8, 3, offsetof( ArenaVertex, Ke ) );
+
+    // Object index: instance i of a draw with base instance b reads
+    // b + i/viewCount
+    std::vector<std::uint32_t> ids( kMaxObjects );
+    std::iota( ids.begin(), ids.end(), 0u );
+
+    glGenBuffers( 1, &mObjectIds );
+    glBindBuffer( GL_ARRAY_BUFFER, mObjectIds );
+    glBufferData( GL_ARRAY_BUFFER, ids.size() * sizeof(std::uint32_t), ids.data(), GL_STATIC_DRAW );
+    glVertexAttribIPointer( kObjectIndexAttrib, 1, GL_UNSIGNED_INT, 0, nullptr );
+    glVertexAttribDivisor( kObjectIndexAttrib, mViewCount );
+    glEnableVertexAttribArray( kObjectIndexAttrib );
+
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIbo );
+
+    // Position-only VAO for depth passes
+    glGenBuffers( 1, &mPositionVbo );
+
+    glGenVertexArrays( 1, &mDepthVao );
+    gl_state().bind_vertex_array( mDepthVao );
+
+    glBindBuffer( GL_ARRAY_BUFFER, mPositionVbo );
+    glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vec3f), nullptr );
+    glEnableVertexAttribArray( 0 );
+
+    glBindBuffer( GL_ARRAY_BUFFER, mObjectIds );
+    glVertexAttribIPointer( kObjectIndexAttrib, 1, GL_UNSIGNED_INT, 0, nullptr );
+    glVertexAttribDivisor( kObjectIndexAttrib, mViewCount );
+    glEnableVertexAttribArray( kObjectIndexAttrib );
+
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mIbo );
+
+    gl_state().bind_vertex_array( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
@@ -0,0 +1,130 @@
+#ifndef GEOMETRY_ARENA_HPP_B81F4C6A_2E97_4D35_9A0C_5E3D7B14F286
+#define GEOMETRY_ARENA_HPP_B81F4C6A_2E97_4D35_9A0C_5E3D7B14F286
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bounds.hpp"
+#include "simple_mesh.hpp"
+
+#include "../vmlib/vec2.hpp"
+#include "../vmlib/vec3.hpp"
+
+// Static geometry arena
+//
+// All static meshes live in one interleaved vertex buffer and one index
+// buffer, described by a single VAO. Each mesh is sub-allocated from these
+// and is identified by a MeshRange only. Drawing a mesh therefore needs no
+// VAO or buffer switch; the range is passed to glDrawElementsBaseVertex(),
+// with indices stored relative to the mesh's first vertex.
+//
+// Meshes are added on the CPU side and uploaded in one go:
+//    GeometryArena arena;
+//    MeshRange const pad = arena.add( launchpadMesh );
+//    arena.upload();
+//    ...
+//    arena.bind();
+//    arena.draw( pad, objectIndex );
+//
+// Vertex attribute locations match the default shader (see default.vert).
+// Attribute streams that a mesh does not provide are zero-filled. The VAO
+// also sources the per-instance object index (kObjectIndexAttrib) from an
+// identity buffer, so that the base instance of a draw selects the object.
+// With multiple views per draw, each object is instanced once per view (see
+// set_view_count()).
+//
+// Depth-only passes use a second VAO (bind_depth()) that reads the positions
+// from a separate, tightly packed stream instead of the interleaved vertices,
+// so they fetch 12 rather than sizeof(ArenaVertex) bytes per vertex. It
+// shares the index buffer and the object index attribute; the same
+// MeshRanges and draws apply.
+
+struct MeshRange
+{
+    GLint baseVertex = 0;     // Added to every index of the mesh
+    GLuint firstIndex = 0;    // In indices, not bytes
+    GLsizei indexCount = 0;
+    Aabb bounds;              // Model space
+};
+
+// Interleaved vertex layout of the arena
+struct ArenaVertex
+{
+    Vec3f position;
+    Vec3f color;
+    Vec3f normal;
+    Vec2f texcoord;
+    Vec3f Ka;
+    Vec3f Kd;
+    Vec3f Ks;
+    float Ns;
+    Vec3f Ke;
+};
+
+class GeometryArena final
+{
+    public:
+        // Number of distinct object indices the identity buffer provides
+        static constexpr std::uint32_t kMaxObjects = 1u << 16;
+
+    public:
+        GeometryArena() = default;
+        ~GeometryArena();
+
+        GeometryArena( GeometryArena const& ) = delete;
+        GeometryArena& operator= ( GeometryArena const& ) = delete;
+
+    public:
+        // Appends the mesh (indexing it first if required). The mesh is not
+        // visible to the GPU until the next upload().
+        MeshRange add( SimpleMeshData const& );
+
+        // (Re-)uploads the buffers if meshes were added since the last call.
+        // Requires a current OpenGL context.
+        void upload();
+
+        // Binds the shared VAO. Must be bound for draw().
+        void bind() const;
+
+        // Binds the position-only VAO; draw() may be used with it as well.
+        void bind_depth() const;
+
+        // Draws the range as objects aObject .. aObject+aObjectCount-1 (see
+        // frame_uniforms.hpp), once per view
+        void draw( MeshRange const&, std::uint32_t aObject, std::uint32_t aObjectCount = 1 ) const;
+
+        // Number of views drawn per object: the object index advances every
+        // aViewCount instances. Draws must multiply their instance count by
+        // it. Requires upload() to have created the VAO.
+        void set_view_count( std::uint32_t aViewCount );
+        std::uint32_t view_count() const noexcept;
+
+        GLuint vao() const noexcept;
+        GLuint depth_vao() const noexcept;
+        GLuint vertex_buffer() const noexcept;
+        GLuint index_buffer() const noexcept;
+
+        std::size_t vertex_count() const noexcept;
+        std::size_t index_count() const noexcept;
+
+    private:
+        void create_vao_();
+
+        std::vector<ArenaVertex> mVertices;
+        std::vector<std::uint32_t> mIndices;
+        bool mDirty = false;
+        std::uint32_t mViewCount = 1;
+
+        GLuint mVao = 0;
+        GLuint mVbo = 0;
+        GLuint mDepthVao = 0;
+        GLuint mPositionVbo = 0;
+        GLuint mIbo = 0;
+        GLuint mObjectIds = 0;
+};
+
+#endif // GEOMETRY_ARENA_HPP_B81F4C6A_2E97_4D35_9A0C_5E3D7B14F286
@@ -0,0 +1,219 @@
+#include "gl_state.hpp"
+
+#include <numeric>
+
+std::size_t GlStateStats::total_issued() const noexcept
+{
+    return std::accumulate( issued.begin(), issued.end(), std::size_t(0) );
+}
+std::size_t GlStateStats::total_skipped() const noexcept
+{
+    return std::accumulate( skipped.begin(), skipped.end(), std::size_t(0) );
+}
+
+GlStateCache::GlStateCache()
+{
+    invalidate();
+}
+
+bool GlStateCache::enable( GLenum aCapability )
+{
+    return set_enabled( aCapability, true );
+}
+bool GlStateCache::disable( GLenum aCapability )
+{
+    return set_enabled( aCapability, false );
+}
+
+bool GlStateCache::set_enabled( GLenum aCapability, bool aEnabled )
+{
+    Tristate_& state = capability_( aCapability );
+    Tristate_ const wanted = aEnabled ? Tristate_::on : Tristate_::off;
+
+    if( !count_( GlStateCall::capability, state != wanted ) )
+        return false;
+
+    if( aEnabled )
+        glEnable( aCapability );
+    else
+        glDisable( aCapability );
+
+    state = wanted;
+    return true;
+}
+
+bool GlStateCache::blend_func( GLenum aSrc, GLenum aDst )
+{
+    if( !count_( GlStateCall::blendFunc, aSrc != mBlendSrc || aDst != mBlendDst ) )
+        return false;
+
+    glBlendFunc( aSrc, aDst );
+    mBlendSrc = aSrc;
+    mBlendDst = aDst;
+    return true;
+}
+
+bool GlStateCache::depth_func( GLenum aFunc )
+{
+    if( !count_( GlStateCall::depthFunc, aFunc != mDepthFunc ) )
+        return false;
+
+    glDepthFunc( aFunc );
+    mDepthFunc = aFunc;
+    return true;
+}
+
+bool GlStateCache::depth_mask( bool aWrite )
+{
+    Tristate_ const wanted = aWrite ? Tristate_::on : Tristate_::off;
+    if( !count_( GlStateCall::depthMask, wanted != mDepthMask ) )
+        return false;
+
+    glDepthMask( aWrite ? GL_TRUE : GL_FALSE );
+    mDepthMask = wanted;
+    return true;
+}
+
+bool GlStateCache::color_mask( bool aWrite )
+{
+    Tristate_ const wanted = aWrite ? Tristate_::on : Tristate_::off;
+    if( !count_( GlStateCall::colorMask, wanted != mColorMask ) )
+        return false;
+
+    GLboolean const write = aWrite ? GL_TRUE : GL_FALSE;
+    glColorMask( write, write, write, write );
+    mColorMask = wanted;
+    return true;
+}
+
+bool GlStateCache::use_program( GLuint aProgram )
+{
+    if( !count_( GlStateCall::program, aProgram != mProgram ) )
+        return false;
+
+    glUseProgram( aProgram );
+    mProgram = aProgram;
+    return true;
+}
+
+bool GlStateCache::bind_vertex_array( GLuint aVao )
+{
+    if( !count_( GlStateCall::vertexArray, aVao != mVertexArray ) )
+        return false;
+
+    glBindVertexArray( aVao );
+    mVertexArray = aVao;
+    return true;
+}
+
+bool GlStateCache::active_texture( GLenum aUnit )
+{
+    if( !count_( GlStateCall::activeTexture, aUnit != mActiveTexture ) )
+        return false;
+
+    glActiveTexture( aUnit );
+    mActiveTexture = aUnit;
+    return true;
+}
+
+bool GlStateCache::bind_texture( GLenum aTarget, GLuint aTexture )
+{
+    std::size_t const unit = std::size_t(mActiveTexture - GL_TEXTURE0);
+    bool const tracked = GL_TEXTURE_2D == aTarget && kUnknown_ != mActiveTexture && unit < kTextureUnits;
+
+    if( !count_( GlStateCall::texture, !tracked || aTexture != mTexture2d[unit] ) )
+        return false;
+
+    glBindTexture( aTarget, aTexture );
+    if( tracked )
+        mTexture2d[unit] = aTexture;
+    return true;
+}
+
+bool GlStateCache::bind_texture_2d( GLenum aUnit, GLuint aTexture )
+{
+    std::size_t const unit = std::size_t(aUnit - GL_TEXTURE0);
+    if( unit < kTextureUnits && aTexture == mTexture2d[unit] )
+        return count_( GlStateCall::texture, false );
+
+    active_texture( aUnit );
+    return bind_texture( GL_TEXTURE_2D, aTexture );
+}
+
+void GlStateCache::forget_program( GLuint aProgram ) noexcept
+{
+    // A deleted program stays in use until another one is bound; the name
+    // may be reused in the meantime
+    if( aProgram == mProgram )
+        mProgram = kUnknown_;
+}
+
+void GlStateCache::forget_vertex_array( GLuint aVao ) noexcept
+{
+    if( aVao == mVertexArray )
+        mVertexArray = 0;
+}
+
+void GlStateCache::forget_texture( GLuint aTexture ) noexcept
+{
+    for( auto& bound : mTexture2d )
+    {
+        if( aTexture == bound )
+            bound = 0;
+    }
+}
+
+void GlStateCache::invalidate() noexcept
+{
+    mCapabilities.clear();
+
+    mBlendSrc = mBlendDst = kUnknown_;
+    mDepthFunc = kUnknown_;
+    mDepthMask = Tristate_::unknown;
+    mColorMask = Tristate_::unknown;
+
+    mProgram = kUnknown_;
+    mVertexArray = kUnknown_;
+    mActiveTexture = kUnknown_;
+    mTexture2d.fill( kUnknown_ );
+}
+
+void GlStateCache::end_frame() noexcept
+{
+    mLastFrame = mFrame;
+    mFrame = GlStateStats{};
+}
+
+GlStateStats const& GlStateCache::frame_stats() const noexcept
+{
+    return mFrame;
+}
+GlStateStats const& GlStateCache::last_frame_stats() const noexcept
+{
+    return mLastFrame;
+}
+
+bool GlStateCache::count_( GlStateCall aCall, bool aIssue ) noexcept
+{
+    auto& counter = aIssue ? mFrame.issued : mFrame.skipped;
+    ++counter[std::size_t(aCall)];
+    return aIssue;
+}
+
+GlStateCache::Tristate_& GlStateCache::capability_( GLenum aCapability )
+{
+    for( auto& cap : mCapabilities )
+    {
+        if( aCapability == cap.capability )
+            return cap.state;
+    }
+
+    mCapabilities.emplace_back( Capability_{ aCapability, Tristate_::unknown } );
+    return mCapabilities.back().state;
+}
+
+GlStateCache& gl_state()
+{
+    static GlStateCache cache;
+    return cache;
+}
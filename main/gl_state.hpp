@@ -0,0 +1,143 @@
+#ifndef GL_STATE_HPP_6819C217_E9CE_45B6_A479_13DFFD56FE59
+#define GL_STATE_HPP_6819C217_E9CE_45B6_A479_13DFFD56FE59
+
+#include <glad/glad.h>
+
+#include <array>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+// OpenGL state cache
+//
+// A thin layer over the GL calls that the render code issues most often:
+// capabilities (glEnable/glDisable), blend function, depth function and
+// mask, color mask, program, VAO, active texture unit and 2D texture
+// bindings. Each
+// setter compares against the last value it set and skips the GL call if
+// nothing would change. Setters return true if the call was issued.
+//
+// All render code goes through the shared instance, gl_state(), so that the
+// cache mirrors the real context state. Renderers set the state they need
+// up front instead of restoring "defaults" afterwards; with the cache, the
+// common case of consecutive renderers agreeing on a state costs nothing.
+//
+// The cache starts out (and is reset to, see invalidate()) not knowing any
+// state, so the first call of each kind is always issued. GL state changed
+// behind the cache's back must be reported:
+//  - forget_*() after deleting an object (the binding reverts to zero),
+//  - invalidate() after anything else, e.g., third-party GL code.
+//
+// Counters of issued and skipped calls are kept per frame (end_frame()).
+// The cache is meant for the thread that owns the context.
+
+enum class GlStateCall : std::uint8_t
+{
+    capability,
+    blendFunc,
+    depthFunc,
+    depthMask,
+    colorMask,
+    program,
+    vertexArray,
+    activeTexture,
+    texture,
+
+    count
+};
+
+struct GlStateStats
+{
+    static constexpr std::size_t kCalls = std::size_t(GlStateCall::count);
+
+    std::array<std::size_t, kCalls> issued{};
+    std::array<std::size_t, kCalls> skipped{};
+
+    std::size_t total_issued() const noexcept;
+    std::size_t total_skipped() const noexcept;
+};
+
+class GlStateCache final
+{
+    public:
+        // Units whose GL_TEXTURE_2D binding is tracked; other units and
+        // targets are passed through.
+        static constexpr std::size_t kTextureUnits = 16;
+
+    public:
+        GlStateCache();
+
+        GlStateCache( GlStateCache const& ) = delete;
+        GlStateCache& operator= ( GlStateCache const& ) = delete;
+
+    public:
+        bool enable( GLenum aCapability );
+        bool disable( GLenum aCapability );
+        bool set_enabled( GLenum aCapability, bool aEnabled );
+
+        bool blend_func( GLenum aSrc, GLenum aDst );
+        bool depth_func( GLenum );
+        bool depth_mask( bool );
+        bool color_mask( bool );  // All channels
+
+        bool use_program( GLuint );
+        bool bind_vertex_array( GLuint );
+
+        // aUnit is GL_TEXTURE0 + i
+        bool active_texture( GLenum aUnit );
+
+        // Binds to the active unit
+        bool bind_texture( GLenum aTarget, GLuint );
+
+        // Selects aUnit only if the binding has to change
+        bool bind_texture_2d( GLenum aUnit, GLuint );
+
+        // The object was deleted; bindings of it revert to zero.
+        void forget_program( GLuint ) noexcept;
+        void forget_vertex_array( GLuint ) noexcept;
+        void forget_texture( GLuint ) noexcept;
+
+        // Forgets all state; the next call of each kind is issued.
+        void invalidate() noexcept;
+
+        // Starts counting a new frame.
+        void end_frame() noexcept;
+
+        GlStateStats const& frame_stats() const noexcept;       // So far
+        GlStateStats const& last_frame_stats() const noexcept;  // Complete
+
+    private:
+        static constexpr GLuint kUnknown_ = ~GLuint(0);
+
+        enum class Tristate_ : std::uint8_t { unknown, off, on };
+
+        struct Capability_
+        {
+            GLenum capability;
+            Tristate_ state;
+        };
+
+        bool count_( GlStateCall, bool aIssue ) noexcept;
+        Tristate_& capability_( GLenum );
+
+        std::vector<Capability_> mCapabilities;  // Few; searched linearly
+
+        GLenum mBlendSrc, mBlendDst;
+        GLenum mDepthFunc;
+        Tristate_ mDepthMask;
+        Tristate_ mColorMask;
+
+        GLuint mProgram;
+        GLuint mVertexArray;
+        GLenum mActiveTexture;
+        std::array<GLuint, kTextureUnits> mTexture2d;
+
+        GlStateStats mFrame;
+        GlStateStats mLastFrame;
+};
+
+// The cache of the application's context
+GlStateCache& gl_state();
+
+#endif // GL_STATE_HPP_6819C217_E9CE_45B6_A479_13DFFD56FE59
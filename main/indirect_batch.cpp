@@ -0,0 +1,121 @@
+#include "indirect_batch.hpp"
+
+#include <algorithm>
+
+#include "gl_state.hpp"
+
+IndirectBatch::~IndirectBatch()
+{
+    if( 0 != mBuffer )
+        glDeleteBuffers( 1, &mBuffer );
+}
+
+void IndirectBatch::add( MeshRange const& aRange, std::uint32_t aObject, GLuint aTexture, std::uint32_t aInstanceCount )
+{
+    mEntries.emplace_back( Entry_{ aTexture, DrawElementsIndirectCommand{
+        GLuint(aRange.indexCount),
+        aInstanceCount,
+        aRange.firstIndex,
+        aRange.baseVertex,
+        aObject
+    } } );
+}
+
+void IndirectBatch::clear()
+{
+    mEntries.clear();
+    mGroups.clear();
+}
+
+void IndirectBatch::build()
+{
+    std::stable_sort( mEntries.begin(), mEntries.end(), [] ( Entry_ const& aA, Entry_ const& aB ) {
+        return aA.texture < aB.texture;
+    } );
+
+    mGroups.clear();
+    std::vector<DrawElementsIndirectCommand> commands;
+    commands.reserve( mEntries.size() );
+
+    for( auto const& entry : mEntries )
+    {
+        if( mGroups.empty() || mGroups.back().texture != entry.texture )
+            mGroups.emplace_back( Group_{ entry.texture, commands.size(), 0 } );
+
+        ++mGroups.back().count;
+        commands.emplace_back( entry.command );
+    }
+
+    if( 0 == mBuffer )
+        glGenBuffers( 1, &mBuffer );
+
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, mBuffer );
+    glBufferData( GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW );
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+}
+
+void IndirectBatch::draw() const
+{
+    if( mGroups.empty() )
+        return;
+
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, mBuffer );
+
+    for( auto const& group : mGroups )
+    {
+        gl_state().bind_texture_2d( GL_TEXTURE0, group.texture );
+
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES,
+            GL_UNSIGNED_INT,
+            reinterpret_cast<void const*>(group.first * sizeof(DrawElementsIndirectCommand)),
+            GLsizei(group.count),
+            0
+        );
+    }
+
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+}
+
+void IndirectBatch::draw( GLuint aProgram, GLuint aTexturedProgram ) const
+{
+    if( mGroups.empty() )
+        return;
+
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, mBuffer );
+
+    for( auto const& group : mGroups )
+    {
+        gl_state().use_program( 0 != group.texture ? aTexturedProgram : aProgram );
+        gl_state().bind_texture_2d( GL_TEXTURE0, group.texture );
+
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES,
+            GL_UNSIGNED_INT,
+            reinterpret_cast<void const*>(group.first * sizeof(DrawElementsIndirectCommand)),
+            GLsizei(group.count),
+            0
+        );
+    }
+
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+}
+
+void IndirectBatch::draw_untextured() const
+{
+    if( mEntries.empty() )
+        return;
+
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, mBuffer );
+    glMultiDrawElementsIndirect( GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, GLsizei(mEntries.size()), 0 );
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+}
+
+std::size_t IndirectBatch::command_count() const noexcept
+{
+    return mEntries.size();
+}
+std::size_t IndirectBatch::multi_draw_count() const noexcept
+{
+    return mGroups.size();
+}
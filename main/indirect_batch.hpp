@@ -0,0 +1,97 @@
+#ifndef INDIRECT_BATCH_HPP_5A1E7C30_B84D_4F29_93E6_0D2C8F4A71B5
+#define INDIRECT_BATCH_HPP_5A1E7C30_B84D_4F29_93E6_0D2C8F4A71B5
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "geometry_arena.hpp"
+
+// Indirect draw batch for static geometry
+//
+// The draws of the static scene are recorded into a GL_DRAW_INDIRECT_BUFFER
+// and replayed with glMultiDrawElementsIndirect(). Each command draws one
+// arena range; its base instance is the object index, which the default
+// shader uses to look up transform and material (see frame_uniforms.hpp).
+// The batch is cheap to rebuild, so it can be re-recorded per view with the
+// objects that survived culling.
+// Commands are grouped by texture, the only state that cannot be selected
+// per draw, so a batch costs one multi-draw per distinct texture.
+//
+// Example:
+//    IndirectBatch batch;
+//    batch.add( terrainRange, terrainObject, terrainTexture );
+//    batch.add( padRange, padObject );
+//    batch.build();
+//    ...
+//    arena.bind();
+//    batch.draw();
+
+// Layout defined by the OpenGL specification
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+class IndirectBatch final
+{
+    public:
+        IndirectBatch() = default;
+        ~IndirectBatch();
+
+        IndirectBatch( IndirectBatch const& ) = delete;
+        IndirectBatch& operator= ( IndirectBatch const& ) = delete;
+
+    public:
+        // Records a draw of aInstanceCount consecutive objects, starting at
+        // aObject. Takes effect at the next build().
+        void add( MeshRange const&, std::uint32_t aObject, GLuint aTexture = 0, std::uint32_t aInstanceCount = 1 );
+
+        // Drops all recorded draws.
+        void clear();
+
+        // Sorts the commands by texture and uploads them.
+        void build();
+
+        // Issues the batch. The program and the arena's VAO must be bound.
+        void draw() const;
+
+        // As draw(), but binds aTexturedProgram for the commands that use a
+        // texture and aProgram for the others (see ShaderPermutations).
+        void draw( GLuint aProgram, GLuint aTexturedProgram ) const;
+
+        // Issues all commands as one multi-draw, without binding textures;
+        // for passes that do not sample them (depth only).
+        void draw_untextured() const;
+
+        std::size_t command_count() const noexcept;
+        std::size_t multi_draw_count() const noexcept;
+
+    private:
+        struct Entry_
+        {
+            GLuint texture;
+            DrawElementsIndirectCommand command;
+        };
+
+        struct Group_
+        {
+            GLuint texture;
+            std::size_t first;
+            std::size_t count;
+        };
+
+        std::vector<Entry_> mEntries;
+        std::vector<Group_> mGroups;
+
+        GLuint mBuffer = 0;
+};
+
+#endif // INDIRECT_BATCH_HPP_5A1E7C30_B84D_4F29_93E6_0D2C8F4A71B5
@@ -0,0 +1,244 @@
+#include "input_log.hpp"
+
+#include <filesystem>
+#include <system_error>
+
+#include <cstdio>
+#include <cstring>
+
+#include "../support/error.hpp"
+
+namespace
+{
+    constexpr char kMagic_[4] = { 'G', 'P', 'I', 'L' };
+    constexpr std::uint32_t kVersion_ = 2;
+
+    struct Header_
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t seed;
+        std::uint32_t windowWidth, windowHeight;
+    };
+
+    static_assert( 20 == sizeof(Header_) );
+
+    void put_varint_( std::vector<std::uint8_t>& aOut, std::uint64_t aValue )
+    {
+        while( aValue >= 0x80u )
+        {
+            aOut.push_back( std::uint8_t(aValue | 0x80u) );
+            aValue >>= 7;
+        }
+        aOut.push_back( std::uint8_t(aValue) );
+    }
+
+    std::uint64_t zigzag_( int aValue ) noexcept
+    {
+        auto const v = std::int64_t(aValue);
+        return (std::uint64_t(v) << 1) ^ std::uint64_t(v >> 63);
+    }
+    int unzigzag_( std::uint64_t aValue ) noexcept
+    {
+        return int(std::int64_t(aValue >> 1) ^ -std::int64_t(aValue & 1));
+    }
+
+    void put_float_( std::vector<std::uint8_t>& aOut, float aValue )
+    {
+        std::uint8_t bytes[sizeof(float)];
+        std::memcpy( bytes, &aValue, sizeof(float) );
+        aOut.insert( aOut.end(), bytes, bytes + sizeof(float) );
+    }
+
+    // Input helper, with bounds checking
+    struct Reader_
+    {
+        std::uint8_t const* data;
+        std::size_t size;
+        std::size_t offset = 0;
+
+        std::uint8_t const* take( std::size_t aBytes )
+        {
+            if( aBytes > size - offset )
+                throw Error( "decode_input_log(): truncated data (need %zu bytes at offset %zu, have %zu)", aBytes, offset, size );
+
+            auto const* ptr = data + offset;
+            offset += aBytes;
+            return ptr;
+        }
+
+        std::uint8_t byte()
+        {
+            return *take( 1 );
+        }
+
+        std::uint64_t varint()
+        {
+            std::uint64_t value = 0;
+            for( unsigned shift = 0; shift < 64; shift += 7 )
+            {
+                auto const b = byte();
+                value |= std::uint64_t(b & 0x7fu) << shift;
+                if( !(b & 0x80u) )
+                    return value;
+            }
+
+            throw Error( "decode_input_log(): corrupt varint at offset %zu", offset );
+        }
+
+        float float32()
+        {
+            float value;
+            std::memcpy( &value, take( sizeof(float) ), sizeof(float) );
+            return value;
+        }
+    };
+}
+
+std::vector<std::uint8_t> encode_input_log( InputLog const& aLog )
+{
+    std::vector<std::uint8_t> out( sizeof(Header_) );
+
+    Header_ header{};
+    std::memcpy( header.magic, kMagic_, sizeof(kMagic_) );
+    header.version = kVersion_;
+    header.seed = aLog.seed;
+    header.windowWidth = aLog.windowWidth;
+    header.windowHeight = aLog.windowHeight;
+    std::memcpy( out.data(), &header, sizeof(Header_) );
+
+    std::uint64_t step = 0;
+    for( auto const& event : aLog.events )
+    {
+        if( event.step < step )
+            throw Error( "encode_input_log(): events out of order (step %llu after %llu)", (unsigned long long)event.step, (unsigned long long)step );
+
+        put_varint_( out, event.step - step );
+        step = event.step;
+
+        out.push_back( std::uint8_t(event.type) );
+        switch( event.type )
+        {
+            case InputEventType::key:
+                put_varint_( out, zigzag_( event.code ) );
+                put_varint_( out, zigzag_( event.scancode ) );
+                out.push_back( std::uint8_t(event.action) );
+                out.push_back( std::uint8_t(event.mods) );
+                break;
+
+            case InputEventType::cursor:
+                put_float_( out, event.x );
+                put_float_( out, event.y );
+                break;
+
+            case InputEventType::mouseButton:
+                out.push_back( std::uint8_t(event.code) );
+                out.push_back( std::uint8_t(event.action) );
+                out.push_back( std::uint8_t(event.mods) );
+                break;
+
+            case InputEventType::end:
+                break;
+        }
+    }
+
+    return out;
+}
+
+InputLog decode_input_log( std::uint8_t const* aData, std::size_t aSize )
+{
+    Reader_ in{ aData, aSize };
+
+    Header_ header;
+    std::memcpy( &header, in.take( sizeof(Header_) ), sizeof(Header_) );
+
+    if( 0 != std::memcmp( header.magic, kMagic_, sizeof(kMagic_) ) )
+        throw Error( "decode_input_log(): not an input log (bad magic)" );
+    if( kVersion_ != header.version )
+        throw Error( "decode_input_log(): unsupported version %u (expected %u)", header.version, kVersion_ );
+
+    if( 0 == header.windowWidth || 0 == header.windowHeight )
+        throw Error( "decode_input_log(): no window size" );
+
+    InputLog log;
+    log.seed = header.seed;
+    log.windowWidth = header.windowWidth;
+    log.windowHeight = header.windowHeight;
+
+    std::uint64_t step = 0;
+    while( in.offset < in.size )
+    {
+        InputEvent event;
+        step += in.varint();
+        event.step = step;
+        event.type = InputEventType(in.byte());
+
+        switch( event.type )
+        {
+            case InputEventType::key:
+                event.code = unzigzag_( in.varint() );
+                event.scancode = unzigzag_( in.varint() );
+                event.action = in.byte();
+                event.mods = in.byte();
+                break;
+
+            case InputEventType::cursor:
+                event.x = in.float32();
+                event.y = in.float32();
+                break;
+
+            case InputEventType::mouseButton:
+                event.code = in.byte();
+                event.action = in.byte();
+                event.mods = in.byte();
+                break;
+
+            case InputEventType::end:
+                break;
+
+            default:
+                throw Error( "decode_input_log(): unknown event type %u at offset %zu", unsigned(event.type), in.offset - 1 );
+        }
+
+        log.events.emplace_back( event );
+    }
+
+    return log;
+}
+
+void save_input_log( char const* aPath, InputLog const& aLog )
+{
+    auto const bytes = encode_input_log( aLog );
+
+    std::FILE* fout = std::fopen( aPath, "wb" );
+    if( !fout )
+        throw Error( "save_input_log(): unable to open '%s' for writing", aPath );
+
+    auto const written = std::fwrite( bytes.data(), 1, bytes.size(), fout );
+    std::fclose( fout );
+
+    if( written != bytes.size() )
+        throw Error( "save_input_log(): short write to '%s' (%zu of %zu bytes)", aPath, written, bytes.size() );
+}
+
+InputLog load_input_log( char const* aPath )
+{
+    std::error_code ec;
+    auto const size = std::filesystem::file_size( aPath, ec );
+    if( ec )
+        throw Error( "load_input_log(): unable to query the size of '%s': %s", aPath, ec.message().c_str() );
+
+    std::FILE* fin = std::fopen( aPath, "rb" );
+    if( !fin )
+        throw Error( "load_input_log(): unable to open '%s'", aPath );
+
+    auto const length = std::size_t(size);
+    std::vector<std::uint8_t> bytes( length );
+    auto const read = std::fread( bytes.data(), 1, length, fin );
+    std::fclose( fin );
+
+    if( read != length )
+        throw Error( "load_input_log(): error while reading '%s' (%zu bytes read, %zu total)", aPath, read, length );
+
+    return decode_input_log( bytes.data(), bytes.size() );
+}
@@ -0,0 +1,64 @@
+#ifndef INPUT_LOG_HPP_3C8E5A17_94B2_4D61_8F0A_E27B5C6D1A49
+#define INPUT_LOG_HPP_3C8E5A17_94B2_4D61_8F0A_E27B5C6D1A49
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+// Recorded input (".input"), for replaying a session
+//
+// Each GLFW key, cursor and mouse button event is stored with the index of
+// the simulation step before which it was applied (see FixedTimestep).
+// Replaying applies every event before the same step, so the simulation
+// (cameras, rocket, particles) repeats exactly, however different the frame
+// rate of the replay is. The log also holds the seed of the particles'
+// random numbers (see seedParticles()), and the window size that cursor
+// positions were hit-tested against (buttons, picking); a replay uses the
+// same size.
+//
+// Encoding, after a 20 byte header (magic, version, seed, window size):
+//  - step: delta to the previous event's step, LEB128
+//  - type: 1 byte
+//  - key: key and scancode zig-zag LEB128, action and mods 1 byte each
+//  - cursor: x and y as 32 bit floats
+//  - mouse button: button, action and mods, 1 byte each
+// Most events take 4 to 10 bytes.
+
+enum class InputEventType : std::uint8_t
+{
+    key = 1,
+    cursor = 2,
+    mouseButton = 3,
+    end = 4         // The recording stopped here
+};
+
+struct InputEvent
+{
+    std::uint64_t step = 0;
+    InputEventType type = InputEventType::end;
+
+    // Key (code = key) or mouse button (code = button)
+    int code = 0;
+    int scancode = 0;
+    int action = 0;
+    int mods = 0;
+
+    // Cursor position. Floats, in recording and replay alike.
+    float x = 0.f, y = 0.f;
+};
+
+struct InputLog
+{
+    std::uint32_t seed = 0;
+    std::uint32_t windowWidth = 0, windowHeight = 0;   // Screen coordinates
+    std::vector<InputEvent> events; // By step
+};
+
+std::vector<std::uint8_t> encode_input_log( InputLog const& );
+InputLog decode_input_log( std::uint8_t const*, std::size_t );
+
+void save_input_log( char const* aPath, InputLog const& );
+InputLog load_input_log( char const* aPath );
+
+#endif // INPUT_LOG_HPP_3C8E5A17_94B2_4D61_8F0A_E27B5C6D1A49
@@ -0,0 +1,306 @@
+#include "instance_manager.hpp"
+
+#include <tuple>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include "../support/error.hpp"
+
+namespace
+{
+    // Instances with equal keys are drawn together
+    auto group_key_( MeshRange const& aMesh, GLuint aTexture, bool aStatic )
+    {
+        return std::make_tuple( !aStatic, aTexture, aMesh.baseVertex, aMesh.firstIndex, aMesh.indexCount );
+    }
+}
+
+InstanceManager::~InstanceManager()
+{
+    if( 0 != mBuffer )
+        glDeleteBuffers( 1, &mBuffer );
+    if( 0 != mVisibilityBuffer )
+        glDeleteBuffers( 1, &mVisibilityBuffer );
+}
+
+InstanceHandle InstanceManager::add( MeshRange const& aMesh, GLuint aTexture, Mat44f const& aModel2World, DrawMaterial const& aMaterial, bool aStatic )
+{
+    if( mInstances.size() >= GeometryArena::kMaxObjects )
+        throw Error( "InstanceManager: more than %u instances", unsigned(GeometryArena::kMaxObjects) );
+
+    InstanceHandle const handle{ std::uint32_t(mInstances.size()) };
+    std::int32_t const proxy = mTree.insert( transform_aabb( aMesh.bounds, aModel2World ), handle.id );
+    mInstances.emplace_back( Instance_{ aMesh, aTexture, aStatic, aModel2World, aMaterial, 0, proxy } );
+
+    mLayoutDirty = true;
+    return handle;
+}
+
+void InstanceManager::set_transform( InstanceHandle aHandle, Mat44f const& aModel2World )
+{
+    auto& instance = mInstances.at( aHandle.id );
+    instance.model2world = aModel2World;
+
+    mTree.move( instance.proxy, transform_aabb( instance.mesh.bounds, aModel2World ) );
+
+    if( !mLayoutDirty )
+        mark_dirty_( instance.slot );
+}
+
+void InstanceManager::set_material( InstanceHandle aHandle, DrawMaterial const& aMaterial )
+{
+    auto& instance = mInstances.at( aHandle.id );
+    instance.material = aMaterial;
+
+    if( !mLayoutDirty )
+        mark_dirty_( instance.slot );
+}
+
+Mat44f const& InstanceManager::transform( InstanceHandle aHandle ) const
+{
+    return mInstances.at( aHandle.id ).model2world;
+}
+
+Vec3f InstanceManager::position( InstanceHandle aHandle ) const
+{
+    Mat44f const& m = transform( aHandle );
+    return Vec3f{ m( 0, 3 ), m( 1, 3 ), m( 2, 3 ) };
+}
+
+InstanceSyncStats InstanceManager::sync()
+{
+    InstanceSyncStats stats;
+
+    if( 0 == mBuffer )
+        glGenBuffers( 1, &mBuffer );
+
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, mBuffer );
+
+    if( mLayoutDirty )
+    {
+        relayout_();
+
+        std::size_t const bytes = mData.size() * sizeof(ObjectData);
+        if( bytes > mBufferBytes )
+        {
+            glBufferData( GL_SHADER_STORAGE_BUFFER, bytes, mData.data(), GL_DYNAMIC_DRAW );
+            mBufferBytes = bytes;
+        }
+        else
+            glBufferSubData( GL_SHADER_STORAGE_BUFFER, 0, bytes, mData.data() );
+
+        stats.relayout = true;
+        stats.uploadedInstances = mData.size();
+        stats.uploadRanges = 1;
+    }
+    else if( !mDirty.empty() )
+    {
+        std::sort( mDirty.begin(), mDirty.end() );
+
+        // Merge consecutive slots into one upload each
+        for( std::size_t i = 0; i < mDirty.size(); )
+        {
+            std::size_t j = i + 1;
+            while( j < mDirty.size() && mDirty[j] == mDirty[j-1] + 1 )
+                ++j;
+
+            std::uint32_t const first = mDirty[i];
+            std::size_t const count = j - i;
+            for( std::uint32_t slot = first; slot < first + count; ++slot )
+            {
+                update_slot_( slot );
+                mIsDirty[slot] = false;
+            }
+
+            glBufferSubData( GL_SHADER_STORAGE_BUFFER, first * sizeof(ObjectData), count * sizeof(ObjectData), mData.data() + first );
+
+            stats.uploadedInstances += count;
+            ++stats.uploadRanges;
+            i = j;
+        }
+    }
+
+    mDirty.clear();
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+
+    return stats;
+}
+
+void InstanceManager::bind( GLuint aBinding, GLuint aVisibilityBinding ) const
+{
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, aBinding, mBuffer );
+
+    if( 0 != mVisibilityBuffer )
+        glBindBufferBase( GL_SHADER_STORAGE_BUFFER, aVisibilityBinding, mVisibilityBuffer );
+}
+
+void InstanceManager::upload_visibility( std::vector<std::uint8_t> const& aVisible )
+{
+    if( 0 == mVisibilityBuffer )
+        glGenBuffers( 1, &mVisibilityBuffer );
+
+    // std430 uint array; slot s is byte s&3 (little endian) of element s/4
+    std::size_t const bytes = std::max<std::size_t>( 4, (aVisible.size() + 3) & ~std::size_t(3) );
+    mVisibility.assign( bytes, 0 );
+    std::copy( aVisible.begin(), aVisible.end(), mVisibility.begin() );
+
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, mVisibilityBuffer );
+    if( bytes > mVisibilityBytes )
+    {
+        glBufferData( GL_SHADER_STORAGE_BUFFER, bytes, mVisibility.data(), GL_STREAM_DRAW );
+        mVisibilityBytes = bytes;
+    }
+    else
+        glBufferSubData( GL_SHADER_STORAGE_BUFFER, 0, bytes, mVisibility.data() );
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+}
+
+std::vector<InstanceGroup> const& InstanceManager::groups() const noexcept
+{
+    return mGroups;
+}
+
+std::uint32_t InstanceManager::slot( InstanceHandle aHandle ) const
+{
+    return mInstances.at( aHandle.id ).slot;
+}
+
+InstanceHandle InstanceManager::handle_at( std::uint32_t aSlot ) const
+{
+    return InstanceHandle{ mHandleAt.at( aSlot ) };
+}
+
+CullStats InstanceManager::cull( Frustum const* aFrustums, std::size_t aCount, std::vector<std::uint8_t>& aVisible ) const
+{
+    if( aCount > kMaxViews )
+        throw Error( "InstanceManager: %zu views, at most %zu supported", aCount, kMaxViews );
+
+    aVisible.assign( mInstances.size(), 0 );
+
+    // Each instance has its own slot, so the jobs of the query never write
+    // the same element; visibility is counted afterwards.
+    mTree.parallel_query( aFrustums, aCount, [&] ( std::uint32_t aHandle, std::uint32_t aMask ) {
+        aVisible[mInstances[aHandle].slot] = std::uint8_t(aMask);
+    } );
+
+    std::size_t visible = 0;
+    for( auto const mask : aVisible )
+        visible += std::size_t(__builtin_popcount( mask ));
+
+    return CullStats{ visible, mInstances.size() * aCount - visible };
+}
+
+std::size_t InstanceManager::cull_occluded( OcclusionBuffer const& aOcclusion, std::uint8_t aViewBit, std::vector<std::uint8_t>& aVisible ) const
+{
+    std::size_t occluded = 0;
+    for( std::uint32_t slot = 0; slot < aVisible.size(); ++slot )
+    {
+        if( !(aVisible[slot] & aViewBit) )
+            continue;
+
+        auto const& instance = mInstances[mHandleAt[slot]];
+        if( !aOcclusion.is_visible( transform_aabb( instance.mesh.bounds, instance.model2world ) ) )
+        {
+            aVisible[slot] &= std::uint8_t(~aViewBit);
+            ++occluded;
+        }
+    }
+
+    return occluded;
+}
+
+std::optional<InstanceHandle> InstanceManager::pick( Vec3f aOrigin, Vec3f aDirection ) const
+{
+    Vec3f const inv{ 1.f / aDirection.x, 1.f / aDirection.y, 1.f / aDirection.z };
+
+    // The tree tests the fat bounds; refine with the instance's own bounds
+    auto const hit = mTree.raycast( aOrigin, aDirection, std::numeric_limits<float>::max(), [&] ( std::uint32_t aHandle, float ) {
+        auto const& instance = mInstances[aHandle];
+        float t = 0.f;
+        if( !intersect_ray( transform_aabb( instance.mesh.bounds, instance.model2world ), aOrigin, inv, std::numeric_limits<float>::max(), t ) )
+            return -1.f;
+        return t;
+    } );
+
+    if( AabbTree::kNull == hit.proxy )
+        return std::nullopt;
+
+    return InstanceHandle{ hit.userData };
+}
+
+std::optional<InstanceHandle> InstanceManager::nearest( Vec3f aPoint, float aMaxDistance ) const
+{
+    std::int32_t const proxy = mTree.nearest( aPoint, aMaxDistance );
+    if( AabbTree::kNull == proxy )
+        return std::nullopt;
+
+    return InstanceHandle{ mTree.user_data( proxy ) };
+}
+
+void InstanceManager::record( IndirectBatch& aBatch, bool aStatic, std::vector<std::uint8_t> const& aVisible, std::uint8_t aViewMask, std::uint32_t aViewCount ) const
+{
+    for( auto const& group : mGroups )
+    {
+        if( group.isStatic != aStatic )
+            continue;
+
+        for_each_visible_run( group, aVisible, aViewMask, [&] ( std::uint32_t aFirst, std::uint32_t aCount ) {
+            aBatch.add( group.mesh, aFirst, group.texture, aCount * aViewCount );
+        } );
+    }
+}
+
+std::size_t InstanceManager::size() const noexcept
+{
+    return mInstances.size();
+}
+
+void InstanceManager::relayout_()
+{
+    // Order instances by group; stable, so that slots follow insertion order
+    std::vector<std::uint32_t> order( mInstances.size() );
+    std::iota( order.begin(), order.end(), 0u );
+    std::stable_sort( order.begin(), order.end(), [this] ( std::uint32_t aA, std::uint32_t aB ) {
+        auto const& a = mInstances[aA];
+        auto const& b = mInstances[aB];
+        return group_key_( a.mesh, a.texture, a.isStatic ) < group_key_( b.mesh, b.texture, b.isStatic );
+    } );
+
+    mGroups.clear();
+    mData.resize( mInstances.size() );
+    mHandleAt = order;
+
+    for( std::uint32_t slot = 0; slot < order.size(); ++slot )
+    {
+        auto& instance = mInstances[order[slot]];
+        instance.slot = slot;
+        update_slot_( slot );
+
+        if( mGroups.empty()
+            || group_key_( instance.mesh, instance.texture, instance.isStatic ) != group_key_( mGroups.back().mesh, mGroups.back().texture, mGroups.back().isStatic ) )
+        {
+            mGroups.emplace_back( InstanceGroup{ instance.mesh, instance.texture, instance.isStatic, instance.material.id, slot, 0 } );
+        }
+
+        ++mGroups.back().count;
+    }
+
+    mIsDirty.assign( mData.size(), false );
+    mLayoutDirty = false;
+}
+
+void InstanceManager::update_slot_( std::uint32_t aSlot )
+{
+    auto const& instance = mInstances[mHandleAt[aSlot]];
+    mData[aSlot] = make_object_data( instance.model2world, instance.material );
+}
+
+void InstanceManager::mark_dirty_( std::uint32_t aSlot )
+{
+    if( !mIsDirty[aSlot] )
+    {
+        mIsDirty[aSlot] = true;
+        mDirty.push_back( aSlot );
+    }
+}
@@ -0,0 +1,190 @@
+#ifndef INSTANCE_MANAGER_HPP_D6F02B4E_3C71_4A98_B5E2_81A9C4F07D36
+#define INSTANCE_MANAGER_HPP_D6F02B4E_3C71_4A98_B5E2_81A9C4F07D36
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <optional>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "geometry_arena.hpp"
+#include "frame_uniforms.hpp"
+#include "aabb_tree.hpp"
+#include "frustum_cull.hpp"
+#include "indirect_batch.hpp"
+#include "occlusion.hpp"
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+// Instance manager
+//
+// Owns the per-object data (ObjectBlock, see frame_uniforms.hpp) of all scene
+// objects. Objects that share a mesh and a texture form a group; the
+// instances of a group occupy consecutive slots of the object buffer, so
+// that each group is drawn by a single instanced draw whose base instance is
+// the group's first slot:
+//    glDrawElementsInstancedBaseVertexBaseInstance( ..., group.count, ..., group.first )
+//
+// Updates are incremental. set_transform() and set_material() only mark the
+// instance's slot; sync() uploads the modified slots, merged into runs of
+// consecutive slots. Adding instances changes the layout, which sync()
+// rebuilds and uploads in full.
+//
+// The world-space bounds of all instances are kept in a dynamic AABB tree,
+// which is refit as instances move. It serves per-view frustum culling,
+// picking and proximity queries. Culling splits a group into runs of
+// consecutive visible slots, each of which is still a single instanced draw
+// (see for_each_visible_run()).
+//
+// When several views are drawn in one pass, the draws cover the union of
+// the views' visible runs, and the visibility masks are uploaded as well
+// (upload_visibility()) so that the shader can drop an object from the views
+// it is not visible in.
+
+struct InstanceHandle
+{
+    std::uint32_t id;
+};
+
+struct InstanceGroup
+{
+    MeshRange mesh;
+    GLuint texture;
+    bool isStatic;
+    std::uint16_t material;  // Material id of the first instance; for sorting
+    std::uint32_t first;     // First slot
+    std::uint32_t count;     // Number of instances
+};
+
+struct InstanceSyncStats
+{
+    bool relayout = false;
+    std::size_t uploadedInstances = 0;
+    std::size_t uploadRanges = 0;
+};
+
+class InstanceManager final
+{
+    public:
+        // Views per cull() call; a view is one bit of the visibility masks
+        static constexpr std::size_t kMaxViews = 8;
+
+    public:
+        InstanceManager() = default;
+        ~InstanceManager();
+
+        InstanceManager( InstanceManager const& ) = delete;
+        InstanceManager& operator= ( InstanceManager const& ) = delete;
+
+    public:
+        // Static instances are expected to rarely move; see record().
+        InstanceHandle add( MeshRange const&, GLuint aTexture, Mat44f const& aModel2World, DrawMaterial const&, bool aStatic );
+
+        void set_transform( InstanceHandle, Mat44f const& );
+        void set_material( InstanceHandle, DrawMaterial const& );
+
+        Mat44f const& transform( InstanceHandle ) const;
+        Vec3f position( InstanceHandle ) const;
+
+        // Uploads pending changes. Requires a current OpenGL context.
+        InstanceSyncStats sync();
+
+        // Binds the object buffer as ObjectBlock, and the visibility masks
+        // (if uploaded) as VisibilityBlock.
+        void bind( GLuint aBinding = kObjectStorageBinding, GLuint aVisibilityBinding = kVisibilityStorageBinding ) const;
+
+        // Uploads the masks of cull() for the shader, packed four slots per
+        // uint. Requires a current OpenGL context.
+        void upload_visibility( std::vector<std::uint8_t> const& aVisible );
+
+        // Groups and slots are valid after sync()
+        std::vector<InstanceGroup> const& groups() const noexcept;
+        std::uint32_t slot( InstanceHandle ) const;
+        InstanceHandle handle_at( std::uint32_t aSlot ) const;
+
+        // Culls all instances against up to kMaxViews frustums in a single
+        // traversal of the tree (on worker threads for large scenes, see
+        // AabbTree::parallel_query()). Bit v of aVisible[slot] is set if the
+        // instance in slot may be visible in view v. Valid after sync().
+        CullStats cull( Frustum const* aFrustums, std::size_t aCount, std::vector<std::uint8_t>& aVisible ) const;
+
+        // Clears bit aViewBit of the instances that aOcclusion reports as
+        // hidden. Returns the number of instances that were cleared.
+        std::size_t cull_occluded( OcclusionBuffer const& aOcclusion, std::uint8_t aViewBit, std::vector<std::uint8_t>& aVisible ) const;
+
+        // Instance whose world-space bounds the ray aOrigin + t*aDirection
+        // (t >= 0) enters first, if any.
+        std::optional<InstanceHandle> pick( Vec3f aOrigin, Vec3f aDirection ) const;
+
+        // Instance whose bounds are closest to aPoint, if any lies within
+        // aMaxDistance. The distance is measured to the tree's fat bounds.
+        std::optional<InstanceHandle> nearest( Vec3f aPoint, float aMaxDistance ) const;
+
+        // Records one instanced command per run of instances of the static
+        // (or dynamic) groups that are visible in any view of aViewMask.
+        // Each instance is drawn aViewCount times (see
+        // GeometryArena::set_view_count()).
+        void record( IndirectBatch&, bool aStatic, std::vector<std::uint8_t> const& aVisible, std::uint8_t aViewMask, std::uint32_t aViewCount = 1 ) const;
+
+        std::size_t size() const noexcept;
+
+    private:
+        struct Instance_
+        {
+            MeshRange mesh;
+            GLuint texture;
+            bool isStatic;
+            Mat44f model2world;
+            DrawMaterial material;
+            std::uint32_t slot;
+            std::int32_t proxy;
+        };
+
+        void relayout_();
+        void mark_dirty_( std::uint32_t aSlot );
+        void update_slot_( std::uint32_t aSlot );
+
+        std::vector<Instance_> mInstances;      // By handle id
+        std::vector<InstanceGroup> mGroups;
+
+        std::vector<ObjectData> mData;          // By slot
+        std::vector<std::uint32_t> mHandleAt;   // Slot -> handle id
+        std::vector<std::uint32_t> mDirty;      // Slots
+        std::vector<bool> mIsDirty;             // By slot
+        AabbTree mTree;                         // User data: handle id
+        bool mLayoutDirty = false;
+
+        GLuint mBuffer = 0;
+        std::size_t mBufferBytes = 0;
+
+        std::vector<std::uint8_t> mVisibility;  // Padded to a multiple of 4
+        GLuint mVisibilityBuffer = 0;
+        std::size_t mVisibilityBytes = 0;
+};
+
+// Calls aFunc( first, count ) for each run of consecutive slots of the group
+// that are visible in any view of aViewMask (see InstanceManager::cull()).
+template< typename tFunc >
+void for_each_visible_run( InstanceGroup const& aGroup, std::vector<std::uint8_t> const& aVisible, std::uint8_t aViewMask, tFunc&& aFunc )
+{
+    std::uint32_t const end = aGroup.first + aGroup.count;
+    for( std::uint32_t slot = aGroup.first; slot < end; )
+    {
+        if( !(aVisible[slot] & aViewMask) )
+        {
+            ++slot;
+            continue;
+        }
+
+        std::uint32_t const first = slot;
+        while( slot < end && (aVisible[slot] & aViewMask) )
+            ++slot;
+
+        aFunc( first, slot - first );
+    }
+}
+
+#endif // INSTANCE_MANAGER_HPP_D6F02B4E_3C71_4A98_B5E2_81A9C4F07D36
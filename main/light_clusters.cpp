@@ -0,0 +1,325 @@
+#include "light_clusters.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+
+#include "../support/error.hpp"
+#include "../support/job_system.hpp"
+
+namespace
+{
+    // Lights and tiles share one 32 bit word in the per-slice results
+    static_assert( kClusterTilesPerSlice <= 256 );
+    constexpr std::size_t kMaxLights_ = std::size_t(1) << 24;
+
+    // Header of ClusterBlock (std430)
+    struct ClusterHeader_
+    {
+        std::uint32_t dims[4];  // Tiles x, y, slices, clusters per view
+        float depth[4];         // Slice scale and bias, near, far
+    };
+
+    std::uint8_t tile_( float aNdc, std::uint32_t aTiles ) noexcept
+    {
+        float const t = std::floor( (aNdc * 0.5f + 0.5f) * float(aTiles) );
+        return std::uint8_t(std::clamp( t, 0.f, float(aTiles - 1) ));
+    }
+
+    // Binds the buffer to GL_SHADER_STORAGE_BUFFER, growing it to at least
+    // aBytes. Contents are lost when it grows.
+    void reserve_( GLuint& aBuffer, std::size_t& aCapacity, std::size_t aBytes )
+    {
+        if( 0 == aBuffer )
+            glGenBuffers( 1, &aBuffer );
+
+        glBindBuffer( GL_SHADER_STORAGE_BUFFER, aBuffer );
+        if( aBytes > aCapacity || 0 == aCapacity )
+        {
+            aCapacity = std::max<std::size_t>( 64, aBytes + aBytes / 2 );
+            glBufferData( GL_SHADER_STORAGE_BUFFER, aCapacity, nullptr, GL_STREAM_DRAW );
+        }
+    }
+}
+
+LightClusters::LightClusters() = default;
+
+LightClusters::~LightClusters()
+{
+    GLuint const buffers[] = { mLightBuffer, mClusterBuffer, mIndexBuffer };
+    for( auto const buffer : buffers )
+    {
+        if( 0 != buffer )
+            glDeleteBuffers( 1, &buffer );
+    }
+}
+
+void LightClusters::set_projection( Mat44f const& aProj )
+{
+    float const p00 = aProj(0,0), p11 = aProj(1,1);
+    float const p22 = aProj(2,2), p23 = aProj(2,3);
+
+    if( -1.f != aProj(3,2) || 0.f == p00 || 0.f == p11 )
+        throw Error( "LightClusters::set_projection(): not a perspective projection" );
+
+    // Inverse of the depth mapping of make_perspective_projection()
+    float const zNear = p23 / (p22 - 1.f);
+    float const zFar = p23 / (p22 + 1.f);
+    if( !(zNear > 0.f) || !(zFar > zNear) )
+        throw Error( "LightClusters::set_projection(): invalid depth range %g .. %g", double(zNear), double(zFar) );
+
+    if( !mBounds.empty() && p00 == mP00 && p11 == mP11 && zNear == mNear && zFar == mFar )
+        return;
+
+    mP00 = p00;
+    mP11 = p11;
+    mNear = zNear;
+    mFar = zFar;
+
+    float const logRatio = std::log( zFar / zNear );
+    mSliceScale = float(kClusterSlices) / logRatio;
+    mSliceBias = -float(kClusterSlices) * std::log( zNear ) / logRatio;
+
+    // Cluster bounds: at depth d, NDC x maps to view x = ndc * d / p00. The
+    // extremes of each tile are found at its near or far end.
+    mBounds.resize( kClustersPerView );
+    for( std::uint32_t k = 0; k < kClusterSlices; ++k )
+    {
+        float const d0 = zNear * std::pow( zFar / zNear, float(k) / float(kClusterSlices) );
+        float const d1 = zNear * std::pow( zFar / zNear, float(k+1) / float(kClusterSlices) );
+
+        for( std::uint32_t ty = 0; ty < kClusterTilesY; ++ty )
+        {
+            float const y0 = (-1.f + 2.f * float(ty) / float(kClusterTilesY)) / p11;
+            float const y1 = (-1.f + 2.f * float(ty+1) / float(kClusterTilesY)) / p11;
+
+            for( std::uint32_t tx = 0; tx < kClusterTilesX; ++tx )
+            {
+                float const x0 = (-1.f + 2.f * float(tx) / float(kClusterTilesX)) / p00;
+                float const x1 = (-1.f + 2.f * float(tx+1) / float(kClusterTilesX)) / p00;
+
+                Aabb& bounds = mBounds[(k * kClusterTilesY + ty) * kClusterTilesX + tx];
+                bounds.min = Vec3f{ std::min( x0 * d0, x0 * d1 ), std::min( y0 * d0, y0 * d1 ), -d1 };
+                bounds.max = Vec3f{ std::max( x1 * d0, x1 * d1 ), std::max( y1 * d0, y1 * d1 ), -d0 };
+            }
+        }
+    }
+}
+
+ClusterStats LightClusters::assign( Mat44f const* aViews, std::size_t aViewCount, std::vector<PointLight> const& aLights )
+{
+    if( mBounds.empty() )
+        throw Error( "LightClusters::assign(): no projection set" );
+
+    std::size_t const count = aLights.size();
+    if( count >= kMaxLights_ )
+        throw Error( "LightClusters::assign(): %zu lights, at most %zu supported", count, kMaxLights_ - 1 );
+
+    std::size_t const entries = aViewCount * count;
+    for( auto* values : { &mX, &mY, &mZ, &mR } )
+        values->resize( entries );
+    for( auto* values : { &mSliceMin, &mSliceMax, &mTileMinX, &mTileMaxX, &mTileMinY, &mTileMaxY } )
+        values->resize( entries );
+
+    for( std::size_t v = 0; v < aViewCount; ++v )
+        prepare_view_( v, aViews[v], aLights );
+
+    // One job per slice of each view
+    std::size_t const jobs = aViewCount * kClusterSlices;
+    if( mSlices.size() < jobs )
+        mSlices.resize( jobs );
+
+    // Slices near the camera hold most of the work; with a job per slice,
+    // idle threads steal the remaining ones.
+    std::size_t const grain = entries < kParallelClusterThreshold ? jobs : 1;
+    job_system().parallel_for( 0, jobs, grain, [&] ( std::size_t aBegin, std::size_t aEnd ) {
+        for( std::size_t j = aBegin; j < aEnd; ++j )
+            assign_slice_( j / kClusterSlices, std::uint32_t(j % kClusterSlices), count, mSlices[j] );
+    } );
+
+    // Concatenate the slices. Job j covers clusters j * tiles per slice, ...
+    std::size_t total = 0;
+    for( std::size_t j = 0; j < jobs; ++j )
+        total += mSlices[j].indices.size();
+
+    mClusters.resize( aViewCount * kClustersPerView );
+    mIndices.resize( total );
+
+    ClusterStats stats;
+    stats.lights = count;
+    stats.assignments = total;
+
+    std::uint32_t offset = 0;
+    for( std::size_t j = 0; j < jobs; ++j )
+    {
+        Slice_ const& slice = mSlices[j];
+        ClusterRange* ranges = mClusters.data() + j * kClusterTilesPerSlice;
+
+        std::uint32_t local = 0;
+        for( std::uint32_t t = 0; t < kClusterTilesPerSlice; ++t )
+        {
+            ranges[t] = ClusterRange{ offset + local, slice.counts[t] };
+            local += slice.counts[t];
+            stats.maxPerCluster = std::max<std::size_t>( stats.maxPerCluster, slice.counts[t] );
+        }
+
+        std::copy( slice.indices.begin(), slice.indices.end(), mIndices.begin() + offset );
+        offset += local;
+    }
+
+    return stats;
+}
+
+std::vector<ClusterRange> const& LightClusters::clusters() const noexcept
+{
+    return mClusters;
+}
+std::vector<std::uint32_t> const& LightClusters::indices() const noexcept
+{
+    return mIndices;
+}
+
+std::uint32_t LightClusters::slice( float aDepth ) const noexcept
+{
+    float const s = std::floor( std::log( std::max( aDepth, mNear ) ) * mSliceScale + mSliceBias );
+    return std::uint32_t(std::clamp( s, 0.f, float(kClusterSlices - 1) ));
+}
+
+std::uint32_t LightClusters::cluster_at( std::size_t aView, Vec3f aViewPosition ) const noexcept
+{
+    float const depth = std::max( -aViewPosition.z, mNear );
+    std::uint32_t const tx = tile_( mP00 * aViewPosition.x / depth, kClusterTilesX );
+    std::uint32_t const ty = tile_( mP11 * aViewPosition.y / depth, kClusterTilesY );
+
+    return std::uint32_t(aView) * kClustersPerView + (slice( depth ) * kClusterTilesY + ty) * kClusterTilesX + tx;
+}
+
+void LightClusters::upload( std::vector<PointLight> const& aLights )
+{
+    ClusterHeader_ const header{
+        { kClusterTilesX, kClusterTilesY, kClusterSlices, kClustersPerView },
+        { mSliceScale, mSliceBias, mNear, mFar }
+    };
+
+    std::size_t const lightBytes = aLights.size() * sizeof(PointLight);
+    std::size_t const rangeBytes = mClusters.size() * sizeof(ClusterRange);
+    std::size_t const indexBytes = mIndices.size() * sizeof(std::uint32_t);
+
+    reserve_( mLightBuffer, mLightBytes, lightBytes );
+    glBufferSubData( GL_SHADER_STORAGE_BUFFER, 0, lightBytes, aLights.data() );
+
+    reserve_( mClusterBuffer, mClusterBytes, sizeof(ClusterHeader_) + rangeBytes );
+    glBufferSubData( GL_SHADER_STORAGE_BUFFER, 0, sizeof(ClusterHeader_), &header );
+    glBufferSubData( GL_SHADER_STORAGE_BUFFER, sizeof(ClusterHeader_), rangeBytes, mClusters.data() );
+
+    reserve_( mIndexBuffer, mIndexBytes, indexBytes );
+    glBufferSubData( GL_SHADER_STORAGE_BUFFER, 0, indexBytes, mIndices.data() );
+
+    glBindBuffer( GL_SHADER_STORAGE_BUFFER, 0 );
+
+    bind();
+}
+
+void LightClusters::bind() const
+{
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, kLightStorageBinding, mLightBuffer );
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, kClusterStorageBinding, mClusterBuffer );
+    glBindBufferBase( GL_SHADER_STORAGE_BUFFER, kLightIndexStorageBinding, mIndexBuffer );
+}
+
+void LightClusters::prepare_view_( std::size_t aView, Mat44f const& aV, std::vector<PointLight> const& aLights )
+{
+    std::size_t const count = aLights.size();
+    std::size_t const base = aView * count;
+
+    float* const x = mX.data() + base;
+    float* const y = mY.data() + base;
+    float* const z = mZ.data() + base;
+    float* const r = mR.data() + base;
+
+    // Centers to view space
+    for( std::size_t i = 0; i < count; ++i )
+    {
+        Vec3f const p = aLights[i].position;
+        x[i] = aV(0,0) * p.x + aV(0,1) * p.y + aV(0,2) * p.z + aV(0,3);
+        y[i] = aV(1,0) * p.x + aV(1,1) * p.y + aV(1,2) * p.z + aV(1,3);
+        z[i] = aV(2,0) * p.x + aV(2,1) * p.y + aV(2,2) * p.z + aV(2,3);
+        r[i] = aLights[i].range;
+    }
+
+    // Clusters that may be touched: the slices of the sphere's depth range,
+    // and the tiles covered by its bounding box over that range. For a fixed
+    // depth, x/depth grows with x; for a fixed x, it is monotonic in depth,
+    // so the box's NDC extremes are at its corners.
+    for( std::size_t i = 0; i < count; ++i )
+    {
+        float const depth = -z[i];
+        float const nearest = std::max( depth - r[i], mNear );
+        float const farthest = std::min( depth + r[i], mFar );
+
+        float const left = mP00 * std::min( (x[i] - r[i]) / nearest, (x[i] - r[i]) / farthest );
+        float const right = mP00 * std::max( (x[i] + r[i]) / nearest, (x[i] + r[i]) / farthest );
+        float const bottom = mP11 * std::min( (y[i] - r[i]) / nearest, (y[i] - r[i]) / farthest );
+        float const top = mP11 * std::max( (y[i] + r[i]) / nearest, (y[i] + r[i]) / farthest );
+
+        if( nearest > farthest || left > 1.f || right < -1.f || bottom > 1.f || top < -1.f )
+        {
+            // Outside of the frustum: empty slice range
+            mSliceMin[base+i] = 1;
+            mSliceMax[base+i] = 0;
+            continue;
+        }
+
+        mSliceMin[base+i] = std::uint8_t(slice( nearest ));
+        mSliceMax[base+i] = std::uint8_t(slice( farthest ));
+        mTileMinX[base+i] = tile_( left, kClusterTilesX );
+        mTileMaxX[base+i] = tile_( right, kClusterTilesX );
+        mTileMinY[base+i] = tile_( bottom, kClusterTilesY );
+        mTileMaxY[base+i] = tile_( top, kClusterTilesY );
+    }
+}
+
+void LightClusters::assign_slice_( std::size_t aView, std::uint32_t aSlice, std::size_t aLightCount, Slice_& aOut )
+{
+    std::size_t const base = aView * aLightCount;
+    Aabb const* const bounds = mBounds.data() + aSlice * kClusterTilesPerSlice;
+
+    aOut.counts.fill( 0 );
+    aOut.pairs.clear();
+
+    for( std::size_t i = 0; i < aLightCount; ++i )
+    {
+        std::size_t const l = base + i;
+        if( aSlice < mSliceMin[l] || aSlice > mSliceMax[l] )
+            continue;
+
+        Vec3f const center{ mX[l], mY[l], mZ[l] };
+        float const radiusSq = mR[l] * mR[l];
+
+        for( std::uint32_t ty = mTileMinY[l]; ty <= mTileMaxY[l]; ++ty )
+        {
+            for( std::uint32_t tx = mTileMinX[l]; tx <= mTileMaxX[l]; ++tx )
+            {
+                std::uint32_t const tile = ty * kClusterTilesX + tx;
+                if( distance_squared( bounds[tile], center ) > radiusSq )
+                    continue;
+
+                aOut.pairs.emplace_back( tile << 24 | std::uint32_t(i) );
+                ++aOut.counts[tile];
+            }
+        }
+    }
+
+    // Counting sort by tile; the lights of a tile stay in ascending order
+    std::array<std::uint32_t, kClusterTilesPerSlice> starts;
+    std::uint32_t start = 0;
+    for( std::uint32_t t = 0; t < kClusterTilesPerSlice; ++t )
+    {
+        starts[t] = start;
+        start += aOut.counts[t];
+    }
+
+    aOut.indices.resize( aOut.pairs.size() );
+    for( auto const pair : aOut.pairs )
+        aOut.indices[starts[pair >> 24]++] = pair & 0xffffffu;
+}
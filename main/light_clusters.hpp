@@ -0,0 +1,153 @@
+#ifndef LIGHT_CLUSTERS_HPP_A1C1D47B_2E15_4A36_9A79_EF8E48C5DA3B
+#define LIGHT_CLUSTERS_HPP_A1C1D47B_2E15_4A36_9A79_EF8E48C5DA3B
+
+#include <glad/glad.h>
+
+#include <array>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bounds.hpp"
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+// Clustered forward lighting
+//
+// Fragments do not evaluate every point light. The view frustum is divided
+// into clusters ("froxels"): kClusterTilesX x kClusterTilesY tiles in NDC,
+// times kClusterSlices slices in view depth. Slices are spaced exponentially
+// between the near and far plane, so that clusters are roughly as deep as
+// they are wide. Once per frame, the CPU assigns each light to the clusters
+// that its sphere of influence (PointLight::range) touches; the default
+// fragment shader looks up the cluster it falls into and loops over that
+// cluster's lights only.
+//
+// Assignment runs per view and depth slice:
+//  - the light centers are moved to view space as structure-of-arrays, a
+//    straight loop of independent float operations that the compiler
+//    vectorizes,
+//  - each light's depth range and a conservative rectangle of tiles bound
+//    the clusters to test,
+//  - the sphere is tested against the view-space bounds of those clusters.
+// Slices are independent. With many lights (kParallelClusterThreshold lights
+// times views), each slice is a job of the shared job system. Each slice sorts
+// its results by cluster (a counting sort) and the slices are concatenated
+// in order, so the output does not depend on the number of threads.
+//
+// All views share the projection (set_projection()); the bounds of the
+// clusters are computed in view space once per projection.
+//
+// Shader interface (std430, see default.frag):
+//  - LightBlock: the lights, PointLight,
+//  - ClusterBlock: the grid parameters, then the offset and count of the
+//    lights of each cluster (ClusterRange),
+//  - LightIndexBlock: the light indices of all clusters.
+// The clusters of frame view v start at v * kClustersPerView.
+
+constexpr GLuint kLightStorageBinding = 4;
+constexpr GLuint kClusterStorageBinding = 5;
+constexpr GLuint kLightIndexStorageBinding = 6;
+
+constexpr std::uint32_t kClusterTilesX = 16;
+constexpr std::uint32_t kClusterTilesY = 9;
+constexpr std::uint32_t kClusterSlices = 24;
+
+constexpr std::uint32_t kClusterTilesPerSlice = kClusterTilesX * kClusterTilesY;
+constexpr std::uint32_t kClustersPerView = kClusterTilesPerSlice * kClusterSlices;
+
+constexpr std::size_t kParallelClusterThreshold = 1024;
+
+// One element of LightBlock. Intensity falls off as 1/(1 + d^2/radius^2),
+// windowed to reach zero at range.
+struct PointLight
+{
+    Vec3f position;   // World space
+    float range;
+    Vec3f color;
+    float radius;
+};
+
+static_assert( sizeof(PointLight) == 32 );
+
+struct ClusterRange
+{
+    std::uint32_t offset;  // Into the light indices
+    std::uint32_t count;
+};
+
+struct ClusterStats
+{
+    std::size_t lights = 0;
+    std::size_t assignments = 0;      // Light indices over all clusters
+    std::size_t maxPerCluster = 0;
+};
+
+class LightClusters final
+{
+    public:
+        LightClusters();
+        ~LightClusters();
+
+        LightClusters( LightClusters const& ) = delete;
+        LightClusters& operator= ( LightClusters const& ) = delete;
+
+    public:
+        // The projection shared by all views; must be a perspective
+        // projection as made by make_perspective_projection().
+        void set_projection( Mat44f const& );
+
+        // Assigns the lights to the clusters of views 0 .. aViewCount-1,
+        // given their view matrices.
+        ClusterStats assign( Mat44f const* aViews, std::size_t aViewCount, std::vector<PointLight> const& );
+
+        // Results of the last assign()
+        std::vector<ClusterRange> const& clusters() const noexcept;
+        std::vector<std::uint32_t> const& indices() const noexcept;
+
+        // Slice of a view-space depth (-z), clamped to the grid
+        std::uint32_t slice( float aDepth ) const noexcept;
+
+        // Cluster of a view-space position in view aView, as the shader
+        // computes it
+        std::uint32_t cluster_at( std::size_t aView, Vec3f aViewPosition ) const noexcept;
+
+        // Uploads the lights and the results of the last assign(), and binds
+        // the three blocks.
+        void upload( std::vector<PointLight> const& );
+        void bind() const;
+
+    private:
+        // Results of one slice of one view, sorted by tile
+        struct Slice_
+        {
+            std::array<std::uint32_t, kClusterTilesPerSlice> counts;
+            std::vector<std::uint32_t> pairs;    // tile << 24 | light
+            std::vector<std::uint32_t> indices;
+        };
+
+        void prepare_view_( std::size_t aView, Mat44f const&, std::vector<PointLight> const& );
+        void assign_slice_( std::size_t aView, std::uint32_t aSlice, std::size_t aLightCount, Slice_& );
+
+        float mP00 = 0.f, mP11 = 0.f;
+        float mNear = 0.f, mFar = 0.f;
+        float mSliceScale = 0.f, mSliceBias = 0.f;  // slice = log(depth) * scale + bias
+        std::vector<Aabb> mBounds;  // View space, per cluster of a view
+
+        // Per view and light; view v starts at v * light count
+        std::vector<float> mX, mY, mZ, mR;  // View-space spheres
+        std::vector<std::uint8_t> mSliceMin, mSliceMax;
+        std::vector<std::uint8_t> mTileMinX, mTileMaxX, mTileMinY, mTileMaxY;
+
+        std::vector<Slice_> mSlices;
+
+        std::vector<ClusterRange> mClusters;
+        std::vector<std::uint32_t> mIndices;
+
+        GLuint mLightBuffer = 0, mClusterBuffer = 0, mIndexBuffer = 0;
+        std::size_t mLightBytes = 0, mClusterBytes = 0, mIndexBytes = 0;
+};
+
+#endif // LIGHT_CLUSTERS_HPP_A1C1D47B_2E15_4A36_9A79_EF8E48C5DA3B
@@ -2,13 +2,59 @@
 
 #include <rapidobj/rapidobj.hpp>
 #include <iostream>
+#include <filesystem>
+#include <system_error>
+
+#include <cstdio>
 
 #include "../support/error.hpp"
+#include "../support/job_system.hpp"
 #include "../vmlib/mat33.hpp"
 #include "../vmlib/vec2.hpp"
 
+#include "mesh_codec.hpp"
+#include "mesh_cleanup.hpp"
+#include "mesh_winding.hpp"
 
-SimpleMeshData load_wavefront_obj(char const* aPath, bool isTextureSupplied, Mat44f aPreTransform)
+namespace
+{
+    constexpr std::size_t kVerticesPerJob_ = 16 * 1024;
+
+    void apply_pre_transform_(SimpleMeshData& aMesh, Mat44f const& aPreTransform)
+    {
+        // Calculate normal transformation matrix
+        Mat33f const N = mat44_to_mat33(transpose(invert(aPreTransform)));
+
+        // Transform positions by aPreTransform. Vertices are independent;
+        // large meshes are transformed on all cores.
+        JobSystem& jobs = job_system();
+        jobs.parallel_for(0, aMesh.positions.size(), kVerticesPerJob_, [&](std::size_t aBegin, std::size_t aEnd) {
+            for (std::size_t i = aBegin; i < aEnd; ++i)
+            {
+                Vec3f& p = aMesh.positions[i];
+
+                Vec4f p4{ p.x, p.y, p.z, 1.f };
+                Vec4f t = aPreTransform * p4;
+                t /= t.w;
+
+                p = Vec3f{ t.x, t.y, t.z };
+            }
+        });
+
+        jobs.parallel_for(0, aMesh.normals.size(), kVerticesPerJob_, [&](std::size_t aBegin, std::size_t aEnd) {
+            for (std::size_t i = aBegin; i < aEnd; ++i)
+            {
+                // Transform the normal using N (inverse transpose of the transformation matrix)
+                Vec3f transformedNormal = N * aMesh.normals[i];
+
+                // Normalize the transformed normal and assign it back
+                aMesh.normals[i] = normalize(transformedNormal);
+            }
+        });
+    }
+}
+
+SimpleMeshData parse_wavefront_obj(char const* aPath, bool isTextureSupplied)
 {
     // Load the OBJ file
     auto result = rapidobj::ParseFile(aPath);
@@ -26,9 +72,6 @@ SimpleMeshData load_wavefront_obj(char const* aPath, bool isTextureSupplied, Mat
     float minZ = std::numeric_limits<float>::max();
     float maxZ = std::numeric_limits<float>::lowest();
 
-    // Calculate normal transformation matrix
-    Mat33f const N = mat44_to_mat33(transpose(invert(aPreTransform)));
-
     // Iterate through the shapes and load the necessary data
     for (auto const& shape : result.shapes)
     {
@@ -125,28 +168,83 @@ SimpleMeshData load_wavefront_obj(char const* aPath, bool isTextureSupplied, Mat
 
     ret.isTextureSupplied = isTextureSupplied;
 
-    // Transform positions by aPreTransform
-    for (auto& p : ret.positions)
+    return ret;
+}
+
+SimpleMeshData load_wavefront_obj(char const* aPath, bool isTextureSupplied, Mat44f aPreTransform)
+{
+    SimpleMeshData ret = parse_wavefront_obj(aPath, isTextureSupplied);
+
+    apply_pre_transform_(ret, aPreTransform);
+
+    // Make winding consistent with the normals, so that back-face culling works
+    auto const winding = fix_winding(ret);
+    if (winding.inconsistent)
+        std::cout << "Flipped " << winding.inconsistent << " of " << winding.triangles << " triangles in " << aPath << std::endl;
+
+    return ret;
+}
+
+SimpleMeshData load_wavefront_obj_cached(char const* aPath, bool isTextureSupplied, Mat44f aPreTransform)
+{
+    namespace fs = std::filesystem;
+
+    fs::path const objPath(aPath);
+    fs::path cachePath = objPath;
+    cachePath += ".cmesh";
+
+    // The binary copy is stored without the pre-transform, so that the same
+    // file serves every placement of the asset.
+    std::error_code ec;
+    bool upToDate = fs::exists(cachePath, ec)
+        && fs::last_write_time(cachePath, ec) >= fs::last_write_time(objPath, ec)
+        && !ec;
+
+    SimpleMeshData ret;
+    MeshStats stats;
+    if (upToDate)
     {
-        Vec4f p4{ p.x, p.y, p.z, 1.f };
-        Vec4f t = aPreTransform * p4;
-        t /= t.w;
+        try
+        {
+            ret = load_mesh_binary(cachePath.string().c_str());
 
-        p = Vec3f{ t.x, t.y, t.z };
+            // Quantization may collapse slivers into degenerate triangles
+            stats = clean_mesh(ret);
+        }
+        catch (std::exception const& eErr)
+        {
+            // Truncated, corrupt or from another version: it is only a
+            // cache, so drop it and rebuild it from the OBJ.
+            std::fprintf(stderr, "Warning: discarding mesh cache '%s': %s\n", cachePath.string().c_str(), eErr.what());
+            fs::remove(cachePath, ec);
+            upToDate = false;
+        }
     }
 
-    for (auto& n : ret.normals)
+    if (!upToDate)
     {
-        // Transform the normal using N (inverse transpose of the transformation matrix)
-        Vec3f transformedNormal = N * n;
-
-        // Normalize the transformed normal
-        transformedNormal = normalize(transformedNormal);
+        ret = load_wavefront_obj(aPath, isTextureSupplied);
+        stats = clean_mesh(ret);
 
-        // Assign the normalized normal back
-        n = transformedNormal;
+        try
+        {
+            save_mesh_binary(cachePath.string().c_str(), ret);
+        }
+        catch (std::exception const& eErr)
+        {
+            // Not fatal; we just pay for the OBJ parse again next time.
+            std::fprintf(stderr, "Warning: could not write mesh cache: %s\n", eErr.what());
+        }
     }
 
+    print_mesh_stats(aPath, stats);
+
+    ret.isTextureSupplied = isTextureSupplied;
+    apply_pre_transform_(ret, aPreTransform);
+
+    // The binary copy is consistent already, but a mirroring pre-transform flips it
+    fix_winding(ret);
+
     return ret;
 }
 
@@ -4,6 +4,15 @@
 #include "simple_mesh.hpp"
 #include "../vmlib/mat44.hpp"
 
+// Parses the OBJ file as is: no pre-transform, and triangles keep the winding
+// from the file. load_wavefront_obj() applies both.
+SimpleMeshData parse_wavefront_obj(char const* aPath, bool isTextureSupplied = false);
+
 SimpleMeshData load_wavefront_obj(char const* aPath, bool isTextureSupplied = false, Mat44f aPreTransform = kIdentity44f);
 
+// As load_wavefront_obj(), but goes through a compact binary copy of the mesh
+// ("<aPath>.cmesh", see mesh_codec.hpp). The binary copy is (re-)created from
+// the OBJ when it is missing, older than the OBJ file, or unreadable.
+SimpleMeshData load_wavefront_obj_cached(char const* aPath, bool isTextureSupplied = false, Mat44f aPreTransform = kIdentity44f);
+
 #endif // LOADOBJ_HPP_2CF735BE_6624_413E_B6DC_B5BBA337F96F
@@ -15,6 +15,11 @@
 #include <iostream>
 #include <chrono>       
 #include <format>
+#include <optional>
+#include <thread>
+#include <random>
+#include <exception>
+#include <functional>
 
 #include "../support/error.hpp"
 #include "../support/program.hpp"
@@ -29,6 +34,24 @@
 #include "loadobj.hpp"
 #include "texture.hpp"
 #include "spaceship.hpp"
+#include "mesh_cache.hpp"
+#include "geometry_arena.hpp"
+#include "render_queue.hpp"
+#include "persistent_ring.hpp"
+#include "frame_uniforms.hpp"
+#include "indirect_batch.hpp"
+#include "instance_manager.hpp"
+#include "frustum_cull.hpp"
+#include "occlusion.hpp"
+#include "multi_view.hpp"
+#include "gl_state.hpp"
+#include "light_clusters.hpp"
+#include "shader_reloader.hpp"
+#include "dynamic_resolution.hpp"
+#include "fixed_timestep.hpp"
+#include "triple_buffer.hpp"
+#include "run_options.hpp"
+#include "input_log.hpp"
 #include "particle.hpp"
 #include "render_text.hpp"
 #include "button.hpp"
@@ -51,9 +74,12 @@ const std::string LANGERSO_TEXTURE_ASSET_PATH = DIR_PATH + "/assets/cw2/L3211E-4
 const std::string LAUNCHPAD_OBJ_ASSET_PATH = DIR_PATH + "/assets/cw2/landingpad.obj";
 const std::string PARTICLE_TEXTURE_ASSET_PATH = DIR_PATH + "/assets/cw2/explosion.png";
 const std::string DSMD_FONT_ASSET_PATH = DIR_PATH + "/assets/cw2/DroidSansMonoDotted.ttf";
+const std::string SHADER_CACHE_PATH = DIR_PATH + "/shader-cache";
 
 
-static constexpr int MAX_POINT_LIGHTS = 3;
+// Point lights: the rocket's lights come first (see updateRocketLights())
+static constexpr std::size_t ROCKET_POINT_LIGHTS = 4;
+static constexpr std::size_t TERRAIN_BEACONS = 256;
 static constexpr Vec3f rocketStartPos = { 0.0f, 0.0f, 0.0f };
 
 namespace
@@ -66,6 +92,10 @@ namespace
 
     constexpr float rocketAcceleration_ = 0.1f;
 
+    // Places the (shared) rocket mesh on its launchpad; the rocket's flight
+    // (model2worldRocket) is applied on top
+    Mat44f const kRocketPlacement_ = make_translation({ 2.f, 0.15f, -2.f }) * make_scaling(0.05f, 0.05f, 0.05f);
+
     using Clock = std::chrono::high_resolution_clock;
     using Secondsf = std::chrono::duration<float>;
 
@@ -77,23 +107,68 @@ namespace
     };
 
     // --------------- Program State ---------------
+    // Settings that rendering reads. The main thread changes them; the render
+    // thread sees them as part of each snapshot (see RenderSnapshot_).
+    struct RenderSettings_
+    {
+        ViewLayout viewLayout = ViewLayout::single;
+        bool occlusionCulling = true;
+
+        // Draw all views in one pass (if the driver supports it, see
+        // multi_view.hpp) rather than one pass per view
+        bool singlePassMultiView = true;
+
+        // Lay down depth first, so that the scene pass shades each pixel
+        // once (see renderDepthPrepass())
+        bool depthPrepass = false;
+
+        // Scene shader variants
+        bool pointLights = true;
+        bool fog = false;
+
+        // Render the scene at a fraction of the framebuffer resolution, as
+        // the GPU time allows (see dynamic_resolution.hpp)
+        bool dynamicResolution = true;
+
+        // Swap interval 1; otherwise rendering is uncapped (the simulation
+        // runs at a fixed rate either way, see fixed_timestep.hpp)
+        bool vsync = true;
+
+        CameraMode cameraMode1 = CameraMode::FREE;
+        CameraMode cameraMode2 = CameraMode::CHASE;
+
+        float chaseDistance = 1.0f;
+        Vec3f groundCameraPos = { -5.f, 1.0f, 0.f };
+    };
+
     struct State_
     {
+        // -------------- Render thread --------------
+        // Set up before the render thread starts; only it uses them after.
+
         // Font loading and rendering
         FONScontext* fsContext = nullptr;
 
-        // Shaders
-        ShaderProgram* prog = nullptr;
+        // Shaders; the scene shader is compiled per variant (see
+        // sceneDefines())
+        ShaderPermutations* sceneShaders = nullptr;
+        ShaderProgram* depthShader = nullptr;
         ShaderProgram* particleShader = nullptr;
         ShaderProgram* textShader = nullptr;
         ShaderProgram* buttonShader = nullptr;
 
+        // Recompiles changed shaders in the background
+        ShaderReloader* shaderReloader = nullptr;
+
         std::vector<Button> buttons;
 
-        bool isSplitScreen = false;
+        bool hasVertexViewportIndex = false;
+        float resolutionScale = 1.f;
 
-        CameraMode cameraMode1 = CameraMode::FREE;
-        CameraMode cameraMode2 = CameraMode::CHASE;
+        // -------------- Main thread --------------
+        // Input and simulation
+
+        RenderSettings_ settings;
 
         bool keyPressC = false;
         bool keyPressShiftC = false;
@@ -102,6 +177,28 @@ namespace
 
         bool cameraMovement = false;
 
+        // Mouse picking; the cursor position is normalized to [0,1].
+        // Requests are counted, so that the render thread notices each
+        // change even if it skips snapshots.
+        std::uint32_t pickRequests = 0;
+        float pickX = 0.f, pickY = 0.f;
+
+        // Shader reloads ('R'), counted likewise
+        std::uint32_t reloadRequests = 0;
+
+        // Mouse, as of the last input event (window coordinates). Buttons
+        // and picking use these instead of polling GLFW, so that replayed
+        // input behaves like the recorded one.
+        float cursorX = 0.f, cursorY = 0.f;
+        bool mouseLeftDown = false;
+        int windowWidth = 0, windowHeight = 0;
+
+        // Input recording and replay (see input_log.hpp). Events are keyed
+        // by the number of simulation steps that ran before them.
+        std::uint64_t simulationStep = 0;
+        InputLog* recording = nullptr;  // Not recording if null
+        bool replaying = false;         // The user's input is ignored
+
         struct CamCtrl_
         {
             float FAST_SPEED_MULT = 2.f;
@@ -136,20 +233,6 @@ namespace
         CamCtrl_ cam1;  // First camera controls
         CamCtrl_ cam2;  // Second camera controls
 
-        // -------------- Point Lights --------------
-        struct PointLight {
-            Vec3f position;
-            float padding1;
-            Vec3f color;
-            float padding2;
-            Vec3f normals;
-            float radius;
-        };
-
-        struct PointLightBlock {
-            PointLight lights[MAX_POINT_LIGHTS];
-        };
-
         // -------------- Rocket State --------------
         struct rcktCtrl_ {
             Vec3f position = rocketStartPos;
@@ -182,9 +265,94 @@ namespace
                 particles.clear();
             }
         } rcktCtrl;
+    };
 
-        float chaseDistance = 1.0f;
-        Vec3f groundCameraPos = { -5.f, 1.0f, 0.f };
+    // Simulated state that rendering interpolates between steps
+    struct SimPose_
+    {
+        Vec4f cam1Position;
+        Vec4f cam2Position;
+        Vec3f rocketPosition;
+        Mat44f rocketModel;
+    };
+
+    // Everything that rendering needs from one simulated frame; part of
+    // each snapshot, so that rendering never reads the simulation state in
+    // State_.
+    struct SimFrame_
+    {
+        SimPose_ pose;                  // Interpolated
+        State_::CamCtrl_ cam1, cam2;    // At the interpolated positions
+
+        // The last two steps, and pose's position between them. A snapshot
+        // that is drawn again later continues from there (see posedAt()).
+        SimPose_ previous, current;
+        float alpha = 0.f;
+        float step = 0.f;               // Seconds per step
+
+        std::vector<Particle> particles;
+        bool rocketMoving = false;
+        std::size_t steps = 0;
+    };
+
+    // One frame's input to the render thread, published by the main thread
+    // (see TripleBuffer). Immutable once published.
+    struct RenderSnapshot_
+    {
+        SimFrame_ sim;
+        RenderSettings_ settings;
+
+        // Framebuffer size and window position
+        int width = 0, height = 0;
+        int windowX = 0, windowY = 0;
+
+        Button::State launchButton = Button::State::NEUTRAL;
+        Button::State resetButton = Button::State::NEUTRAL;
+
+        // Requests, by count (see State_)
+        std::uint32_t pickRequests = 0;
+        float pickX = 0.f, pickY = 0.f;
+        std::uint32_t reloadRequests = 0;
+
+        // Metrics of the main thread
+        bool keyPressC = false;
+        bool keyPressShiftC = false;
+        bool keyPressV = false;
+        bool keyPressF = false;
+        bool cameraMovement = false;
+        double simulationMs = 0.0;
+        Clock::time_point published;
+
+        // Nothing is published until the next snapshot (minimized window);
+        // the render thread waits rather than drawing this one
+        bool paused = false;
+
+        // The last snapshot: the render thread exits
+        bool quit = false;
+    };
+
+    // Stops the render thread: publishes a last snapshot, joins, and makes
+    // the GL context current on this thread again (for cleanup). Also when
+    // main() exits by an exception, as a std::thread must be joined.
+    struct RenderThreadJoiner_
+    {
+        ~RenderThreadJoiner_() { join(); }
+
+        void join()
+        {
+            if (!thread.joinable())
+                return;
+
+            snapshots.back().quit = true;
+            snapshots.publish();
+            thread.join();
+
+            glfwMakeContextCurrent(window);
+        }
+
+        TripleBuffer<RenderSnapshot_>& snapshots;
+        std::thread& thread;
+        GLFWwindow* window;
     };
 
     // ------------------ Function Declarations ------------------
@@ -193,28 +361,84 @@ namespace
     void glfw_callback_motion_(GLFWwindow*, double, double);
     void mouse_button_callback(GLFWwindow*, int, int, int);
 
+    // Records a user input event (unless replaying) and applies it
+    void recordInput(GLFWwindow* window, State_& state, InputEvent event);
+
+    // Applies a user or replayed input event to the state
+    void applyInput(GLFWwindow* window, State_& state, const InputEvent& event);
+    void applyKey(State_& state, int key, int action, int mods);
+    void applyCursor(State_& state, float x, float y);
+    void applyMouseButton(GLFWwindow* window, State_& state, int button, int action);
+
     void updateCamera(State_::CamCtrl_& camera, float dt);
     void updateRocket(State_::rcktCtrl_& rocket, float dt);
 
-    Mat44f compute_view_matrix_for_camera(const State_::CamCtrl_& camCtrl,
-        CameraMode mode,
-        const State_& state);
+    // One fixed step of the simulation: cameras, rocket and particles
+    void simulateStep(State_& state, float dt);
 
-    GLuint setPointLights(State_::PointLight pointLights[MAX_POINT_LIGHTS], SimpleMeshData rocketPos);
+    // Advances the simulation by a frame's wall time and captures the
+    // result. beforeStep() runs before each step, for input that must
+    // happen at a given step (replays, buttons).
+    void simulateFrame(State_& state, FixedTimestep& clock, SimPose_& previousPose, float dt,
+        const std::function<void()>& beforeStep, SimFrame_& out);
 
-    void updatePointLights(Mat44f rocketPosition, SimpleMeshData rocketData, State_::PointLight pointLights[MAX_POINT_LIGHTS]);
+    SimPose_ capturePose(const State_& state);
+    SimPose_ interpolatePose(const SimPose_& from, const SimPose_& to, float t);
 
-    void updatePointLightUBO(GLuint pointLightUBO,
-        State_::PointLight pointLights[MAX_POINT_LIGHTS]);
+    // The frame's pose and cameras at time `when`, interpolated by the wall
+    // time since the frame was published, up to its last step. Particles
+    // are not copied.
+    SimFrame_ posedAt(const SimFrame_& sim, Clock::time_point published, Clock::time_point when);
 
-    // This function: draws the entire scene for one camera's view+proj
+    // rocketPos: the rocket's (interpolated) position
+    Mat44f compute_view_matrix_for_camera(const State_::CamCtrl_& camCtrl,
+        CameraMode mode,
+        const RenderSettings_& settings,
+        const Vec3f& rocketPos);
+
+    // Builds the scene's point lights: the rocket's (updated every frame by
+    // updateRocketLights()), lights around the launchpads and beacons
+    // spread over the terrain
+    std::vector<PointLight> makeSceneLights(const SimpleMeshData& terrain, const Aabb* padBounds, std::size_t padCount);
+
+    void updateRocketLights(const Mat44f& rocketModel, bool engineOn, const SimpleMeshData& rocketData, std::vector<PointLight>& lights);
+
+    // Writes the camera block of a pass over frame views firstView ..
+    // firstView+viewCount-1
+    PersistentRing::Allocation writeCameraBlock(PersistentRing& frameRing,
+        const Mat44f* views,
+        std::size_t viewCount,
+        std::size_t firstView,
+        const Mat44f& projection);
+
+    // Preprocessor definitions of the scene shader variant (see
+    // default.frag) for the current settings
+    ShaderDefines sceneDefines(const RenderSettings_& settings, bool textured);
+
+    // Depth-only pass over the opaque objects, using the position-only
+    // vertex stream. The pass's viewports, camera block and view count must
+    // be set up by the caller, as for renderScene().
+    void renderDepthPrepass(State_& state,
+        std::size_t viewCount,
+        std::size_t firstView,
+        GeometryArena& arena,
+        const InstanceManager& instances,
+        IndirectBatch& staticBatch,
+        const std::vector<std::uint8_t>& visible);
+
+    // This function: draws the entire scene into viewCount viewports at once,
+    // for frame views firstView .. firstView+viewCount-1
     void renderScene(State_& state,
-        const Mat44f& view,
-        const Mat44f& projection,
-        // Below are references to the various VAOs & meshes:
-        GLuint langersoVao, const SimpleMeshData& langersoMesh, GLuint langersoTextureId, size_t langersoCount,
-        GLuint rocketVao, const SimpleMeshData& rocketMesh, size_t rocketCount,
-        GLuint launchpadVao, const SimpleMeshData& launchpadMesh, size_t launchpadCount,
+        const RenderSnapshot_& frame,
+        const Mat44f* views,
+        std::size_t viewCount,
+        std::size_t firstView,
+        RenderQueue& queue,
+        GeometryArena& arena,
+        const InstanceManager& instances,
+        IndirectBatch& staticBatch,
+        const std::vector<std::uint8_t>& visible,
+        std::uint32_t particleMask,
         GLuint particleTextureId);
 
     // RAII-like helpers
@@ -233,157 +457,251 @@ namespace
         std::fprintf(stderr, "GLFW error: %s (%d)\n", aErrDesc, aErrNum);
     }
 
-    void glfw_callback_key_(GLFWwindow* aWindow, int aKey, int, int aAction, int mods)
+    void glfw_callback_key_(GLFWwindow* aWindow, int aKey, int aScancode, int aAction, int mods)
     {
+        // Also while replaying
         if (GLFW_KEY_ESCAPE == aKey && GLFW_PRESS == aAction) {
             glfwSetWindowShouldClose(aWindow, GLFW_TRUE);
             return;
         }
 
         if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow))) {
-            // Press V to toggle split screen:
-            if (aKey == GLFW_KEY_V && aAction == GLFW_PRESS) {
-                state->isSplitScreen = !state->isSplitScreen;
+            InputEvent event;
+            event.type = InputEventType::key;
+            event.code = aKey;
+            event.scancode = aScancode;
+            event.action = aAction;
+            event.mods = mods;
+            recordInput(aWindow, *state, event);
+        }
+    }
+
+    void glfw_callback_motion_(GLFWwindow* aWindow, double aX, double aY)
+    {
+        if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow))) {
+            InputEvent event;
+            event.type = InputEventType::cursor;
+            event.x = float(aX);
+            event.y = float(aY);
+            recordInput(aWindow, *state, event);
+        }
+    }
+
+    void mouse_button_callback(GLFWwindow* aWindow, int button, int action, int mods)
+    {
+        if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow))) {
+            InputEvent event;
+            event.type = InputEventType::mouseButton;
+            event.code = button;
+            event.action = action;
+            event.mods = mods;
+            recordInput(aWindow, *state, event);
+        }
+    }
+
+    void recordInput(GLFWwindow* window, State_& state, InputEvent event)
+    {
+        if (state.replaying)
+            return;
+
+        // The event happens before the next step, in recording and replay
+        // alike; the cursor position is recorded (and applied) as floats
+        event.step = state.simulationStep;
+        if (state.recording)
+            state.recording->events.push_back(event);
+
+        applyInput(window, state, event);
+    }
+
+    void applyInput(GLFWwindow* window, State_& state, const InputEvent& event)
+    {
+        switch (event.type) {
+        case InputEventType::key:
+            applyKey(state, event.code, event.action, event.mods);
+            break;
+        case InputEventType::cursor:
+            applyCursor(state, event.x, event.y);
+            break;
+        case InputEventType::mouseButton:
+            applyMouseButton(window, state, event.code, event.action);
+            break;
+        case InputEventType::end:
+            // The recording ends here
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+            break;
+        }
+    }
+
+    void applyKey(State_& state, int key, int action, int mods)
+    {
+        // Press V to cycle the view layout (single, split screen, quad):
+        if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+            state.settings.viewLayout = next_layout(state.settings.viewLayout);
 #ifdef ENABLE_PERFORMANCE_METRICS
-                state->keyPressV = true;
+            state.keyPressV = true;
 #endif
-            }
+        }
 
-            // Press C to cycle camera 1's mode:
-            if (aKey == GLFW_KEY_C && (mods & GLFW_MOD_SHIFT) == 0 && aAction == GLFW_PRESS) {
-                switch (state->cameraMode1) {
-                case CameraMode::FREE:   state->cameraMode1 = CameraMode::CHASE;   break;
-                case CameraMode::CHASE:  state->cameraMode1 = CameraMode::GROUND; break;
-                case CameraMode::GROUND: state->cameraMode1 = CameraMode::FREE;   break;
-                }
+        // Press C to cycle camera 1's mode:
+        if (key == GLFW_KEY_C && (mods & GLFW_MOD_SHIFT) == 0 && action == GLFW_PRESS) {
+            switch (state.settings.cameraMode1) {
+            case CameraMode::FREE:   state.settings.cameraMode1 = CameraMode::CHASE;   break;
+            case CameraMode::CHASE:  state.settings.cameraMode1 = CameraMode::GROUND; break;
+            case CameraMode::GROUND: state.settings.cameraMode1 = CameraMode::FREE;   break;
+            }
 #ifdef ENABLE_PERFORMANCE_METRICS
-                state->keyPressC = true;
+            state.keyPressC = true;
 #endif
-            }
+        }
 
-            // Press Shift + C to cycle camera 2's mode:
-            if (aKey == GLFW_KEY_C && (mods & GLFW_MOD_SHIFT) && aAction == GLFW_PRESS) {
-                switch (state->cameraMode2) {
-                case CameraMode::CHASE:  state->cameraMode2 = CameraMode::GROUND; break;
-                case CameraMode::GROUND: state->cameraMode2 = CameraMode::CHASE;   break;
-                }
+        // Press Shift + C to cycle camera 2's mode:
+        if (key == GLFW_KEY_C && (mods & GLFW_MOD_SHIFT) && action == GLFW_PRESS) {
+            switch (state.settings.cameraMode2) {
+            case CameraMode::CHASE:  state.settings.cameraMode2 = CameraMode::GROUND; break;
+            case CameraMode::GROUND: state.settings.cameraMode2 = CameraMode::CHASE;   break;
+            }
 #ifdef ENABLE_PERFORMANCE_METRICS
-                state->keyPressShiftC = true;
+            state.keyPressShiftC = true;
 #endif
-            }
+        }
 
-            // Start rocket animation with 'F'
-            if (GLFW_KEY_F == aKey && GLFW_PRESS == aAction) {
-                state->rcktCtrl.isMoving = !state->rcktCtrl.isMoving;
+        // Start rocket animation with 'F'
+        if (GLFW_KEY_F == key && GLFW_PRESS == action) {
+            state.rcktCtrl.isMoving = !state.rcktCtrl.isMoving;
 #ifdef ENABLE_PERFORMANCE_METRICS
-                state->keyPressF = true;
+            state.keyPressF = true;
 #endif
-            }
-            // R-key reloads shaders.
-            if (GLFW_KEY_R == aKey && GLFW_PRESS == aAction) {
-                if (state->prog) {
-                    state->rcktCtrl.reset();
-                    try {
-                        state->prog->reload();
-                        std::fprintf(stderr, "Shaders reloaded and recompiled.\n");
-                    }
-                    catch (std::exception const& eErr) {
-                        std::fprintf(stderr, "Error when reloading shader:\n");
-                        std::fprintf(stderr, "%s\n", eErr.what());
-                        std::fprintf(stderr, "Keeping old shader.\n");
-                    }
-                }
-            }
+        }
+        // Toggle software occlusion culling with 'O'
+        if (GLFW_KEY_O == key && GLFW_PRESS == action) {
+            state.settings.occlusionCulling = !state.settings.occlusionCulling;
+        }
+        // Toggle single-pass multi-view rendering with 'M'
+        if (GLFW_KEY_M == key && GLFW_PRESS == action) {
+            state.settings.singlePassMultiView = !state.settings.singlePassMultiView;
+        }
+        // Toggle the depth pre-pass with 'Z'
+        if (GLFW_KEY_Z == key && GLFW_PRESS == action) {
+            state.settings.depthPrepass = !state.settings.depthPrepass;
+        }
+        // Toggle vsync with 'U' (uncapped frame rate when off)
+        if (GLFW_KEY_U == key && GLFW_PRESS == action) {
+            state.settings.vsync = !state.settings.vsync;
+        }
+        // Toggle dynamic resolution with 'T'
+        if (GLFW_KEY_T == key && GLFW_PRESS == action) {
+            state.settings.dynamicResolution = !state.settings.dynamicResolution;
+        }
+        // Toggle point lights with 'L' and fog with 'G' (shader variants)
+        if (GLFW_KEY_L == key && GLFW_PRESS == action) {
+            state.settings.pointLights = !state.settings.pointLights;
+        }
+        if (GLFW_KEY_G == key && GLFW_PRESS == action) {
+            state.settings.fog = !state.settings.fog;
+        }
+        // R-key reloads shaders (in the background; changed files are
+        // reloaded automatically)
+        if (GLFW_KEY_R == key && GLFW_PRESS == action) {
+            ++state.reloadRequests;
+        }
 
-            // Handle WASD keys for cam1:
-            if (GLFW_KEY_W == aKey) {
-                state->cam1.movingForward = (aAction != GLFW_RELEASE);
-            }
-            if (GLFW_KEY_S == aKey) {
-                state->cam1.movingBack = (aAction != GLFW_RELEASE);
-            }
-            if (GLFW_KEY_A == aKey) {
-                state->cam1.movingLeft = (aAction != GLFW_RELEASE);
-            }
-            if (GLFW_KEY_D == aKey) {
-                state->cam1.movingRight = (aAction != GLFW_RELEASE);
-            }
-            if (GLFW_KEY_E == aKey) {
-                state->cam1.movingUp = (aAction != GLFW_RELEASE);
+        // Handle WASD keys for cam1:
+        if (GLFW_KEY_W == key) {
+            state.cam1.movingForward = (action != GLFW_RELEASE);
+        }
+        if (GLFW_KEY_S == key) {
+            state.cam1.movingBack = (action != GLFW_RELEASE);
+        }
+        if (GLFW_KEY_A == key) {
+            state.cam1.movingLeft = (action != GLFW_RELEASE);
+        }
+        if (GLFW_KEY_D == key) {
+            state.cam1.movingRight = (action != GLFW_RELEASE);
+        }
+        if (GLFW_KEY_E == key) {
+            state.cam1.movingUp = (action != GLFW_RELEASE);
+        }
+        if (GLFW_KEY_Q == key) {
+            state.cam1.movingDown = (action != GLFW_RELEASE);
+        }
+
+        // SHIFT speeds up camera, CONTROL slows it down
+        if (key == GLFW_KEY_LEFT_SHIFT || key == GLFW_KEY_RIGHT_SHIFT) {
+            if (action == GLFW_PRESS) {
+                state.cam1.speed_multiplier = state.cam1.FAST_SPEED_MULT;
             }
-            if (GLFW_KEY_Q == aKey) {
-                state->cam1.movingDown = (aAction != GLFW_RELEASE);
+            else if (action == GLFW_RELEASE) {
+                state.cam1.speed_multiplier = state.cam1.NORMAL_SPEED_MULT;
             }
+        }
 
-            // SHIFT speeds up camera, CONTROL slows it down
-            if (aKey == GLFW_KEY_LEFT_SHIFT || aKey == GLFW_KEY_RIGHT_SHIFT) {
-                if (aAction == GLFW_PRESS) {
-                    state->cam1.speed_multiplier = state->cam1.FAST_SPEED_MULT;
-                }
-                else if (aAction == GLFW_RELEASE) {
-                    state->cam1.speed_multiplier = state->cam1.NORMAL_SPEED_MULT;
-                }
+        if (key == GLFW_KEY_LEFT_CONTROL || key == GLFW_KEY_RIGHT_CONTROL) {
+            if (action == GLFW_PRESS) {
+                state.cam1.speed_multiplier = state.cam1.SLOW_SPEED_MULT;
             }
-
-            if (aKey == GLFW_KEY_LEFT_CONTROL || aKey == GLFW_KEY_RIGHT_CONTROL) {
-                if (aAction == GLFW_PRESS) {
-                    state->cam1.speed_multiplier = state->cam1.SLOW_SPEED_MULT;
-                }
-                else if (aAction == GLFW_RELEASE) {
-                    state->cam1.speed_multiplier = state->cam1.NORMAL_SPEED_MULT;
-                }
+            else if (action == GLFW_RELEASE) {
+                state.cam1.speed_multiplier = state.cam1.NORMAL_SPEED_MULT;
             }
         }
     }
 
-    void glfw_callback_motion_(GLFWwindow* aWindow, double aX, double aY)
+    void applyCursor(State_& state, float x, float y)
     {
-        if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow)))
-        {
-            // Only rotate camera1 if it's active
-            if (state->cam1.cameraActive)
-            {
-                float dx = float(aX - state->cam1.lastX);
-                float dy = float(aY - state->cam1.lastY);
+        state.cursorX = x;
+        state.cursorY = y;
 
-                state->cam1.phi += dx * kMouseSensitivity_;
-                state->cam1.theta += dy * kMouseSensitivity_;
+        // Only rotate camera1 if it's active
+        if (state.cam1.cameraActive)
+        {
+            float dx = x - state.cam1.lastX;
+            float dy = y - state.cam1.lastY;
 
-                // Limit pitch to +/- 90°
-                if (state->cam1.theta > std::numbers::pi_v<float> / 2.f)
-                    state->cam1.theta = state->cam1.lastTheta;
-                else if (state->cam1.theta < -std::numbers::pi_v<float> / 2.f)
-                    state->cam1.theta = state->cam1.lastTheta;
-            }
+            state.cam1.phi += dx * kMouseSensitivity_;
+            state.cam1.theta += dy * kMouseSensitivity_;
 
-            state->cam1.lastX = float(aX);
-            state->cam1.lastY = float(aY);
-            state->cam1.lastTheta = state->cam1.theta;
+            // Limit pitch to +/- 90°
+            if (state.cam1.theta > std::numbers::pi_v<float> / 2.f)
+                state.cam1.theta = state.cam1.lastTheta;
+            else if (state.cam1.theta < -std::numbers::pi_v<float> / 2.f)
+                state.cam1.theta = state.cam1.lastTheta;
         }
+
+        state.cam1.lastX = x;
+        state.cam1.lastY = y;
+        state.cam1.lastTheta = state.cam1.theta;
     }
 
-    void mouse_button_callback(GLFWwindow* aWindow, int button, int action, int /*mods*/)
+    void applyMouseButton(GLFWwindow* window, State_& state, int button, int action)
     {
-        if (auto* state = static_cast<State_*>(glfwGetWindowUserPointer(aWindow)))
+        if (button == GLFW_MOUSE_BUTTON_LEFT)
+            state.mouseLeftDown = (action != GLFW_RELEASE);
+
+        if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
         {
-            if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
-            {
-                // Toggle camera1's "active" state
-                state->cam1.cameraActive = !state->cam1.cameraActive;
+            // Toggle camera1's "active" state
+            state.cam1.cameraActive = !state.cam1.cameraActive;
 
-                if (state->cam1.cameraActive) {
-                    // Hide and lock cursor to window center
-                    glfwSetInputMode(aWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-                }
-                else {
-                    // Normal cursor
-                    glfwSetInputMode(aWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
-                }
+            if (state.cam1.cameraActive) {
+                // Hide and lock cursor to window center
+                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+            }
+            else {
+                // Normal cursor
+                glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+            }
+        }
+        else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !state.cam1.cameraActive)
+        {
+            // Pick the object under the cursor (resolved by the render thread)
+            if (state.windowWidth > 0 && state.windowHeight > 0)
+            {
+                ++state.pickRequests;
+                state.pickX = state.cursorX / float(state.windowWidth);
+                state.pickY = state.cursorY / float(state.windowHeight);
             }
         }
     }
 
-
     // Function to update camera position based on movement
     void updateCamera(State_::CamCtrl_& camera, float dt)
     {
@@ -436,104 +754,55 @@ namespace
 
     }
 
-    GLuint setPointLights(State_::PointLight pointLights[MAX_POINT_LIGHTS], SimpleMeshData rocketPos)
+    std::vector<PointLight> makeSceneLights(const SimpleMeshData& terrain, const Aabb* padBounds, std::size_t padCount)
     {
-        // Update point light data with larger radius values
-        pointLights[0].position = rocketPos.pointLightPos[0];
-        pointLights[0].radius = 1.0f;        // Increased radius significantly
-        pointLights[0].color = Vec3f{ 1.f, 0.f, 0.f }; // Red
-        pointLights[0].normals = rocketPos.pointLightNorms[0];
-
-        pointLights[1].position = rocketPos.pointLightPos[1];
-        pointLights[1].radius = 1.0f;
-        pointLights[1].color = Vec3f{ 0.f, 1.f, 0.f }; // Green
-        pointLights[1].normals = rocketPos.pointLightNorms[1];
-
-        pointLights[2].position = rocketPos.pointLightPos[2];
-        pointLights[2].radius = 1.0f;
-        pointLights[2].color = Vec3f{ 0.f, 0.f, 1.f }; // Blue
-        pointLights[2].normals = rocketPos.pointLightNorms[2];
-
-        for (size_t i = 0; i < MAX_POINT_LIGHTS; ++i)
-        {
-            std::cout << "Point Light " << i << " Position: ("
-                << pointLights[i].position.x << ", "
-                << pointLights[i].position.y << ", "
-                << pointLights[i].position.z << ")\n";
-        }
+        std::vector<PointLight> lights(ROCKET_POINT_LIGHTS);
 
-        // Create and setup UBO
-        GLuint pointLightUBO;
-        glGenBuffers(1, &pointLightUBO);
-        glBindBuffer(GL_UNIFORM_BUFFER, pointLightUBO);
-
-        // Allocate and initialize buffer in one step
-        State_::PointLightBlock pointLightData;
-        for (int i = 0; i < MAX_POINT_LIGHTS; ++i) {
-            pointLightData.lights[i] = pointLights[i];
+        // Eight amber lights around the rim of each launchpad
+        for (std::size_t p = 0; p < padCount; ++p)
+        {
+            Vec3f const c = center(padBounds[p]);
+            Vec3f const e = half_extent(padBounds[p]);
+            for (int i = 0; i < 8; ++i)
+            {
+                float const angle = float(i) * std::numbers::pi_v<float> / 4.f;
+                Vec3f const position{ c.x + e.x * std::cos(angle), padBounds[p].max.y + 0.05f, c.z + e.z * std::sin(angle) };
+                lights.push_back(PointLight{ position, 1.f, Vec3f{ 1.f, 0.6f, 0.2f }, 0.3f });
+            }
         }
-        glBufferData(GL_UNIFORM_BUFFER, sizeof(State_::PointLightBlock), &pointLightData, GL_STATIC_DRAW);
-
-        // Bind to uniform buffer binding point
-        glBindBufferBase(GL_UNIFORM_BUFFER, 1, pointLightUBO);
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-        return pointLightUBO;
-    }
 
-    void updatePointLights(Mat44f rocketPosition, SimpleMeshData rocketData, State_::PointLight pointLights[MAX_POINT_LIGHTS])
-    {
-        Mat33f const N = mat44_to_mat33(transpose(invert(rocketPosition)));
-        for (int i = 0; i < MAX_POINT_LIGHTS; ++i)
+        // Beacons just above every n-th terrain vertex
+        static constexpr Vec3f beaconColors[] = { { 1.f, 0.2f, 0.2f }, { 1.f, 1.f, 1.f }, { 0.2f, 0.8f, 1.f } };
+        std::size_t const stride = std::max<std::size_t>(1, terrain.positions.size() / TERRAIN_BEACONS);
+        for (std::size_t i = 0, b = 0; i < terrain.positions.size() && b < TERRAIN_BEACONS; i += stride, ++b)
         {
-            // Transform light positions with rocket matrix
-            Vec4f transformedPos = rocketPosition * Vec4f{ rocketData.pointLightPos[i].x, rocketData.pointLightPos[i].y, rocketData.pointLightPos[i].z, 1.0f };
-            Vec3f transformedNorm = normalize(N * rocketData.pointLightNorms[i]);
-
-            pointLights[i].position = rocketData.pointLightPos[i];
-            pointLights[i].normals = transformedNorm;
-
-            //std::cout << "Before - Position: (" << rocketData.pointLightPos[i].x << ", " << rocketData.pointLightPos[i].y << ", " << rocketData.pointLightPos[i].z << ")" << ", Normal: (" << rocketData.pointLightNorms[i].x << ", " << rocketData.pointLightNorms[i].y << ", " << rocketData.pointLightNorms[i].z << ")\n"; std::cout << "After - Position: (" << transformedPos.x << ", " << transformedPos.y << ", " << transformedPos.z << ")" << ", Normal: (" << transformedNorm.x << ", " << transformedNorm.y << ", " << transformedNorm.z << ")\n";
-
-            // Maintain other properties that were set in setPointLights
-            if (i == 0) {
-                pointLights[i].color = Vec3f{ 1.f, 0.f, 0.f }; // Red
-            }
-            else if (i == 1) {
-                pointLights[i].color = Vec3f{ 0.f, 1.f, 0.f }; // Green
-            }
-            else {
-                pointLights[i].color = Vec3f{ 0.f, 0.f, 1.f }; // Blue
-            }
-            pointLights[i].radius = 1.0f;
+            Vec3f const& p = terrain.positions[i];
+            lights.push_back(PointLight{ Vec3f{ p.x, p.y + 0.1f, p.z }, 2.f, beaconColors[b % 3], 0.5f });
         }
+
+        return lights;
     }
 
-    void updatePointLightUBO(GLuint pointLightUBO, State_::PointLight pointLights[MAX_POINT_LIGHTS])
+    void updateRocketLights(const Mat44f& rocketModel, bool engineOn, const SimpleMeshData& rocketData, std::vector<PointLight>& lights)
     {
-        State_::PointLightBlock pointLightData;
-        for (int i = 0; i < MAX_POINT_LIGHTS; ++i) {
-            pointLightData.lights[i] = pointLights[i];
-        }
+        static constexpr Vec3f colors[3] = { { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } }; // Red, green, blue
 
-        // Debugging
-        /*for (size_t i = 0; i < MAX_POINT_LIGHTS; ++i)
+        // The light positions are in the rocket's model space
+        Mat44f const& model = rocketModel;
+        for (std::size_t i = 0; i < 3; ++i)
         {
-            std::cout << "Point Light " << i << " Position: ("
-                << pointLights[i].position.x << ", "
-                << pointLights[i].position.y << ", "
-                << pointLights[i].position.z << ")\n";
-        }*/
-
+            Vec4f const p = model * Vec4f{ rocketData.pointLightPos[i].x, rocketData.pointLightPos[i].y, rocketData.pointLightPos[i].z, 1.f };
+            lights[i] = PointLight{ Vec3f{ p.x, p.y, p.z }, 4.f, colors[i], 1.f };
+        }
 
-        // Update the buffer without recreating it
-        glBindBuffer(GL_UNIFORM_BUFFER, pointLightUBO);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(State_::PointLightBlock), &pointLightData);
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        // Engine glow, while the engine burns
+        Vec4f const engine = model * rocketData.engineLocation;
+        Vec3f const glow = engineOn ? Vec3f{ 1.f, 0.55f, 0.2f } : Vec3f{ 0.f, 0.f, 0.f };
+        lights[3] = PointLight{ Vec3f{ engine.x, engine.y, engine.z }, 2.f, glow, 0.5f };
     }
 
 
-    Mat44f compute_view_matrix_for_camera(const State_::CamCtrl_& camCtrl, CameraMode mode, const State_& state)
+    Mat44f compute_view_matrix_for_camera(const State_::CamCtrl_& camCtrl, CameraMode mode, const RenderSettings_& settings, const Vec3f& rocketPos)
     {
         switch (mode) {
         case CameraMode::FREE: {
@@ -547,12 +816,10 @@ namespace
         case CameraMode::CHASE:
         {
             // Chase from behind the rocket at a fixed distance
-            auto const& rocketPos = state.rcktCtrl.position;
-
             Vec3f rocketForwardWS = { 0.f, 0.f, -1.f };
 
             // Position the chase camera behind and slightly above rocket
-            Vec3f chaseCamPos = rocketPos - rocketForwardWS * state.chaseDistance + Vec3f{ 0.f, 1.f, 0.f };
+            Vec3f chaseCamPos = rocketPos - rocketForwardWS * settings.chaseDistance + Vec3f{ 0.f, 1.f, 0.f };
             Vec4f chaseCamPos4 = { chaseCamPos.x, chaseCamPos.y, chaseCamPos.z, 1.f };
 
             // Look towards rocket
@@ -568,12 +835,11 @@ namespace
         case CameraMode::GROUND:
         {
             // Always stay at groundCameraPos, look at rocket.
-            auto const& rocketPos = state.rcktCtrl.position;
             Vec4f rocketPos4 = { rocketPos.x + 1.47f , rocketPos.y, rocketPos.z - 1.20f, 1.f };
             Vec4f groundPos4 = {
-                state.groundCameraPos.x,
-                state.groundCameraPos.y,
-                state.groundCameraPos.z,
+                settings.groundCameraPos.x,
+                settings.groundCameraPos.y,
+                settings.groundCameraPos.z,
                 1.f
             };
 
@@ -680,6 +946,87 @@ namespace
         else
             rocket.particleTimer = 0.f;
     }
+
+    void simulateStep(State_& state, float dt)
+    {
+        // Update cameras
+        updateCamera(state.cam1, dt);
+        updateCamera(state.cam2, dt);
+
+        // Update rocket; particles are emitted at a fixed rate of simulated
+        // time
+        updateRocket(state.rcktCtrl, dt);
+        state.rcktCtrl.particleTimer += dt;
+
+        // Update particles
+        if (state.rcktCtrl.isMoving)
+            updateParticles(dt, state.rcktCtrl.particles);
+    }
+
+    void simulateFrame(State_& state, FixedTimestep& clock, SimPose_& previousPose, float dt,
+        const std::function<void()>& beforeStep, SimFrame_& out)
+    {
+        // Fixed steps, however long the frame took
+        out.steps = clock.advance(dt);
+        for (std::size_t i = 0; i < out.steps; ++i)
+        {
+            beforeStep();
+
+            previousPose = capturePose(state);
+            simulateStep(state, clock.step());
+            ++state.simulationStep;
+        }
+
+        // Render between the last two steps
+        out.previous = previousPose;
+        out.current = capturePose(state);
+        out.alpha = clock.alpha();
+        out.step = clock.step();
+        out.pose = interpolatePose(out.previous, out.current, out.alpha);
+
+        out.cam1 = state.cam1;
+        out.cam2 = state.cam2;
+        out.cam1.position = out.pose.cam1Position;
+        out.cam2.position = out.pose.cam2Position;
+
+        out.particles.assign(state.rcktCtrl.particles.begin(), state.rcktCtrl.particles.end());
+        out.rocketMoving = state.rcktCtrl.isMoving;
+    }
+
+    SimPose_ capturePose(const State_& state)
+    {
+        return SimPose_{
+            state.cam1.position,
+            state.cam2.position,
+            state.rcktCtrl.position,
+            state.rcktCtrl.model2worldRocket
+        };
+    }
+
+    SimPose_ interpolatePose(const SimPose_& from, const SimPose_& to, float t)
+    {
+        return SimPose_{
+            lerp(from.cam1Position, to.cam1Position, t),
+            lerp(from.cam2Position, to.cam2Position, t),
+            lerp(from.rocketPosition, to.rocketPosition, t),
+            interpolate_rigid(from.rocketModel, to.rocketModel, t)
+        };
+    }
+
+    SimFrame_ posedAt(const SimFrame_& sim, Clock::time_point published, Clock::time_point when)
+    {
+        float const elapsed = std::chrono::duration_cast<Secondsf>(when - published).count();
+        float const t = std::min(1.f, sim.alpha + std::max(0.f, elapsed) / sim.step);
+
+        SimFrame_ ret;
+        ret.pose = interpolatePose(sim.previous, sim.current, t);
+        ret.cam1 = sim.cam1;
+        ret.cam2 = sim.cam2;
+        ret.cam1.position = ret.pose.cam1Position;
+        ret.cam2.position = ret.pose.cam2Position;
+        ret.rocketMoving = sim.rocketMoving;
+        return ret;
+    }
 } // end anonymous namespace
 
 #ifdef ENABLE_PERFORMANCE_METRICS
@@ -702,10 +1049,28 @@ static GLuint g_timestampViewAEnd[MAX_FRAMES_IN_FLIGHT];
 static GLuint g_timestampViewBStart[MAX_FRAMES_IN_FLIGHT];
 static GLuint g_timestampViewBEnd[MAX_FRAMES_IN_FLIGHT];
 
+// Depth pre-pass (all views); zero length when disabled
+static GLuint g_timestampDepthPrepassStart[MAX_FRAMES_IN_FLIGHT];
+static GLuint g_timestampDepthPrepassEnd[MAX_FRAMES_IN_FLIGHT];
+
 // CPU times
 static double g_cpuRenderTimes[MAX_FRAMES_IN_FLIGHT] = {};
 static double g_cpuFrameTimes[MAX_FRAMES_IN_FLIGHT] = {};
 
+// Frustum culling results, summed over all views
+static std::size_t g_visibleObjects[MAX_FRAMES_IN_FLIGHT] = {};
+static std::size_t g_culledObjects[MAX_FRAMES_IN_FLIGHT] = {};
+static std::size_t g_occludedObjects[MAX_FRAMES_IN_FLIGHT] = {};  // Included in culled
+static std::size_t g_glCallsIssued[MAX_FRAMES_IN_FLIGHT] = {};     // State changes, see gl_state.hpp
+static std::size_t g_glCallsSkipped[MAX_FRAMES_IN_FLIGHT] = {};
+static std::size_t g_pointLights[MAX_FRAMES_IN_FLIGHT] = {};
+static std::size_t g_lightAssignments[MAX_FRAMES_IN_FLIGHT] = {};  // Light indices over all clusters and views
+static float g_resolutionScale[MAX_FRAMES_IN_FLIGHT] = {};
+static std::size_t g_simulationSteps[MAX_FRAMES_IN_FLIGHT] = {};
+static double g_simulationTimes[MAX_FRAMES_IN_FLIGHT] = {};     // On the main thread
+static double g_snapshotLatencies[MAX_FRAMES_IN_FLIGHT] = {};   // Published to drawn
+static std::uint64_t g_snapshotsSkipped[MAX_FRAMES_IN_FLIGHT] = {};  // Published, never drawn
+
 static int g_currentFrameIndex = 0;
 static int g_totalFrameCount = 0;
 
@@ -713,7 +1078,7 @@ static int g_totalFrameCount = 0;
 static std::ofstream g_csvOut;
 
 // This function retrieves queries for a given older frame and writes CSV
-static void retrieveQueries(int frameIndex, State_& state)
+static void retrieveQueries(int frameIndex, RenderSnapshot_ const& frame)
 {
     GLuint64 fs = 0, fe = 0;
     glGetQueryObjectui64v(g_timestampFrameStart[frameIndex], GL_QUERY_RESULT, &fs);
@@ -750,16 +1115,37 @@ static void retrieveQueries(int frameIndex, State_& state)
     glGetQueryObjectui64v(g_timestampViewBEnd[frameIndex], GL_QUERY_RESULT, &vbE);
     double viewBMs = double(vbE - vbS) * 1e-6;
 
+    // Depth pre-pass
+    GLuint64 dpS = 0, dpE = 0;
+    glGetQueryObjectui64v(g_timestampDepthPrepassStart[frameIndex], GL_QUERY_RESULT, &dpS);
+    glGetQueryObjectui64v(g_timestampDepthPrepassEnd[frameIndex], GL_QUERY_RESULT, &dpE);
+    double depthPrepassMs = double(dpE - dpS) * 1e-6;
+
     double cpuRenderMs = g_cpuRenderTimes[frameIndex];
     double cpuFrameMs = g_cpuFrameTimes[frameIndex];
 
+    std::size_t visibleObjects = g_visibleObjects[frameIndex];
+    std::size_t culledObjects = g_culledObjects[frameIndex];
+    std::size_t occludedObjects = g_occludedObjects[frameIndex];
+    std::size_t glCallsIssued = g_glCallsIssued[frameIndex];
+    std::size_t glCallsSkipped = g_glCallsSkipped[frameIndex];
+    std::size_t pointLights = g_pointLights[frameIndex];
+    std::size_t lightAssignments = g_lightAssignments[frameIndex];
+    float resolutionScale = g_resolutionScale[frameIndex];
+    std::size_t simulationSteps = g_simulationSteps[frameIndex];
+    double simulationMs = g_simulationTimes[frameIndex];
+    double snapshotLatencyMs = g_snapshotLatencies[frameIndex];
+    std::uint64_t snapshotsSkipped = g_snapshotsSkipped[frameIndex];
+
     // Gather user input flags
-    int keyC = (state.keyPressC ? 1 : 0);
-    int keyShiftC = (state.keyPressShiftC ? 1 : 0);
-    int keyV = (state.keyPressV ? 1 : 0);
-    int keyF = (state.keyPressF ? 1 : 0);
-    int cameraMoved = (state.cameraMovement ? 1 : 0);
-    int splitted = (state.isSplitScreen ? 1 : 0);
+    int keyC = (frame.keyPressC ? 1 : 0);
+    int keyShiftC = (frame.keyPressShiftC ? 1 : 0);
+    int keyV = (frame.keyPressV ? 1 : 0);
+    int keyF = (frame.keyPressF ? 1 : 0);
+    int cameraMoved = (frame.cameraMovement ? 1 : 0);
+    int splitted = (frame.settings.viewLayout != ViewLayout::single ? 1 : 0);
+    int depthPrepass = (frame.settings.depthPrepass ? 1 : 0);
+    int vsync = (frame.settings.vsync ? 1 : 0);
 
     // Convert camera modes to int
     auto toCamInt = [](CameraMode cm)->int {
@@ -770,8 +1156,8 @@ static void retrieveQueries(int frameIndex, State_& state)
         }
         return 0;
         };
-    int cam1Mode = toCamInt(state.cameraMode1);
-    int cam2Mode = toCamInt(state.cameraMode2);
+    int cam1Mode = toCamInt(frame.settings.cameraMode1);
+    int cam2Mode = toCamInt(frame.settings.cameraMode2);
 
     if (g_csvOut.is_open())
     {
@@ -791,15 +1177,42 @@ static void retrieveQueries(int frameIndex, State_& state)
             << cameraMoved << ","
             << splitted << ","
             << cam1Mode << ","
-            << cam2Mode
+            << cam2Mode << ","
+            << visibleObjects << ","
+            << culledObjects << ","
+            << occludedObjects << ","
+            << glCallsIssued << ","
+            << glCallsSkipped << ","
+            << pointLights << ","
+            << lightAssignments << ","
+            << depthPrepassMs << ","
+            << depthPrepass << ","
+            << resolutionScale << ","
+            << simulationSteps << ","
+            << vsync << ","
+            << simulationMs << ","
+            << snapshotLatencyMs << ","
+            << snapshotsSkipped
             << "\n";
     }
 }
 #endif
 
 // ------------------ Main ------------------
-int main() try
+int main(int aArgc, char* aArgv[]) try
 {
+    RunOptions const options = parse_run_options(aArgc, aArgv);
+    if (options.help)
+    {
+        std::printf("%s", run_options_usage());
+        return 0;
+    }
+
+    // Headless: GLFW's null platform needs no display, and its windows are
+    // only a context (EGL or OSMesa, e.g., on Mesa's llvmpipe)
+    if (options.headless)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+
     // Initialize GLFW
     if (GLFW_TRUE != glfwInit())
     {
@@ -827,8 +1240,15 @@ int main() try
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #   endif
 
+    if (options.headless)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API,
+            HeadlessContext::osmesa == options.context ? GLFW_OSMESA_CONTEXT_API : GLFW_EGL_CONTEXT_API);
+    }
+
     // Create window
-    GLFWwindow* window = glfwCreateWindow(1280, 720,
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height,
         kWindowTitle,
         nullptr, nullptr);
     if (!window)
@@ -850,7 +1270,8 @@ int main() try
 
     // Make context current
     glfwMakeContextCurrent(window);
-    glfwSwapInterval(1); // vsync
+    if (!options.headless)
+        glfwSwapInterval(1); // vsync
 
     // Init GLAD
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
@@ -861,53 +1282,79 @@ int main() try
     std::printf("VERSION                    %s\n", glGetString(GL_VERSION));
     std::printf("SHADING_LANGUAGE_VERSION   %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
+    state.hasVertexViewportIndex = has_vertex_viewport_index();
+    std::printf("Single-pass multi-view     %s\n", state.hasVertexViewportIndex ? "yes" : "no (one pass per view)");
+
 #   if !defined(NDEBUG)
     setup_gl_debug_output();
 #   endif
 
     OGL_CHECKPOINT_ALWAYS();
 
-    // Global GL state
+    // Global GL state. State that passes change goes through the state
+    // cache (see gl_state.hpp); each pass sets what it needs.
+    GlStateCache& gl = gl_state();
     glClearColor(0.2f, 0.2f, 0.2f, 0.0f);
-    glEnable(GL_FRAMEBUFFER_SRGB);
-    glEnable(GL_DEPTH_TEST);
-    // glEnable(GL_CULL_FACE);
-    // glCullFace(GL_BACK);
-    // glFrontFace(GL_CCW);
-    glEnable(GL_BLEND);
-    //glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-    glDepthMask(GL_TRUE);
+    gl.enable(GL_FRAMEBUFFER_SRGB);
+    gl.enable(GL_DEPTH_TEST);
+    gl.enable(GL_CULL_FACE);     // All meshes are wound CCW (see mesh_winding.hpp)
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CCW);
+    gl.depth_mask(true);
 
     // Framebuffer size
     int iwidth, iheight;
     glfwGetFramebufferSize(window, &iwidth, &iheight);
     glViewport(0, 0, iwidth, iheight);
 
-    // Load shaders
-    ShaderProgram prog({
+    // Load shaders. Linked programs are cached on disk, so that later runs
+    // skip compiling GLSL (see program_cache.hpp).
+    ProgramBinaryCache shaderCache(SHADER_CACHE_PATH, gl_driver_string());
+
+    ShaderPermutations sceneShaders({
         {GL_VERTEX_SHADER,   "assets/cw2/default.vert"},
         {GL_FRAGMENT_SHADER, "assets/cw2/default.frag"}
-        });
-    state.prog = &prog;
+        }, &shaderCache);
+    state.sceneShaders = &sceneShaders;
+
+    // The variants of the initial settings; others compile when toggled
+    sceneShaders.get(sceneDefines(state.settings, false));
+    sceneShaders.get(sceneDefines(state.settings, true));
+
+    ShaderProgram depthShader({
+        {GL_VERTEX_SHADER,   "assets/cw2/depth.vert"},
+        {GL_FRAGMENT_SHADER, "assets/cw2/depth.frag"}
+        }, {}, &shaderCache);
+    state.depthShader = &depthShader;
 
     ShaderProgram particleShader({
         {GL_VERTEX_SHADER,   "assets/cw2/particle.vert"},
         {GL_FRAGMENT_SHADER, "assets/cw2/particle.frag"}
-        });
+        }, {}, &shaderCache);
     state.particleShader = &particleShader;
 
     ShaderProgram textShader({
         {GL_VERTEX_SHADER,   "assets/cw2/text.vert"},
         {GL_FRAGMENT_SHADER, "assets/cw2/text.frag"}
-        });
+        }, {}, &shaderCache);
     state.textShader = &textShader;
 
     ShaderProgram buttonShader({
         {GL_VERTEX_SHADER,   "assets/cw2/button.vert"},
         {GL_FRAGMENT_SHADER, "assets/cw2/button.frag"}
-        });
+        }, {}, &shaderCache);
     state.buttonShader = &buttonShader;
 
+    std::printf("Shader cache               %zu programs loaded, %zu compiled\n", shaderCache.hits(), shaderCache.misses());
+
+    // Hot-reload. The text and button programs are not watched: fontstash
+    // and the buttons keep their program names.
+    ShaderReloader shaderReloader(window, DIR_PATH + "/assets/cw2", &shaderCache);
+    shaderReloader.watch(sceneShaders);
+    shaderReloader.watch(depthShader);
+    shaderReloader.watch(particleShader);
+    state.shaderReloader = &shaderReloader;
+
     // -------------- Load fonts --------------
     state.fsContext = glfonsCreate(1280, 720, FONS_ZERO_TOPLEFT, textShader.programId());
 
@@ -936,31 +1383,72 @@ int main() try
     //state.buttons.push_back(Button())
 
     // -------------- Load all meshes & textures --------------
+    // All static meshes share one vertex/index buffer and VAO
+    GeometryArena arena;
+
     // Langerso
-    auto langersoMesh = load_wavefront_obj(LANGERSO_OBJ_ASSET_PATH.c_str(), true);
-    GLuint langersoVao = create_vao(langersoMesh);
+    auto langersoMesh = load_wavefront_obj_cached(LANGERSO_OBJ_ASSET_PATH.c_str(), true);
+    MeshRange langersoRange = arena.add(langersoMesh);
     GLuint langersoTextureId = load_texture_2d(LANGERSO_TEXTURE_ASSET_PATH.c_str());
-    size_t langersoVertexCount = langersoMesh.positions.size();
 
     // Launchpad
-    auto launchpadMesh = load_wavefront_obj(
+    auto launchpadMesh = load_wavefront_obj_cached(
         LAUNCHPAD_OBJ_ASSET_PATH.c_str(),
         false,
         make_translation({ 2.f, 0.005f, -2.f }) * make_scaling(0.5f, 0.5f, 0.5f)
     );
-    GLuint launchpadVao = create_vao(launchpadMesh);
-    size_t launchpadVertexCount = launchpadMesh.positions.size();
-
-    // Rocket
-    auto rocketMesh = create_spaceship(
-        32,
-        { 0.2f, 0.2f, 0.2f }, { 0.8f, 0.2f, 0.2f }, // body & fin colors
-        make_translation({ 2.f,0.15f,-2.f }) * make_scaling(0.05f, 0.05f, 0.05f),
-        false
-    );
-    GLuint rocketVao = create_vao(rocketMesh);
-    size_t rocketVertexCount = rocketMesh.positions.size();
-    state.rcktCtrl.enginePosition = rocketMesh.engineLocation;
+    MeshRange launchpadRange = arena.add(launchpadMesh);
+
+    // Rocket (procedural meshes are memoized; identical requests share
+    // geometry, colors and placement are per instance)
+    MeshCache meshCache;
+    auto rocket = meshCache.spaceship(32, false);
+    print_mesh_stats("spaceship", rocket->stats);
+    SimpleMeshData const& rocketMesh = rocket->data;
+    MeshRange rocketRange = arena.add(rocketMesh);
+
+    arena.upload();
+
+    // Scene objects, drawn through the render queue. Material ids must be
+    // unique per distinct material.
+    DrawMaterial const launchpadMaterial{ 3, launchpadMesh.isTextureSupplied, launchpadMesh.mins, launchpadMesh.diffs };
+
+    // Objects sharing a mesh (the launchpads) are drawn as one instanced draw
+    InstanceManager instances;
+    instances.add(langersoRange, langersoTextureId, kIdentity44f,
+        { 1, langersoMesh.isTextureSupplied, langersoMesh.mins, langersoMesh.diffs }, true);
+    DrawMaterial rocketMaterial{ 2, rocketMesh.isTextureSupplied, rocketMesh.mins, rocketMesh.diffs };
+    rocketMaterial.palette[0] = { 0.2f, 0.2f, 0.2f };   // Body
+    rocketMaterial.palette[1] = { 0.8f, 0.2f, 0.2f };   // Fins
+    rocketMaterial.palette[2] = { 0.8f, 0.8f, 0.8f };   // Nozzle
+    InstanceHandle const rocketInstance = instances.add(rocketRange, 0, state.rcktCtrl.model2worldRocket * kRocketPlacement_,
+        rocketMaterial, false);
+    InstanceHandle const launchpadInstances[2] = {
+        instances.add(launchpadRange, 0, kIdentity44f, launchpadMaterial, true),
+        instances.add(launchpadRange, 0, make_translation({ 3.f, 0.f, -5.f }), launchpadMaterial, true)
+    };
+
+    // Occluders for software occlusion culling: a coarse version of the
+    // terrain (about 128 cells across) and the launchpads
+    Aabb const terrainBounds = aabb_of(langersoMesh.positions);
+    Vec3f const terrainSize = terrainBounds.max - terrainBounds.min;
+    OccluderMesh const terrainOccluder = simplify_occluder(langersoMesh, std::max(terrainSize.x, terrainSize.z) / 128.f);
+    OccluderMesh const launchpadOccluder = simplify_occluder(launchpadMesh, 0.f);
+
+    OcclusionBuffer occlusion;
+
+    // Display names for picking, by instance handle
+    std::vector<std::string> const instanceNames{ "Terrain", "Spaceship", "Launchpad 1", "Launchpad 2" };
+
+    // The visible part of the static scene is drawn with multi-draw indirect
+    IndirectBatch staticBatch;
+    std::vector<std::uint8_t> visibleInstances;
+
+    RenderQueue renderQueue;
+
+    // Per-frame camera data (triple buffered, see persistent_ring.hpp)
+    PersistentRing frameRing(16 * 1024);
+    state.rcktCtrl.enginePosition = kRocketPlacement_ * rocketMesh.engineLocation;
     state.rcktCtrl.engineDirection = rocketMesh.engineDirection;
 
     // Particles
@@ -968,8 +1456,16 @@ int main() try
     GLuint particleTextureId = load_texture_2d_with_alpha(PARTICLE_TEXTURE_ASSET_PATH.c_str());
 
     // -------------- Set up lights --------------
-    State_::PointLight pointLights[MAX_POINT_LIGHTS];
-    GLuint pointLightUBO = setPointLights(pointLights, rocketMesh);
+    Aabb const launchpadBounds = aabb_of(launchpadMesh.positions);
+    Aabb padBounds[2];
+    for (std::size_t i = 0; i < 2; ++i)
+        padBounds[i] = transform_aabb(launchpadBounds, instances.transform(launchpadInstances[i]));
+
+    std::vector<PointLight> sceneLights = makeSceneLights(langersoMesh, padBounds, 2);
+    std::cout << "Point lights: " << sceneLights.size() << "\n";
+
+    // Lights are binned per view into clusters, see light_clusters.hpp
+    LightClusters lightClusters;
 
     OGL_CHECKPOINT_ALWAYS();
 
@@ -991,240 +1487,607 @@ int main() try
     glGenQueries(MAX_FRAMES_IN_FLIGHT, g_timestampViewBStart);
     glGenQueries(MAX_FRAMES_IN_FLIGHT, g_timestampViewBEnd);
 
+    glGenQueries(MAX_FRAMES_IN_FLIGHT, g_timestampDepthPrepassStart);
+    glGenQueries(MAX_FRAMES_IN_FLIGHT, g_timestampDepthPrepassEnd);
+
     g_csvOut.open("performance.csv", std::ios::out);
     g_csvOut << "Frame,FrameGPUTime,TerrainGPUTime,LaunchpadsGPUTime,SpaceshipGPUTime,"
         << "ViewAGPUTime,ViewBGPUTime,CPURenderTime,CPUFrameTime,"
         << "KeyPressC,KeyPressShiftC,KeyPressV,KeyPressF,"
-        << "CameraMovement,SplitScreenEnabled,Camera1Mode,Camera2Mode\n";
+        << "CameraMovement,SplitScreenEnabled,Camera1Mode,Camera2Mode,"
+        << "VisibleObjects,CulledObjects,OccludedObjects,"
+        << "GLCallsIssued,GLCallsSkipped,PointLights,LightAssignments,"
+        << "DepthPrepassGPUTime,DepthPrepass,ResolutionScale,SimulationSteps,VSync,"
+        << "SimulationCPUTime,SnapshotLatency,SnapshotsSkipped\n";
 #endif
 
-    // -------------- Timing variables --------------
-    auto last = Clock::now();
-    int lastwSize = 1280;
-    int lasthSize = 720;
+    // Offscreen target of the scene, when rendered at a lower resolution
+    SceneTarget sceneTarget;
 
-    int lastXPosWindow = 0;
-    int lastYPosWindow = 0;
-
-    // Main loop
-    while (!glfwWindowShouldClose(window))
+    // Headless runs have no window; frames end up in this target instead
+    std::optional<SceneTarget> headlessTarget;
+    if (options.headless)
     {
-        // By default, assume no camera movement
-        state.cameraMovement = false;
+        headlessTarget.emplace();
+        state.settings.vsync = false;
+        std::printf("Headless                   %d x %d, %zu frames\n", options.width, options.height, options.frames);
+    }
+    GLuint const outputFramebuffer = headlessTarget ? headlessTarget->framebuffer() : 0;
+    GpuFrameTimer gpuFrameTimer;
+    ResolutionController resolution;
+
+    // Simulation clock, and the state before its last step
+    FixedTimestep simClock;
+    SimPose_ previousPose = capturePose(state);
+
+    // Input replay and recording. The particles' random numbers are seeded
+    // like the recording's, so that a replay simulates the same frames.
+    std::optional<InputLog> replay;
+    std::size_t replayNext = 0;
+    if (!options.replay.empty())
+    {
+        replay = load_input_log(options.replay.c_str());
+        std::printf("Replaying                  %s (%zu events)\n", options.replay.c_str(), replay->events.size());
+    }
 
-        glfwPollEvents();
+    InputLog recording;
+    recording.seed = replay ? replay->seed : options.seed ? *options.seed : std::random_device{}();
+    seedParticles(recording.seed);
 
-        // Check for window resizing
-        int w, h, XPosWindow, YPosWindow;
-        glfwGetFramebufferSize(window, &w, &h);
-        glfwGetWindowPos(window, &XPosWindow, &YPosWindow);
-        if (w <= 0 || h <= 0 || w != lastwSize || h != lasthSize || lastXPosWindow != XPosWindow || lastYPosWindow != YPosWindow)
-        {
-            do {
-                // Pause when minimized
-                auto now = Clock::now();
-                last = now;
+    // Cursor positions are hit-tested against the window size, which hence
+    // stays fixed while recording, and is the recording's in a replay
+    if (replay)
+        glfwSetWindowSize(window, int(replay->windowWidth), int(replay->windowHeight));
+    if (replay || !options.record.empty())
+        glfwSetWindowAttrib(window, GLFW_RESIZABLE, GLFW_FALSE);
 
-                //state.rcktCtrl.particleTimer = 0.f;
-                glfwWaitEvents();
-                glfwGetFramebufferSize(window, &w, &h);
-            } while (w <= 0 || h <= 0);
+    {
+        int width = 0, height = 0;
+        glfwGetWindowSize(window, &width, &height);
+        recording.windowWidth = std::uint32_t(width);
+        recording.windowHeight = std::uint32_t(height);
+    }
 
-            fonsResetAtlas(state.fsContext, w, h);
-        }
-        glViewport(0, 0, w, h);
+    state.replaying = replay.has_value();
+    if (!options.record.empty())
+    {
+        state.recording = &recording;
+        std::printf("Recording                  %s (seed %u)\n", options.record.c_str(), unsigned(recording.seed));
+    }
 
-        // Compute dt
-        auto now = Clock::now();
-        float dt = std::chrono::duration_cast<Secondsf>(now - last).count();
-        last = now;
-        lasthSize = h;
-        lastwSize = w;
-        lastXPosWindow = XPosWindow;
-        lastYPosWindow = YPosWindow;
+    // The main thread simulates and publishes a snapshot per step of input;
+    // the render thread draws the latest one
+    TripleBuffer<RenderSnapshot_> snapshots;
 
-#ifdef ENABLE_PERFORMANCE_METRICS
-        auto cpuFrameStart = Clock::now();
-        glQueryCounter(g_timestampFrameStart[g_currentFrameIndex], GL_TIMESTAMP);
-#endif
+    // -------------- Render thread --------------
+    // Owns the GL context while it runs. It reads only its snapshot and the
+    // render resources in State_. Exits after options.frames frames, if set.
+    std::size_t framesDrawn = 0;
 
-        bool anyMove = (state.cam1.movingForward || state.cam1.movingBack ||
-            state.cam1.movingLeft || state.cam1.movingRight ||
-            state.cam1.movingUp || state.cam1.movingDown);
-        state.cameraMovement = anyMove;
+    auto renderLoop = [&]() {
+        glfwMakeContextCurrent(window);
 
-        // Update cameras
-        updateCamera(state.cam1, dt);
-        updateCamera(state.cam2, dt);
+        int lastwSize = 1280;
+        int lasthSize = 720;
 
-        // Update rocket
-        updateRocket(state.rcktCtrl, dt);
+        int lastXPosWindow = 0;
+        int lastYPosWindow = 0;
+
+        // Requests of the main thread that were handled
+        std::uint32_t pickRequests = 0;
+        std::uint32_t reloadRequests = 0;
+        bool vsync = !options.headless;
 
-        // Update point lights
-        updatePointLights(state.rcktCtrl.model2worldRocket,
-            rocketMesh,
-            pointLights);
-        updatePointLightUBO(pointLightUBO, pointLights);
+        std::string pickedName;
+
+        std::uint64_t seen = 0;
+        while (0 == options.frames || framesDrawn < options.frames)
+        {
+            // The latest snapshot. With vsync, waits if none was published
+            // since the last one. Without (uncapped, and headless runs),
+            // draws the latest one again rather than wait, interpolated to
+            // the time of drawing.
+            std::uint64_t const previous = seen;
+            if (vsync || 0 == seen || snapshots.front().paused)
+                seen = snapshots.wait(seen);
+            else
+                seen = snapshots.published();
+
+            if (!snapshots.acquire() && vsync)
+                continue;
+
+            RenderSnapshot_ const& frame = snapshots.front();
+            if (frame.quit)
+                break;
+            if (frame.paused)
+                continue;
+
+            [[maybe_unused]] double const snapshotLatencyMs =
+                std::chrono::duration<double, std::milli>(Clock::now() - frame.published).count();
+            [[maybe_unused]] std::uint64_t const snapshotsSkipped = seen > previous ? seen - previous - 1 : 0;
+
+            // Reloads requested with 'R' compile in the background too
+            if (frame.reloadRequests != reloadRequests)
+            {
+                reloadRequests = frame.reloadRequests;
+                shaderReloader.reload_all();
+            }
 
+            // Install shaders that finished compiling; never waits
+            shaderReloader.update();
 
-        // Update patricle system
-        state.rcktCtrl.particleTimer += dt;  // Accumulate time
+            if (frame.settings.vsync != vsync && !options.headless)
+            {
+                vsync = frame.settings.vsync;
+                glfwSwapInterval(vsync ? 1 : 0);
+            }
 
+            // Window resized or moved
+            int const w = frame.width, h = frame.height;
+            if (w != lastwSize || h != lasthSize || lastXPosWindow != frame.windowX || lastYPosWindow != frame.windowY)
+                fonsResetAtlas(state.fsContext, w, h);
+            glViewport(0, 0, w, h);
 
+            lasthSize = h;
+            lastwSize = w;
+            lastXPosWindow = frame.windowX;
+            lastYPosWindow = frame.windowY;
 
-        // Update particles
-        if (state.rcktCtrl.isMoving)
-            updateParticles(dt, state.rcktCtrl.particles);
+            // Resolution of the scene, from the GPU times of finished frames
+            while (auto const sample = gpuFrameTimer.poll())
+                resolution.update(sample->ms, sample->tag);
 
-        // Prepare once for entire frame
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            state.resolutionScale = frame.settings.dynamicResolution ? resolution.scale() : 1.f;
+            int const sceneWidth = scaled_size(w, state.resolutionScale);
+            int const sceneHeight = scaled_size(h, state.resolutionScale);
 
 #ifdef ENABLE_PERFORMANCE_METRICS
-        auto cpuRenderStart = Clock::now();
-
-        // Always do these queries so they're "used" each frame
-        glQueryCounter(g_timestampViewAStart[g_currentFrameIndex], GL_TIMESTAMP);
+            auto cpuFrameStart = Clock::now();
+            glQueryCounter(g_timestampFrameStart[g_currentFrameIndex], GL_TIMESTAMP);
 #endif
 
-        // If not split-screen, we do a single render:
-        if (!state.isSplitScreen)
-        {
-            // Build a single projection
-            Mat44f proj = make_perspective_projection(
-                60.f * std::numbers::pi_v<float> / 180.f,
-                float(w) / float(h),
-                0.1f, 100.f
-            );
+            // Only the pose and cameras are interpolated; particles are
+            // drawn as of the snapshot
+            SimFrame_ const sim = posedAt(frame.sim, frame.published, Clock::now());
+            SimPose_ const& pose = sim.pose;
 
-            Mat44f view = compute_view_matrix_for_camera(
-                state.cam1,
-                state.cameraMode1,
-                state
-            );
+            instances.set_transform(rocketInstance, pose.rocketModel * kRocketPlacement_);
 
-            // Render
-            renderScene(
-                state,
-                view, proj,
-                langersoVao, langersoMesh, langersoTextureId, langersoVertexCount,
-                rocketVao, rocketMesh, rocketVertexCount,
-                launchpadVao, launchpadMesh, launchpadVertexCount,
-                particleTextureId
-            );
-        }
-        else
-        {
-            // Bottom half
-            glViewport(0, 0, w, h / 2);
+            // Update point lights
+            updateRocketLights(pose.rocketModel * kRocketPlacement_, sim.rocketMoving, rocketMesh, sceneLights);
+
+            // Object data: only instances that moved are uploaded
+            instances.sync();
+
+            // Views of this frame
+            ViewRect viewRects[kMaxLayoutViews];
+            std::size_t const viewCount = layout_views(frame.settings.viewLayout, sceneWidth, sceneHeight, viewRects);
 
-            Mat44f proj1 = make_perspective_projection(
+            Mat44f const proj = make_perspective_projection(
                 60.f * std::numbers::pi_v<float> / 180.f,
-                float(w) / float(h / 2),      // aspect 
+                float(viewRects[0].width) / float(std::max(viewRects[0].height, 1)),
                 0.1f, 100.f
             );
-            Mat44f view1 = compute_view_matrix_for_camera(
-                state.cam1,
-                state.cameraMode1,
-                state
-            );
 
-            renderScene(
-                state,
-                view1, proj1,
-                langersoVao, langersoMesh, langersoTextureId, langersoVertexCount,
-                rocketVao, rocketMesh, rocketVertexCount,
-                launchpadVao, launchpadMesh, launchpadVertexCount,
-                particleTextureId
-            );
+            // Split screen: camera 1 below camera 2. Quad adds the camera 2 mode
+            // that is not in use and a top-down view of the rocket.
+            Vec3f const& rocketPos = pose.rocketPosition;
+            Vec4f const rocketTarget{ rocketPos.x + 1.47f, rocketPos.y, rocketPos.z - 1.20f, 1.f };
+
+            Mat44f const views[kMaxLayoutViews] = {
+                compute_view_matrix_for_camera(sim.cam1, frame.settings.cameraMode1, frame.settings, rocketPos),
+                compute_view_matrix_for_camera(sim.cam2, frame.settings.cameraMode2, frame.settings, rocketPos),
+                compute_view_matrix_for_camera(sim.cam2, frame.settings.cameraMode2 == CameraMode::CHASE ? CameraMode::GROUND : CameraMode::CHASE, frame.settings, rocketPos),
+                make_look_at(rocketTarget + Vec4f{ 0.f, 15.f, 0.01f, 0.f }, rocketTarget, Vec4f{ 0.f, 0.f, -1.f, 0.f })
+            };
+
+            // Cull all views in one traversal of the scene's AABB tree
+            Frustum frustums[kMaxLayoutViews];
+            for (std::size_t v = 0; v < viewCount; ++v)
+                frustums[v] = make_frustum(proj * views[v]);
+
+            CullStats cullStats = instances.cull(frustums, viewCount, visibleInstances);
+
+            // The particle system is culled as a whole; bit v for view v
+            Aabb const particleWorldBounds = particleBounds(frame.sim.particles);
+            std::uint32_t particleMask = 0;
+            for (std::size_t v = 0; v < viewCount; ++v)
+            {
+                if (intersects(frustums[v], particleWorldBounds))
+                    particleMask |= 1u << v;
+            }
+
+            // Then against the occluders, which are rasterized per view on the CPU
+            std::size_t occludedCount = 0;
+            if (frame.settings.occlusionCulling)
+            {
+                for (std::size_t v = 0; v < viewCount; ++v)
+                {
+                    occlusion.begin(proj * views[v]);
+                    occlusion.add_occluder(terrainOccluder, kIdentity44f);
+                    for (auto const pad : launchpadInstances)
+                        occlusion.add_occluder(launchpadOccluder, instances.transform(pad));
+                    occlusion.rasterize();
+
+                    std::size_t const hidden = instances.cull_occluded(occlusion, std::uint8_t(1u << v), visibleInstances);
+                    cullStats.visible -= hidden;
+                    cullStats.culled += hidden;
+                    occludedCount += hidden;
+
+                    if ((particleMask & (1u << v)) && !occlusion.is_visible(particleWorldBounds))
+                    {
+                        particleMask &= ~(1u << v);
+                        ++occludedCount;
+                    }
+                }
+            }
+
+            for (std::size_t v = 0; v < viewCount; ++v)
+            {
+                if (!frame.sim.particles.empty())
+                    ++((particleMask & (1u << v)) ? cullStats.visible : cullStats.culled);
+            }
+
+            // Data shared by all views is uploaded once per frame
+            instances.upload_visibility(visibleInstances);
+            instances.bind();
+
+            lightClusters.set_projection(proj);
+            [[maybe_unused]] ClusterStats const lightStats = lightClusters.assign(views, viewCount, sceneLights);
+            lightClusters.upload(sceneLights);
+
+            if (0 != particleMask)
+                uploadParticles(frame.sim.particles);
+
+            // Mouse picking: the instance whose bounds the cursor ray hits first
+            if (frame.pickRequests != pickRequests)
+            {
+                pickRequests = frame.pickRequests;
+                pickedName.clear();
+
+                // The cursor position is relative to the window, y down
+                if (auto const hit = view_at(viewRects, viewCount, frame.pickX * float(sceneWidth), (1.f - frame.pickY) * float(sceneHeight)))
+                {
+                    Mat44f const clip2world = invert(proj * views[hit->view]);
+                    Vec4f const nearPoint = clip2world * Vec4f{ hit->ndc.x, hit->ndc.y, -1.f, 1.f };
+                    Vec4f const farPoint = clip2world * Vec4f{ hit->ndc.x, hit->ndc.y, 1.f, 1.f };
+
+                    Vec3f const origin{ nearPoint.x / nearPoint.w, nearPoint.y / nearPoint.w, nearPoint.z / nearPoint.w };
+                    Vec3f const target{ farPoint.x / farPoint.w, farPoint.y / farPoint.w, farPoint.z / farPoint.w };
+
+                    auto const picked = instances.pick(origin, target - origin);
+                    pickedName = picked ? instanceNames[picked->id] : "";
+                }
+            }
+
+            frameRing.begin_frame(viewCount * (sizeof(CameraBlockUniforms) + frameRing.uniform_alignment()));
+
+            // One submission for all views (every draw is instanced once per
+            // view, and the shader routes each instance to its viewport), or one
+            // pass per view
+            bool const singlePass = frame.settings.singlePassMultiView && state.hasVertexViewportIndex;
+            std::size_t const passCount = singlePass ? 1 : viewCount;
+            std::size_t const passViews = singlePass ? viewCount : 1;
+
+            // Camera blocks of the passes; the depth pre-pass and the scene pass
+            // share them
+            PersistentRing::Allocation cameraBlocks[kMaxLayoutViews];
+            for (std::size_t p = 0; p < passCount; ++p)
+                cameraBlocks[p] = writeCameraBlock(frameRing, &views[p], passViews, p, proj);
+
+            auto const beginPass = [&](std::size_t p) {
+                if (singlePass)
+                {
+                    set_viewports(viewRects, viewCount);
+                    gl.enable(GL_SCISSOR_TEST);
+                }
+                else
+                    glViewport(viewRects[p].x, viewRects[p].y, viewRects[p].width, viewRects[p].height);
+
+                glBindBufferRange(GL_UNIFORM_BUFFER, kCameraUniformBinding, frameRing.buffer(), cameraBlocks[p].offset, sizeof(CameraBlockUniforms));
+                arena.set_view_count(std::uint32_t(passViews));
+            };
+
+            // The scene's GPU time steers the resolution
+            gpuFrameTimer.begin(state.resolutionScale);
+            if (headlessTarget)
+                headlessTarget->bind(w, h);
+            if (frame.settings.dynamicResolution)
+                sceneTarget.bind(w, h);
+
+            // Prepare once for entire frame (clears honour the write masks and scissor test)
+            gl.depth_mask(true);
+            gl.color_mask(true);
+            gl.disable(GL_SCISSOR_TEST);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 #ifdef ENABLE_PERFORMANCE_METRICS
-            glQueryCounter(g_timestampViewAEnd[g_currentFrameIndex], GL_TIMESTAMP);
+            auto cpuRenderStart = Clock::now();
 
-            glQueryCounter(g_timestampViewBStart[g_currentFrameIndex], GL_TIMESTAMP);
+            // Always do these queries so they're "used" each frame
+            glQueryCounter(g_timestampDepthPrepassStart[g_currentFrameIndex], GL_TIMESTAMP);
 #endif
 
-            // Top half
-            glViewport(0, h / 2, w, h / 2);
+            if (frame.settings.depthPrepass)
+            {
+                for (std::size_t p = 0; p < passCount; ++p)
+                {
+                    beginPass(p);
+                    renderDepthPrepass(state, passViews, p, arena, instances, staticBatch, visibleInstances);
+                }
+            }
 
-            Mat44f proj2 = make_perspective_projection(
-                60.f * std::numbers::pi_v<float> / 180.f,
-                float(w) / float(h / 2),      // aspect
-                0.1f, 100.f
-            );
-            Mat44f view2 = compute_view_matrix_for_camera(
-                state.cam2,
-                state.cameraMode2,
-                state
-            );
+#ifdef ENABLE_PERFORMANCE_METRICS
+            glQueryCounter(g_timestampDepthPrepassEnd[g_currentFrameIndex], GL_TIMESTAMP);
+            glQueryCounter(g_timestampViewAStart[g_currentFrameIndex], GL_TIMESTAMP);
+#endif
 
-            renderScene(
-                state,
-                view2, proj2,
-                langersoVao, langersoMesh, langersoTextureId, langersoVertexCount,
-                rocketVao, rocketMesh, rocketVertexCount,
-                launchpadVao, launchpadMesh, launchpadVertexCount,
-                particleTextureId
-            );
-        }
+            for (std::size_t p = 0; p < passCount; ++p)
+            {
+                beginPass(p);
+
+                renderScene(
+                    state, frame,
+                    &views[p], passViews, p,
+                    renderQueue, arena, instances, staticBatch,
+                    visibleInstances, particleMask, particleTextureId
+                );
+
+#ifdef ENABLE_PERFORMANCE_METRICS
+                // With a single pass, the views are not separable; view A
+                // covers all of them
+                if (p == 0 && viewCount > 1)
+                {
+                    glQueryCounter(g_timestampViewAEnd[g_currentFrameIndex], GL_TIMESTAMP);
+
+                    glQueryCounter(g_timestampViewBStart[g_currentFrameIndex], GL_TIMESTAMP);
+                }
+#endif
+            }
+
+            gl.disable(GL_SCISSOR_TEST);
 
-        // Reset viewport for text stuff
-        glViewport(0, 0, w, h);
+            // Scale up to the window; the UI is drawn at full resolution
+            if (frame.settings.dynamicResolution)
+                sceneTarget.resolve(sceneWidth, sceneHeight, w, h, outputFramebuffer);
+            gpuFrameTimer.end();
+
+            // Reset viewport for text stuff
+            glViewport(0, 0, w, h);
 
 #ifdef ENABLE_PERFORMANCE_METRICS
-        glQueryCounter(g_timestampViewBEnd[g_currentFrameIndex], GL_TIMESTAMP);
+            glQueryCounter(g_timestampViewBEnd[g_currentFrameIndex], GL_TIMESTAMP);
 #endif
 
-        // Output altitude of rocket
-        std::string altitudeText = std::format("Altitude: {:.4f}", state.rcktCtrl.position.y);
-        renderText(state.fsContext, altitudeText.c_str(), 10.0f, 20.0f, 20.0f, glfonsRGBA(255, 255, 255, 255), fontSans); // White text
+            // Output altitude of rocket
+            std::string altitudeText = std::format("Altitude: {:.4f}", pose.rocketPosition.y);
+            renderText(state.fsContext, altitudeText.c_str(), 10.0f, 20.0f, 20.0f, glfonsRGBA(255, 255, 255, 255), fontSans); // White text
+
+            if (!pickedName.empty())
+            {
+                std::string pickedText = "Selected: " + pickedName;
+                renderText(state.fsContext, pickedText.c_str(), 10.0f, 45.0f, 20.0f, glfonsRGBA(255, 255, 255, 255), fontSans);
+            }
+
 
 
 
+            // Render buttons, in their state as of the snapshot
+            launchButton.render(w, h, frame.launchButton);
+            resetButton.render(w, h, frame.resetButton);
 
-        // Update and render buttons
-        launchButton.update(window);
-        launchButton.render(w, h);
 
-        resetButton.update(window);
-        resetButton.render(w, h);
+            // The GPU may reuse this frame's ring region once it is done with it
+            frameRing.end_frame();
 
+            // Swap buffers (headless: there is nothing to present)
+            if (options.headless)
+                glFlush();
+            else
+                glfwSwapBuffers(window);
 
-        // Swap buffers
-        glfwSwapBuffers(window);
+            ++framesDrawn;
 
 #ifdef ENABLE_PERFORMANCE_METRICS
-        glQueryCounter(g_timestampFrameEnd[g_currentFrameIndex], GL_TIMESTAMP);
+            glQueryCounter(g_timestampFrameEnd[g_currentFrameIndex], GL_TIMESTAMP);
+
+            auto cpuRenderEnd = Clock::now();
+            g_cpuRenderTimes[g_currentFrameIndex] =
+                std::chrono::duration<double, std::milli>(cpuRenderEnd - cpuRenderStart).count();
+
+            auto cpuFrameEnd = Clock::now();
+            g_cpuFrameTimes[g_currentFrameIndex] =
+                std::chrono::duration<double, std::milli>(cpuFrameEnd - cpuFrameStart).count();
+
+            g_visibleObjects[g_currentFrameIndex] = cullStats.visible;
+            g_culledObjects[g_currentFrameIndex] = cullStats.culled;
+            g_occludedObjects[g_currentFrameIndex] = occludedCount;
+            g_glCallsIssued[g_currentFrameIndex] = gl_state().frame_stats().total_issued();
+            g_glCallsSkipped[g_currentFrameIndex] = gl_state().frame_stats().total_skipped();
+            g_pointLights[g_currentFrameIndex] = lightStats.lights;
+            g_lightAssignments[g_currentFrameIndex] = lightStats.assignments;
+            g_resolutionScale[g_currentFrameIndex] = state.resolutionScale;
+            g_simulationSteps[g_currentFrameIndex] = sim.steps;
+            g_simulationTimes[g_currentFrameIndex] = frame.simulationMs;
+            g_snapshotLatencies[g_currentFrameIndex] = snapshotLatencyMs;
+            g_snapshotsSkipped[g_currentFrameIndex] = snapshotsSkipped;
+
+            g_totalFrameCount++;
+
+            // retrieve older frame
+            if (g_totalFrameCount > MAX_FRAMES_IN_FLIGHT)
+            {
+                int retrieveIdx = (g_currentFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+                retrieveQueries(retrieveIdx, frame);
+            }
+
+            g_currentFrameIndex = (g_currentFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+#endif
+
+            // Per-frame counters of the GL state cache
+            gl.end_frame();
+        }
+
+        glfwMakeContextCurrent(nullptr);
+    };
+
+    // Hand the GL context over; from here, this thread handles windowing,
+    // input and simulation, and never waits for the render thread
+    glfwMakeContextCurrent(nullptr);
+
+    std::exception_ptr renderError;
+    std::atomic<bool> renderExited{ false };
+    auto const renderStart = Clock::now();
+    std::thread renderThread([&]() {
+        try
+        {
+            renderLoop();
+        }
+        catch (...)
+        {
+            renderError = std::current_exception();
+            glfwMakeContextCurrent(nullptr);
+        }
 
-        auto cpuRenderEnd = Clock::now();
-        g_cpuRenderTimes[g_currentFrameIndex] =
-            std::chrono::duration<double, std::milli>(cpuRenderEnd - cpuRenderStart).count();
+        renderExited = true;
+        glfwPostEmptyEvent();
+    });
+    RenderThreadJoiner_ renderJoiner{ snapshots, renderThread, window };
 
-        auto cpuFrameEnd = Clock::now();
-        g_cpuFrameTimes[g_currentFrameIndex] =
-            std::chrono::duration<double, std::milli>(cpuFrameEnd - cpuFrameStart).count();
+    // -------------- Timing variables --------------
+    auto last = Clock::now();
+
+    // Buttons, as of the last step
+    Button::State launchButtonState = Button::State::NEUTRAL;
+    Button::State resetButtonState = Button::State::NEUTRAL;
+
+    // Input that must happen at a given simulation step
+    std::function<void()> const beforeStep = [&]() {
+        if (replay)
+        {
+            while (replayNext < replay->events.size() && replay->events[replayNext].step <= state.simulationStep)
+                applyInput(window, state, replay->events[replayNext++]);
+        }
+
+        // Buttons change the simulation
+        launchButtonState = launchButton.update(state.cursorX, state.cursorY, state.windowWidth, state.windowHeight, state.mouseLeftDown);
+        resetButtonState = resetButton.update(state.cursorX, state.cursorY, state.windowWidth, state.windowHeight, state.mouseLeftDown);
+    };
 
-        g_totalFrameCount++;
+    // Picking and the buttons use the window size of the last frame. A
+    // replay uses the recording's, whatever size the window got.
+    if (replay)
+    {
+        state.windowWidth = int(replay->windowWidth);
+        state.windowHeight = int(replay->windowHeight);
+    }
+    else
+        glfwGetWindowSize(window, &state.windowWidth, &state.windowHeight);
 
-        // retrieve older frame
-        if (g_totalFrameCount > MAX_FRAMES_IN_FLIGHT)
+    // Main loop
+    while (!glfwWindowShouldClose(window) && !renderExited)
+    {
+        // Input, at least once per simulation step
+        glfwWaitEventsTimeout(kSimulationStep);
+
+        int w, h, XPosWindow, YPosWindow;
+        glfwGetFramebufferSize(window, &w, &h);
+        glfwGetWindowPos(window, &XPosWindow, &YPosWindow);
+        if (!replay)
+            glfwGetWindowSize(window, &state.windowWidth, &state.windowHeight);
+        if (w <= 0 || h <= 0)
         {
-            int retrieveIdx = (g_currentFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
-            retrieveQueries(retrieveIdx, state);
+            // Pause when minimized; nothing is published meanwhile, and
+            // the render thread waits for the next snapshot
+            RenderSnapshot_& paused = snapshots.back();
+            paused.paused = true;
+            paused.quit = false;
+            snapshots.publish();
+
+            do {
+                glfwWaitEvents();
+                glfwGetFramebufferSize(window, &w, &h);
+            } while ((w <= 0 || h <= 0) && !glfwWindowShouldClose(window));
+
+            last = Clock::now();
+            continue;
         }
 
-        g_currentFrameIndex = (g_currentFrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+        // Compute dt
+        auto now = Clock::now();
+        float dt = std::chrono::duration_cast<Secondsf>(now - last).count();
+        last = now;
+
+        state.cameraMovement = (state.cam1.movingForward || state.cam1.movingBack ||
+            state.cam1.movingLeft || state.cam1.movingRight ||
+            state.cam1.movingUp || state.cam1.movingDown);
+
+        // The snapshot slot is this thread's until published
+        RenderSnapshot_& frame = snapshots.back();
+
+        auto const simStart = Clock::now();
+        simulateFrame(state, simClock, previousPose, dt, beforeStep, frame.sim);
+        frame.simulationMs = std::chrono::duration<double, std::milli>(Clock::now() - simStart).count();
+
+        frame.launchButton = launchButtonState;
+        frame.resetButton = resetButtonState;
+
+        frame.settings = state.settings;
+        frame.width = w;
+        frame.height = h;
+        frame.windowX = XPosWindow;
+        frame.windowY = YPosWindow;
+        frame.pickRequests = state.pickRequests;
+        frame.pickX = state.pickX;
+        frame.pickY = state.pickY;
+        frame.reloadRequests = state.reloadRequests;
+        frame.keyPressC = state.keyPressC;
+        frame.keyPressShiftC = state.keyPressShiftC;
+        frame.keyPressV = state.keyPressV;
+        frame.keyPressF = state.keyPressF;
+        frame.cameraMovement = state.cameraMovement;
+        frame.paused = false;
+        frame.quit = false;
+
+        frame.published = Clock::now();
+        snapshots.publish();
 
         // Reset keyPress flags so they only appear "1" in CSV for a single frame
         state.keyPressC = false;
         state.keyPressShiftC = false;
         state.keyPressV = false;
         state.keyPressF = false;
-#endif
+    }
+
+    // Stop rendering; the context is current here again
+    renderJoiner.join();
+
+    if (state.recording)
+    {
+        InputEvent end;
+        end.step = state.simulationStep;
+        end.type = InputEventType::end;
+        recording.events.push_back(end);
+
+        save_input_log(options.record.c_str(), recording);
+        std::printf("Recorded %zu input events over %llu steps\n", recording.events.size() - 1, (unsigned long long)state.simulationStep);
+    }
+
+    if (renderError)
+        std::rethrow_exception(renderError);
+
+    if (options.headless)
+    {
+        double const seconds = std::chrono::duration<double>(Clock::now() - renderStart).count();
+        std::printf("Headless: %zu frames in %.2f s (%.3f ms per frame)\n",
+            framesDrawn, seconds, framesDrawn ? 1000.0 * seconds / double(framesDrawn) : 0.0);
     }
 
 
     // Cleanup
-    state.prog = nullptr;
+    state.shaderReloader = nullptr;
+    state.sceneShaders = nullptr;
+    state.depthShader = nullptr;
 
 #ifdef ENABLE_PERFORMANCE_METRICS
     // Delete queries
@@ -1245,6 +2108,9 @@ int main() try
     glDeleteQueries(MAX_FRAMES_IN_FLIGHT, g_timestampViewBStart);
     glDeleteQueries(MAX_FRAMES_IN_FLIGHT, g_timestampViewBEnd);
 
+    glDeleteQueries(MAX_FRAMES_IN_FLIGHT, g_timestampDepthPrepassStart);
+    glDeleteQueries(MAX_FRAMES_IN_FLIGHT, g_timestampDepthPrepassEnd);
+
     if (g_csvOut.is_open())
         g_csvOut.close();
 #endif
@@ -1264,114 +2130,170 @@ catch (std::exception const& eErr)
 namespace
 {
 
-    // This function draws all objects (Langerso, Rocket, Launchpads, etc.)
-    // for a single camera's "view" and "projection".
-    void renderScene(State_& state,
-        const Mat44f& view,
-        const Mat44f& projection,
-        GLuint langersoVao, const SimpleMeshData& langersoMesh, GLuint langersoTextureId, size_t langersoCount,
-        GLuint rocketVao, const SimpleMeshData& rocketMesh, size_t rocketCount,
-        GLuint launchpadVao, const SimpleMeshData& launchpadMesh, size_t launchpadCount,
-        GLuint particleTextureId
-    )
+    PersistentRing::Allocation writeCameraBlock(PersistentRing& frameRing,
+        const Mat44f* views,
+        std::size_t viewCount,
+        std::size_t firstView,
+        const Mat44f& projection)
     {
-        // Use the shader program
-        glUseProgram(state.prog->programId());
+        auto const cameraBlock = frameRing.allocate(sizeof(CameraBlockUniforms), frameRing.uniform_alignment());
+        auto* cameras = static_cast<CameraBlockUniforms*>(cameraBlock.data);
+        for (std::size_t v = 0; v < viewCount; ++v)
+            cameras->views[v] = make_camera_uniforms(views[v], projection);
+        cameras->viewCount = std::uint32_t(viewCount);
+        cameras->firstView = std::uint32_t(firstView);
+        frameRing.flush(cameraBlock, sizeof(CameraBlockUniforms));
+
+        return cameraBlock;
+    }
 
-        // Common light direction & color
-        Vec3f lightDir = normalize(Vec3f{ 0.f, 1.f, -1.f });
-        glUniform3fv(2, 1, &lightDir.x);
-        glUniform3f(3, 0.678f, 0.847f, 0.902f);
-        glUniform3f(4, 0.05f, 0.05f, 0.05f);
+    // Opaque objects only: the particles neither write depth nor are hidden
+    // by the pre-pass. depth.vert computes gl_Position exactly like
+    // default.vert (both are invariant), so that the scene pass can test for
+    // equal depth.
+    ShaderDefines sceneDefines(const RenderSettings_& settings, bool textured)
+    {
+        ShaderDefines defines{ textured ? "TEXTURED 1" : "TEXTURED 0" };
+        if (!settings.pointLights)
+            defines.emplace_back("MAX_POINT_LIGHTS 0");
+        if (settings.fog)
+            defines.emplace_back("FOG");
+        return defines;
+    }
 
-        // 1) -------------- Langerso --------------
-#ifdef ENABLE_PERFORMANCE_METRICS
-        //glQueryCounter(g_timestampTerrainStart[g_currentFrameIndex], GL_TIMESTAMP);
-#endif
+    void renderDepthPrepass(State_& state,
+        std::size_t viewCount,
+        std::size_t firstView,
+        GeometryArena& arena,
+        const InstanceManager& instances,
+        IndirectBatch& staticBatch,
+        const std::vector<std::uint8_t>& visible
+    )
+    {
+        GlStateCache& gl = gl_state();
+        gl.enable(GL_DEPTH_TEST);
+        gl.enable(GL_CULL_FACE);
+        gl.depth_func(GL_LESS);
+        gl.depth_mask(true);
+        gl.color_mask(false);
+        gl.disable(GL_BLEND);
+
+        gl.use_program(state.depthShader->programId());
+        arena.bind_depth();
+
+        std::uint8_t const viewMask = std::uint8_t(((1u << viewCount) - 1) << firstView);
+
+        // Static scene: all textures in one multi-draw
+        staticBatch.clear();
+        instances.record(staticBatch, true, visible, viewMask, std::uint32_t(viewCount));
+        staticBatch.build();
+        staticBatch.draw_untextured();
+
+        for (auto const& group : instances.groups())
         {
-            Mat44f model2world = kIdentity44f;
-            Mat33f normalMatrix = mat44_to_mat33(transpose(invert(model2world)));
-            Mat44f mvp = projection * view * model2world;
-
-            glUniformMatrix4fv(0, 1, GL_TRUE, mvp.v);
-            glUniformMatrix3fv(1, 1, GL_TRUE, normalMatrix.v);
-
-            // Texture:
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, langersoTextureId);
-            glUniform1i(5, langersoMesh.isTextureSupplied);  // location=5
-
-            glUniform2f(6, langersoMesh.mins.x, langersoMesh.mins.y);   // location=6
-            glUniform2f(7, langersoMesh.diffs.x, langersoMesh.diffs.y); // location=7
-
-            glBindVertexArray(langersoVao);
-            glDrawArrays(GL_TRIANGLES, 0, (GLsizei)langersoCount);
+            if (group.isStatic)
+                continue;
 
-            glBindTexture(GL_TEXTURE_2D, 0);
+            for_each_visible_run(group, visible, viewMask, [&](std::uint32_t first, std::uint32_t count) {
+                arena.draw(group.mesh, first, count);
+            });
         }
-#ifdef ENABLE_PERFORMANCE_METRICS
-        //glQueryCounter(g_timestampTerrainEnd[g_currentFrameIndex], GL_TIMESTAMP);
-#endif
+    }
 
-        // 2) -------------- Rocket --------------
-#ifdef ENABLE_PERFORMANCE_METRICS
-        //glQueryCounter(g_timestampSpaceshipStart[g_currentFrameIndex], GL_TIMESTAMP);
-#endif
+    // This function draws all objects (Langerso, Rocket, Launchpads, etc.)
+    // for viewCount cameras, in a single pass (see multi_view.hpp). The
+    // viewports, the camera block and the arena's view count must be set up
+    // by the caller.
+    void renderScene(State_& state,
+        const RenderSnapshot_& frame,
+        const Mat44f* views,
+        std::size_t viewCount,
+        std::size_t firstView,
+        RenderQueue& queue,
+        GeometryArena& arena,
+        const InstanceManager& instances,
+        IndirectBatch& staticBatch,
+        const std::vector<std::uint8_t>& visible,
+        std::uint32_t particleMask,
+        GLuint particleTextureId
+    )
+    {
+        // State of the opaque pass; particles change it (after all opaque
+        // draws), the cache filters what is already set. After a depth
+        // pre-pass, only the nearest surface passes the depth test and the
+        // depth buffer is complete already.
+        GlStateCache& gl = gl_state();
+        gl.enable(GL_DEPTH_TEST);
+        gl.enable(GL_CULL_FACE);
+        gl.depth_func(frame.settings.depthPrepass ? GL_EQUAL : GL_LESS);
+        gl.depth_mask(!frame.settings.depthPrepass);
+        gl.color_mask(true);
+        gl.disable(GL_BLEND);
+        gl.disable(GL_PROGRAM_POINT_SIZE);
+
+        // Variants of the current settings; textured objects use their own
+        // (compiled on first use)
+        GLuint const program = state.sceneShaders->get(sceneDefines(frame.settings, false)).programId();
+        GLuint const texturedProgram = state.sceneShaders->get(sceneDefines(frame.settings, true)).programId();
+
+        // Common light direction & color (uniforms are program state, so the
+        // queue's draws pick them up)
+        Vec3f lightDir = normalize(Vec3f{ 0.f, 1.f, -1.f });
+        for (GLuint const variant : { program, texturedProgram })
         {
-            Mat44f model2world = state.rcktCtrl.model2worldRocket;
-            Mat33f normalMatrix = mat44_to_mat33(transpose(invert(model2world)));
-            Mat44f mvp = projection * view * model2world;
-
-            glUniformMatrix4fv(0, 1, GL_TRUE, mvp.v);
-            glUniformMatrix3fv(1, 1, GL_TRUE, normalMatrix.v);
-            glUniform1i(5, rocketMesh.isTextureSupplied);
-
-            glBindVertexArray(rocketVao);
-            glDrawArrays(GL_TRIANGLES, 0, (GLsizei)rocketCount);
+            glProgramUniform3fv(variant, 2, 1, &lightDir.x);
+            glProgramUniform3f(variant, 3, 0.678f, 0.847f, 0.902f);
+            glProgramUniform3f(variant, 4, 0.05f, 0.05f, 0.05f);
         }
-#ifdef ENABLE_PERFORMANCE_METRICS
-        //glQueryCounter(g_timestampSpaceshipEnd[g_currentFrameIndex], GL_TIMESTAMP);
-#endif
 
-        // 3) -------------- Launchpad #1 --------------
-#ifdef ENABLE_PERFORMANCE_METRICS
-        //glQueryCounter(g_timestampLaunchpadsStart[g_currentFrameIndex], GL_TIMESTAMP);
-#endif
-        {
-            Mat44f model2world = kIdentity44f;
-            Mat33f normalMatrix = mat44_to_mat33(transpose(invert(model2world)));
-            Mat44f mvp = projection * view * model2world;
+        // Transparent draws are sorted for the first view
+        queue.begin(views[0]);
 
-            glUniformMatrix4fv(0, 1, GL_TRUE, mvp.v);
-            glUniformMatrix3fv(1, 1, GL_TRUE, normalMatrix.v);
-            glUniform1i(5, launchpadMesh.isTextureSupplied);
+        // Only objects visible in any of the views (see InstanceManager::cull())
+        // are submitted; the shader drops them from the other views
+        std::uint8_t const viewMask = std::uint8_t(((1u << viewCount) - 1) << firstView);
 
-            glBindVertexArray(launchpadVao);
-            glDrawArrays(GL_TRIANGLES, 0, (GLsizei)launchpadCount);
-        }
-
-        // 4) -------------- Launchpad #2 --------------
-        {
-            Mat44f model2world = make_translation({ 3.f,0.f,-5.f });
-            Mat33f normalMatrix = mat44_to_mat33(transpose(invert(model2world)));
-            Mat44f mvp = projection * view * model2world;
+        // Static scene: a single multi-draw (per texture)
+        staticBatch.clear();
+        instances.record(staticBatch, true, visible, viewMask, std::uint32_t(viewCount));
+        staticBatch.build();
 
-            glUniformMatrix4fv(0, 1, GL_TRUE, mvp.v);
-            glUniformMatrix3fv(1, 1, GL_TRUE, normalMatrix.v);
-            glUniform1i(5, launchpadMesh.isTextureSupplied);
+        queue.submit(RenderPass::opaque, Vec3f{ 0.f, 0.f, 0.f }, [&] {
+            arena.bind();
+            staticBatch.draw(program, texturedProgram);
+        });
 
-            glBindVertexArray(launchpadVao);
-            glDrawArrays(GL_TRIANGLES, 0, (GLsizei)launchpadCount);
+        // Dynamic meshes: one instanced draw per run of visible instances
+        for (auto const& group : instances.groups())
+        {
+            if (group.isStatic)
+                continue;
+
+            for_each_visible_run(group, visible, viewMask, [&](std::uint32_t first, std::uint32_t count) {
+                DrawPacket packet;
+                packet.program = group.texture ? texturedProgram : program;
+                packet.vao = arena.vao();
+                packet.texture = group.texture;
+                packet.material = group.material;
+                packet.range = group.mesh;
+                packet.object = first;
+                packet.instanceCount = count * std::uint32_t(viewCount);
+                packet.position = instances.position(instances.handle_at(first));
+
+                queue.submit(RenderPass::opaque, packet);
+            });
         }
 
-#ifdef ENABLE_PERFORMANCE_METRICS
-        //glQueryCounter(g_timestampLaunchpadsEnd[g_currentFrameIndex], GL_TIMESTAMP);
-#endif
-
-        // 5) -------------- Particle Exhaust --------------
+        // Particle exhaust (uploaded once per frame)
+        if (particleMask & viewMask)
         {
-            renderParticles(state.rcktCtrl.particles, state.particleShader->programId(), particleTextureId, projection * view);
+            Vec3f const& rocket = frame.sim.pose.rocketPosition;
+            queue.submit(RenderPass::transparent, rocket, [&] {
+                renderParticles(frame.sim.particles.size(), state.particleShader->programId(), particleTextureId, std::uint32_t(viewCount), particleMask, state.resolutionScale);
+            });
         }
+
+        queue.execute();
     }
 
 } // end namespace
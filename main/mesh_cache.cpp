@@ -0,0 +1,123 @@
+#include "mesh_cache.hpp"
+
+#include <utility>
+
+#include "../support/hash.hpp"
+
+#include "cylinder.hpp"
+#include "cone.hpp"
+#include "triangle_prism.hpp"
+#include "ovoid.hpp"
+#include "spaceship.hpp"
+
+namespace
+{
+    void push_( std::vector<float>& aParams, Vec2f aVec )
+    {
+        aParams.insert( aParams.end(), { aVec.x, aVec.y } );
+    }
+
+    void push_( std::vector<float>& aParams, std::size_t aValue )
+    {
+        // Subdivision counts are small; float represents them exactly.
+        aParams.push_back( float(aValue) );
+    }
+
+    void push_( std::vector<float>& aParams, bool aValue )
+    {
+        aParams.push_back( aValue ? 1.f : 0.f );
+    }
+
+    void push_( std::vector<float>& aParams, float aValue )
+    {
+        aParams.push_back( aValue );
+    }
+
+    template< typename... tArgs >
+    MeshKey make_key_( MeshGenerator aGenerator, tArgs const&... aArgs )
+    {
+        MeshKey key{ aGenerator, {} };
+        (push_( key.params, aArgs ), ...);
+        return key;
+    }
+}
+
+std::size_t MeshKeyHash::operator()( MeshKey const& aKey ) const noexcept
+{
+    // The generator id and the bit patterns of the parameters
+    std::uint64_t const hash = fnv1a_values( kFnv1aBasis, aKey.generator );
+    return std::size_t(fnv1a( hash, aKey.params.data(), aKey.params.size() * sizeof(float) ));
+}
+
+template< typename tBuild >
+std::shared_ptr<CachedMesh const> MeshCache::get_or_create_( MeshKey&& aKey, tBuild&& aBuild )
+{
+    if( auto const it = mEntries.find( aKey ); it != mEntries.end() )
+    {
+        ++mHits;
+        return it->second;
+    }
+
+    ++mMisses;
+
+    auto entry = std::make_shared<CachedMesh>();
+    entry->data = aBuild();
+    entry->stats = clean_mesh( entry->data );
+    entry->vertexCount = entry->data.positions.size();
+
+    mEntries.emplace( std::move(aKey), entry );
+    return entry;
+}
+
+std::shared_ptr<CachedMesh const> MeshCache::cylinder( bool aCapped, std::size_t aSubdivs )
+{
+    return get_or_create_( make_key_( MeshGenerator::cylinder, aCapped, aSubdivs ), [&] {
+        return make_cylinder( aCapped, aSubdivs, kPaletteColor0 );
+    } );
+}
+
+std::shared_ptr<CachedMesh const> MeshCache::cone( bool aCapped, std::size_t aSubdivs )
+{
+    return get_or_create_( make_key_( MeshGenerator::cone, aCapped, aSubdivs ), [&] {
+        return make_cone( aCapped, aSubdivs, kPaletteColor0 );
+    } );
+}
+
+std::shared_ptr<CachedMesh const> MeshCache::triangle_prism( bool aCentrePrism, Vec2f aP1, Vec2f aP2, Vec2f aP3, float aDepth )
+{
+    return get_or_create_( make_key_( MeshGenerator::trianglePrism, aCentrePrism, aP1, aP2, aP3, aDepth ), [&] {
+        return make_triangle_based_prism( aCentrePrism, aP1, aP2, aP3, aDepth, kPaletteColor0 );
+    } );
+}
+
+std::shared_ptr<CachedMesh const> MeshCache::truncated_ovoid( std::size_t aCircleSubdivs, std::size_t aHeightSubdivs, float aVerticalScale, float aTopCutoff, float aBottomCutoff )
+{
+    return get_or_create_( make_key_( MeshGenerator::truncatedOvoid, aCircleSubdivs, aHeightSubdivs, aVerticalScale, aTopCutoff, aBottomCutoff ), [&] {
+        return make_truncated_ovoid( aCircleSubdivs, aHeightSubdivs, aVerticalScale, aTopCutoff, aBottomCutoff, kPaletteColor0 );
+    } );
+}
+
+std::shared_ptr<CachedMesh const> MeshCache::spaceship( std::size_t aSubdivs, bool aIsTextureSupplied )
+{
+    return get_or_create_( make_key_( MeshGenerator::spaceship, aSubdivs, aIsTextureSupplied ), [&] {
+        return create_spaceship( aSubdivs, kPaletteColor0, kPaletteColor1, kIdentity44f, aIsTextureSupplied, kPaletteColor2 );
+    } );
+}
+
+void MeshCache::clear()
+{
+    mEntries.clear();
+}
+
+std::size_t MeshCache::size() const noexcept
+{
+    return mEntries.size();
+}
+std::size_t MeshCache::hits() const noexcept
+{
+    return mHits;
+}
+std::size_t MeshCache::misses() const noexcept
+{
+    return mMisses;
+}
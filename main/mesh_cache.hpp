@@ -0,0 +1,130 @@
+#ifndef MESH_CACHE_HPP_4F0C1E57_8B2A_4D6E_9C31_7A5D2E8B6F14
+#define MESH_CACHE_HPP_4F0C1E57_8B2A_4D6E_9C31_7A5D2E8B6F14
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "simple_mesh.hpp"
+#include "mesh_cleanup.hpp"
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/vec2.hpp"
+
+// Procedural mesh cache
+//
+// Generating a mesh is expensive compared to drawing it. The cache memoizes
+// the procedural generators: a request is keyed by the generator type and
+// its geometry parameters, and identical requests share the same CachedMesh.
+//
+// Everything that differs between placed copies is per-instance data that
+// stays out of the shared geometry (see InstanceManager). Meshes are
+// generated at the origin (no pre-transform); the instance transform places
+// them. They are also generated in the base colors kPaletteColor0..2, which
+// the instance's DrawMaterial::palette replaces with its own colors.
+//
+// Example:
+//    MeshCache cache;
+//    auto rocket = cache.spaceship( 32 );
+//    MeshRange range = arena.add( rocket->data );
+//
+//    DrawMaterial paint{ 2 };
+//    paint.palette[0] = bodyColor;   // kPaletteColor0: main body
+//    paint.palette[1] = finColor;    // kPaletteColor1: fins and stands
+//    instances.add( range, 0, model2world, paint, false );
+
+// Base colors of cached meshes; single-colored meshes use kPaletteColor0
+constexpr Vec3f kPaletteColor0{ 1.f, 0.f, 0.f };
+constexpr Vec3f kPaletteColor1{ 0.f, 1.f, 0.f };
+constexpr Vec3f kPaletteColor2{ 0.f, 0.f, 1.f };
+
+enum class MeshGenerator : std::uint32_t
+{
+    cylinder = 0,
+    cone,
+    trianglePrism,
+    truncatedOvoid,
+    spaceship
+};
+
+struct MeshKey
+{
+    MeshGenerator generator;
+    std::vector<float> params; // All geometry parameters, flattened
+
+    bool operator==( MeshKey const& ) const = default;
+};
+
+struct MeshKeyHash
+{
+    std::size_t operator()( MeshKey const& ) const noexcept;
+};
+
+struct CachedMesh
+{
+    SimpleMeshData data;       // Cleaned, see clean_mesh()
+    MeshStats stats;
+    std::size_t vertexCount = 0;
+};
+
+class MeshCache final
+{
+    public:
+        MeshCache() = default;
+
+        MeshCache( MeshCache const& ) = delete;
+        MeshCache& operator= ( MeshCache const& ) = delete;
+
+    public:
+        std::shared_ptr<CachedMesh const> cylinder(
+            bool aCapped = true,
+            std::size_t aSubdivs = 16
+        );
+
+        std::shared_ptr<CachedMesh const> cone(
+            bool aCapped = true,
+            std::size_t aSubdivs = 16
+        );
+
+        std::shared_ptr<CachedMesh const> triangle_prism(
+            bool aCentrePrism,
+            Vec2f aP1, Vec2f aP2, Vec2f aP3,
+            float aDepth
+        );
+
+        std::shared_ptr<CachedMesh const> truncated_ovoid(
+            std::size_t aCircleSubdivs,
+            std::size_t aHeightSubdivs,
+            float aVerticalScale,
+            float aTopCutoff,
+            float aBottomCutoff
+        );
+
+        // Main body in kPaletteColor0, fins and stands in kPaletteColor1,
+        // nozzle in kPaletteColor2
+        std::shared_ptr<CachedMesh const> spaceship(
+            std::size_t aSubdivs = 32,
+            bool aIsTextureSupplied = false
+        );
+
+        // Drops all entries. Handles that are still held elsewhere stay
+        // valid.
+        void clear();
+
+        std::size_t size() const noexcept;
+        std::size_t hits() const noexcept;
+        std::size_t misses() const noexcept;
+
+    private:
+        template< typename tBuild >
+        std::shared_ptr<CachedMesh const> get_or_create_( MeshKey&&, tBuild&& );
+
+        std::unordered_map<MeshKey, std::shared_ptr<CachedMesh>, MeshKeyHash> mEntries;
+        std::size_t mHits = 0;
+        std::size_t mMisses = 0;
+};
+
+#endif // MESH_CACHE_HPP_4F0C1E57_8B2A_4D6E_9C31_7A5D2E8B6F14
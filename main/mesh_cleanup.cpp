@@ -0,0 +1,168 @@
+#include "mesh_cleanup.hpp"
+
+#include <array>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_set>
+
+#include <cstdio>
+#include <cstdint>
+
+#include "../support/hash.hpp"
+
+namespace
+{
+    using Triangle_ = std::array<std::uint32_t, 3>;
+
+    struct TriangleHash_
+    {
+        std::size_t operator()( Triangle_ const& aTri ) const noexcept
+        {
+            return std::size_t(fnv1a_values( kFnv1aBasis, aTri ));
+        }
+    };
+
+    // Rotates the corners such that the smallest index comes first. This
+    // keeps the winding, so that only same-facing copies compare equal.
+    Triangle_ canonical_( Triangle_ aTri )
+    {
+        auto const first = std::min_element( aTri.begin(), aTri.end() );
+        std::rotate( aTri.begin(), first, aTri.end() );
+        return aTri;
+    }
+
+    template< typename tType >
+    void compact_( std::vector<tType>& aStream, std::vector<std::uint32_t> const& aRemap, std::size_t aVertexCount, std::size_t aKeptCount )
+    {
+        // Streams that are not per-vertex (e.g. missing texcoords) are left alone
+        if( aStream.size() != aVertexCount )
+            return;
+
+        std::vector<tType> out( aKeptCount );
+        for( std::size_t i = 0; i < aVertexCount; ++i )
+        {
+            if( aRemap[i] != std::numeric_limits<std::uint32_t>::max() )
+                out[aRemap[i]] = aStream[i];
+        }
+
+        aStream = std::move(out);
+    }
+
+    template< typename tType >
+    std::size_t bytes_( std::vector<tType> const& aStream )
+    {
+        return aStream.size() * sizeof(tType);
+    }
+}
+
+std::size_t MeshStats::total_bytes() const noexcept
+{
+    return positionBytes + normalBytes + colorBytes + texcoordBytes + materialBytes + indexBytes;
+}
+
+MeshStats clean_mesh( SimpleMeshData& aMesh )
+{
+    aMesh = make_indexed( std::move(aMesh) );
+
+    // Filter triangles
+    std::size_t degenerate = 0, duplicate = 0;
+
+    std::unordered_set<Triangle_, TriangleHash_> seen;
+    seen.reserve( aMesh.indices.size() / 3 );
+
+    std::vector<std::uint32_t> indices;
+    indices.reserve( aMesh.indices.size() );
+
+    for( std::size_t i = 0; i+2 < aMesh.indices.size(); i += 3 )
+    {
+        Triangle_ const tri{ aMesh.indices[i+0], aMesh.indices[i+1], aMesh.indices[i+2] };
+
+        if( tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0]
+            || is_degenerate_triangle( aMesh.positions[tri[0]], aMesh.positions[tri[1]], aMesh.positions[tri[2]] ) )
+        {
+            ++degenerate;
+            continue;
+        }
+
+        if( !seen.emplace( canonical_( tri ) ).second )
+        {
+            ++duplicate;
+            continue;
+        }
+
+        indices.insert( indices.end(), tri.begin(), tri.end() );
+    }
+
+    // Compact vertices, in order of first reference (this also improves
+    // locality of the vertex fetches)
+    std::size_t const vertexCount = aMesh.positions.size();
+
+    std::vector<std::uint32_t> remap( vertexCount, std::numeric_limits<std::uint32_t>::max() );
+    std::uint32_t kept = 0;
+    for( auto& idx : indices )
+    {
+        if( remap[idx] == std::numeric_limits<std::uint32_t>::max() )
+            remap[idx] = kept++;
+        idx = remap[idx];
+    }
+
+    compact_( aMesh.positions, remap, vertexCount, kept );
+    compact_( aMesh.normals, remap, vertexCount, kept );
+    compact_( aMesh.colors, remap, vertexCount, kept );
+    compact_( aMesh.texcoords, remap, vertexCount, kept );
+    compact_( aMesh.Ka, remap, vertexCount, kept );
+    compact_( aMesh.Kd, remap, vertexCount, kept );
+    compact_( aMesh.Ks, remap, vertexCount, kept );
+    compact_( aMesh.Ns, remap, vertexCount, kept );
+    compact_( aMesh.Ke, remap, vertexCount, kept );
+
+    aMesh.indices = std::move(indices);
+
+    MeshStats stats = mesh_stats( aMesh );
+    stats.degenerateRemoved = degenerate;
+    stats.duplicateRemoved = duplicate;
+    stats.unreferencedRemoved = vertexCount - kept;
+    return stats;
+}
+
+MeshStats mesh_stats( SimpleMeshData const& aMesh )
+{
+    MeshStats stats;
+    stats.vertices = aMesh.positions.size();
+    stats.triangles = draw_count( aMesh ) / 3;
+
+    stats.positionBytes = bytes_( aMesh.positions );
+    stats.normalBytes = bytes_( aMesh.normals );
+    stats.colorBytes = bytes_( aMesh.colors );
+    stats.texcoordBytes = bytes_( aMesh.texcoords );
+    stats.materialBytes = bytes_( aMesh.Ka ) + bytes_( aMesh.Kd ) + bytes_( aMesh.Ks ) + bytes_( aMesh.Ns ) + bytes_( aMesh.Ke );
+    stats.indexBytes = bytes_( aMesh.indices );
+
+    constexpr float kMax = std::numeric_limits<float>::max();
+    stats.boundsMin = Vec3f{ kMax, kMax, kMax };
+    stats.boundsMax = Vec3f{ -kMax, -kMax, -kMax };
+    for( auto const& p : aMesh.positions )
+    {
+        stats.boundsMin = Vec3f{ std::min( stats.boundsMin.x, p.x ), std::min( stats.boundsMin.y, p.y ), std::min( stats.boundsMin.z, p.z ) };
+        stats.boundsMax = Vec3f{ std::max( stats.boundsMax.x, p.x ), std::max( stats.boundsMax.y, p.y ), std::max( stats.boundsMax.z, p.z ) };
+    }
+
+    return stats;
+}
+
+void print_mesh_stats( char const* aName, MeshStats const& aStats )
+{
+    auto const kib = [] ( std::size_t aBytes ) { return aBytes / 1024.0; };
+
+    std::printf( "Mesh '%s': %zu vertices, %zu triangles\n", aName, aStats.vertices, aStats.triangles );
+    std::printf( "  removed: %zu degenerate, %zu duplicate triangles; %zu unreferenced vertices\n",
+        aStats.degenerateRemoved, aStats.duplicateRemoved, aStats.unreferencedRemoved );
+    std::printf( "  bounds: (%g, %g, %g) - (%g, %g, %g)\n",
+        aStats.boundsMin.x, aStats.boundsMin.y, aStats.boundsMin.z,
+        aStats.boundsMax.x, aStats.boundsMax.y, aStats.boundsMax.z );
+    std::printf( "  memory: %.1f KiB (positions %.1f, normals %.1f, colors %.1f, texcoords %.1f, materials %.1f, indices %.1f)\n",
+        kib( aStats.total_bytes() ), kib( aStats.positionBytes ), kib( aStats.normalBytes ), kib( aStats.colorBytes ),
+        kib( aStats.texcoordBytes ), kib( aStats.materialBytes ), kib( aStats.indexBytes ) );
+}
@@ -0,0 +1,58 @@
+#ifndef MESH_CLEANUP_HPP_6D3A9F28_E15C_4B07_A8D4_2F7C1B5E9036
+#define MESH_CLEANUP_HPP_6D3A9F28_E15C_4B07_A8D4_2F7C1B5E9036
+
+#include <cstddef>
+
+#include "simple_mesh.hpp"
+
+#include "../vmlib/vec3.hpp"
+
+// Mesh cleanup
+//
+// clean_mesh() converts a mesh into indexed form (see make_indexed()) and
+// removes primitives that would be rasterized for nothing:
+//  - degenerate triangles: repeated corner indices, or (numerically) zero
+//    area, see is_degenerate_triangle(). The generators produce these at the
+//    poles of closed shapes.
+//  - duplicate triangles: the same three vertices with the same winding.
+//    Triangles with opposite winding (double-sided geometry) are kept.
+//  - unreferenced vertices, which are compacted away.
+//
+// It runs as part of loading (OBJ assets and cached procedural meshes), so
+// only cleaned meshes are uploaded.
+
+struct MeshStats
+{
+    std::size_t vertices = 0;
+    std::size_t triangles = 0;
+
+    std::size_t degenerateRemoved = 0;
+    std::size_t duplicateRemoved = 0;
+    std::size_t unreferencedRemoved = 0;  // Vertices
+
+    // Size of each stream, in bytes (as uploaded by create_vao())
+    std::size_t positionBytes = 0;
+    std::size_t normalBytes = 0;
+    std::size_t colorBytes = 0;
+    std::size_t texcoordBytes = 0;
+    std::size_t materialBytes = 0;  // Ka, Kd, Ks, Ns and Ke together
+    std::size_t indexBytes = 0;
+
+    // Axis aligned bounds of the positions; min > max for an empty mesh
+    Vec3f boundsMin{ 0.f, 0.f, 0.f };
+    Vec3f boundsMax{ 0.f, 0.f, 0.f };
+
+    std::size_t total_bytes() const noexcept;
+};
+
+// Cleans the mesh in place and returns the statistics of the result,
+// including the number of removed elements.
+MeshStats clean_mesh( SimpleMeshData& );
+
+// Statistics of a mesh as-is (the *Removed counts are zero).
+MeshStats mesh_stats( SimpleMeshData const& );
+
+// Prints a short report to stdout.
+void print_mesh_stats( char const* aName, MeshStats const& );
+
+#endif // MESH_CLEANUP_HPP_6D3A9F28_E15C_4B07_A8D4_2F7C1B5E9036
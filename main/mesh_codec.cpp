@@ -0,0 +1,485 @@
+#include "mesh_codec.hpp"
+
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "../support/error.hpp"
+#include "../support/hash.hpp"
+
+namespace
+{
+    constexpr char kMagic_[4] = { 'C', 'M', 'S', 'H' };
+    constexpr std::uint32_t kVersion_ = 1;
+
+    constexpr std::uint32_t kHasNormals_ = 1u << 0;
+    constexpr std::uint32_t kHasTexcoords_ = 1u << 1;
+    constexpr std::uint32_t kHasMaterials_ = 1u << 2;
+    constexpr std::uint32_t kTextureSupplied_ = 1u << 3;
+
+    struct Header_
+    {
+        char magic[4];
+        std::uint32_t version;
+        std::uint32_t flags;
+        std::uint32_t vertexCount;
+        std::uint32_t indexCount;
+        std::uint32_t indexBytes;    // Size of the variable length index stream
+        std::uint32_t materialCount;
+        std::uint32_t reserved;
+
+        Vec3f posMin, posMax;        // Quantization box for positions
+        Vec2f texMin, texMax;        // Quantization box for texture coordinates
+
+        Vec2f mins, diffs;
+        Vec3f pointLightPos[3];
+        Vec3f pointLightNorms[3];
+        Vec4f engineLocation;
+        Vec4f engineDirection;
+    };
+
+    struct Material_
+    {
+        Vec3f color, Ka, Kd, Ks;
+        float Ns;
+        Vec3f Ke;
+
+        bool operator==( Material_ const& aOther ) const noexcept
+        {
+            return 0 == std::memcmp( this, &aOther, sizeof(Material_) );
+        }
+    };
+
+    struct MaterialHash_
+    {
+        std::size_t operator()( Material_ const& aMat ) const noexcept
+        {
+            return std::size_t(fnv1a_values( kFnv1aBasis, aMat ));
+        }
+    };
+
+    // Output helpers
+    template< typename tType >
+    void put_( std::vector<std::uint8_t>& aOut, tType const& aValue )
+    {
+        auto const* bytes = reinterpret_cast<std::uint8_t const*>(&aValue);
+        aOut.insert( aOut.end(), bytes, bytes + sizeof(tType) );
+    }
+
+    void put_varint_( std::vector<std::uint8_t>& aOut, std::uint32_t aValue )
+    {
+        while( aValue >= 0x80u )
+        {
+            aOut.push_back( std::uint8_t(aValue | 0x80u) );
+            aValue >>= 7;
+        }
+        aOut.push_back( std::uint8_t(aValue) );
+    }
+
+    // Input helper, with bounds checking
+    struct Reader_
+    {
+        std::uint8_t const* data;
+        std::size_t size;
+        std::size_t offset = 0;
+
+        std::uint8_t const* take( std::size_t aBytes )
+        {
+            if( aBytes > size - offset )
+                throw Error( "decode_mesh(): truncated data (need %zu bytes at offset %zu, have %zu)", aBytes, offset, size );
+
+            auto const* ptr = data + offset;
+            offset += aBytes;
+            return ptr;
+        }
+    };
+
+    std::uint16_t quantize_unorm16_( float aValue, float aMin, float aExtent )
+    {
+        float const t = aExtent > 0.f ? (aValue - aMin) / aExtent : 0.f;
+        return std::uint16_t(std::lround( std::clamp( t, 0.f, 1.f ) * 65535.f ));
+    }
+
+    std::int16_t quantize_snorm16_( float aValue )
+    {
+        return std::int16_t(std::lround( std::clamp( aValue, -1.f, 1.f ) * 32767.f ));
+    }
+
+    // Octahedral normal encoding: project onto the octahedron |x|+|y|+|z| = 1
+    // and fold the lower hemisphere over the diagonals.
+    Vec2f oct_encode_( Vec3f aN )
+    {
+        float const l1 = std::abs( aN.x ) + std::abs( aN.y ) + std::abs( aN.z );
+        if( l1 <= 0.f )
+            return Vec2f{ 0.f, 0.f };
+
+        float x = aN.x / l1;
+        float y = aN.y / l1;
+        if( aN.z < 0.f )
+        {
+            float const fx = (1.f - std::abs( y )) * (x >= 0.f ? 1.f : -1.f);
+            float const fy = (1.f - std::abs( x )) * (y >= 0.f ? 1.f : -1.f);
+            x = fx;
+            y = fy;
+        }
+        return Vec2f{ x, y };
+    }
+
+    Vec3f oct_decode_( float aX, float aY )
+    {
+        float const z = 1.f - std::abs( aX ) - std::abs( aY );
+        float const t = std::max( -z, 0.f );
+        Vec3f const n{
+            aX + (aX >= 0.f ? -t : t),
+            aY + (aY >= 0.f ? -t : t),
+            z
+        };
+        return normalize( n );
+    }
+
+    template< typename tType >
+    bool per_vertex_( std::vector<tType> const& aStream, std::size_t aVertexCount )
+    {
+        return aVertexCount > 0 && aStream.size() == aVertexCount;
+    }
+}
+
+std::vector<std::uint8_t> encode_mesh( SimpleMeshData const& aMesh )
+{
+    SimpleMeshData const mesh = make_indexed( aMesh );
+
+    std::size_t const vertexCount = mesh.positions.size();
+    if( vertexCount > std::numeric_limits<std::uint32_t>::max() || mesh.indices.size() > std::numeric_limits<std::uint32_t>::max() )
+        throw Error( "encode_mesh(): mesh too large (%zu vertices, %zu indices)", vertexCount, mesh.indices.size() );
+
+    Header_ header{};
+    std::memcpy( header.magic, kMagic_, sizeof(kMagic_) );
+    header.version = kVersion_;
+    header.vertexCount = std::uint32_t(vertexCount);
+    header.indexCount = std::uint32_t(mesh.indices.size());
+
+    if( per_vertex_( mesh.normals, vertexCount ) )
+        header.flags |= kHasNormals_;
+    if( per_vertex_( mesh.texcoords, vertexCount ) )
+        header.flags |= kHasTexcoords_;
+    if( per_vertex_( mesh.colors, vertexCount ) && per_vertex_( mesh.Ka, vertexCount ) && per_vertex_( mesh.Kd, vertexCount )
+        && per_vertex_( mesh.Ks, vertexCount ) && per_vertex_( mesh.Ns, vertexCount ) && per_vertex_( mesh.Ke, vertexCount ) )
+    {
+        header.flags |= kHasMaterials_;
+    }
+    if( mesh.isTextureSupplied )
+        header.flags |= kTextureSupplied_;
+
+    // Quantization bounds
+    header.posMin = Vec3f{ 0.f, 0.f, 0.f };
+    header.posMax = Vec3f{ 0.f, 0.f, 0.f };
+    if( vertexCount )
+    {
+        header.posMin = header.posMax = mesh.positions[0];
+        for( auto const& p : mesh.positions )
+        {
+            header.posMin = Vec3f{ std::min( header.posMin.x, p.x ), std::min( header.posMin.y, p.y ), std::min( header.posMin.z, p.z ) };
+            header.posMax = Vec3f{ std::max( header.posMax.x, p.x ), std::max( header.posMax.y, p.y ), std::max( header.posMax.z, p.z ) };
+        }
+    }
+    if( header.flags & kHasTexcoords_ )
+    {
+        header.texMin = header.texMax = mesh.texcoords[0];
+        for( auto const& t : mesh.texcoords )
+        {
+            header.texMin = Vec2f{ std::min( header.texMin.x, t.x ), std::min( header.texMin.y, t.y ) };
+            header.texMax = Vec2f{ std::max( header.texMax.x, t.x ), std::max( header.texMax.y, t.y ) };
+        }
+    }
+
+    header.mins = mesh.mins;
+    header.diffs = mesh.diffs;
+    for( int i = 0; i < 3; ++i )
+    {
+        header.pointLightPos[i] = mesh.pointLightPos[i];
+        header.pointLightNorms[i] = mesh.pointLightNorms[i];
+    }
+    header.engineLocation = mesh.engineLocation;
+    header.engineDirection = mesh.engineDirection;
+
+    // Material palette
+    std::vector<Material_> palette;
+    std::vector<std::uint16_t> materialIds;
+    if( header.flags & kHasMaterials_ )
+    {
+        std::unordered_map<Material_, std::uint16_t, MaterialHash_> lookup;
+        materialIds.reserve( vertexCount );
+        for( std::size_t i = 0; i < vertexCount; ++i )
+        {
+            Material_ mat{};
+            mat.color = mesh.colors[i];
+            mat.Ka = mesh.Ka[i];
+            mat.Kd = mesh.Kd[i];
+            mat.Ks = mesh.Ks[i];
+            mat.Ns = mesh.Ns[i];
+            mat.Ke = mesh.Ke[i];
+
+            auto const [it, inserted] = lookup.emplace( mat, std::uint16_t(palette.size()) );
+            if( inserted )
+            {
+                if( palette.size() > std::numeric_limits<std::uint16_t>::max() )
+                    throw Error( "encode_mesh(): more than 65536 unique materials" );
+                palette.emplace_back( mat );
+            }
+            materialIds.emplace_back( it->second );
+        }
+        header.materialCount = std::uint32_t(palette.size());
+    }
+
+    // Index stream
+    std::vector<std::uint8_t> indexBytes;
+    indexBytes.reserve( mesh.indices.size() );
+    std::int64_t prev = 0;
+    for( auto const idx : mesh.indices )
+    {
+        std::int64_t const delta = std::int64_t(idx) - prev;
+        prev = idx;
+
+        // Zig-zag: small negative and positive deltas both map to small values
+        std::uint32_t const zz = std::uint32_t((delta << 1) ^ (delta >> 63));
+        put_varint_( indexBytes, zz );
+    }
+    header.indexBytes = std::uint32_t(indexBytes.size());
+
+    // Write out
+    std::vector<std::uint8_t> out;
+    out.reserve( sizeof(Header_) + vertexCount * (6 + 4 + 4 + 2) + palette.size() * sizeof(Material_) + indexBytes.size() );
+
+    put_( out, header );
+
+    Vec3f const posExtent = header.posMax - header.posMin;
+    for( auto const& p : mesh.positions )
+    {
+        put_( out, quantize_unorm16_( p.x, header.posMin.x, posExtent.x ) );
+        put_( out, quantize_unorm16_( p.y, header.posMin.y, posExtent.y ) );
+        put_( out, quantize_unorm16_( p.z, header.posMin.z, posExtent.z ) );
+    }
+
+    if( header.flags & kHasNormals_ )
+    {
+        for( auto const& n : mesh.normals )
+        {
+            Vec2f const oct = oct_encode_( n );
+            put_( out, quantize_snorm16_( oct.x ) );
+            put_( out, quantize_snorm16_( oct.y ) );
+        }
+    }
+
+    if( header.flags & kHasTexcoords_ )
+    {
+        for( auto const& t : mesh.texcoords )
+        {
+            put_( out, quantize_unorm16_( t.x, header.texMin.x, header.texMax.x - header.texMin.x ) );
+            put_( out, quantize_unorm16_( t.y, header.texMin.y, header.texMax.y - header.texMin.y ) );
+        }
+    }
+
+    if( header.flags & kHasMaterials_ )
+    {
+        for( auto const& mat : palette )
+            put_( out, mat );
+        for( auto const id : materialIds )
+            put_( out, id );
+    }
+
+    out.insert( out.end(), indexBytes.begin(), indexBytes.end() );
+    return out;
+}
+
+SimpleMeshData decode_mesh( std::uint8_t const* aData, std::size_t aSize )
+{
+    Reader_ in{ aData, aSize };
+
+    Header_ header;
+    std::memcpy( &header, in.take( sizeof(Header_) ), sizeof(Header_) );
+
+    if( 0 != std::memcmp( header.magic, kMagic_, sizeof(kMagic_) ) )
+        throw Error( "decode_mesh(): not a mesh file (bad magic)" );
+    if( kVersion_ != header.version )
+        throw Error( "decode_mesh(): unsupported version %u (expected %u)", header.version, kVersion_ );
+
+    std::size_t const vertexCount = header.vertexCount;
+
+    SimpleMeshData ret;
+    ret.mins = header.mins;
+    ret.diffs = header.diffs;
+    ret.isTextureSupplied = 0 != (header.flags & kTextureSupplied_);
+    for( int i = 0; i < 3; ++i )
+    {
+        ret.pointLightPos[i] = header.pointLightPos[i];
+        ret.pointLightNorms[i] = header.pointLightNorms[i];
+    }
+    ret.engineLocation = header.engineLocation;
+    ret.engineDirection = header.engineDirection;
+
+    // Positions
+    {
+        auto const* src = in.take( vertexCount * 3 * sizeof(std::uint16_t) );
+        Vec3f const scale = (header.posMax - header.posMin) / 65535.f;
+
+        ret.positions.resize( vertexCount );
+        for( std::size_t i = 0; i < vertexCount; ++i )
+        {
+            std::uint16_t q[3];
+            std::memcpy( q, src + i*sizeof(q), sizeof(q) );
+            ret.positions[i] = Vec3f{
+                header.posMin.x + float(q[0]) * scale.x,
+                header.posMin.y + float(q[1]) * scale.y,
+                header.posMin.z + float(q[2]) * scale.z
+            };
+        }
+    }
+
+    // Normals
+    if( header.flags & kHasNormals_ )
+    {
+        auto const* src = in.take( vertexCount * 2 * sizeof(std::int16_t) );
+
+        ret.normals.resize( vertexCount );
+        for( std::size_t i = 0; i < vertexCount; ++i )
+        {
+            std::int16_t q[2];
+            std::memcpy( q, src + i*sizeof(q), sizeof(q) );
+            ret.normals[i] = oct_decode_( float(q[0]) / 32767.f, float(q[1]) / 32767.f );
+        }
+    }
+
+    // Texture coordinates
+    if( header.flags & kHasTexcoords_ )
+    {
+        auto const* src = in.take( vertexCount * 2 * sizeof(std::uint16_t) );
+        Vec2f const scale{ (header.texMax.x - header.texMin.x) / 65535.f, (header.texMax.y - header.texMin.y) / 65535.f };
+
+        ret.texcoords.resize( vertexCount );
+        for( std::size_t i = 0; i < vertexCount; ++i )
+        {
+            std::uint16_t q[2];
+            std::memcpy( q, src + i*sizeof(q), sizeof(q) );
+            ret.texcoords[i] = Vec2f{
+                header.texMin.x + float(q[0]) * scale.x,
+                header.texMin.y + float(q[1]) * scale.y
+            };
+        }
+    }
+
+    // Materials
+    if( header.flags & kHasMaterials_ )
+    {
+        // Sizes from the header are checked against the data before anything
+        // is allocated for them
+        std::size_t const paletteBytes = std::size_t(header.materialCount) * sizeof(Material_);
+        auto const* paletteSrc = in.take( paletteBytes );
+
+        std::vector<Material_> palette( header.materialCount );
+        std::memcpy( palette.data(), paletteSrc, paletteBytes );
+
+        auto const* src = in.take( vertexCount * sizeof(std::uint16_t) );
+
+        ret.colors.resize( vertexCount );
+        ret.Ka.resize( vertexCount );
+        ret.Kd.resize( vertexCount );
+        ret.Ks.resize( vertexCount );
+        ret.Ns.resize( vertexCount );
+        ret.Ke.resize( vertexCount );
+        for( std::size_t i = 0; i < vertexCount; ++i )
+        {
+            std::uint16_t id;
+            std::memcpy( &id, src + i*sizeof(id), sizeof(id) );
+            if( id >= palette.size() )
+                throw Error( "decode_mesh(): material index %u out of range (%zu materials)", unsigned(id), palette.size() );
+
+            auto const& mat = palette[id];
+            ret.colors[i] = mat.color;
+            ret.Ka[i] = mat.Ka;
+            ret.Kd[i] = mat.Kd;
+            ret.Ks[i] = mat.Ks;
+            ret.Ns[i] = mat.Ns;
+            ret.Ke[i] = mat.Ke;
+        }
+    }
+
+    // Indices
+    {
+        auto const* src = in.take( header.indexBytes );
+        auto const* const end = src + header.indexBytes;
+
+        // Every index takes at least one byte
+        if( header.indexCount > header.indexBytes )
+            throw Error( "decode_mesh(): %u indices in %u bytes", header.indexCount, header.indexBytes );
+
+        ret.indices.resize( header.indexCount );
+        std::int64_t prev = 0;
+        for( std::size_t i = 0; i < header.indexCount; ++i )
+        {
+            std::uint32_t zz = 0;
+            for( unsigned shift = 0; ; shift += 7 )
+            {
+                if( src == end || shift > 28 )
+                    throw Error( "decode_mesh(): corrupt index stream" );
+
+                std::uint8_t const byte = *src++;
+                zz |= std::uint32_t(byte & 0x7fu) << shift;
+                if( !(byte & 0x80u) )
+                    break;
+            }
+
+            std::int64_t const delta = std::int64_t(zz >> 1) ^ -std::int64_t(zz & 1u);
+            prev += delta;
+
+            if( prev < 0 || std::size_t(prev) >= vertexCount )
+                throw Error( "decode_mesh(): index %lld out of range (%zu vertices)", (long long)prev, vertexCount );
+
+            ret.indices[i] = std::uint32_t(prev);
+        }
+    }
+
+    return ret;
+}
+
+void save_mesh_binary( char const* aPath, SimpleMeshData const& aMesh )
+{
+    auto const bytes = encode_mesh( aMesh );
+
+    std::FILE* fout = std::fopen( aPath, "wb" );
+    if( !fout )
+        throw Error( "save_mesh_binary(): unable to open '%s' for writing", aPath );
+
+    auto const written = std::fwrite( bytes.data(), 1, bytes.size(), fout );
+    std::fclose( fout );
+
+    if( written != bytes.size() )
+        throw Error( "save_mesh_binary(): short write to '%s' (%zu of %zu bytes)", aPath, written, bytes.size() );
+}
+
+SimpleMeshData load_mesh_binary( char const* aPath )
+{
+    std::error_code ec;
+    auto const size = std::filesystem::file_size( aPath, ec );
+    if( ec )
+        throw Error( "load_mesh_binary(): unable to query the size of '%s': %s", aPath, ec.message().c_str() );
+
+    std::FILE* fin = std::fopen( aPath, "rb" );
+    if( !fin )
+        throw Error( "load_mesh_binary(): unable to open '%s'", aPath );
+
+    auto const length = std::size_t(size);
+    std::vector<std::uint8_t> bytes( length );
+    auto const read = std::fread( bytes.data(), 1, length, fin );
+    std::fclose( fin );
+
+    if( read != length )
+        throw Error( "load_mesh_binary(): error while reading '%s' (%zu bytes read, %zu total)", aPath, read, length );
+
+    return decode_mesh( bytes.data(), bytes.size() );
+}
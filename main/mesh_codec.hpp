@@ -0,0 +1,36 @@
+#ifndef MESH_CODEC_HPP_9E2B7C41_3D5A_4F86_B0E1_6C8A4D27F953
+#define MESH_CODEC_HPP_9E2B7C41_3D5A_4F86_B0E1_6C8A4D27F953
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "simple_mesh.hpp"
+
+// Compact binary mesh format (".cmesh")
+//
+// The encoder welds the mesh into an indexed form (see make_indexed()) and
+// stores each stream in a compact representation:
+//  - positions: 3x 16 bit, quantized to the mesh's axis aligned bounding box
+//  - normals: 2x 16 bit, octahedral encoding
+//  - texture coordinates: 2x 16 bit, quantized to their bounds (if present)
+//  - colour and material: a palette of unique (colour, Ka, Kd, Ks, Ns, Ke)
+//    tuples plus a 16 bit palette index per vertex
+//  - indices: delta to the previous index, zig-zag mapped and written as a
+//    variable length (LEB128) byte code
+//
+// Fixed-size streams are stored structure-of-arrays so that decoding is a
+// handful of straight loops over contiguous data, which the compiler
+// vectorizes. The decoder always returns an indexed mesh.
+//
+// Positions are lossy (1/65535 of the bounding box extent per axis); all
+// other non-vertex members of SimpleMeshData are stored exactly.
+
+std::vector<std::uint8_t> encode_mesh( SimpleMeshData const& );
+SimpleMeshData decode_mesh( std::uint8_t const*, std::size_t );
+
+void save_mesh_binary( char const* aPath, SimpleMeshData const& );
+SimpleMeshData load_mesh_binary( char const* aPath );
+
+#endif // MESH_CODEC_HPP_9E2B7C41_3D5A_4F86_B0E1_6C8A4D27F953
@@ -0,0 +1,219 @@
+#include "mesh_winding.hpp"
+
+#include <deque>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
+#include <bit>
+#include <cstdint>
+
+#include "../support/hash.hpp"
+
+namespace
+{
+    // |cos| between geometric and vertex normals below which a triangle is
+    // considered ambiguous (e.g. normals smoothed across a sharp crease).
+    constexpr float kAmbiguousCos_ = 0.1f;
+
+    enum class Orientation_ : std::uint8_t { degenerate, ambiguous, keep, flip };
+
+    std::size_t triangle_count_( SimpleMeshData const& aMesh )
+    {
+        return (aMesh.indices.empty() ? aMesh.positions.size() : aMesh.indices.size()) / 3;
+    }
+
+    std::size_t corner_( SimpleMeshData const& aMesh, std::size_t aTri, std::size_t aCorner )
+    {
+        std::size_t const i = aTri*3 + aCorner;
+        return aMesh.indices.empty() ? i : aMesh.indices[i];
+    }
+
+    // Edge between two positions, compared by exact bit pattern so that
+    // duplicated (non-indexed) vertices still connect.
+    struct PositionKey_
+    {
+        std::uint32_t x, y, z;
+        bool operator==( PositionKey_ const& ) const = default;
+    };
+
+    PositionKey_ key_( Vec3f aPos )
+    {
+        return { std::bit_cast<std::uint32_t>( aPos.x ), std::bit_cast<std::uint32_t>( aPos.y ), std::bit_cast<std::uint32_t>( aPos.z ) };
+    }
+
+    struct EdgeKey_
+    {
+        PositionKey_ from, to;
+        bool operator==( EdgeKey_ const& ) const = default;
+    };
+
+    struct EdgeKeyHash_
+    {
+        std::size_t operator()( EdgeKey_ const& aKey ) const noexcept
+        {
+            return std::size_t(fnv1a_values( kFnv1aBasis, aKey.from, aKey.to ));
+        }
+    };
+
+    std::vector<Orientation_> classify_( SimpleMeshData const& aMesh, WindingReport& aReport )
+    {
+        std::size_t const triCount = triangle_count_( aMesh );
+        bool const hasNormals = aMesh.normals.size() == aMesh.positions.size();
+
+        std::vector<Orientation_> orient( triCount, Orientation_::ambiguous );
+
+        // Pass 1: orientation from the stored normals
+        for( std::size_t t = 0; t < triCount; ++t )
+        {
+            std::size_t const i0 = corner_( aMesh, t, 0 ), i1 = corner_( aMesh, t, 1 ), i2 = corner_( aMesh, t, 2 );
+            Vec3f const a = aMesh.positions[i0], b = aMesh.positions[i1], c = aMesh.positions[i2];
+
+            Vec3f const face = cross( b - a, c - a );
+            float const faceLen = length( face );
+            if( is_degenerate_triangle( a, b, c ) )
+            {
+                orient[t] = Orientation_::degenerate;
+                continue;
+            }
+
+            if( !hasNormals )
+                continue;
+
+            Vec3f const n = aMesh.normals[i0] + aMesh.normals[i1] + aMesh.normals[i2];
+            float const nLen = length( n );
+            if( !(nLen > 0.f) )
+                continue;
+
+            float const cosine = dot( face, n ) / (faceLen * nLen);
+            if( cosine > kAmbiguousCos_ )
+                orient[t] = Orientation_::keep;
+            else if( cosine < -kAmbiguousCos_ )
+                orient[t] = Orientation_::flip;
+        }
+
+        // Pass 2: propagate orientation across shared edges into ambiguous
+        // triangles. Edges are stored in their current (stored) direction.
+        std::unordered_map<EdgeKey_, std::vector<std::uint32_t>, EdgeKeyHash_> edges;
+        std::deque<std::uint32_t> queue;
+        bool anyAmbiguous = false;
+
+        for( std::size_t t = 0; t < triCount; ++t )
+        {
+            if( Orientation_::degenerate == orient[t] )
+                continue;
+
+            for( std::size_t e = 0; e < 3; ++e )
+            {
+                Vec3f const from = aMesh.positions[corner_( aMesh, t, e )];
+                Vec3f const to = aMesh.positions[corner_( aMesh, t, (e+1) % 3 )];
+                edges[EdgeKey_{ key_( from ), key_( to ) }].push_back( std::uint32_t(t) );
+            }
+
+            if( Orientation_::ambiguous == orient[t] )
+                anyAmbiguous = true;
+            else
+                queue.push_back( std::uint32_t(t) );
+        }
+
+        while( anyAmbiguous && !queue.empty() )
+        {
+            std::uint32_t const t = queue.front();
+            queue.pop_front();
+
+            bool const tFlipped = Orientation_::flip == orient[t];
+
+            for( std::size_t e = 0; e < 3; ++e )
+            {
+                Vec3f const from = aMesh.positions[corner_( aMesh, t, e )];
+                Vec3f const to = aMesh.positions[corner_( aMesh, t, (e+1) % 3 )];
+
+                // Neighbour stores the edge reversed: consistent if both keep
+                // (or both flip) their current winding.
+                if( auto const it = edges.find( EdgeKey_{ key_( to ), key_( from ) } ); it != edges.end() )
+                {
+                    for( auto const n : it->second )
+                    {
+                        if( Orientation_::ambiguous != orient[n] )
+                            continue;
+                        orient[n] = tFlipped ? Orientation_::flip : Orientation_::keep;
+                        queue.push_back( n );
+                    }
+                }
+
+                // Neighbour stores the edge in the same direction: one of the
+                // two must be flipped.
+                if( auto const it = edges.find( EdgeKey_{ key_( from ), key_( to ) } ); it != edges.end() )
+                {
+                    for( auto const n : it->second )
+                    {
+                        if( n == t || Orientation_::ambiguous != orient[n] )
+                            continue;
+                        orient[n] = tFlipped ? Orientation_::keep : Orientation_::flip;
+                        queue.push_back( n );
+                    }
+                }
+            }
+        }
+
+        aReport.triangles = triCount;
+        for( auto const o : orient )
+        {
+            switch( o )
+            {
+                case Orientation_::degenerate: ++aReport.degenerate; break;
+                case Orientation_::ambiguous: ++aReport.ambiguous; break;
+                case Orientation_::flip: ++aReport.inconsistent; break;
+                case Orientation_::keep: break;
+            }
+        }
+
+        return orient;
+    }
+
+    template< typename tType >
+    void swap_corners_( std::vector<tType>& aStream, std::size_t aI, std::size_t aJ )
+    {
+        if( aI < aStream.size() && aJ < aStream.size() )
+            std::swap( aStream[aI], aStream[aJ] );
+    }
+}
+
+WindingReport check_winding( SimpleMeshData const& aMesh )
+{
+    WindingReport report;
+    classify_( aMesh, report );
+    return report;
+}
+
+WindingReport fix_winding( SimpleMeshData& aMesh )
+{
+    WindingReport report;
+    auto const orient = classify_( aMesh, report );
+
+    for( std::size_t t = 0; t < orient.size(); ++t )
+    {
+        if( Orientation_::flip != orient[t] )
+            continue;
+
+        if( !aMesh.indices.empty() )
+        {
+            std::swap( aMesh.indices[t*3 + 1], aMesh.indices[t*3 + 2] );
+            continue;
+        }
+
+        // Non-indexed: swap all per-vertex attributes of corners 1 and 2
+        std::size_t const i = t*3 + 1, j = t*3 + 2;
+        swap_corners_( aMesh.positions, i, j );
+        swap_corners_( aMesh.normals, i, j );
+        swap_corners_( aMesh.colors, i, j );
+        swap_corners_( aMesh.texcoords, i, j );
+        swap_corners_( aMesh.Ka, i, j );
+        swap_corners_( aMesh.Kd, i, j );
+        swap_corners_( aMesh.Ks, i, j );
+        swap_corners_( aMesh.Ns, i, j );
+        swap_corners_( aMesh.Ke, i, j );
+    }
+
+    return report;
+}
@@ -0,0 +1,33 @@
+#ifndef MESH_WINDING_HPP_2A7E5C93_D14B_4F08_8E6A_C3B95F1D7042
+#define MESH_WINDING_HPP_2A7E5C93_D14B_4F08_8E6A_C3B95F1D7042
+
+#include <cstddef>
+
+#include "simple_mesh.hpp"
+
+// Triangle winding validation
+//
+// Back-face culling requires every front-facing triangle to be wound counter-
+// clockwise. A triangle's orientation is derived from the stored vertex
+// normals: its geometric normal, cross(b-a, c-a), should point the same way
+// as the (summed) vertex normals. Triangles where the two are close to
+// perpendicular are ambiguous; these take their orientation from already
+// resolved neighbours, such that every shared edge is traversed in opposite
+// directions by the two triangles (consistent manifold orientation).
+
+struct WindingReport
+{
+    std::size_t triangles = 0;
+    std::size_t inconsistent = 0;  // Wound against their normals (or neighbours)
+    std::size_t ambiguous = 0;     // Could not be resolved either way
+    std::size_t degenerate = 0;    // Zero area; no orientation
+};
+
+// Reports inconsistently wound triangles without modifying the mesh.
+WindingReport check_winding( SimpleMeshData const& );
+
+// Flips inconsistently wound triangles in place. Returns the report from
+// before the fix (i.e., report.inconsistent triangles were flipped).
+WindingReport fix_winding( SimpleMeshData& );
+
+#endif // MESH_WINDING_HPP_2A7E5C93_D14B_4F08_8E6A_C3B95F1D7042
@@ -0,0 +1,123 @@
+#include "multi_view.hpp"
+
+#include <cstring>
+
+#include "../support/error.hpp"
+
+std::size_t view_count( ViewLayout aLayout ) noexcept
+{
+    switch( aLayout )
+    {
+        case ViewLayout::single: return 1;
+        case ViewLayout::split: return 2;
+        case ViewLayout::quad: return 4;
+    }
+
+    return 1;
+}
+
+ViewLayout next_layout( ViewLayout aLayout ) noexcept
+{
+    switch( aLayout )
+    {
+        case ViewLayout::single: return ViewLayout::split;
+        case ViewLayout::split: return ViewLayout::quad;
+        case ViewLayout::quad: return ViewLayout::single;
+    }
+
+    return ViewLayout::single;
+}
+
+std::size_t layout_views( ViewLayout aLayout, int aWidth, int aHeight, ViewRect* aRects ) noexcept
+{
+    // Odd sizes: the upper/right views get the extra pixel
+    int const halfW = aWidth / 2;
+    int const halfH = aHeight / 2;
+
+    switch( aLayout )
+    {
+        case ViewLayout::single:
+            aRects[0] = ViewRect{ 0, 0, aWidth, aHeight };
+            return 1;
+
+        case ViewLayout::split:
+            aRects[0] = ViewRect{ 0, 0, aWidth, halfH };
+            aRects[1] = ViewRect{ 0, halfH, aWidth, aHeight - halfH };
+            return 2;
+
+        case ViewLayout::quad:
+            aRects[0] = ViewRect{ 0, 0, halfW, halfH };
+            aRects[1] = ViewRect{ halfW, 0, aWidth - halfW, halfH };
+            aRects[2] = ViewRect{ 0, halfH, halfW, aHeight - halfH };
+            aRects[3] = ViewRect{ halfW, halfH, aWidth - halfW, aHeight - halfH };
+            return 4;
+    }
+
+    return 0;
+}
+
+std::optional<ViewHit> view_at( ViewRect const* aRects, std::size_t aCount, float aX, float aY ) noexcept
+{
+    for( std::size_t i = 0; i < aCount; ++i )
+    {
+        ViewRect const& r = aRects[i];
+        if( r.width <= 0 || r.height <= 0 )
+            continue;
+
+        float const u = (aX - float(r.x)) / float(r.width);
+        float const v = (aY - float(r.y)) / float(r.height);
+        if( u < 0.f || u >= 1.f || v < 0.f || v >= 1.f )
+            continue;
+
+        return ViewHit{ i, Vec2f{ 2.f * u - 1.f, 2.f * v - 1.f } };
+    }
+
+    return std::nullopt;
+}
+
+void set_viewports( ViewRect const* aRects, std::size_t aCount )
+{
+    GLfloat viewports[kMaxLayoutViews * 4];
+    GLint scissors[kMaxLayoutViews * 4];
+
+    if( aCount > kMaxLayoutViews )
+        throw Error( "set_viewports(): %zu views, at most %zu supported", aCount, kMaxLayoutViews );
+
+    for( std::size_t i = 0; i < aCount; ++i )
+    {
+        ViewRect const& r = aRects[i];
+        viewports[4*i+0] = GLfloat(r.x);
+        viewports[4*i+1] = GLfloat(r.y);
+        viewports[4*i+2] = GLfloat(r.width);
+        viewports[4*i+3] = GLfloat(r.height);
+
+        scissors[4*i+0] = r.x;
+        scissors[4*i+1] = r.y;
+        scissors[4*i+2] = r.width;
+        scissors[4*i+3] = r.height;
+    }
+
+    glViewportArrayv( 0, GLsizei(aCount), viewports );
+    glScissorArrayv( 0, GLsizei(aCount), scissors );
+}
+
+bool has_vertex_viewport_index()
+{
+    GLint count = 0;
+    glGetIntegerv( GL_NUM_EXTENSIONS, &count );
+
+    for( GLint i = 0; i < count; ++i )
+    {
+        auto const* name = reinterpret_cast<char const*>(glGetStringi( GL_EXTENSIONS, GLuint(i) ));
+        if( !name )
+            continue;
+
+        if( 0 == std::strcmp( name, "GL_ARB_shader_viewport_layer_array" )
+            || 0 == std::strcmp( name, "GL_AMD_vertex_shader_viewport_index" ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,73 @@
+#ifndef MULTI_VIEW_HPP_C8100F9D_93B2_4B40_B9B6_B1D9CF8B5179
+#define MULTI_VIEW_HPP_C8100F9D_93B2_4B40_B9B6_B1D9CF8B5179
+
+#include <glad/glad.h>
+
+#include <optional>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../vmlib/vec2.hpp"
+
+// Viewport layouts and single-pass multi-view rendering
+//
+// A layout splits the window into up to kMaxLayoutViews viewports. With
+// single-pass multi-view, all viewports are drawn by one submission:
+//  - set_viewports() loads the rectangles into the viewport (and scissor)
+//    arrays.
+//  - Each draw is issued with its instance count multiplied by the number
+//    of views. The default shader derives the view from gl_InstanceID
+//    (view = gl_InstanceID % viewCount) and writes it to gl_ViewportIndex;
+//    the object index attribute advances once every viewCount instances
+//    (see GeometryArena::set_view_count()).
+//
+// Writing gl_ViewportIndex from a vertex shader requires
+// ARB_shader_viewport_layer_array or AMD_vertex_shader_viewport_index. If
+// neither is present, the views are drawn one at a time instead.
+
+enum class ViewLayout : std::uint8_t
+{
+    single,  // One view filling the window
+    split,   // Two views, stacked
+    quad     // Four views, 2x2
+};
+
+constexpr std::size_t kMaxLayoutViews = 4;
+
+// Pixels; y = 0 is the bottom row (OpenGL window coordinates)
+struct ViewRect
+{
+    int x, y;
+    int width, height;
+};
+
+std::size_t view_count( ViewLayout ) noexcept;
+
+// single -> split -> quad -> single
+ViewLayout next_layout( ViewLayout ) noexcept;
+
+// Writes the viewports of the layout into aRects (at least kMaxLayoutViews
+// elements). Views are ordered bottom to top, then left to right. Returns
+// the number of views.
+std::size_t layout_views( ViewLayout, int aWidth, int aHeight, ViewRect* aRects ) noexcept;
+
+struct ViewHit
+{
+    std::size_t view;
+    Vec2f ndc;  // Position within the view, [-1,1]
+};
+
+// View containing the window point (aX, aY), in pixels with y = 0 at the
+// bottom, if any.
+std::optional<ViewHit> view_at( ViewRect const* aRects, std::size_t aCount, float aX, float aY ) noexcept;
+
+// Sets viewports and scissor rectangles 0 .. aCount-1. Enable
+// GL_SCISSOR_TEST to keep point sprites from bleeding into a neighbour.
+void set_viewports( ViewRect const* aRects, std::size_t aCount );
+
+// True if vertex shaders can select the viewport. Requires a current
+// OpenGL context.
+bool has_vertex_viewport_index();
+
+#endif // MULTI_VIEW_HPP_C8100F9D_93B2_4B40_B9B6_B1D9CF8B5179
@@ -0,0 +1,370 @@
+#include "occlusion.hpp"
+
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#include <cmath>
+
+#include "../support/error.hpp"
+#include "../support/hash.hpp"
+#include "../support/job_system.hpp"
+
+#include "../vmlib/vec4.hpp"
+
+namespace
+{
+    struct CellKey_
+    {
+        std::int32_t x, y, z;
+
+        bool operator== ( CellKey_ const& ) const = default;
+    };
+
+    struct CellHash_
+    {
+        std::size_t operator() ( CellKey_ const& aKey ) const noexcept
+        {
+            return std::size_t(fnv1a_values( kFnv1aBasis, aKey ));
+        }
+    };
+
+    // Minimum w of projected vertices. Triangles are clipped against the near
+    // plane, so this only rejects degenerate projections.
+    constexpr float kMinClipW = 1e-6f;
+}
+
+OccluderMesh simplify_occluder( SimpleMeshData const& aMesh, float aCellSize )
+{
+    SimpleMeshData const mesh = make_indexed( aMesh );
+
+    OccluderMesh result;
+    std::vector<std::uint32_t> remap( mesh.positions.size() );
+
+    if( aCellSize <= 0.f )
+    {
+        result.positions = mesh.positions;
+        for( std::size_t i = 0; i < remap.size(); ++i )
+            remap[i] = std::uint32_t(i);
+    }
+    else
+    {
+        std::unordered_map<CellKey_, std::uint32_t, CellHash_> cells;
+        for( std::size_t i = 0; i < mesh.positions.size(); ++i )
+        {
+            Vec3f const p = mesh.positions[i];
+            CellKey_ const key{
+                std::int32_t(std::floor( p.x / aCellSize )),
+                std::int32_t(std::floor( p.y / aCellSize )),
+                std::int32_t(std::floor( p.z / aCellSize ))
+            };
+
+            auto const [it, inserted] = cells.emplace( key, std::uint32_t(result.positions.size()) );
+            if( inserted )
+                result.positions.emplace_back( p );
+            else if( p.y < result.positions[it->second].y )
+                result.positions[it->second] = p;
+
+            remap[i] = it->second;
+        }
+    }
+
+    for( std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3 )
+    {
+        std::uint32_t const a = remap[mesh.indices[i+0]];
+        std::uint32_t const b = remap[mesh.indices[i+1]];
+        std::uint32_t const c = remap[mesh.indices[i+2]];
+        if( a == b || b == c || c == a )
+            continue;
+
+        result.indices.insert( result.indices.end(), { a, b, c } );
+    }
+
+    return result;
+}
+
+OcclusionBuffer::OcclusionBuffer( std::size_t aWidth, std::size_t aHeight )
+{
+    if( 0 == aWidth || 0 == aHeight )
+        throw Error( "OcclusionBuffer: invalid size %zu x %zu", aWidth, aHeight );
+
+    // Level i halves level i-1 (rounding up), down to a single texel
+    std::size_t w = aWidth, h = aHeight;
+    for( ;; )
+    {
+        mLevels.emplace_back( Level_{ w, h, std::vector<float>( w*h, 1.f ) } );
+        if( 1 == w && 1 == h )
+            break;
+
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+}
+
+void OcclusionBuffer::begin( Mat44f const& aViewProjection )
+{
+    mViewProjection = aViewProjection;
+    mTriangles.clear();
+}
+
+void OcclusionBuffer::add_occluder( OccluderMesh const& aMesh, Mat44f const& aModel2World )
+{
+    Mat44f const model2clip = mViewProjection * aModel2World;
+
+    std::vector<Vec4f> clip( aMesh.positions.size() );
+    for( std::size_t i = 0; i < aMesh.positions.size(); ++i )
+    {
+        Vec3f const p = aMesh.positions[i];
+        clip[i] = model2clip * Vec4f{ p.x, p.y, p.z, 1.f };
+    }
+
+    for( std::size_t i = 0; i + 2 < aMesh.indices.size(); i += 3 )
+    {
+        Vec4f const tri[3] = { clip[aMesh.indices[i+0]], clip[aMesh.indices[i+1]], clip[aMesh.indices[i+2]] };
+
+        // Distance to the near plane z = -w
+        float const d[3] = { tri[0].z + tri[0].w, tri[1].z + tri[1].w, tri[2].z + tri[2].w };
+        if( d[0] >= 0.f && d[1] >= 0.f && d[2] >= 0.f )
+        {
+            add_triangle_( tri[0], tri[1], tri[2] );
+            continue;
+        }
+        if( d[0] < 0.f && d[1] < 0.f && d[2] < 0.f )
+            continue;
+
+        // Clip against the near plane; the result has three or four corners
+        Vec4f poly[4];
+        int count = 0;
+        for( int e = 0; e < 3; ++e )
+        {
+            int const n = (e + 1) % 3;
+            if( d[e] >= 0.f )
+                poly[count++] = tri[e];
+            if( (d[e] >= 0.f) != (d[n] >= 0.f) )
+            {
+                float const t = d[e] / (d[e] - d[n]);
+                poly[count++] = tri[e] + t * (tri[n] - tri[e]);
+            }
+        }
+
+        add_triangle_( poly[0], poly[1], poly[2] );
+        if( 4 == count )
+            add_triangle_( poly[0], poly[2], poly[3] );
+    }
+}
+
+void OcclusionBuffer::rasterize()
+{
+    auto& base = mLevels[0].depth;
+    std::fill( base.begin(), base.end(), 1.f );
+
+    // Bands of whole rows; each job writes its own pixels only. Every band
+    // visits all triangles, so bands are at least 8 rows.
+    std::size_t const rows = mLevels[0].height;
+    std::size_t const bandRows = mTriangles.size() < kParallelRasterThreshold
+        ? rows
+        : std::max<std::size_t>( 8, rows / (4 * job_system().thread_count()) );
+
+    job_system().parallel_for( 0, rows, bandRows, [this] ( std::size_t aBegin, std::size_t aEnd ) {
+        rasterize_rows_( aBegin, aEnd );
+    } );
+
+    build_levels_();
+}
+
+bool OcclusionBuffer::is_visible( Aabb const& aBox ) const
+{
+    if( is_empty( aBox ) )
+        return false;
+
+    float const width = float(mLevels[0].width);
+    float const height = float(mLevels[0].height);
+
+    float minX = std::numeric_limits<float>::max(), maxX = -std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max(), maxY = -std::numeric_limits<float>::max();
+    float minZ = 1.f;
+
+    for( int i = 0; i < 8; ++i )
+    {
+        Vec4f const corner{
+            (i & 1) ? aBox.max.x : aBox.min.x,
+            (i & 2) ? aBox.max.y : aBox.min.y,
+            (i & 4) ? aBox.max.z : aBox.min.z,
+            1.f
+        };
+
+        Vec4f const c = mViewProjection * corner;
+        if( c.w <= kMinClipW || c.z < -c.w )
+            return true; // Reaches the near plane: cannot be hidden reliably
+
+        float const inv = 1.f / c.w;
+        float const x = (c.x * inv * 0.5f + 0.5f) * width;
+        float const y = (c.y * inv * 0.5f + 0.5f) * height;
+
+        minX = std::min( minX, x ); maxX = std::max( maxX, x );
+        minY = std::min( minY, y ); maxY = std::max( maxY, y );
+        minZ = std::min( minZ, c.z * inv * 0.5f + 0.5f );
+    }
+
+    // Outside of the screen: up to the frustum test
+    if( maxX < 0.f || maxY < 0.f || minX >= width || minY >= height )
+        return true;
+
+    std::size_t const x0 = std::size_t(std::max( 0.f, std::floor( minX ) ));
+    std::size_t const y0 = std::size_t(std::max( 0.f, std::floor( minY ) ));
+    std::size_t const x1 = std::min( mLevels[0].width - 1, std::size_t(std::max( 0.f, std::floor( maxX ) )) );
+    std::size_t const y1 = std::min( mLevels[0].height - 1, std::size_t(std::max( 0.f, std::floor( maxY ) )) );
+
+    // Coarsest level at which the rectangle spans at most 4x4 texels
+    std::size_t level = 0;
+    while( level + 1 < mLevels.size() && std::max( (x1 >> level) - (x0 >> level), (y1 >> level) - (y0 >> level) ) >= 4 )
+        ++level;
+
+    Level_ const& lvl = mLevels[level];
+    float farthest = 0.f;
+    for( std::size_t y = y0 >> level; y <= (y1 >> level); ++y )
+    {
+        for( std::size_t x = x0 >> level; x <= (x1 >> level); ++x )
+            farthest = std::max( farthest, lvl.depth[y * lvl.width + x] );
+    }
+
+    return minZ <= farthest;
+}
+
+std::size_t OcclusionBuffer::width() const noexcept
+{
+    return mLevels[0].width;
+}
+std::size_t OcclusionBuffer::height() const noexcept
+{
+    return mLevels[0].height;
+}
+std::size_t OcclusionBuffer::levels() const noexcept
+{
+    return mLevels.size();
+}
+
+float OcclusionBuffer::depth( std::size_t aX, std::size_t aY ) const
+{
+    return mLevels[0].depth.at( aY * mLevels[0].width + aX );
+}
+
+std::size_t OcclusionBuffer::triangle_count() const noexcept
+{
+    return mTriangles.size();
+}
+
+void OcclusionBuffer::add_triangle_( Vec4f aA, Vec4f aB, Vec4f aC )
+{
+    float const width = float(mLevels[0].width);
+    float const height = float(mLevels[0].height);
+
+    // Corners on the near plane may have w == 0 if the near distance is tiny
+    if( aA.w <= kMinClipW || aB.w <= kMinClipW || aC.w <= kMinClipW )
+        return;
+
+    Triangle_ tri;
+    Vec4f const corners[3] = { aA, aB, aC };
+    for( int i = 0; i < 3; ++i )
+    {
+        float const inv = 1.f / corners[i].w;
+        tri.x[i] = (corners[i].x * inv * 0.5f + 0.5f) * width;
+        tri.y[i] = (corners[i].y * inv * 0.5f + 0.5f) * height;
+        tri.z[i] = std::clamp( corners[i].z * inv * 0.5f + 0.5f, 0.f, 1.f );
+    }
+
+    // Off-screen or without area: nothing to rasterize
+    float const minX = std::min( { tri.x[0], tri.x[1], tri.x[2] } ), maxX = std::max( { tri.x[0], tri.x[1], tri.x[2] } );
+    float const minY = std::min( { tri.y[0], tri.y[1], tri.y[2] } ), maxY = std::max( { tri.y[0], tri.y[1], tri.y[2] } );
+    if( maxX < 0.f || maxY < 0.f || minX >= width || minY >= height )
+        return;
+
+    float const area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+    if( std::abs( area ) < 1e-8f )
+        return;
+
+    tri.minY = std::max( 0, int(std::floor( minY )) );
+    tri.maxY = std::min( int(height) - 1, int(std::ceil( maxY )) );
+    mTriangles.emplace_back( tri );
+}
+
+void OcclusionBuffer::rasterize_rows_( std::size_t aBeginRow, std::size_t aEndRow )
+{
+    std::size_t const width = mLevels[0].width;
+    float* const depth = mLevels[0].depth.data();
+
+    for( auto const& tri : mTriangles )
+    {
+        int const rowBegin = std::max( tri.minY, int(aBeginRow) );
+        int const rowEnd = std::min( tri.maxY + 1, int(aEndRow) );
+        if( rowBegin >= rowEnd )
+            continue;
+
+        // Edge functions E(x,y) = A*x + B*y + C, oriented so that the inside
+        // is positive for either winding.
+        float const area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+        float const sign = area > 0.f ? 1.f : -1.f;
+
+        float A[3], B[3], C[3];
+        for( int e = 0; e < 3; ++e )
+        {
+            int const i = (e + 1) % 3, j = (e + 2) % 3;
+            A[e] = sign * (tri.y[i] - tri.y[j]);
+            B[e] = sign * (tri.x[j] - tri.x[i]);
+            C[e] = sign * (tri.x[i] * tri.y[j] - tri.x[j] * tri.y[i]);
+        }
+
+        // Depth is affine in screen space: z = zx*x + zy*y + z0
+        float const invArea = sign / area;
+        float const zx = (A[0] * tri.z[0] + A[1] * tri.z[1] + A[2] * tri.z[2]) * invArea;
+        float const zy = (B[0] * tri.z[0] + B[1] * tri.z[1] + B[2] * tri.z[2]) * invArea;
+        float const z0 = (C[0] * tri.z[0] + C[1] * tri.z[1] + C[2] * tri.z[2]) * invArea;
+
+        int const colBegin = std::max( 0, int(std::floor( std::min( { tri.x[0], tri.x[1], tri.x[2] } ) )) );
+        int const colEnd = std::min( int(width), int(std::ceil( std::max( { tri.x[0], tri.x[1], tri.x[2] } ) )) + 1 );
+        if( colBegin >= colEnd )
+            continue;
+
+        for( int row = rowBegin; row < rowEnd; ++row )
+        {
+            float const py = float(row) + 0.5f;
+            float* const out = depth + std::size_t(row) * width;
+
+            float const e0 = B[0] * py + C[0];
+            float const e1 = B[1] * py + C[1];
+            float const e2 = B[2] * py + C[2];
+            float const ez = zy * py + z0;
+
+            // Pixel centers inside all three edges take the nearer depth
+            for( int col = colBegin; col < colEnd; ++col )
+            {
+                float const px = float(col) + 0.5f;
+                bool const inside = (A[0] * px + e0 >= 0.f) & (A[1] * px + e1 >= 0.f) & (A[2] * px + e2 >= 0.f);
+                float const z = zx * px + ez;
+                out[col] = inside ? std::min( out[col], z ) : out[col];
+            }
+        }
+    }
+}
+
+void OcclusionBuffer::build_levels_()
+{
+    for( std::size_t l = 1; l < mLevels.size(); ++l )
+    {
+        Level_ const& src = mLevels[l-1];
+        Level_& dst = mLevels[l];
+
+        for( std::size_t y = 0; y < dst.height; ++y )
+        {
+            std::size_t const sy0 = 2*y, sy1 = std::min( 2*y + 1, src.height - 1 );
+            for( std::size_t x = 0; x < dst.width; ++x )
+            {
+                std::size_t const sx0 = 2*x, sx1 = std::min( 2*x + 1, src.width - 1 );
+                dst.depth[y * dst.width + x] = std::max(
+                    std::max( src.depth[sy0 * src.width + sx0], src.depth[sy0 * src.width + sx1] ),
+                    std::max( src.depth[sy1 * src.width + sx0], src.depth[sy1 * src.width + sx1] )
+                );
+            }
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef OCCLUSION_HPP_8B0F9B2E_BC7C_4D81_BB71_0FF19EC584CA
+#define OCCLUSION_HPP_8B0F9B2E_BC7C_4D81_BB71_0FF19EC584CA
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bounds.hpp"
+#include "simple_mesh.hpp"
+
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/vec4.hpp"
+#include "../vmlib/mat44.hpp"
+
+// Software occlusion culling
+//
+// A few simplified occluder meshes are rasterized on the CPU into a low
+// resolution depth buffer. The bounds of potential occludees are then tested
+// against it before they are submitted. Nothing is read back from the GPU,
+// so the test works without one (and without a frame of latency).
+//
+// Per view:
+//    occlusion.begin( projection * view );
+//    occlusion.add_occluder( terrainOccluder, kIdentity44f );
+//    occlusion.rasterize();
+//    ...
+//    if( !occlusion.is_visible( worldBounds ) )
+//        skip the object
+//
+// Depth is NDC z mapped to [0,1], smaller is nearer; the buffer keeps the
+// nearest occluder depth of each pixel. rasterize() also builds a chain of
+// coarser levels holding the farthest depth of each 2x2 block below
+// (hierarchical depth). is_visible() projects the box, picks the level at
+// which the box covers only a few texels, and reports the box as occluded
+// if its nearest depth lies behind the farthest occluder depth under it.
+//
+// Occluder triangles are clipped against the near plane. Boxes that cross
+// it are always visible. Occluders should lie inside the geometry they stand
+// in for (see simplify_occluder()), or objects may be culled incorrectly.
+//
+// Triangles are rasterized with edge functions evaluated a row at a time in
+// branch-free loops that the compiler vectorizes. Large occluder sets are
+// rasterized in horizontal bands, as jobs of the shared job system.
+
+struct OccluderMesh
+{
+    std::vector<Vec3f> positions;
+    std::vector<std::uint32_t> indices;
+};
+
+// Reduces a mesh to a coarse occluder by clustering its vertices in a grid
+// of aCellSize and dropping triangles that collapse. Each cluster is
+// represented by its lowest vertex (smallest y), so that height-field-like
+// meshes such as terrain shrink downwards and do not occlude more than the
+// original. aCellSize <= 0 keeps all vertices.
+OccluderMesh simplify_occluder( SimpleMeshData const&, float aCellSize );
+
+constexpr std::size_t kParallelRasterThreshold = 2048;  // Triangles
+
+class OcclusionBuffer final
+{
+    public:
+        explicit OcclusionBuffer( std::size_t aWidth = 256, std::size_t aHeight = 128 );
+
+    public:
+        // Starts a new view. Drops all occluders.
+        void begin( Mat44f const& aViewProjection );
+
+        void add_occluder( OccluderMesh const&, Mat44f const& aModel2World );
+
+        // Rasterizes the occluders and builds the depth hierarchy.
+        void rasterize();
+
+        // False if the box is certainly hidden by the occluders.
+        bool is_visible( Aabb const& ) const;
+
+        std::size_t width() const noexcept;
+        std::size_t height() const noexcept;
+        std::size_t levels() const noexcept;
+
+        // Depth of pixel (x, y) of level 0; y = 0 is the bottom row.
+        float depth( std::size_t aX, std::size_t aY ) const;
+
+        std::size_t triangle_count() const noexcept;
+
+    private:
+        struct Triangle_
+        {
+            float x[3], y[3], z[3];  // Pixels and [0,1] depth
+            int minY, maxY;          // Rows covered, inclusive
+        };
+
+        struct Level_
+        {
+            std::size_t width, height;
+            std::vector<float> depth;
+        };
+
+        void add_triangle_( Vec4f, Vec4f, Vec4f );
+        void rasterize_rows_( std::size_t aBeginRow, std::size_t aEndRow );
+        void build_levels_();
+
+        Mat44f mViewProjection = kIdentity44f;
+
+        std::vector<Triangle_> mTriangles;
+        std::vector<Level_> mLevels;  // mLevels[0] is full resolution
+};
+
+#endif // OCCLUSION_HPP_8B0F9B2E_BC7C_4D81_BB71_0FF19EC584CA
@@ -32,6 +32,10 @@ SimpleMeshData make_truncated_ovoid(
     // Calculate theta (horizontal) step
     float thetaStep = 2.0f * std::numbers::pi_v<float> / float(aCircleSubdivs);
 
+    // A truncated ovoid is an open shell, so its inside can be seen through the
+    // cut. Emit the inside explicitly, so it survives back-face culling.
+    bool const isOpen = topCutoff > 0.f || bottomCutoff > 0.f;
+
     // Generate vertices and triangles
     for (std::size_t phi_idx = 0; phi_idx < aHeightSubdivs; ++phi_idx) {
         float phi1 = phiStart + phi_idx * phiStep;
@@ -80,6 +84,15 @@ SimpleMeshData make_truncated_ovoid(
             // Second triangle of quad
             data.positions.insert(data.positions.end(), { v2, v4, v3 });
             data.normals.insert(data.normals.end(), { n2, n4, n3 });
+
+            if (isOpen) {
+                // Inside: reversed winding and normals
+                data.positions.insert(data.positions.end(), { v1, v3, v2 });
+                data.normals.insert(data.normals.end(), { -n1, -n3, -n2 });
+
+                data.positions.insert(data.positions.end(), { v2, v3, v4 });
+                data.normals.insert(data.normals.end(), { -n2, -n3, -n4 });
+            }
         }
     }
 
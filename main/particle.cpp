@@ -5,6 +5,28 @@
 #include "../vmlib/vec4.hpp"
 #include "../vmlib/mat44.hpp"
 
+#include "../support/job_system.hpp"
+
+#include "gl_state.hpp"
+
+namespace
+{
+    // Seeded, so that replays emit the same particles (seedParticles()).
+    // std::mt19937's sequence is fixed by the standard; the distributions'
+    // are not, hence the explicit conversion in randomUnit_().
+    std::mt19937 gParticleRandom_;
+
+    float randomUnit_()
+    {
+        return static_cast<float>(gParticleRandom_() >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+void seedParticles(std::uint32_t seed)
+{
+    gParticleRandom_.seed(seed);
+}
+
 void emitParticle(std::vector<Particle>& particles, const Vec4f& enginePosition, const Vec4f& engineDirection, const Mat44f& model2world)
 {
     // Transform position
@@ -26,9 +48,9 @@ void emitParticle(std::vector<Particle>& particles, const Vec4f& enginePosition,
 
     // Calculate random direction offset 
     Vec3f randomOffset = {
-        (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 0.5f,
-        (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 0.5f,
-        (static_cast<float>(rand()) / RAND_MAX - 0.5f) * 0.5f
+        (randomUnit_() - 0.5f) * 0.5f,
+        (randomUnit_() - 0.5f) * 0.5f,
+        (randomUnit_() - 0.5f) * 0.5f
     };
 
     newParticle.velocity = engDir * 5.0f + randomOffset;
@@ -41,15 +63,19 @@ void emitParticle(std::vector<Particle>& particles, const Vec4f& enginePosition,
 
 void updateParticles(float deltaTime, std::vector<Particle>& particles)
 {
-    for (auto& particle : particles)
-    {
-        if (particle.lifetime > 0.0f)
+    // Particles are independent; chunks are integrated on all cores
+    job_system().parallel_for(0, particles.size(), 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
         {
-            // Update particle's position and fade
-            particle.position += particle.velocity * deltaTime;
-            particle.lifetime -= deltaTime;
+            Particle& particle = particles[i];
+            if (particle.lifetime > 0.0f)
+            {
+                // Update particle's position and fade
+                particle.position += particle.velocity * deltaTime;
+                particle.lifetime -= deltaTime;
+            }
         }
-    }
+    });
 
     // Remove expired particles
     particles.erase(
@@ -61,6 +87,23 @@ void updateParticles(float deltaTime, std::vector<Particle>& particles)
     );
 }
 
+Aabb particleBounds(const std::vector<Particle>& particles)
+{
+    // Sprites are sized in pixels (see particle.vert); at the default size
+    // and field of view they cover less than this many world units.
+    constexpr float kSpriteRadius = 0.25f;
+
+    Aabb bounds;
+    for (const auto& particle : particles)
+        bounds = merge(bounds, particle.position);
+
+    if (is_empty(bounds))
+        return bounds;
+
+    const Vec3f margin{ kSpriteRadius, kSpriteRadius, kSpriteRadius };
+    return Aabb{ bounds.min - margin, bounds.max + margin };
+}
+
 
 // OpenGL handles
 GLuint particleVAO, particleVBO = 0;
@@ -71,7 +114,7 @@ void setupParticleSystem()
     glGenVertexArrays(1, &particleVAO);
     glGenBuffers(1, &particleVBO);
 
-    glBindVertexArray(particleVAO);
+    gl_state().bind_vertex_array(particleVAO);
 
     // Allocate memory for the particle VBO
     glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
@@ -85,38 +128,40 @@ void setupParticleSystem()
     glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (void*)offsetof(Particle, size));
     glEnableVertexAttribArray(1);
 
-    glBindVertexArray(0);
+    gl_state().bind_vertex_array(0);
+}
+
+void uploadParticles(const std::vector<Particle>& particles)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, particles.size() * sizeof(Particle), particles.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void renderParticles(const std::vector<Particle>& particles, GLuint shaderProgram, GLuint texture, Mat44f viewProjection) 
+void renderParticles(std::size_t count, GLuint shaderProgram, GLuint texture, std::uint32_t viewCount, std::uint32_t viewMask, float pointScale)
 {
+    GlStateCache& gl = gl_state();
+
     // Use particle shader program
-    glUseProgram(shaderProgram);
-    glBlendFunc(GL_ONE, GL_SRC_ALPHA);
-    glDepthMask(GL_FALSE);  // Disable depth writing for transparent objects
-    glEnable(GL_PROGRAM_POINT_SIZE);  // Enable controlling point size via shaders
+    gl.use_program(shaderProgram);
+    gl.enable(GL_BLEND);
+    gl.blend_func(GL_ONE, GL_SRC_ALPHA);
+    gl.depth_func(GL_LESS);  // The opaque pass may test for equality (depth pre-pass)
+    gl.depth_mask(false);  // Disable depth writing for transparent objects
+    gl.enable(GL_PROGRAM_POINT_SIZE);  // Enable controlling point size via shaders
 
-    // Pass uniform data
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uViewProjection"), 1, GL_TRUE, viewProjection.v);
+    // Pass uniform data (the cameras are in the CameraBlock)
+    glUniform1ui(1, viewMask);
+    glUniform1f(2, pointScale);  // Point sizes are in pixels (see dynamic_resolution.hpp)
 
     // Bind texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    gl.bind_texture_2d(GL_TEXTURE0, texture);
     glUniform1i(glGetUniformLocation(shaderProgram, "uTexture"), 0);
 
-    // Update particle buffer
-    glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, particles.size() * sizeof(Particle), particles.data());
-
-    // Draw particles
-    glBindVertexArray(particleVAO);
-    glDrawArrays(GL_POINTS, 0, particles.size());
-    glBindVertexArray(0);
-
-    // Re-enable depth writing for next solid object
-    glDepthMask(GL_TRUE);   
-    // Disable point size control from shader (restore default)
-    glDisable(GL_PROGRAM_POINT_SIZE);
+    // Draw particles, one instance per view. Later passes set the depth
+    // mask and blending they need (see gl_state.hpp).
+    gl.bind_vertex_array(particleVAO);
+    glDrawArraysInstanced(GL_POINTS, 0, GLsizei(count), GLsizei(viewCount));
 }
 
 
@@ -2,12 +2,16 @@
 #define PARTICLE_HPP
 
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 #include <glad/glad.h>
 
 #include "../vmlib/vec3.hpp"
 #include "../vmlib/vec4.hpp"
 #include "../vmlib/mat44.hpp"
 
+#include "bounds.hpp"
+
 // Particle structure
 struct Particle {
     Vec3f position;   // World-space position
@@ -19,12 +23,26 @@ struct Particle {
 constexpr int MAX_PARTICLES = 1000000;
 //std::vector<Particle> particles;
 
+// Seeds the random source of emitParticle(); the same seed and the same
+// calls give the same particles.
+void seedParticles(std::uint32_t seed);
+
 void emitParticle(std::vector<Particle>& particles, const Vec4f& enginePosition, const Vec4f& engineDirection, const Mat44f& model2world);
 
 void updateParticles(float deltaTime, std::vector<Particle>& particles);
 
+// World-space bounds of all particles, including the extent of the sprites.
+Aabb particleBounds(const std::vector<Particle>& particles);
+
 void setupParticleSystem();
 
-void renderParticles(const std::vector<Particle>& particles, GLuint shaderProgram, GLuint texture, Mat44f viewProjection);
+// Copies the particles to the GPU; once per frame, before renderParticles().
+void uploadParticles(const std::vector<Particle>& particles);
+
+// Draws the uploaded particles into viewCount views at once, with the
+// cameras of the bound CameraBlock (see frame_uniforms.hpp). viewMask has a
+// bit per frame view the particles are visible in. Point sizes are scaled by
+// pointScale, the resolution scale of the target.
+void renderParticles(std::size_t count, GLuint shaderProgram, GLuint texture, std::uint32_t viewCount, std::uint32_t viewMask, float pointScale = 1.f);
 
 #endif // PARTICLE_HPP
@@ -0,0 +1,190 @@
+#include "persistent_ring.hpp"
+
+#include <algorithm>
+
+#include <cstdint>
+
+#include "../support/error.hpp"
+
+namespace
+{
+    void wait_and_delete_( GLsync& aFence )
+    {
+        if( !aFence )
+            return;
+
+        // Flush on the first attempt, so that the fence is guaranteed to
+        // signal eventually.
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for( ;; )
+        {
+            GLenum const res = glClientWaitSync( aFence, flags, 1000000 /* ns */ );
+            if( GL_ALREADY_SIGNALED == res || GL_CONDITION_SATISFIED == res )
+                break;
+            if( GL_WAIT_FAILED == res )
+                throw Error( "glClientWaitSync() failed" );
+
+            flags = 0;
+        }
+
+        glDeleteSync( aFence );
+        aFence = nullptr;
+    }
+}
+
+PersistentRing::PersistentRing( std::size_t aBytesPerFrame )
+{
+    GLint align = 0;
+    glGetIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align );
+    if( align > 0 )
+        mUniformAlignment = std::size_t(align);
+
+    glGetIntegerv( GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &align );
+    if( align > 0 )
+        mStorageAlignment = std::size_t(align);
+
+    create_( aBytesPerFrame );
+}
+
+PersistentRing::~PersistentRing()
+{
+    destroy_();
+}
+
+void PersistentRing::begin_frame( std::size_t aMinBytes )
+{
+    if( aMinBytes > mBytesPerFrame )
+    {
+        // Regions may still be in flight; wait for all of them
+        for( auto& fence : mFences )
+            wait_and_delete_( fence );
+
+        std::size_t bytes = mBytesPerFrame;
+        while( bytes < aMinBytes )
+            bytes *= 2;
+
+        destroy_();
+        create_( bytes );
+    }
+
+    mFrame = (mFrame + 1) % kFrames;
+    wait_and_delete_( mFences[mFrame] );
+
+    mUsed = 0;
+    mInFrame = true;
+}
+
+PersistentRing::Allocation PersistentRing::allocate( std::size_t aBytes, std::size_t aAlignment )
+{
+    if( !mInFrame )
+        throw Error( "PersistentRing::allocate() outside of begin_frame()/end_frame()" );
+
+    std::size_t const align = aAlignment ? aAlignment : 1;
+    std::size_t const start = (mUsed + align - 1) / align * align;
+    if( start + aBytes > mBytesPerFrame )
+        throw Error( "PersistentRing: frame region exhausted (%zu + %zu > %zu bytes)", start, aBytes, mBytesPerFrame );
+
+    mUsed = start + aBytes;
+
+    std::size_t const offset = mFrame * mBytesPerFrame + start;
+    void* data = mPersistent ? static_cast<void*>(mMapped + offset) : static_cast<void*>(mStaging.data() + start);
+
+    return { data, GLintptr(offset) };
+}
+
+void PersistentRing::flush( Allocation const& aAllocation, std::size_t aBytes )
+{
+    if( mPersistent )
+        return; // Coherent mapping
+
+    glBindBuffer( GL_COPY_WRITE_BUFFER, mBuffer );
+    glBufferSubData( GL_COPY_WRITE_BUFFER, aAllocation.offset, GLsizeiptr(aBytes), aAllocation.data );
+    glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+}
+
+void PersistentRing::end_frame()
+{
+    if( !mInFrame )
+        return;
+
+    mFences[mFrame] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+    mInFrame = false;
+}
+
+GLuint PersistentRing::buffer() const noexcept
+{
+    return mBuffer;
+}
+bool PersistentRing::persistent() const noexcept
+{
+    return mPersistent;
+}
+std::size_t PersistentRing::bytes_per_frame() const noexcept
+{
+    return mBytesPerFrame;
+}
+
+std::size_t PersistentRing::uniform_alignment() const noexcept
+{
+    return mUniformAlignment;
+}
+std::size_t PersistentRing::storage_alignment() const noexcept
+{
+    return mStorageAlignment;
+}
+
+void PersistentRing::create_( std::size_t aBytesPerFrame )
+{
+    // Keep regions aligned to the offset alignments
+    std::size_t const regionAlign = std::max( mUniformAlignment, mStorageAlignment );
+    mBytesPerFrame = (aBytesPerFrame + regionAlign - 1) / regionAlign * regionAlign;
+
+    GLsizeiptr const total = GLsizeiptr(mBytesPerFrame * kFrames);
+
+    glGenBuffers( 1, &mBuffer );
+    glBindBuffer( GL_COPY_WRITE_BUFFER, mBuffer );
+
+    mPersistent = GLAD_GL_VERSION_4_4;
+    if( mPersistent )
+    {
+        GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage( GL_COPY_WRITE_BUFFER, total, nullptr, flags );
+        mMapped = static_cast<std::byte*>(glMapBufferRange( GL_COPY_WRITE_BUFFER, 0, total, flags ));
+
+        if( !mMapped )
+            throw Error( "PersistentRing: unable to map %zu bytes persistently", std::size_t(total) );
+    }
+    else
+    {
+        glBufferData( GL_COPY_WRITE_BUFFER, total, nullptr, GL_STREAM_DRAW );
+        mStaging.resize( mBytesPerFrame );
+    }
+
+    glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+}
+
+void PersistentRing::destroy_()
+{
+    for( auto& fence : mFences )
+    {
+        if( fence )
+            glDeleteSync( fence );
+        fence = nullptr;
+    }
+
+    if( 0 != mBuffer )
+    {
+        if( mMapped )
+        {
+            glBindBuffer( GL_COPY_WRITE_BUFFER, mBuffer );
+            glUnmapBuffer( GL_COPY_WRITE_BUFFER );
+            glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+        }
+
+        glDeleteBuffers( 1, &mBuffer );
+    }
+
+    mBuffer = 0;
+    mMapped = nullptr;
+    mStaging.clear();
+}
@@ -0,0 +1,97 @@
+#ifndef PERSISTENT_RING_HPP_0C5B8E37_94A2_4F1D_B6E3_7A28D1C9F045
+#define PERSISTENT_RING_HPP_0C5B8E37_94A2_4F1D_B6E3_7A28D1C9F045
+
+#include <glad/glad.h>
+
+#include <array>
+#include <vector>
+
+#include <cstddef>
+
+// Per-frame streaming buffer
+//
+// One GL buffer split into kFrames regions. Each frame writes its dynamic
+// data (camera uniforms, object transforms, ...) into the next region and
+// binds sub-ranges of it. A fence is placed after the frame's commands; the
+// region is only rewritten once that fence has signalled, i.e., once the GPU
+// is done reading it. With three regions the CPU can run up to two frames
+// ahead without ever waiting.
+//
+// With OpenGL 4.4 (glBufferStorage) the buffer is mapped persistently and
+// coherently, so writes go straight to GPU-visible memory. Otherwise writes
+// go to a CPU copy of the region and flush() uploads them.
+//
+// Usage per frame:
+//    ring.begin_frame( bytesNeeded );
+//    auto const block = ring.allocate( sizeof(Data), uboAlignment );
+//    std::memcpy( block.data, &data, sizeof(Data) );
+//    ring.flush( block, sizeof(Data) );
+//    glBindBufferRange( GL_UNIFORM_BUFFER, binding, ring.buffer(), block.offset, sizeof(Data) );
+//    ... draw ...
+//    ring.end_frame();
+
+class PersistentRing final
+{
+    public:
+        static constexpr std::size_t kFrames = 3;
+
+        struct Allocation
+        {
+            void* data;       // Write-only; valid until end_frame()
+            GLintptr offset;  // Into buffer()
+        };
+
+    public:
+        explicit PersistentRing( std::size_t aBytesPerFrame );
+        ~PersistentRing();
+
+        PersistentRing( PersistentRing const& ) = delete;
+        PersistentRing& operator= ( PersistentRing const& ) = delete;
+
+    public:
+        // Waits until the next region is no longer in use. Grows the ring
+        // (waiting for all frames) if it cannot hold aMinBytes.
+        void begin_frame( std::size_t aMinBytes = 0 );
+
+        // Sub-allocates from the current region. Throws if the region is
+        // exhausted; size the frame in begin_frame().
+        Allocation allocate( std::size_t aBytes, std::size_t aAlignment );
+
+        // Makes the written data visible to the GPU. A no-op for the
+        // persistent mapping; uploads the range otherwise.
+        void flush( Allocation const&, std::size_t aBytes );
+
+        // Fences the current region. Call after the frame's last draw that
+        // reads from it.
+        void end_frame();
+
+        GLuint buffer() const noexcept;
+        bool persistent() const noexcept;
+        std::size_t bytes_per_frame() const noexcept;
+
+        // Offset alignments required for glBindBufferRange()
+        std::size_t uniform_alignment() const noexcept;
+        std::size_t storage_alignment() const noexcept;
+
+    private:
+        void create_( std::size_t aBytesPerFrame );
+        void destroy_();
+
+        GLuint mBuffer = 0;
+        std::size_t mBytesPerFrame = 0;
+        bool mPersistent = false;
+
+        std::size_t mUniformAlignment = 256;
+        std::size_t mStorageAlignment = 256;
+
+        std::byte* mMapped = nullptr;      // Persistent mapping of the whole buffer
+        std::vector<std::byte> mStaging;   // Fallback: CPU copy of one region
+
+        std::size_t mFrame = 0;
+        std::size_t mUsed = 0;
+        bool mInFrame = false;
+
+        std::array<GLsync, kFrames> mFences{};
+};
+
+#endif // PERSISTENT_RING_HPP_0C5B8E37_94A2_4F1D_B6E3_7A28D1C9F045
@@ -0,0 +1,190 @@
+#include "render_queue.hpp"
+
+#include <bit>
+#include <array>
+#include <utility>
+
+#include "gl_state.hpp"
+
+namespace
+{
+    constexpr std::uint32_t kDepthBits_ = 20;
+
+    // Non-negative floats order like their bit patterns. Dropping the sign
+    // bit and the low mantissa bits keeps the order (up to ties).
+    std::uint64_t quantize_depth_( float aDepth ) noexcept
+    {
+        if( !(aDepth > 0.f) )
+            return 0;
+
+        return std::bit_cast<std::uint32_t>( aDepth ) >> (31 - kDepthBits_);
+    }
+
+    std::uint64_t bits_( std::uint64_t aValue, std::uint32_t aBits ) noexcept
+    {
+        return aValue & ((std::uint64_t(1) << aBits) - 1);
+    }
+}
+
+void radix_sort( std::vector<RenderSortEntry>& aEntries, std::vector<RenderSortEntry>& aScratch )
+{
+    std::size_t const count = aEntries.size();
+    if( count < 2 )
+        return;
+
+    aScratch.resize( count );
+
+    // All eight histograms in a single pass over the keys
+    std::array<std::array<std::uint32_t, 256>, 8> histograms{};
+    for( auto const& entry : aEntries )
+    {
+        for( std::size_t digit = 0; digit < 8; ++digit )
+            ++histograms[digit][(entry.key >> (8*digit)) & 0xff];
+    }
+
+    std::vector<RenderSortEntry>* src = &aEntries;
+    std::vector<RenderSortEntry>* dst = &aScratch;
+
+    for( std::size_t digit = 0; digit < 8; ++digit )
+    {
+        auto& histogram = histograms[digit];
+
+        // Every key has the same digit: this pass would not move anything
+        if( histogram[((*src)[0].key >> (8*digit)) & 0xff] == count )
+            continue;
+
+        std::uint32_t offset = 0;
+        for( auto& bucket : histogram )
+        {
+            std::uint32_t const n = bucket;
+            bucket = offset;
+            offset += n;
+        }
+
+        for( auto const& entry : *src )
+            (*dst)[histogram[(entry.key >> (8*digit)) & 0xff]++] = entry;
+
+        std::swap( src, dst );
+    }
+
+    if( src != &aEntries )
+        aEntries.swap( aScratch );
+}
+
+std::uint64_t make_sort_key( RenderPass aPass, GLuint aProgram, std::uint16_t aMaterial, GLuint aTexture, GLuint aVao, float aViewDepth )
+{
+    std::uint64_t const pass = bits_( std::uint64_t(aPass), 4 );
+    std::uint64_t const state = (bits_( aProgram, 8 ) << 32)
+        | (bits_( aMaterial, 12 ) << 20)
+        | (bits_( aTexture, 12 ) << 8)
+        | bits_( aVao, 8 );
+    std::uint64_t const depth = quantize_depth_( aViewDepth );
+
+    if( RenderPass::transparent == aPass )
+    {
+        std::uint64_t const farFirst = bits_( ~depth, kDepthBits_ );
+        return (pass << 60) | (farFirst << 40) | state;
+    }
+
+    return (pass << 60) | (state << kDepthBits_) | depth;
+}
+
+void RenderQueue::begin( Mat44f const& aView )
+{
+    mView = aView;
+
+    mPackets.clear();
+    mCallbacks.clear();
+    mEntries.clear();
+
+    mStats = RenderQueueStats{};
+}
+
+void RenderQueue::submit( RenderPass aPass, DrawPacket const& aPacket )
+{
+    mEntries.emplace_back( RenderSortEntry{
+        make_sort_key( aPass, aPacket.program, aPacket.material, aPacket.texture, aPacket.vao, view_depth_( aPacket.position ) ),
+        std::uint32_t(mPackets.size())
+    } );
+    mPackets.emplace_back( aPacket );
+}
+
+void RenderQueue::submit( RenderPass aPass, Vec3f aWorldPosition, std::function<void()> aDraw )
+{
+    DrawPacket packet;
+    packet.range.firstIndex = GLuint(mCallbacks.size());
+    mCallbacks.emplace_back( std::move(aDraw) );
+
+    mEntries.emplace_back( RenderSortEntry{
+        make_sort_key( aPass, 0, 0, 0, 0, view_depth_( aWorldPosition ) ),
+        std::uint32_t(mPackets.size())
+    } );
+    mPackets.emplace_back( packet );
+}
+
+void RenderQueue::execute()
+{
+    radix_sort( mEntries, mScratch );
+
+    GlStateCache& gl = gl_state();
+
+    mStats.packets = mEntries.size();
+
+    for( auto const& entry : mEntries )
+    {
+        DrawPacket const& packet = mPackets[entry.index];
+
+        // Callbacks change state through the cache as well, so packets after
+        // them still skip what the callback left in place
+        if( 0 == packet.program )
+        {
+            mCallbacks[packet.range.firstIndex]();
+            continue;
+        }
+
+        if( gl.use_program( packet.program ) )
+            ++mStats.programBinds;
+        else
+            ++mStats.skippedStateChanges;
+
+        if( gl.bind_vertex_array( packet.vao ) )
+            ++mStats.vaoBinds;
+        else
+            ++mStats.skippedStateChanges;
+
+        if( gl.bind_texture_2d( GL_TEXTURE0, packet.texture ) )
+            ++mStats.textureBinds;
+        else
+            ++mStats.skippedStateChanges;
+
+        // Transform and material are in the object block; the base instance
+        // selects the object
+        glDrawElementsInstancedBaseVertexBaseInstance(
+            GL_TRIANGLES,
+            packet.range.indexCount,
+            GL_UNSIGNED_INT,
+            reinterpret_cast<void const*>(packet.range.firstIndex * sizeof(std::uint32_t)),
+            GLsizei(packet.instanceCount),
+            packet.range.baseVertex,
+            packet.object
+        );
+        ++mStats.draws;
+    }
+}
+
+RenderQueueStats const& RenderQueue::stats() const noexcept
+{
+    return mStats;
+}
+
+std::vector<RenderSortEntry> const& RenderQueue::sorted() const noexcept
+{
+    return mEntries;
+}
+
+float RenderQueue::view_depth_( Vec3f aWorldPosition ) const noexcept
+{
+    // Distance along the view direction (the camera looks down -z)
+    Vec4f const p = mView * Vec4f{ aWorldPosition.x, aWorldPosition.y, aWorldPosition.z, 1.f };
+    return -p.z;
+}
@@ -0,0 +1,119 @@
+#ifndef RENDER_QUEUE_HPP_47C2E9A1_5B3F_4D86_8E10_D9A36F7B2C54
+#define RENDER_QUEUE_HPP_47C2E9A1_5B3F_4D86_8E10_D9A36F7B2C54
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <functional>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "geometry_arena.hpp"
+#include "frame_uniforms.hpp"
+
+#include "../vmlib/vec2.hpp"
+#include "../vmlib/vec3.hpp"
+#include "../vmlib/mat44.hpp"
+
+// Sorted render queue
+//
+// Objects submit draw packets for one view; the queue assigns each packet a
+// 64 bit sort key, sorts the keys with a radix sort and issues the draws in
+// key order. While executing, GL state (program, VAO, texture) is only
+// changed when it differs from the current state (see gl_state.hpp).
+// Transforms and material parameters are per-object data (see
+// frame_uniforms.hpp); a packet only names its object, which is passed as the
+// draw's base instance.
+//
+// Key layout, most significant bits first:
+//   opaque:       pass:4 | program:8 | material:12 | texture:12 | vao:8 | depth:20
+//   transparent:  pass:4 | ~depth:20 | program:8 | material:12 | texture:12 | vao:8
+//
+// Opaque packets are grouped by state and then drawn front to back; transparent
+// ones are drawn back to front. The program, texture and VAO fields hold the
+// low bits of the GL object names: a collision only makes the grouping less
+// perfect, since redundant-state elimination compares the full values.
+//
+// The queue keeps its storage between frames, so submitting and sorting does
+// not allocate in the steady state.
+
+enum class RenderPass : std::uint8_t
+{
+    opaque = 0,
+    transparent = 1
+};
+
+struct DrawPacket
+{
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint texture = 0;
+    std::uint16_t material = 0;       // DrawMaterial::id; for sorting only
+    MeshRange range;
+    std::uint32_t object = 0;         // Index into ObjectBlock
+    std::uint32_t instanceCount = 1;  // Objects object .. object+instanceCount-1
+    Vec3f position{ 0.f, 0.f, 0.f };  // World space; for depth sorting
+};
+
+struct RenderQueueStats
+{
+    std::size_t packets = 0;
+    std::size_t draws = 0;
+    std::size_t programBinds = 0;
+    std::size_t vaoBinds = 0;
+    std::size_t textureBinds = 0;
+    std::size_t skippedStateChanges = 0;
+};
+
+// Sort entry: key plus the index of the packet it refers to.
+struct RenderSortEntry
+{
+    std::uint64_t key;
+    std::uint32_t index;
+};
+
+// Stable LSD radix sort on the 64 bit keys (8 bit digits). Digits that are
+// equal in all keys are skipped. aScratch is resized as needed.
+void radix_sort( std::vector<RenderSortEntry>& aEntries, std::vector<RenderSortEntry>& aScratch );
+
+std::uint64_t make_sort_key( RenderPass, GLuint aProgram, std::uint16_t aMaterial, GLuint aTexture, GLuint aVao, float aViewDepth );
+
+class RenderQueue final
+{
+    public:
+        // Starts a new view. Drops all packets from the previous one.
+        void begin( Mat44f const& aView );
+
+        void submit( RenderPass, DrawPacket const& );
+
+        // Custom draw code (e.g., particles), sorted by the given world-space
+        // position. The GL state the queue tracks is assumed to be modified.
+        void submit( RenderPass, Vec3f aWorldPosition, std::function<void()> aDraw );
+
+        // Sorts and issues all packets. The camera and object blocks must be
+        // bound (see frame_uniforms.hpp).
+        void execute();
+
+        RenderQueueStats const& stats() const noexcept;
+
+        // Packets in execution order; valid after execute()
+        std::vector<RenderSortEntry> const& sorted() const noexcept;
+
+    private:
+        float view_depth_( Vec3f aWorldPosition ) const noexcept;
+
+        Mat44f mView = kIdentity44f;
+
+        // Custom draws are stored separately; their packet has program == 0
+        // and the callback index in range.firstIndex.
+        std::vector<DrawPacket> mPackets;
+        std::vector<std::function<void()>> mCallbacks;
+
+        std::vector<RenderSortEntry> mEntries;
+        std::vector<RenderSortEntry> mScratch;
+
+        RenderQueueStats mStats;
+};
+
+#endif // RENDER_QUEUE_HPP_47C2E9A1_5B3F_4D86_8E10_D9A36F7B2C54
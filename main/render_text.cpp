@@ -10,6 +10,8 @@
 
 #include "../vmlib/mat44.hpp"
 
+#include "gl_state.hpp"
+
 struct GLFONScontext {
 	GLuint tex;
 	GLuint vao, vboVerts, vboTexCoords, vboColors, shaderProgram;
@@ -23,13 +25,14 @@ int glfons__renderCreate(void* userPtr, int width, int height)
 	// Create may be called multiple times, delete existing texture.
 	if (gl->tex != 0) {
 		glDeleteTextures(1, &gl->tex);
+		gl_state().forget_texture(gl->tex);
 		gl->tex = 0;
 	}
 	gl->width = width;
 	gl->height = height;
 
 	glGenTextures(1, &gl->tex);
-	glBindTexture(GL_TEXTURE_2D, gl->tex);
+	gl_state().bind_texture(GL_TEXTURE_2D, gl->tex);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -51,7 +54,7 @@ static void glfons__renderUpdate(void* userPtr, int* rect, const unsigned char*
 	int h = rect[3] - rect[1];
 
 	if (gl->tex == 0) return;
-	glBindTexture(GL_TEXTURE_2D, gl->tex);
+	gl_state().bind_texture(GL_TEXTURE_2D, gl->tex);
 	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 	glPixelStorei(GL_UNPACK_ROW_LENGTH, gl->width);
 	glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect[0]);
@@ -72,11 +75,13 @@ static void glfons__renderDraw(void* userPtr, const float* verts, const float* t
 
 	if (gl->tex == 0) return;
 
+	GlStateCache& state = gl_state();
+
 	// Bind texture
-	glBindTexture(GL_TEXTURE_2D, gl->tex);
+	state.bind_texture_2d(GL_TEXTURE0, gl->tex);
 
 	// Bind VAO
-	glBindVertexArray(gl->vao);
+	state.bind_vertex_array(gl->vao);
 
 	// Upload vertex positions
 	glBindBuffer(GL_ARRAY_BUFFER, gl->vboVerts);
@@ -97,11 +102,12 @@ static void glfons__renderDraw(void* userPtr, const float* verts, const float* t
 	glEnableVertexAttribArray(2);
 
 	// Use the shader program
-	glUseProgram(gl->shaderProgram);
+	state.use_program(gl->shaderProgram);
 
-	glDisable(GL_DEPTH_TEST);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	state.disable(GL_DEPTH_TEST);
+	state.disable(GL_CULL_FACE);	// The y-flipping projection reverses glyph winding
+	state.enable(GL_BLEND);
+	state.blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// Compute and load ortho projection matrix
 	float projMatrix[16] = {
@@ -119,13 +125,7 @@ static void glfons__renderDraw(void* userPtr, const float* verts, const float* t
 	// Draw triangles
 	glDrawArrays(GL_TRIANGLES, 0, nverts);
 
-	// Restore OpenGL state
-	glEnable(GL_DEPTH_TEST);
-	glDepthMask(GL_TRUE);
-	glDisable(GL_BLEND);
-
-	// Unbind everything (optional, for cleanliness)
-	glBindVertexArray(0);
+	// No state is restored; the next pass sets what it needs (see gl_state.hpp)
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
@@ -137,12 +137,14 @@ static void glfons__renderDelete(void* userPtr)
 	// Delete texture if it exists
 	if (gl->tex != 0) {
 		glDeleteTextures(1, &gl->tex);
+		gl_state().forget_texture(gl->tex);
 		gl->tex = 0;
 	}
 
 	// Delete VAO if it exists
 	if (gl->vao != 0) {
 		glDeleteVertexArrays(1, &gl->vao);
+		gl_state().forget_vertex_array(gl->vao);
 		gl->vao = 0;
 	}
 
@@ -0,0 +1,108 @@
+#include "run_options.hpp"
+
+#include <charconv>
+#include <string_view>
+
+#include "../support/error.hpp"
+
+namespace
+{
+    template< typename tValue >
+    bool parse_number_( std::string_view aText, tValue& aValue )
+    {
+        auto const* end = aText.data() + aText.size();
+        auto const [ptr, ec] = std::from_chars( aText.data(), end, aValue );
+        return std::errc{} == ec && end == ptr;
+    }
+
+    // "--name=value": the value, if aArg is option aName
+    bool option_value_( std::string_view aArg, std::string_view aName, std::string_view& aValue )
+    {
+        if( !aArg.starts_with( aName ) || aArg.size() == aName.size() || '=' != aArg[aName.size()] )
+            return false;
+
+        aValue = aArg.substr( aName.size() + 1 );
+        return true;
+    }
+}
+
+RunOptions parse_run_options( int aArgc, char const* const* aArgv )
+{
+    RunOptions options;
+    bool framesGiven = false;
+
+    for( int i = 1; i < aArgc; ++i )
+    {
+        std::string_view const arg = aArgv[i];
+        std::string_view value;
+
+        if( "--headless" == arg )
+            options.headless = true;
+        else if( "--help" == arg || "-h" == arg )
+            options.help = true;
+        else if( option_value_( arg, "--context", value ) )
+        {
+            if( "egl" == value )
+                options.context = HeadlessContext::egl;
+            else if( "osmesa" == value )
+                options.context = HeadlessContext::osmesa;
+            else
+                throw Error( "Unknown context API '%.*s' (egl or osmesa)", int(value.size()), value.data() );
+        }
+        else if( option_value_( arg, "--size", value ) )
+        {
+            auto const x = value.find( 'x' );
+            if( std::string_view::npos == x
+                || !parse_number_( value.substr( 0, x ), options.width )
+                || !parse_number_( value.substr( x+1 ), options.height )
+                || options.width <= 0 || options.height <= 0 )
+            {
+                throw Error( "Invalid size '%.*s' (WIDTHxHEIGHT)", int(value.size()), value.data() );
+            }
+        }
+        else if( option_value_( arg, "--frames", value ) )
+        {
+            if( !parse_number_( value, options.frames ) || 0 == options.frames )
+                throw Error( "Invalid frame count '%.*s'", int(value.size()), value.data() );
+
+            framesGiven = true;
+        }
+        else if( option_value_( arg, "--record", value ) && !value.empty() )
+            options.record = value;
+        else if( option_value_( arg, "--replay", value ) && !value.empty() )
+            options.replay = value;
+        else if( option_value_( arg, "--seed", value ) )
+        {
+            std::uint32_t seed;
+            if( !parse_number_( value, seed ) )
+                throw Error( "Invalid seed '%.*s'", int(value.size()), value.data() );
+
+            options.seed = seed;
+        }
+        else
+            throw Error( "Unknown option '%s'\n%s", aArgv[i], run_options_usage() );
+    }
+
+    if( !options.record.empty() && !options.replay.empty() )
+        throw Error( "--record and --replay are exclusive" );
+
+    // Benchmarks must end
+    if( options.headless && !framesGiven )
+        options.frames = kDefaultHeadlessFrames;
+
+    return options;
+}
+
+char const* run_options_usage() noexcept
+{
+    return
+        "Options:\n"
+        "  --headless             Render offscreen, without a window or display\n"
+        "  --context=egl|osmesa   Context API of the headless mode (default: egl)\n"
+        "  --size=WxH             Framebuffer size (default: 1280x720)\n"
+        "  --frames=N             Exit after N frames (headless default: 600)\n"
+        "  --record=PATH          Record the input to PATH\n"
+        "  --replay=PATH          Replay the input recorded in PATH\n"
+        "  --seed=N               Seed of the particles (default: random)\n"
+        "  --help                 Print this and exit\n";
+}
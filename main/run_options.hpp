@@ -0,0 +1,55 @@
+#ifndef RUN_OPTIONS_HPP_7A41C3E9_2D58_4F0B_8E6A_B3C95D1E2F07
+#define RUN_OPTIONS_HPP_7A41C3E9_2D58_4F0B_8E6A_B3C95D1E2F07
+
+#include <string>
+#include <optional>
+
+#include <cstddef>
+#include <cstdint>
+
+// Command line options
+//
+//    --headless             No window: render offscreen, through GLFW's null
+//                           platform (no display needed)
+//    --context=egl|osmesa   Context API of the headless mode (default: egl;
+//                           e.g., Mesa llvmpipe for either)
+//    --size=WxH             Framebuffer size (default: 1280x720)
+//    --frames=N             Exit after N frames (default: until closed, or
+//                           kDefaultHeadlessFrames when headless)
+//    --record=PATH          Record the input to PATH (see input_log.hpp)
+//    --replay=PATH          Replay the input recorded in PATH, ignoring the
+//                           user's (except Escape)
+//    --seed=N               Seed of the particles' random numbers (default:
+//                           random; replays use the recorded seed)
+//    --help                 Print the options and exit
+//
+// Invalid options throw Error.
+
+enum class HeadlessContext
+{
+    egl,
+    osmesa
+};
+
+constexpr std::size_t kDefaultHeadlessFrames = 600;
+
+struct RunOptions
+{
+    bool headless = false;
+    HeadlessContext context = HeadlessContext::egl;
+
+    int width = 1280, height = 720;
+
+    std::size_t frames = 0; // 0: no limit
+
+    std::string record, replay; // Empty: none
+    std::optional<std::uint32_t> seed;
+
+    bool help = false;
+};
+
+RunOptions parse_run_options( int aArgc, char const* const* aArgv );
+
+char const* run_options_usage() noexcept;
+
+#endif // RUN_OPTIONS_HPP_7A41C3E9_2D58_4F0B_8E6A_B3C95D1E2F07
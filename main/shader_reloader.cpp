@@ -0,0 +1,296 @@
+#include "shader_reloader.hpp"
+
+#include <algorithm>
+#include <exception>
+
+#include <cstdio>
+
+#if defined(__linux__)
+#   include <unistd.h>
+#   include <sys/inotify.h>
+#endif
+
+#include "../support/error.hpp"
+
+#include "gl_state.hpp"
+
+namespace
+{
+    bool uses_file_( std::vector<ShaderProgram::ShaderSource> const& aSources, std::string const& aName )
+    {
+        return std::any_of( aSources.begin(), aSources.end(), [&] ( auto const& aSource ) {
+            return std::filesystem::path( aSource.sourcePath ).filename() == aName;
+        } );
+    }
+}
+
+#if defined(__linux__)
+DirectoryWatcher::DirectoryWatcher( std::filesystem::path aDirectory )
+    : mDirectory( std::move(aDirectory) )
+{
+    mFd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( mFd < 0 )
+        throw Error( "inotify_init1() failed" );
+
+    if( inotify_add_watch( mFd, mDirectory.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO ) < 0 )
+    {
+        close( mFd );
+        throw Error( "Unable to watch '%s'", mDirectory.string().c_str() );
+    }
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    if( mFd >= 0 )
+        close( mFd );
+}
+
+std::vector<std::string> DirectoryWatcher::poll()
+{
+    std::vector<std::string> ret;
+
+    alignas(inotify_event) char buffer[4096];
+    for( ;; )
+    {
+        ssize_t const bytes = read( mFd, buffer, sizeof(buffer) );
+        if( bytes <= 0 )
+            break;  // EAGAIN: no more events
+
+        for( ssize_t offset = 0; offset < bytes; )
+        {
+            auto const* event = reinterpret_cast<inotify_event const*>(buffer + offset);
+            if( event->len > 0 )
+            {
+                std::string name( event->name );
+                if( std::find( ret.begin(), ret.end(), name ) == ret.end() )
+                    ret.emplace_back( std::move(name) );
+            }
+
+            offset += ssize_t(sizeof(inotify_event) + event->len);
+        }
+    }
+
+    return ret;
+}
+#else // !__linux__
+DirectoryWatcher::DirectoryWatcher( std::filesystem::path aDirectory )
+    : mDirectory( std::move(aDirectory) )
+{
+    poll();
+}
+
+DirectoryWatcher::~DirectoryWatcher() = default;
+
+std::vector<std::string> DirectoryWatcher::poll()
+{
+    std::vector<std::string> ret;
+
+    std::error_code ec;
+    for( auto const& entry : std::filesystem::directory_iterator( mDirectory, ec ) )
+    {
+        auto const time = entry.last_write_time( ec );
+        if( ec )
+            continue;
+
+        std::string name = entry.path().filename().string();
+        auto const known = std::find_if( mTimes.begin(), mTimes.end(), [&] ( auto const& aTime ) {
+            return aTime.first == name;
+        } );
+
+        if( mTimes.end() == known )
+            mTimes.emplace_back( std::move(name), time );
+        else if( known->second != time )
+        {
+            known->second = time;
+            ret.emplace_back( std::move(name) );
+        }
+    }
+
+    return ret;
+}
+#endif // ~ __linux__
+
+ShaderReloader::ShaderReloader( GLFWwindow* aShareWith, std::filesystem::path aDirectory, ProgramBinaryCache* aCache )
+    : mContext( nullptr )
+    , mDirectory( std::move(aDirectory) )
+    , mCache( aCache )
+    , mWatcher( mDirectory )
+{
+    // Same hints as the main window (still set), but hidden
+    glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+    mContext = glfwCreateWindow( 1, 1, "shader compiler", nullptr, aShareWith );
+    glfwWindowHint( GLFW_VISIBLE, GLFW_TRUE );
+
+    if( !mContext )
+    {
+        char const* msg = nullptr;
+        int ecode = glfwGetError( &msg );
+        throw Error( "glfwCreateWindow() failed for the shader compiler context with '%s' (%d)", msg, ecode );
+    }
+
+    mThread = std::thread( [this] { worker_(); } );
+}
+
+ShaderReloader::~ShaderReloader()
+{
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        mStop = true;
+    }
+    mWake.notify_all();
+    mThread.join();
+
+    // Programs that were never installed; objects are shared, so they can
+    // be deleted from the main context
+    for( auto& result : mResults )
+        glDeleteSync( result.fence );
+    mResults.clear();
+
+    glfwDestroyWindow( mContext );
+}
+
+void ShaderReloader::watch( ShaderProgram& aProgram )
+{
+    mTargets.emplace_back( Target_{ &aProgram, nullptr } );
+}
+void ShaderReloader::watch( ShaderPermutations& aPermutations )
+{
+    mTargets.emplace_back( Target_{ nullptr, &aPermutations } );
+}
+
+void ShaderReloader::reload_all()
+{
+    for( std::size_t i = 0; i < mTargets.size(); ++i )
+        queue_( i );
+}
+
+std::size_t ShaderReloader::update()
+{
+    for( auto const& name : mWatcher.poll() )
+    {
+        for( std::size_t i = 0; i < mTargets.size(); ++i )
+        {
+            auto const& target = mTargets[i];
+            auto const& sources = target.program ? target.program->sources() : target.permutations->sources();
+
+            if( uses_file_( sources, name ) )
+                queue_( i );
+        }
+    }
+
+    // Take the programs whose link has completed; never wait for the others
+    std::vector<Result_> ready;
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        for( auto it = mResults.begin(); it != mResults.end(); )
+        {
+            GLenum const status = glClientWaitSync( it->fence, 0, 0 );
+            if( GL_TIMEOUT_EXPIRED == status )
+            {
+                ++it;
+                continue;
+            }
+
+            glDeleteSync( it->fence );
+            if( GL_WAIT_FAILED != status )
+                ready.emplace_back( std::move(*it) );
+
+            it = mResults.erase( it );
+        }
+    }
+
+    // Install in the order the programs finished, so the latest wins
+    for( auto& result : ready )
+    {
+        auto const& target = mTargets[result.target];
+        ShaderProgram& current = target.program ? *target.program : target.permutations->get( result.defines );
+
+        // The old program is deleted with the result; the cache must not
+        // assume that its name is still bound
+        gl_state().forget_program( current.programId() );
+        current = std::move(result.program);
+    }
+
+    if( !ready.empty() )
+        std::fprintf( stderr, "Shaders reloaded: %zu program(s).\n", ready.size() );
+
+    return ready.size();
+}
+
+std::size_t ShaderReloader::pending() const
+{
+    std::lock_guard<std::mutex> lock( mMutex );
+    return mJobs.size() + mBusy + mResults.size();
+}
+
+void ShaderReloader::queue_( std::size_t aTarget )
+{
+    auto const& target = mTargets[aTarget];
+
+    std::vector<Job_> jobs;
+    if( target.program )
+        jobs.emplace_back( Job_{ aTarget, target.program->defines(), target.program->sources() } );
+    else
+    {
+        for( auto& defines : target.permutations->variants() )
+            jobs.emplace_back( Job_{ aTarget, std::move(defines), target.permutations->sources() } );
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( mMutex );
+        for( auto& job : jobs )
+        {
+            // Editors may write a file several times; compile it once
+            auto const queued = std::find_if( mJobs.begin(), mJobs.end(), [&] ( Job_ const& aJob ) {
+                return aJob.target == job.target && aJob.defines == job.defines;
+            } );
+
+            if( mJobs.end() == queued )
+                mJobs.emplace_back( std::move(job) );
+        }
+    }
+    mWake.notify_one();
+}
+
+void ShaderReloader::worker_()
+{
+    glfwMakeContextCurrent( mContext );
+
+    for( ;; )
+    {
+        Job_ job;
+        {
+            std::unique_lock<std::mutex> lock( mMutex );
+            mWake.wait( lock, [this] { return mStop || !mJobs.empty(); } );
+            if( mStop )
+                break;
+
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+            ++mBusy;
+        }
+
+        try
+        {
+            ShaderProgram program( job.sources, job.defines, mCache );
+
+            // The main thread installs the program once the fence signals,
+            // i.e., once the link has completed on the GPU side as well
+            GLsync const fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+            glFlush();
+
+            std::lock_guard<std::mutex> lock( mMutex );
+            mResults.emplace_back( Result_{ job.target, std::move(job.defines), std::move(program), fence } );
+            --mBusy;
+        }
+        catch( std::exception const& eErr )
+        {
+            std::fprintf( stderr, "Error when reloading shader:\n%s\nKeeping old shader.\n", eErr.what() );
+
+            std::lock_guard<std::mutex> lock( mMutex );
+            --mBusy;
+        }
+    }
+
+    glfwMakeContextCurrent( nullptr );
+}
@@ -0,0 +1,132 @@
+#ifndef SHADER_RELOADER_HPP_8A78DF1B_07DD_483F_BFF3_93EDC57C79E0
+#define SHADER_RELOADER_HPP_8A78DF1B_07DD_483F_BFF3_93EDC57C79E0
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <condition_variable>
+
+#include <cstddef>
+
+#include "../support/program.hpp"
+#include "../support/program_cache.hpp"
+
+// Reports the files of a directory that were written since the last poll()
+//
+// Uses inotify on Linux (a close after writing, or a rename into the
+// directory, as editors do when saving). Elsewhere, the modification times
+// of the directory's files are compared on each poll().
+class DirectoryWatcher final
+{
+    public:
+        explicit DirectoryWatcher( std::filesystem::path aDirectory );
+        ~DirectoryWatcher();
+
+        DirectoryWatcher( DirectoryWatcher const& ) = delete;
+        DirectoryWatcher& operator= ( DirectoryWatcher const& ) = delete;
+
+    public:
+        // Names (relative to the directory) of the changed files. Never
+        // blocks.
+        std::vector<std::string> poll();
+
+    private:
+        std::filesystem::path mDirectory;
+
+#       if defined(__linux__)
+        int mFd = -1;
+#       else
+        std::vector<std::pair<std::string, std::filesystem::file_time_type>> mTimes;
+#       endif
+};
+
+// Background shader hot-reload
+//
+// Watches the directory of the shader sources. When a source changes, the
+// programs that use it are queued for recompilation on a worker thread. The
+// worker owns a hidden GLFW context that shares objects with the main
+// context, so compiling and linking never stall the frame. A fence follows
+// each link; update() installs a program once its fence has signalled, by
+// swapping it with the one in use. Programs that fail to compile or link
+// are reported and dropped; the old program stays in use.
+//
+// A shared context works on every driver, unlike GL_KHR_parallel_shader_compile
+// (which also still needs a synchronous link call on the main thread).
+//
+// The watched programs must outlive the reloader. Apart from the worker,
+// the reloader is used by one thread at a time, on which the context it
+// shares with must be current: the constructor and watch() run on the main
+// thread before rendering starts; update(), reload_all() and pending() on the
+// thread that renders (see main.cpp), and the destructor on the main thread
+// again, once that has finished.
+class ShaderReloader final
+{
+    public:
+        ShaderReloader( GLFWwindow* aShareWith, std::filesystem::path aDirectory, ProgramBinaryCache* = nullptr );
+        ~ShaderReloader();
+
+        ShaderReloader( ShaderReloader const& ) = delete;
+        ShaderReloader& operator= ( ShaderReloader const& ) = delete;
+
+    public:
+        void watch( ShaderProgram& );
+        void watch( ShaderPermutations& );
+
+        // Queues all watched programs, regardless of changes
+        void reload_all();
+
+        // Once per frame: queues the programs of changed files and installs
+        // the programs that finished. Returns the number installed.
+        std::size_t update();
+
+        std::size_t pending() const;
+
+    private:
+        struct Target_
+        {
+            ShaderProgram* program;           // Or:
+            ShaderPermutations* permutations;
+        };
+
+        struct Job_
+        {
+            std::size_t target;
+            ShaderDefines defines;
+            std::vector<ShaderProgram::ShaderSource> sources;
+        };
+
+        struct Result_
+        {
+            std::size_t target;
+            ShaderDefines defines;
+            ShaderProgram program;
+            GLsync fence;
+        };
+
+        void queue_( std::size_t aTarget );
+        void worker_();
+
+        GLFWwindow* mContext;
+        std::filesystem::path mDirectory;
+        ProgramBinaryCache* mCache;
+
+        DirectoryWatcher mWatcher;
+        std::vector<Target_> mTargets;
+
+        mutable std::mutex mMutex;
+        std::condition_variable mWake;
+        std::deque<Job_> mJobs;
+        std::vector<Result_> mResults;
+        std::size_t mBusy = 0;
+        bool mStop = false;
+
+        std::thread mThread;
+};
+
+#endif // SHADER_RELOADER_HPP_8A78DF1B_07DD_483F_BFF3_93EDC57C79E0
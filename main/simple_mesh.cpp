@@ -1,6 +1,85 @@
 #include "simple_mesh.hpp"
 
+#include <array>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+
+#include <cstring>
+
+#include "../support/hash.hpp"
+
+#include "gl_state.hpp"
+
+namespace
+{
+    // All per-vertex attributes of one vertex, used to find duplicates.
+    struct VertexKey_
+    {
+        std::array<float, 24> v;
+
+        bool operator==( VertexKey_ const& aOther ) const noexcept
+        {
+            return 0 == std::memcmp( v.data(), aOther.v.data(), sizeof(v) );
+        }
+    };
+
+    struct VertexKeyHash_
+    {
+        std::size_t operator()( VertexKey_ const& aKey ) const noexcept
+        {
+            return std::size_t(fnv1a_values( kFnv1aBasis, aKey.v ));
+        }
+    };
+
+    template< typename tType >
+    void push_attrib_( float*& aOut, std::vector<tType> const& aStream, std::size_t aIndex, std::size_t aVertexCount )
+    {
+        constexpr std::size_t kFloats = sizeof(tType) / sizeof(float);
+        if( aStream.size() == aVertexCount )
+            std::memcpy( aOut, &aStream[aIndex], sizeof(tType) );
+        aOut += kFloats;
+    }
+
+    template< typename tType >
+    void gather_( std::vector<tType>& aStream, std::vector<std::uint32_t> const& aRemap, std::size_t aVertexCount )
+    {
+        // Streams that are not per-vertex (e.g. missing texcoords) are left alone
+        if( aStream.size() != aVertexCount )
+            return;
+
+        std::vector<tType> out;
+        out.reserve( aRemap.size() );
+        for( auto const idx : aRemap )
+            out.emplace_back( aStream[idx] );
+
+        aStream = std::move(out);
+    }
+
+    void append_indices_( std::vector<std::uint32_t>& aOut, SimpleMeshData const& aMesh, std::uint32_t aBase )
+    {
+        if( aMesh.indices.empty() )
+        {
+            for( std::size_t i = 0; i < aMesh.positions.size(); ++i )
+                aOut.emplace_back( aBase + std::uint32_t(i) );
+        }
+        else
+        {
+            for( auto const idx : aMesh.indices )
+                aOut.emplace_back( aBase + idx );
+        }
+    }
+}
+
 SimpleMeshData concatenate(SimpleMeshData aM, const SimpleMeshData& aN) {
+    // Concatenate indices (only needed if either side is indexed)
+    if (!aM.indices.empty() || !aN.indices.empty()) {
+        std::vector<std::uint32_t> indices;
+        append_indices_(indices, aM, 0);
+        append_indices_(indices, aN, std::uint32_t(aM.positions.size()));
+        aM.indices = std::move(indices);
+    }
+
     // Concatenate vertex positions
     aM.positions.insert(aM.positions.end(), aN.positions.begin(), aN.positions.end());
 
@@ -33,6 +112,71 @@ SimpleMeshData concatenate(SimpleMeshData aM, const SimpleMeshData& aN) {
 
 
 
+SimpleMeshData make_indexed(SimpleMeshData aMesh)
+{
+    if (!aMesh.indices.empty())
+        return aMesh;
+
+    std::size_t const vertexCount = aMesh.positions.size();
+
+    std::unordered_map<VertexKey_, std::uint32_t, VertexKeyHash_> unique;
+    unique.reserve(vertexCount);
+
+    std::vector<std::uint32_t> remap;      // new vertex -> old vertex
+    std::vector<std::uint32_t> indices;    // triangle corners -> new vertex
+    indices.reserve(vertexCount);
+
+    for (std::size_t i = 0; i < vertexCount; ++i)
+    {
+        VertexKey_ key{};
+        float* out = key.v.data();
+        push_attrib_(out, aMesh.positions, i, vertexCount);
+        push_attrib_(out, aMesh.normals, i, vertexCount);
+        push_attrib_(out, aMesh.colors, i, vertexCount);
+        push_attrib_(out, aMesh.texcoords, i, vertexCount);
+        push_attrib_(out, aMesh.Ka, i, vertexCount);
+        push_attrib_(out, aMesh.Kd, i, vertexCount);
+        push_attrib_(out, aMesh.Ks, i, vertexCount);
+        push_attrib_(out, aMesh.Ns, i, vertexCount);
+        push_attrib_(out, aMesh.Ke, i, vertexCount);
+
+        auto const [it, inserted] = unique.emplace(key, std::uint32_t(remap.size()));
+        if (inserted)
+            remap.emplace_back(std::uint32_t(i));
+
+        indices.emplace_back(it->second);
+    }
+
+    gather_(aMesh.positions, remap, vertexCount);
+    gather_(aMesh.normals, remap, vertexCount);
+    gather_(aMesh.colors, remap, vertexCount);
+    gather_(aMesh.texcoords, remap, vertexCount);
+    gather_(aMesh.Ka, remap, vertexCount);
+    gather_(aMesh.Kd, remap, vertexCount);
+    gather_(aMesh.Ks, remap, vertexCount);
+    gather_(aMesh.Ns, remap, vertexCount);
+    gather_(aMesh.Ke, remap, vertexCount);
+
+    aMesh.indices = std::move(indices);
+    return aMesh;
+}
+
+bool is_degenerate_triangle(Vec3f aA, Vec3f aB, Vec3f aC)
+{
+    Vec3f const ab = aB - aA, bc = aC - aB, ca = aA - aC;
+    float const longestSq = std::max({ dot(ab, ab), dot(bc, bc), dot(ca, ca) });
+    float const twiceArea = length(cross(ab, -ca));
+
+    // Also catches NaNs, which compare false
+    return !(twiceArea > 1e-5f * longestSq);
+}
+
+std::size_t draw_count(SimpleMeshData const& aMesh)
+{
+    return aMesh.indices.empty() ? aMesh.positions.size() : aMesh.indices.size();
+}
+
+
 GLuint create_vao(SimpleMeshData const& aMeshData)
 {
     GLuint positionVBO = 0;
@@ -84,7 +228,7 @@ GLuint create_vao(SimpleMeshData const& aMeshData)
     // Create VAO
     GLuint vao = 0;
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    gl_state().bind_vertex_array(vao);
 
     // Position
     glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
@@ -109,31 +253,40 @@ GLuint create_vao(SimpleMeshData const& aMeshData)
     // Ka (Ambience reflectivity)
     glBindBuffer(GL_ARRAY_BUFFER, KaVBO);
     glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(5);
+    glEnableVertexAttribArray(4);
 
     // Kd (Diffuse reflectivity)
     glBindBuffer(GL_ARRAY_BUFFER, KdVBO);
     glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(4);
+    glEnableVertexAttribArray(5);
 
     // Ks (Specular reflectivity)
     glBindBuffer(GL_ARRAY_BUFFER, KsVBO);
     glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(5);
+    glEnableVertexAttribArray(6);
 
     // Ns (Shininess)
     glBindBuffer(GL_ARRAY_BUFFER, NsVBO);
     glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(6);
+    glEnableVertexAttribArray(7);
 
     // Ke (Emission)
     glBindBuffer(GL_ARRAY_BUFFER, KeVBO);
     glVertexAttribPointer(8, 3, GL_FLOAT, GL_FALSE, 0, 0);
-    glEnableVertexAttribArray(7);
+    glEnableVertexAttribArray(8);
+
+    // Index buffer (recorded in the VAO state)
+    GLuint indexEBO = 0;
+    if (!aMeshData.indices.empty()) {
+        glGenBuffers(1, &indexEBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, aMeshData.indices.size() * sizeof(std::uint32_t), aMeshData.indices.data(), GL_STATIC_DRAW);
+    }
 
     // Reset state
-    glBindVertexArray(0);
+    gl_state().bind_vertex_array(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
     // Clean up buffers
     glDeleteBuffers(1, &colorVBO);
@@ -145,6 +298,8 @@ GLuint create_vao(SimpleMeshData const& aMeshData)
     glDeleteBuffers(1, &KsVBO);
     glDeleteBuffers(1, &NsVBO);
     glDeleteBuffers(1, &KeVBO);
+    if (indexEBO)
+        glDeleteBuffers(1, &indexEBO);
 
     return vao;
 }
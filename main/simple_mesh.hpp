@@ -5,6 +5,8 @@
 
 #include <vector>
 
+#include <cstdint>
+
 #include "../vmlib/vec4.hpp"
 #include "../vmlib/vec3.hpp"
 #include "../vmlib/vec2.hpp"
@@ -19,6 +21,7 @@ struct SimpleMeshData {
     std::vector<Vec3f> Ks;         // Specular reflectivity
     std::vector<float> Ns;         // Shininess
     std::vector<Vec3f> Ke;         // Emission
+    std::vector<std::uint32_t> indices; // Optional; empty means every 3 vertices form a triangle
     Vec2f mins;                    // Min tex coord for normalization
     Vec2f diffs;                   // Tex coord diff for normalization
     bool isTextureSupplied = false;
@@ -31,6 +34,18 @@ struct SimpleMeshData {
 
 SimpleMeshData concatenate( SimpleMeshData, SimpleMeshData const& );
 
+// Merges bitwise-identical vertices and fills in the index buffer. Meshes
+// that are already indexed are returned unchanged.
+SimpleMeshData make_indexed( SimpleMeshData );
+
+// True if the triangle has (numerically) zero area, i.e., its area is
+// negligible relative to the square of its longest edge.
+bool is_degenerate_triangle( Vec3f, Vec3f, Vec3f );
+
+// Number of elements to draw: the index count for indexed meshes, otherwise
+// the vertex count.
+std::size_t draw_count( SimpleMeshData const& );
+
 
 GLuint create_vao( SimpleMeshData const& );
 
@@ -7,10 +7,9 @@
 #include "simple_mesh.hpp"
 
 #include <numbers>
-#include <iostream>
 
 
-SimpleMeshData create_spaceship(std::size_t aSubdivs, Vec3f aColorMainBody, Vec3f aColorWings, Mat44f aPreTransform, bool isTextureSupplied)
+SimpleMeshData create_spaceship(std::size_t aSubdivs, Vec3f aColorMainBody, Vec3f aColorWings, Mat44f aPreTransform, bool isTextureSupplied, Vec3f aColorNozzle)
 {
 	// Expecting 4 integral components.
 	// 1. Main body (cylinder)
@@ -74,7 +73,7 @@ SimpleMeshData create_spaceship(std::size_t aSubdivs, Vec3f aColorMainBody, Vec3
 		2.0f,   // vertical scaling (makes it more elongated)
 		0.6f,   // top cutoff (30% from top)
 		0.15f,   // bottom cutoff (20% from bottom)
-		Vec3f{ 0.8f, 0.8f, 0.8f },  // color (metallic gray)
+		aColorNozzle,  // color (metallic gray by default)
 		make_rotation_z(-90 * (std::numbers::pi_v<float> / 180.0)) * make_translation({ 0.f, -2.88f , 0.f }) * make_scaling(0.5f, 0.5f, 0.5f)
 	);
 
@@ -132,26 +131,6 @@ SimpleMeshData create_spaceship(std::size_t aSubdivs, Vec3f aColorMainBody, Vec3
         p = Vec3f{ t.x, t.y, t.z };
     }
 
-	// Initialize min and max values to extreme values
-	Vec3f minVals{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
-	Vec3f maxVals{ std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
-
-	// Initialize variables to store the positions corresponding to min and max values
-	Vec3f minPos, maxPos;
-
-	// DEBUGGER LOOP
-	for (auto& p : rocketData.positions)
-	{
-		// Update min and max values for each component, and store the corresponding position
-		if (p.x < minVals.x) { minVals.x = p.x; minPos = p; }
-		if (p.y < minVals.y) { minVals.y = p.y; minPos = p; }
-		if (p.z < minVals.z) { minVals.z = p.z; minPos = p; }
-
-		if (p.x > maxVals.x) { maxVals.x = p.x; maxPos = p; }
-		if (p.y > maxVals.y) { maxVals.y = p.y; maxPos = p; }
-		if (p.z > maxVals.z) { maxVals.z = p.z; maxPos = p; }
-	}
-
 	for (auto& n : rocketData.normals)
 	{
 		// Transform the normal using N (inverse transpose of the transformation matrix)
@@ -164,10 +143,6 @@ SimpleMeshData create_spaceship(std::size_t aSubdivs, Vec3f aColorMainBody, Vec3
 		n = transformedNormal;
 	}
 
-	// After the loop, minVals and maxVals contain the min and max values for x, y, and z
-	std::cout << "Min values: (" << minVals.x << ", " << minVals.y << ", " << minVals.z << ") at position (" << minPos.x << ", " << minPos.y << ", " << minPos.z << ")" << std::endl;
-	std::cout << "Max values: (" << maxVals.x << ", " << maxVals.y << ", " << maxVals.z << ") at position (" << maxPos.x << ", " << maxPos.y << ", " << maxPos.z << ")" << std::endl;
-
 	// Add point lights
 	rocketData.pointLightPos[0] = Vec3f{ 0.53f, 0.f, 0.53f };			// Going to side of craft
 	rocketData.pointLightPos[1] = mat44_to_mat33(make_rotation_x(std::numbers::pi_v<float>)) * rocketData.pointLightPos[0];			// Going to opposite side of craft
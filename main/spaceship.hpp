@@ -13,7 +13,7 @@
 
 SimpleMeshData create_spaceship(std::size_t aSubdivs = 32, Vec3f aColorMainBody = {1.f, 1.f, 1.f}, 
 	Vec3f aColorWings = { 0.f, 0.f, 0.f }, Mat44f aPreTransform = kIdentity44f,
-	bool isTextureSupplied = false
+	bool isTextureSupplied = false, Vec3f aColorNozzle = { 0.8f, 0.8f, 0.8f }
 );
 
 #endif // SPACESHIP_LOADER_HPP
\ No newline at end of file
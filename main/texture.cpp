@@ -6,6 +6,8 @@
 
 #include "../support/error.hpp"
 
+#include "gl_state.hpp"
+
 GLuint load_texture_2d(char const* aPath)
 {
 	assert(aPath);
@@ -23,7 +25,7 @@ GLuint load_texture_2d(char const* aPath)
 	// Generate texture object and initialize texture with image
 	GLuint tex = 0;
 	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
+	gl_state().bind_texture(GL_TEXTURE_2D, tex);
 
 	
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, ptr);
@@ -59,7 +61,7 @@ GLuint load_texture_2d_with_alpha(char const* aPath)
 	// Generate texture object and initialize texture with image
 	GLuint tex = 0;
 	glGenTextures(1, &tex);
-	glBindTexture(GL_TEXTURE_2D, tex);
+	gl_state().bind_texture(GL_TEXTURE_2D, tex);
 
 	// Load the texture with RGBA channels (which includes alpha)
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, ptr);
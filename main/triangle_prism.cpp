@@ -2,6 +2,8 @@
 
 #include "../vmlib/mat33.hpp"
 
+#include <algorithm>
+
 
 SimpleMeshData make_triangle_based_prism(
     bool centre_prism,
@@ -0,0 +1,91 @@
+#ifndef TRIPLE_BUFFER_HPP_0E5C7A1B_3F64_4D2E_9B8A_6C1D2E7F4A93
+#define TRIPLE_BUFFER_HPP_0E5C7A1B_3F64_4D2E_9B8A_6C1D2E7F4A93
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one producer thread to one consumer thread
+//
+// Three slots: the producer fills back() and publish()es it; the consumer
+// acquire()s the most recently published value and reads it through front()
+// until its next acquire(). A published value is immutable: neither side
+// writes a slot that the other may be reading. Values that are published
+// faster than they are consumed are dropped (latest wins).
+//
+// Neither side ever waits for the other. The consumer may wait() for a new
+// value when it has nothing else to do; the producer does not wait for it.
+//
+// Example:
+//    // Producer                      // Consumer
+//    fill( buffer.back() );           seen = buffer.wait( seen );
+//    buffer.publish();                buffer.acquire();
+//                                     use( buffer.front() );
+template< typename tValue >
+class TripleBuffer final
+{
+    public:
+        TripleBuffer() = default;
+
+        TripleBuffer( TripleBuffer const& ) = delete;
+        TripleBuffer& operator= ( TripleBuffer const& ) = delete;
+
+    public:
+        // Producer
+        tValue& back() noexcept
+        {
+            return mSlots[mBack];
+        }
+
+        void publish() noexcept
+        {
+            mBack = mMiddle.exchange( std::uint8_t(mBack | kFresh_), std::memory_order_acq_rel ) & kIndex_;
+
+            mPublished.fetch_add( 1, std::memory_order_release );
+            mPublished.notify_one();
+        }
+
+        // Consumer. Returns false (and keeps the current front()) if nothing
+        // was published since the last acquire().
+        bool acquire() noexcept
+        {
+            if( !(mMiddle.load( std::memory_order_relaxed ) & kFresh_) )
+                return false;
+
+            mFront = mMiddle.exchange( mFront, std::memory_order_acq_rel ) & kIndex_;
+            return true;
+        }
+
+        tValue const& front() const noexcept
+        {
+            return mSlots[mFront];
+        }
+
+        // Waits until the number of published values differs from aSeen;
+        // returns the new number
+        std::uint64_t wait( std::uint64_t aSeen ) const noexcept
+        {
+            mPublished.wait( aSeen, std::memory_order_acquire );
+            return mPublished.load( std::memory_order_acquire );
+        }
+
+        // Number of values published so far
+        std::uint64_t published() const noexcept
+        {
+            return mPublished.load( std::memory_order_acquire );
+        }
+
+    private:
+        static constexpr std::uint8_t kIndex_ = 0x3;
+        static constexpr std::uint8_t kFresh_ = 0x4;
+
+        std::array<tValue, 3> mSlots{};
+
+        std::uint8_t mBack = 0;                 // Producer only
+        std::atomic<std::uint8_t> mMiddle{ 1 }; // Index, and kFresh_ if unread
+        std::uint8_t mFront = 2;                // Consumer only
+
+        std::atomic<std::uint64_t> mPublished{ 0 };
+};
+
+#endif // TRIPLE_BUFFER_HPP_0E5C7A1B_3F64_4D2E_9B8A_6C1D2E7F4A93
@@ -128,6 +128,54 @@ project "vmlib-test"
 
 	links "x-catch2"
 
+project "main-test"
+	local sources = { 
+		"main-test/**.cpp",
+		"main-test/**.hpp",
+		"main-test/**.hxx",
+		"main-test/**.inl"
+	}
+
+	kind "ConsoleApp"
+	location "main-test"
+
+	files( sources )
+
+	-- CPU-side mesh code from main that is exercised by the tests
+	files {
+		"main/simple_mesh.cpp",
+		"main/mesh_codec.cpp",
+		"main/mesh_cache.cpp",
+		"main/mesh_cleanup.cpp",
+		"main/mesh_winding.cpp",
+		"main/render_queue.cpp",
+		"main/bounds.cpp",
+		"main/frustum_cull.cpp",
+		"main/aabb_tree.cpp",
+		"main/occlusion.cpp",
+		"main/multi_view.cpp",
+		"main/gl_state.cpp",
+		"main/indirect_batch.cpp",
+		"main/instance_manager.cpp",
+		"main/light_clusters.cpp",
+		"main/dynamic_resolution.cpp",
+		"main/fixed_timestep.cpp",
+		"main/run_options.cpp",
+		"main/input_log.cpp",
+		"main/loadobj.cpp",
+		"main/cylinder.cpp",
+		"main/cone.cpp",
+		"main/ovoid.cpp",
+		"main/triangle_prism.cpp",
+		"main/spaceship.cpp"
+	}
+
+	links "vmlib"
+	links "support"
+
+	links "x-glad"
+	links "x-catch2"
+
 project "support"
 	local sources = { 
 		"support/**.cpp",
@@ -0,0 +1,46 @@
+#ifndef HASH_HPP_BD818291_FAFE_4B2C_BE62_C5874F843D71
+#define HASH_HPP_BD818291_FAFE_4B2C_BE62_C5874F843D71
+
+#include <memory>
+#include <type_traits>
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a, 64 bit
+//
+// For hash table keys and cache keys; not for security. Input is fed one
+// byte at a time, as the algorithm specifies, so that every bit of wider
+// values is mixed. Hashes chain: pass the result of one call as aHash of
+// the next to hash several values.
+//
+// Example:
+//    std::uint64_t hash = fnv1a_values( kFnv1aBasis, key.x, key.y );
+//    hash = fnv1a( hash, key.name.data(), key.name.size() );
+constexpr std::uint64_t kFnv1aBasis = 0xcbf29ce484222325ull;
+constexpr std::uint64_t kFnv1aPrime = 0x100000001b3ull;
+
+inline
+std::uint64_t fnv1a( std::uint64_t aHash, void const* aData, std::size_t aSize ) noexcept
+{
+	auto const* bytes = static_cast<unsigned char const*>(aData);
+	for( std::size_t i = 0; i < aSize; ++i )
+	{
+		aHash ^= bytes[i];
+		aHash *= kFnv1aPrime;
+	}
+	return aHash;
+}
+
+// Hashes the bytes of each value. The values must not contain padding,
+// whose bytes are unspecified.
+template< typename... tValues >
+std::uint64_t fnv1a_values( std::uint64_t aHash, tValues const&... aValues ) noexcept
+{
+	static_assert( (std::is_trivially_copyable_v<tValues> && ...) );
+
+	((aHash = fnv1a( aHash, std::addressof(aValues), sizeof(tValues) )), ...);
+	return aHash;
+}
+
+#endif // HASH_HPP_BD818291_FAFE_4B2C_BE62_C5874F843D71
@@ -0,0 +1,260 @@
+#include "job_system.hpp"
+
+#include <cassert>
+
+namespace
+{
+	// The job system and queue of a worker thread
+	thread_local JobSystem const* tSystem_ = nullptr;
+	thread_local std::size_t tQueue_ = 0;
+
+	// Attempts to find work before an idle worker sleeps
+	constexpr int kIdleSpins_ = 64;
+}
+
+// Bounded deque behind a spin lock. Critical sections are a few loads and
+// stores, and each thread mostly uses its own deque; a mutex would cost more
+// than the jobs it protects.
+struct JobSystem::Queue_
+{
+	static constexpr std::size_t kCapacity = 4096; // Power of two
+
+	std::atomic_flag busy;
+	std::atomic<std::size_t> head{ 0 }, tail{ 0 }; // Jobs in [head,tail), modulo kCapacity
+	std::vector<Job_> jobs = std::vector<Job_>( kCapacity );
+
+	void lock() noexcept
+	{
+		while( busy.test_and_set( std::memory_order_acquire ) )
+		{
+			while( busy.test( std::memory_order_relaxed ) )
+				std::this_thread::yield();
+		}
+	}
+	void unlock() noexcept
+	{
+		busy.clear( std::memory_order_release );
+	}
+
+	bool empty() const noexcept
+	{
+		return head.load( std::memory_order_relaxed ) == tail.load( std::memory_order_relaxed );
+	}
+
+	bool push_back( Job_ const& aJob ) noexcept
+	{
+		lock();
+		std::size_t const t = tail.load( std::memory_order_relaxed );
+		bool const full = (t - head.load( std::memory_order_relaxed ) == kCapacity);
+		if( !full )
+		{
+			jobs[t & (kCapacity-1)] = aJob;
+			tail.store( t+1, std::memory_order_relaxed );
+		}
+		unlock();
+		return !full;
+	}
+
+	bool pop_back( Job_& aJob ) noexcept
+	{
+		if( empty() )
+			return false;
+
+		lock();
+		std::size_t const t = tail.load( std::memory_order_relaxed );
+		bool const found = (t != head.load( std::memory_order_relaxed ));
+		if( found )
+		{
+			aJob = jobs[(t-1) & (kCapacity-1)];
+			tail.store( t-1, std::memory_order_relaxed );
+		}
+		unlock();
+		return found;
+	}
+
+	bool steal_front( Job_& aJob ) noexcept
+	{
+		if( empty() )
+			return false;
+
+		lock();
+		std::size_t const h = head.load( std::memory_order_relaxed );
+		bool const found = (h != tail.load( std::memory_order_relaxed ));
+		if( found )
+		{
+			aJob = jobs[h & (kCapacity-1)];
+			head.store( h+1, std::memory_order_relaxed );
+		}
+		unlock();
+		return found;
+	}
+};
+
+
+bool JobCounter::done() const noexcept
+{
+	return 0 == mPending.load( std::memory_order_acquire );
+}
+
+
+JobSystem::JobSystem( std::size_t aThreads )
+{
+	std::size_t const threads = std::max<std::size_t>( 1, aThreads );
+
+	for( std::size_t i = 0; i < threads; ++i )
+		mQueues.emplace_back( std::make_unique<Queue_>() );
+
+	try
+	{
+		for( std::size_t i = 1; i < threads; ++i )
+			mWorkers.emplace_back( [this, i] { worker_( i ); } );
+	}
+	catch( ... )
+	{
+		mStop.store( true, std::memory_order_release );
+		wake_( mWorkers.size() + 1 );
+		for( auto& worker : mWorkers )
+			worker.join();
+		throw;
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	mStop.store( true, std::memory_order_release );
+	wake_( mWorkers.size() + 1 );
+
+	for( auto& worker : mWorkers )
+		worker.join();
+}
+
+void JobSystem::wait( JobCounter& aCounter )
+{
+	std::size_t const queue = queue_of_this_thread_();
+
+	Job_ job;
+	while( !aCounter.done() )
+	{
+		if( next_job_( queue, job ) )
+			execute_( job );
+		else
+			std::this_thread::yield();
+	}
+
+	if( aCounter.mFailed.load( std::memory_order_acquire ) )
+	{
+		auto const error = std::exchange( aCounter.mError, nullptr );
+		aCounter.mFailed.store( false, std::memory_order_relaxed );
+		std::rethrow_exception( error );
+	}
+}
+
+std::size_t JobSystem::thread_count() const noexcept
+{
+	return mQueues.size();
+}
+
+std::size_t JobSystem::default_thread_count() noexcept
+{
+	return std::max( 1u, std::thread::hardware_concurrency() );
+}
+
+void JobSystem::submit_( Job_ const& aJob )
+{
+	aJob.counter->mPending.fetch_add( 1, std::memory_order_relaxed );
+
+	// A full deque means there is plenty of work queued already
+	if( !mQueues[queue_of_this_thread_()]->push_back( aJob ) )
+		execute_( aJob );
+}
+
+void JobSystem::wake_( std::size_t aJobs ) noexcept
+{
+	if( mWorkers.empty() )
+		return;
+
+	mSignal.fetch_add( 1, std::memory_order_release );
+	if( 1 == aJobs )
+		mSignal.notify_one();
+	else
+		mSignal.notify_all();
+}
+
+bool JobSystem::next_job_( std::size_t aQueue, Job_& aJob ) noexcept
+{
+	// Own work first, newest first; then steal the oldest of another thread
+	if( mQueues[aQueue]->pop_back( aJob ) )
+		return true;
+
+	std::size_t const count = mQueues.size();
+	for( std::size_t i = 1; i < count; ++i )
+	{
+		if( mQueues[(aQueue + i) % count]->steal_front( aJob ) )
+			return true;
+	}
+
+	return false;
+}
+
+void JobSystem::execute_( Job_ const& aJob ) noexcept
+{
+	JobCounter& counter = *aJob.counter;
+
+	try
+	{
+		aJob.invoke( aJob.data, aJob.begin, aJob.end );
+	}
+	catch( ... )
+	{
+		if( !counter.mFailed.exchange( true, std::memory_order_acq_rel ) )
+			counter.mError = std::current_exception();
+	}
+
+	// Last: the counter may be destroyed as soon as it reaches zero
+	counter.mPending.fetch_sub( 1, std::memory_order_release );
+}
+
+void JobSystem::worker_( std::size_t aQueue )
+{
+	tSystem_ = this;
+	tQueue_ = aQueue;
+
+	Job_ job;
+	while( !mStop.load( std::memory_order_acquire ) )
+	{
+		if( next_job_( aQueue, job ) )
+		{
+			execute_( job );
+			continue;
+		}
+
+		// Jobs pushed after this load change the signal, so the wait below
+		// cannot miss them
+		auto const signal = mSignal.load( std::memory_order_acquire );
+
+		bool found = false;
+		for( int i = 0; i < kIdleSpins_ && !found; ++i )
+		{
+			found = next_job_( aQueue, job );
+			if( !found )
+				std::this_thread::yield();
+		}
+
+		if( found )
+			execute_( job );
+		else if( !mStop.load( std::memory_order_acquire ) )
+			mSignal.wait( signal, std::memory_order_acquire );
+	}
+}
+
+std::size_t JobSystem::queue_of_this_thread_() const noexcept
+{
+	return this == tSystem_ ? tQueue_ : 0;
+}
+
+
+JobSystem& job_system()
+{
+	static JobSystem system;
+	return system;
+}
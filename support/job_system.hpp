@@ -0,0 +1,174 @@
+#ifndef JOB_SYSTEM_HPP_5B2F8E41_7C0D_4A39_A6E2_93D14F0B7C58
+#define JOB_SYSTEM_HPP_5B2F8E41_7C0D_4A39_A6E2_93D14F0B7C58
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <exception>
+#include <type_traits>
+
+#include <cstddef>
+#include <cstdint>
+
+// Counts the jobs of a group that have not finished yet
+//
+// Jobs are added to a counter when they are submitted and removed when they
+// finish. Waiting for a counter (JobSystem::wait()) is how a job depends on
+// others: a job may itself wait for a counter, and runs other jobs meanwhile.
+// The first exception thrown by a job of the group is rethrown by wait().
+class JobCounter final
+{
+	public:
+		JobCounter() = default;
+
+		JobCounter( JobCounter const& ) = delete;
+		JobCounter& operator= (JobCounter const&) = delete;
+
+	public:
+		bool done() const noexcept;
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<std::size_t> mPending{ 0 };
+
+		std::atomic<bool> mFailed{ false };
+		std::exception_ptr mError;
+};
+
+// Work-stealing job system
+//
+// One worker thread per core (less the thread that submits work). Each
+// thread has its own deque of jobs: it pushes and pops at the back (most
+// recent first, while the data is in its caches), and idle threads steal
+// from the front of the others' deques. Threads that wait for a counter run
+// jobs instead of blocking, so the submitting thread works too.
+//
+// A job is a function pointer and a range; submitting one allocates nothing
+// (run() allocates its task object). parallel_for() submits one job per
+// chunk of its range, so that tiny iterations are grouped. Idle workers
+// sleep until new jobs are pushed.
+//
+// Example:
+//    job_system().parallel_for( 0, particles.size(), 1024, [&] ( std::size_t aBegin, std::size_t aEnd ) {
+//        for( std::size_t i = aBegin; i < aEnd; ++i )
+//            integrate( particles[i] );
+//    } );
+class JobSystem final
+{
+	public:
+		// aThreads: number of threads that run jobs, including the thread
+		// that waits for them; 1 runs every job on the submitting thread.
+		explicit JobSystem( std::size_t aThreads = default_thread_count() );
+		~JobSystem();
+
+		JobSystem( JobSystem const& ) = delete;
+		JobSystem& operator= (JobSystem const&) = delete;
+
+	public:
+		// Runs aTask() on some thread; aCounter counts it until it returns
+		template< typename tTask >
+		void run( JobCounter& aCounter, tTask&& aTask );
+
+		// Returns once aCounter is zero, running jobs meanwhile. Rethrows the
+		// first exception of the counted jobs.
+		void wait( JobCounter& aCounter );
+
+		// Runs aBody( begin, end ) for chunks of [aBegin,aEnd) of at most
+		// aGrain elements (0: a few chunks per thread) and waits for all of
+		// them
+		template< typename tBody >
+		void parallel_for( std::size_t aBegin, std::size_t aEnd, std::size_t aGrain, tBody&& aBody );
+
+		std::size_t thread_count() const noexcept;
+
+		// Hardware threads, at least 1
+		static std::size_t default_thread_count() noexcept;
+
+	private:
+		struct Job_
+		{
+			void (*invoke)( void*, std::size_t, std::size_t );
+			void* data;
+			std::size_t begin, end;
+			JobCounter* counter;
+		};
+
+		struct Queue_;
+
+		void submit_( Job_ const& );
+		void wake_( std::size_t aJobs ) noexcept;
+
+		bool next_job_( std::size_t aQueue, Job_& ) noexcept;
+		void execute_( Job_ const& ) noexcept;
+
+		void worker_( std::size_t aQueue );
+		std::size_t queue_of_this_thread_() const noexcept;
+
+		std::vector<std::unique_ptr<Queue_>> mQueues; // [0]: threads other than the workers
+		std::vector<std::thread> mWorkers;
+
+		std::atomic<std::uint32_t> mSignal{ 0 };     // Changes when jobs are pushed
+		std::atomic<bool> mStop{ false };
+};
+
+// The shared job system (default thread count), created on first use
+JobSystem& job_system();
+
+
+template< typename tTask >
+void JobSystem::run( JobCounter& aCounter, tTask&& aTask )
+{
+	using Task_ = std::decay_t<tTask>;
+
+	auto task = std::make_unique<Task_>( std::forward<tTask>(aTask) );
+
+	submit_( Job_{
+		[] ( void* aData, std::size_t, std::size_t ) {
+			std::unique_ptr<Task_> const self( static_cast<Task_*>(aData) );
+			(*self)();
+		},
+		task.get(), 0, 1, &aCounter
+	} );
+
+	task.release();
+	wake_( 1 );
+}
+
+template< typename tBody >
+void JobSystem::parallel_for( std::size_t aBegin, std::size_t aEnd, std::size_t aGrain, tBody&& aBody )
+{
+	if( aEnd <= aBegin )
+		return;
+
+	std::size_t const count = aEnd - aBegin;
+	std::size_t const grain = aGrain ? aGrain : std::max<std::size_t>( 1, count / (4*thread_count()) );
+
+	if( count <= grain || 1 == thread_count() )
+	{
+		aBody( aBegin, aEnd );
+		return;
+	}
+
+	using Body_ = std::remove_reference_t<tBody>;
+	auto const invoke = [] ( void* aData, std::size_t aChunkBegin, std::size_t aChunkEnd ) {
+		(*static_cast<Body_*>(aData))( aChunkBegin, aChunkEnd );
+	};
+
+	// The body outlives the jobs: this function waits for them
+	JobCounter counter;
+	std::size_t jobs = 0;
+	for( std::size_t begin = aBegin; begin < aEnd; begin += grain, ++jobs )
+	{
+		std::size_t const end = std::min( aEnd, begin + grain );
+		submit_( Job_{ invoke, const_cast<void*>(static_cast<void const*>(std::addressof(aBody))), begin, end, &counter } );
+	}
+
+	wake_( jobs );
+	wait( counter );
+}
+
+#endif // JOB_SYSTEM_HPP_5B2F8E41_7C0D_4A39_A6E2_93D14F0B7C58
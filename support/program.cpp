@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <utility>
+#include <algorithm>
 
 #include <cstdio>
 
@@ -12,10 +13,16 @@
 
 namespace
 {
-	GLuint load_shader_( 
-		GLenum aShaderType, 
+	std::string read_source_( 
 		char const* aSourcePath
 	);
+	GLuint compile_shader_( 
+		GLenum aShaderType, 
+		char const* aSourcePath,
+		std::string const& aSource
+	);
+
+	bool link_status_( GLuint aProgram );
 
 	// lightweight std::experimental::scope_exit alternative
 	// Not the most complete or convenient implementation...
@@ -37,8 +44,15 @@ namespace
 }
 
 ShaderProgram::ShaderProgram( std::vector<ShaderSource> aShaderSources )
+	: ShaderProgram( std::move(aShaderSources), {}, nullptr )
+{}
+
+ShaderProgram::ShaderProgram( std::vector<ShaderSource> aShaderSources, ShaderDefines aDefines, ProgramBinaryCache* aCache )
 	: mProgram( 0 )
 	, mSources( std::move(aShaderSources) )
+	, mDefines( std::move(aDefines) )
+	, mCache( aCache )
+	, mFromCache( false )
 {
 	reload();
 }
@@ -52,11 +66,17 @@ ShaderProgram::~ShaderProgram()
 ShaderProgram::ShaderProgram( ShaderProgram&& aOther ) noexcept
 	: mProgram( std::exchange( aOther.mProgram, 0 ) )
 	, mSources( std::move(aOther.mSources) )
+	, mDefines( std::move(aOther.mDefines) )
+	, mCache( aOther.mCache )
+	, mFromCache( aOther.mFromCache )
 {}
 ShaderProgram& ShaderProgram::operator= (ShaderProgram&& aOther) noexcept
 {
 	std::swap( mProgram, aOther.mProgram );
 	std::swap( mSources, aOther.mSources );
+	std::swap( mDefines, aOther.mDefines );
+	std::swap( mCache, aOther.mCache );
+	std::swap( mFromCache, aOther.mFromCache );
 	return *this;
 }
 
@@ -65,8 +85,57 @@ GLuint ShaderProgram::programId() const noexcept
 	return mProgram;
 }
 
+bool ShaderProgram::fromCache() const noexcept
+{
+	return mFromCache;
+}
+
+std::vector<ShaderProgram::ShaderSource> const& ShaderProgram::sources() const noexcept
+{
+	return mSources;
+}
+ShaderDefines const& ShaderProgram::defines() const noexcept
+{
+	return mDefines;
+}
+
 void ShaderProgram::reload()
 {
+	// Read the sources first; they are part of the cache key
+	std::vector<ProgramBinaryCache::Stage> stages;
+	stages.reserve( mSources.size() );
+
+	for( auto const& source : mSources )
+		stages.emplace_back( ProgramBinaryCache::Stage{ source.type, inject_defines( read_source_( source.sourcePath.c_str() ), mDefines ) } );
+
+	std::uint64_t const key = mCache ? mCache->key( stages ) : 0;
+
+	if( mCache )
+	{
+		if( auto const binary = mCache->load( key ) )
+		{
+			OGL_CHECKPOINT_ALWAYS();
+
+			GLuint prog = glCreateProgram();
+			glProgramBinary( prog, binary->format, binary->data.data(), GLsizei(binary->data.size()) );
+
+			// A driver may reject binaries at any time (e.g., after an
+			// update that did not change its version string).
+			if( link_status_( prog ) )
+			{
+				std::swap( mProgram, prog );
+				if( 0 != prog )
+					glDeleteProgram( prog );
+
+				mFromCache = true;
+				return;
+			}
+
+			glDeleteProgram( prog );
+			mCache->reject( key );
+		}
+	}
+
 	// Space to hold the shaders when we load them
 	std::vector<GLuint> shaders;
 	shaders.reserve( mSources.size() );
@@ -78,9 +147,9 @@ void ShaderProgram::reload()
 			glDeleteShader( shader );
 	} );
 
-	// Load shaders
-	for( auto const& source : mSources )
-		shaders.emplace_back( load_shader_( source.type, source.sourcePath.c_str() ) );
+	// Compile shaders
+	for( std::size_t i = 0; i < mSources.size(); ++i )
+		shaders.emplace_back( compile_shader_( stages[i].type, mSources[i].sourcePath.c_str(), stages[i].text ) );
 
 	// Create program object
 	OGL_CHECKPOINT_ALWAYS();
@@ -106,6 +175,9 @@ void ShaderProgram::reload()
 	for( auto const shader : shaders )
 		glAttachShader( prog, shader );
 
+	if( mCache )
+		glProgramParameteri( prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
 	glLinkProgram( prog );
 
 	{
@@ -131,18 +203,86 @@ void ShaderProgram::reload()
 			std::fprintf( stderr, "Note: shader program linking log:\n%s\n", log.data() );
 	}
 	
+	// Store the linked program for the next run. Drivers without binary
+	// formats report a length of zero.
+	if( mCache )
+	{
+		GLint length = 0;
+		glGetProgramiv( prog, GL_PROGRAM_BINARY_LENGTH, &length );
+
+		if( length > 0 )
+		{
+			ProgramBinary binary;
+			binary.data.resize( std::size_t(length) );
+
+			GLsizei written = 0;
+			glGetProgramBinary( prog, length, &written, &binary.format, binary.data.data() );
+			binary.data.resize( std::size_t(written) );
+
+			if( written > 0 )
+				mCache->store( key, binary );
+		}
+	}
+	
 	OGL_CHECKPOINT_ALWAYS();
 
 	// Replace the old shader program (if any) with the new one
 	std::swap( mProgram, prog );
+	mFromCache = false;
+}
+
+ShaderPermutations::ShaderPermutations( std::vector<ShaderProgram::ShaderSource> aShaderSources, ProgramBinaryCache* aCache )
+	: mSources( std::move(aShaderSources) )
+	, mCache( aCache )
+{}
+
+ShaderProgram& ShaderPermutations::get( ShaderDefines aDefines )
+{
+	std::sort( aDefines.begin(), aDefines.end() );
+
+	auto it = mVariants.find( aDefines );
+	if( mVariants.end() == it )
+	{
+		ShaderProgram program( mSources, aDefines, mCache );
+		it = mVariants.emplace( std::move(aDefines), std::move(program) ).first;
+	}
+
+	return it->second;
+}
+
+void ShaderPermutations::reload()
+{
+	for( auto& variant : mVariants )
+		variant.second.reload();
+}
+
+std::size_t ShaderPermutations::size() const noexcept
+{
+	return mVariants.size();
+}
+
+std::vector<ShaderDefines> ShaderPermutations::variants() const
+{
+	std::vector<ShaderDefines> ret;
+	ret.reserve( mVariants.size() );
+
+	for( auto const& variant : mVariants )
+		ret.emplace_back( variant.first );
+
+	return ret;
+}
+
+std::vector<ShaderProgram::ShaderSource> const& ShaderPermutations::sources() const noexcept
+{
+	return mSources;
 }
 
 namespace
 {
-	GLuint load_shader_( GLenum aShaderType, char const* aSourcePath )
+	std::string read_source_( char const* aSourcePath )
 	{
 		// Load the shader source code from file
-		std::vector<GLchar> source;
+		std::string source;
 
 		if( std::FILE* fin = std::fopen( aSourcePath, "rb" ) )
 		{
@@ -162,9 +302,9 @@ namespace
 				if( 0 == ret )
 				{
 					if( auto const err = std::ferror( fin ) )
-						throw Error( "load_shader_(): error while reading from '%s': %d (%zu bytes read, %zu total)", aSourcePath, err, read, length );
+						throw Error( "read_source_(): error while reading from '%s': %d (%zu bytes read, %zu total)", aSourcePath, err, read, length );
 					if( std::feof( fin ) )
-						throw Error( "load_shader_(): unexpected EOF in '%s' (%zu bytes read, %zu total)", aSourcePath, read, length );
+						throw Error( "read_source_(): unexpected EOF in '%s' (%zu bytes read, %zu total)", aSourcePath, read, length );
 				}
 			
 				read += ret;
@@ -172,9 +312,14 @@ namespace
 		}
 		else
 		{
-			throw Error( "load_shader_(): unable to open input file '%s'", aSourcePath );
+			throw Error( "read_source_(): unable to open input file '%s'", aSourcePath );
 		}
 
+		return source;
+	}
+
+	GLuint compile_shader_( GLenum aShaderType, char const* aSourcePath, std::string const& aSource )
+	{
 		// Create shader object
 		OGL_CHECKPOINT_ALWAYS();
 
@@ -182,10 +327,10 @@ namespace
 
 		// Compile shader
 		GLchar const* sources[] = {
-			source.data()
+			aSource.data()
 		};
 		GLsizei lengths[] = {
-			GLsizei(source.size())
+			GLsizei(aSource.size())
 		};
 
 		glShaderSource( shader, sizeof(sources)/sizeof(sources[0]), sources, lengths );
@@ -237,4 +382,11 @@ namespace
 
 		return shader;
 	}
+
+	bool link_status_( GLuint aProgram )
+	{
+		GLint status = 0;
+		glGetProgramiv( aProgram, GL_LINK_STATUS, &status );
+		return GL_TRUE == status;
+	}
 }
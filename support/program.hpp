@@ -3,12 +3,15 @@
 
 #include <glad/glad.h>
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include <cstdint>
 #include <cstdlib>
 
+#include "program_cache.hpp"
+
 class ShaderProgram final
 {
 	public:
@@ -23,6 +26,14 @@ class ShaderProgram final
 			std::vector<ShaderSource> = {}
 		);
 
+		// Compiles the variant selected by the definitions. With a cache,
+		// the linked program is loaded from (or stored to) the cache.
+		ShaderProgram(
+			std::vector<ShaderSource>,
+			ShaderDefines,
+			ProgramBinaryCache* = nullptr
+		);
+
 		~ShaderProgram();
 
 		ShaderProgram( ShaderProgram const& ) = delete;
@@ -36,9 +47,55 @@ class ShaderProgram final
 
 		void reload();
 
+		// Whether the last reload() used a cached binary
+		bool fromCache() const noexcept;
+
+		std::vector<ShaderSource> const& sources() const noexcept;
+		ShaderDefines const& defines() const noexcept;
+
 	private:
 		GLuint mProgram;
 		std::vector<ShaderSource> mSources;
+
+		ShaderDefines mDefines;
+		ProgramBinaryCache* mCache;
+		bool mFromCache;
+};
+
+// Variants of a shader program, compiled on first use
+//
+// Variants differ in their preprocessor definitions only (see ShaderDefines).
+// The order of the definitions does not matter. Only the variants that are
+// requested with get() are ever compiled.
+class ShaderPermutations final
+{
+	public:
+		explicit ShaderPermutations(
+			std::vector<ShaderProgram::ShaderSource>,
+			ProgramBinaryCache* = nullptr
+		);
+
+		ShaderPermutations( ShaderPermutations const& ) = delete;
+		ShaderPermutations& operator= (ShaderPermutations const&) = delete;
+
+	public:
+		ShaderProgram& get( ShaderDefines );
+
+		// Reloads all compiled variants
+		void reload();
+
+		std::size_t size() const noexcept;
+
+		// Definitions of the compiled variants (sorted)
+		std::vector<ShaderDefines> variants() const;
+
+		std::vector<ShaderProgram::ShaderSource> const& sources() const noexcept;
+
+	private:
+		std::vector<ShaderProgram::ShaderSource> mSources;
+		ProgramBinaryCache* mCache;
+
+		std::map<ShaderDefines, ShaderProgram> mVariants;
 };
 
 #endif // PROGRAM_HPP_39793FD2_7845_47A7_9E21_6DDAD42C9A09
@@ -0,0 +1,215 @@
+#include "program_cache.hpp"
+
+#include <utility>
+#include <system_error>
+
+#include <cstdio>
+#include <cstring>
+
+#include "hash.hpp"
+
+namespace
+{
+	constexpr char kMagic_[8] = { 'P', 'R', 'O', 'G', 'B', 'I', 'N', '\0' };
+	constexpr std::uint32_t kVersion_ = 1;
+
+	struct EntryHeader_
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t format;
+		std::uint64_t key;
+		std::uint64_t size;
+	};
+
+	static_assert( sizeof(EntryHeader_) == 32 );
+
+	// Includes the length, so that ("ab","c") and ("a","bc") differ
+	std::uint64_t hash_string_( std::uint64_t aHash, std::string const& aString ) noexcept
+	{
+		aHash = fnv1a_values( aHash, std::uint64_t(aString.size()) );
+		return fnv1a( aHash, aString.data(), aString.size() );
+	}
+
+	std::string gl_string_( GLenum aName )
+	{
+		auto const* str = reinterpret_cast<char const*>(glGetString( aName ));
+		return str ? str : "";
+	}
+}
+
+std::string inject_defines( std::string const& aSource, ShaderDefines const& aDefines )
+{
+	if( aDefines.empty() )
+		return aSource;
+
+	// Find the line after "#version", which must stay first
+	std::size_t insert = 0;
+	std::size_t line = 1;
+
+	std::size_t const version = aSource.find( "#version" );
+	if( std::string::npos != version )
+	{
+		std::size_t const eol = aSource.find( '\n', version );
+		insert = std::string::npos == eol ? aSource.size() : eol+1;
+
+		for( std::size_t i = 0; i < insert; ++i )
+		{
+			if( '\n' == aSource[i] )
+				++line;
+		}
+	}
+
+	std::string defines;
+	if( insert == aSource.size() && insert > 0 && '\n' != aSource.back() )
+		defines += '\n';
+
+	for( auto const& define : aDefines )
+		defines += "#define " + define + "\n";
+	defines += "#line " + std::to_string( line ) + "\n";
+
+	std::string ret = aSource;
+	ret.insert( insert, defines );
+	return ret;
+}
+
+std::string gl_driver_string()
+{
+	return gl_string_( GL_VENDOR ) + "|" + gl_string_( GL_RENDERER ) + "|"
+		+ gl_string_( GL_VERSION ) + "|" + gl_string_( GL_SHADING_LANGUAGE_VERSION );
+}
+
+ProgramBinaryCache::ProgramBinaryCache( std::filesystem::path aDirectory, std::string aDriver )
+	: mDirectory( std::move(aDirectory) )
+	, mDriver( std::move(aDriver) )
+{
+	std::error_code ec;
+	std::filesystem::create_directories( mDirectory, ec );
+	if( ec )
+		std::fprintf( stderr, "Note: unable to create shader cache '%s': %s\n", mDirectory.string().c_str(), ec.message().c_str() );
+}
+
+std::uint64_t ProgramBinaryCache::key( std::vector<Stage> const& aStages ) const
+{
+	std::uint64_t hash = hash_string_( kFnv1aBasis, mDriver );
+	for( auto const& stage : aStages )
+	{
+		std::uint32_t const type = stage.type;
+		hash = fnv1a_values( hash, type );
+		hash = hash_string_( hash, stage.text );
+	}
+	return hash;
+}
+
+std::optional<ProgramBinary> ProgramBinaryCache::load( std::uint64_t aKey )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	std::optional<ProgramBinary> ret;
+
+	auto const path = entry_path_( aKey );
+	if( std::FILE* fin = std::fopen( path.string().c_str(), "rb" ) )
+	{
+		// The size in the header is only trusted if it matches the file;
+		// a truncated or damaged entry must not trigger a huge allocation.
+		std::error_code ec;
+		std::uintmax_t const fileSize = std::filesystem::file_size( path, ec );
+
+		EntryHeader_ header{};
+		bool const valid = !ec
+			&& 1 == std::fread( &header, sizeof(header), 1, fin )
+			&& 0 == std::memcmp( header.magic, kMagic_, sizeof(kMagic_) )
+			&& kVersion_ == header.version
+			&& aKey == header.key
+			&& fileSize - sizeof(header) == header.size;
+
+		if( valid )
+		{
+			ProgramBinary binary;
+			binary.format = GLenum(header.format);
+			binary.data.resize( std::size_t(header.size) );
+
+			if( binary.data.size() == std::fread( binary.data.data(), 1, binary.data.size(), fin ) )
+				ret = std::move(binary);
+		}
+
+		std::fclose( fin );
+
+		// Damaged entries are dropped, as if rejected (see reject())
+		if( !ret )
+			std::filesystem::remove( path, ec );
+	}
+
+	++(ret ? mHits : mMisses);
+	return ret;
+}
+
+void ProgramBinaryCache::store( std::uint64_t aKey, ProgramBinary const& aBinary )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	auto const path = entry_path_( aKey );
+	auto temp = path;
+	temp += ".tmp";
+
+	bool written = false;
+	if( std::FILE* fout = std::fopen( temp.string().c_str(), "wb" ) )
+	{
+		EntryHeader_ header{};
+		std::memcpy( header.magic, kMagic_, sizeof(kMagic_) );
+		header.version = kVersion_;
+		header.format = std::uint32_t(aBinary.format);
+		header.key = aKey;
+		header.size = aBinary.data.size();
+
+		written = 1 == std::fwrite( &header, sizeof(header), 1, fout )
+			&& aBinary.data.size() == std::fwrite( aBinary.data.data(), 1, aBinary.data.size(), fout );
+
+		written = 0 == std::fclose( fout ) && written;
+	}
+
+	std::error_code ec;
+	if( written )
+		std::filesystem::rename( temp, path, ec );
+
+	if( !written || ec )
+	{
+		std::fprintf( stderr, "Note: unable to write shader cache entry '%s'\n", path.string().c_str() );
+		std::filesystem::remove( temp, ec );
+	}
+}
+
+void ProgramBinaryCache::reject( std::uint64_t aKey )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	std::error_code ec;
+	std::filesystem::remove( entry_path_( aKey ), ec );
+
+	if( mHits )
+		--mHits;
+	++mMisses;
+}
+
+std::filesystem::path const& ProgramBinaryCache::directory() const noexcept
+{
+	return mDirectory;
+}
+
+std::size_t ProgramBinaryCache::hits() const noexcept
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mHits;
+}
+std::size_t ProgramBinaryCache::misses() const noexcept
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	return mMisses;
+}
+
+std::filesystem::path ProgramBinaryCache::entry_path_( std::uint64_t aKey ) const
+{
+	char name[32];
+	std::snprintf( name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(aKey) );
+	return mDirectory / name;
+}
@@ -0,0 +1,88 @@
+#ifndef PROGRAM_CACHE_HPP_1134F0CB_9DF4_4E76_AE19_034AC005FFF0
+#define PROGRAM_CACHE_HPP_1134F0CB_9DF4_4E76_AE19_034AC005FFF0
+
+#include <glad/glad.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+#include <cstddef>
+#include <cstdint>
+
+// Preprocessor definitions for one variant of a shader program. Each entry is
+// either "NAME" or "NAME VALUE" and becomes a "#define" line.
+using ShaderDefines = std::vector<std::string>;
+
+// Inserts the definitions after the "#version" line of a GLSL source (or at
+// the very start, if there is none). A "#line" directive follows them, so
+// that compile errors still refer to the lines of the file on disk.
+std::string inject_defines( std::string const& aSource, ShaderDefines const& );
+
+// Identifies the driver (vendor, renderer, GL and GLSL versions) of the
+// current context. Requires a current context.
+std::string gl_driver_string();
+
+struct ProgramBinary
+{
+	GLenum format = 0;
+	std::vector<std::uint8_t> data;
+};
+
+// On-disk cache of linked program binaries (glGetProgramBinary)
+//
+// Entries are keyed by a 64 bit hash of the driver string and of the type and
+// full text of each shader stage, after the definitions were injected; a
+// changed source file, a different variant, or a driver update hence all miss
+// the cache. Each entry is a single file named after its key. Entries are
+// written to a temporary file first and then renamed, so that an interrupted
+// run never leaves a truncated entry behind.
+//
+// The cache may be used from several threads (e.g., by a background
+// compiler, see ShaderReloader).
+//
+// The cache is an optimization only: I/O errors are reported as notes, and
+// the driver may still reject a binary (glProgramBinary), in which case the
+// caller compiles from source and stores the result again.
+class ProgramBinaryCache final
+{
+	public:
+		struct Stage
+		{
+			GLenum type;
+			std::string text;
+		};
+
+	public:
+		ProgramBinaryCache( std::filesystem::path aDirectory, std::string aDriver );
+
+		ProgramBinaryCache( ProgramBinaryCache const& ) = delete;
+		ProgramBinaryCache& operator= (ProgramBinaryCache const&) = delete;
+
+	public:
+		std::uint64_t key( std::vector<Stage> const& ) const;
+
+		std::optional<ProgramBinary> load( std::uint64_t aKey );
+		void store( std::uint64_t aKey, ProgramBinary const& );
+
+		// A loaded binary that the driver did not accept
+		void reject( std::uint64_t aKey );
+
+		std::filesystem::path const& directory() const noexcept;
+
+		std::size_t hits() const noexcept;
+		std::size_t misses() const noexcept;
+
+	private:
+		std::filesystem::path entry_path_( std::uint64_t aKey ) const;
+
+		std::filesystem::path mDirectory;
+		std::string mDriver;
+
+		mutable std::mutex mMutex;  // Entry files and counters
+		std::size_t mHits = 0, mMisses = 0;
+};
+
+#endif // PROGRAM_CACHE_HPP_1134F0CB_9DF4_4E76_AE19_034AC005FFF0